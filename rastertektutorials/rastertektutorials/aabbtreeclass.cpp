@@ -0,0 +1,993 @@
+#include "aabbtreeclass.h"
+
+#include <algorithm>
+#include <float.h>
+
+// Half the surface area, the constant factor doesn't matter for SAH comparisons
+static float HalfArea(const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	const float dx = max.x - min.x;
+	const float dy = max.y - min.y;
+	const float dz = max.z - min.z;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static void Union(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB, XMFLOAT3& min, XMFLOAT3& max)
+{
+	min = XMFLOAT3(minA.x < minB.x ? minA.x : minB.x, minA.y < minB.y ? minA.y : minB.y, minA.z < minB.z ? minA.z : minB.z);
+	max = XMFLOAT3(maxA.x > maxB.x ? maxA.x : maxB.x, maxA.y > maxB.y ? maxA.y : maxB.y, maxA.z > maxB.z ? maxA.z : maxB.z);
+}
+
+static bool Overlaps(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB)
+{
+	return minA.x <= maxB.x && maxA.x >= minB.x &&
+		minA.y <= maxB.y && maxA.y >= minB.y &&
+		minA.z <= maxB.z && maxA.z >= minB.z;
+}
+
+static bool Contains(const AabbType& outer, const AabbType& inner)
+{
+	return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+		outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static float Component(const XMFLOAT3& v, int axis)
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// Slab test, returns the entry distance or FLT_MAX on a miss
+static float RayBox(const XMFLOAT3& origin, const XMFLOAT3& invDirection, float maxDistance, const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	float t1 = (min.x - origin.x) * invDirection.x;
+	float t2 = (max.x - origin.x) * invDirection.x;
+	float tmin = t1 < t2 ? t1 : t2;
+	float tmax = t1 > t2 ? t1 : t2;
+
+	t1 = (min.y - origin.y) * invDirection.y;
+	t2 = (max.y - origin.y) * invDirection.y;
+	tmin = std::max(tmin, t1 < t2 ? t1 : t2);
+	tmax = std::min(tmax, t1 > t2 ? t1 : t2);
+
+	t1 = (min.z - origin.z) * invDirection.z;
+	t2 = (max.z - origin.z) * invDirection.z;
+	tmin = std::max(tmin, t1 < t2 ? t1 : t2);
+	tmax = std::min(tmax, t1 > t2 ? t1 : t2);
+
+	if (tmax < 0.0f || tmin > tmax || tmin > maxDistance)
+		return FLT_MAX;
+
+	return tmin > 0.0f ? tmin : 0.0f;
+}
+
+AabbTreeClass::AabbTreeClass() :
+	m_Jobs(nullptr),
+	m_root(-1),
+	m_proxyCount(0),
+	m_refitCount(0),
+	m_rebuildCount(0),
+	m_buildRoot(-1),
+	m_buildDone(false),
+	m_building(false)
+{
+}
+
+AabbTreeClass::AabbTreeClass(const AabbTreeClass&)
+{
+}
+
+AabbTreeClass::~AabbTreeClass()
+{
+}
+
+bool AabbTreeClass::Initialize(JobSystemClass* jobs)
+{
+	m_Jobs = jobs;
+	m_root = -1;
+	m_proxyCount = 0;
+	m_refitCount = 0;
+	m_rebuildCount = 0;
+	m_building = false;
+	return true;
+}
+
+void AabbTreeClass::Shutdown()
+{
+	// The rebuild job points at us, let it finish first
+	if (m_building && m_Jobs)
+		m_Jobs->Wait(&m_buildCounter);
+
+	m_building = false;
+	m_nodes.clear();
+	m_parents.clear();
+	m_freeNodes.clear();
+	m_proxies.clear();
+	m_freeProxies.clear();
+	m_buildItems.clear();
+	m_buildNodes.clear();
+	m_buildTasks.clear();
+	m_dirtyProxies.clear();
+	m_root = -1;
+	m_proxyCount = 0;
+}
+
+int AabbTreeClass::CreateProxy(const AabbType& box, unsigned int userData)
+{
+	int proxyId;
+	if (m_freeProxies.empty() == false)
+	{
+		proxyId = m_freeProxies.back();
+		m_freeProxies.pop_back();
+	}
+	else
+	{
+		proxyId = (int)m_proxies.size();
+		m_proxies.push_back(ProxyType());
+		m_proxies[proxyId].dirty = false;
+	}
+
+	ProxyType& proxy = m_proxies[proxyId];
+	proxy.box = box;
+	proxy.fatBox.min = XMFLOAT3(box.min.x - AABB_TREE_MARGIN, box.min.y - AABB_TREE_MARGIN, box.min.z - AABB_TREE_MARGIN);
+	proxy.fatBox.max = XMFLOAT3(box.max.x + AABB_TREE_MARGIN, box.max.y + AABB_TREE_MARGIN, box.max.z + AABB_TREE_MARGIN);
+	proxy.userData = userData;
+	proxy.alive = true;
+
+	const int leaf = AllocateNode();
+	m_nodes[leaf].min = proxy.fatBox.min;
+	m_nodes[leaf].max = proxy.fatBox.max;
+	m_nodes[leaf].child1 = -1;
+	m_nodes[leaf].child2 = proxyId;
+	m_proxies[proxyId].node = leaf;
+	InsertLeaf(leaf);
+
+	++m_proxyCount;
+	MarkDirty(proxyId);
+	return proxyId;
+}
+
+void AabbTreeClass::DestroyProxy(int proxyId)
+{
+	ProxyType& proxy = m_proxies[proxyId];
+	if (proxy.alive == false)
+		return;
+
+	RemoveLeaf(proxy.node);
+	FreeNode(proxy.node);
+	proxy.node = -1;
+	proxy.alive = false;
+	m_freeProxies.push_back(proxyId);
+
+	--m_proxyCount;
+	MarkDirty(proxyId);
+}
+
+bool AabbTreeClass::MoveProxy(int proxyId, const AabbType& box)
+{
+	ProxyType& proxy = m_proxies[proxyId];
+	if (proxy.alive == false)
+		return false;
+
+	proxy.box = box;
+
+	// Still inside the fat box, nothing in the tree needs to change
+	if (Contains(proxy.fatBox, box))
+		return false;
+
+	AabbType fatBox;
+	fatBox.min = XMFLOAT3(box.min.x - AABB_TREE_MARGIN, box.min.y - AABB_TREE_MARGIN, box.min.z - AABB_TREE_MARGIN);
+	fatBox.max = XMFLOAT3(box.max.x + AABB_TREE_MARGIN, box.max.y + AABB_TREE_MARGIN, box.max.z + AABB_TREE_MARGIN);
+
+	const bool teleported = Overlaps(fatBox.min, fatBox.max, proxy.fatBox.min, proxy.fatBox.max) == false;
+	proxy.fatBox = fatBox;
+
+	const int leaf = proxy.node;
+	m_nodes[leaf].min = fatBox.min;
+	m_nodes[leaf].max = fatBox.max;
+
+	/*
+		Normal movement just grows the parents to fit (refit), which keeps the structure but makes it looser.
+		A jump to somewhere unrelated would blow up every parent box so that one gets reinserted instead.
+	*/
+	if (teleported)
+	{
+		RemoveLeaf(leaf);
+		InsertLeaf(leaf);
+	}
+	else
+	{
+		RefitUpwards(m_parents[leaf]);
+		++m_refitCount;
+	}
+
+	MarkDirty(proxyId);
+	return true;
+}
+
+unsigned int AabbTreeClass::GetUserData(int proxyId)
+{
+	return m_proxies[proxyId].userData;
+}
+
+const AabbType& AabbTreeClass::GetFatAabb(int proxyId)
+{
+	return m_proxies[proxyId].fatBox;
+}
+
+void AabbTreeClass::Update()
+{
+	if (m_building)
+	{
+		if (m_buildDone.load() == false)
+			return;
+
+		FinishRebuild();
+	}
+
+	int threshold = (int)(m_proxyCount * AABB_TREE_REBUILD_RATIO);
+	if (threshold < AABB_TREE_MIN_REBUILD)
+		threshold = AABB_TREE_MIN_REBUILD;
+
+	if (m_refitCount >= threshold)
+		StartRebuild();
+}
+
+void AabbTreeClass::Rebuild(bool wait)
+{
+	if (m_building == false)
+		StartRebuild();
+
+	if (wait)
+	{
+		if (m_Jobs)
+			m_Jobs->Wait(&m_buildCounter);
+
+		FinishRebuild();
+	}
+}
+
+void AabbTreeClass::QueryBox(const AabbType& box, std::vector<unsigned int>& results)
+{
+	std::vector<int> stack;
+	stack.reserve(64);
+	QueryBoxInternal(box, results, stack);
+}
+
+void AabbTreeClass::QueryFrustum(const XMFLOAT4* planes, std::vector<unsigned int>& results)
+{
+	std::vector<int> stack;
+	stack.reserve(128);
+	QueryFrustumInternal(planes, results, stack);
+}
+
+bool AabbTreeClass::RayCast(const RayType& ray, RayHitType& hit)
+{
+	std::vector<int> stack;
+	stack.reserve(64);
+	return RayCastInternal(ray, hit, stack);
+}
+
+void AabbTreeClass::QueryBoxes(const AabbType* boxes, int count, std::vector<unsigned int>* results)
+{
+	if (m_Jobs == nullptr)
+	{
+		for (int i = 0; i < count; ++i)
+			QueryBox(boxes[i], results[i]);
+		return;
+	}
+
+	m_Jobs->ParallelFor(count, 32, [&](int begin, int end, int)
+	{
+		std::vector<int> stack;
+		stack.reserve(64);
+		for (int i = begin; i < end; ++i)
+			QueryBoxInternal(boxes[i], results[i], stack);
+	});
+}
+
+void AabbTreeClass::QueryFrustums(const XMFLOAT4* planes, int count, std::vector<unsigned int>* results)
+{
+	// Frustums are few but each one visits a lot of the tree, so one per batch
+	if (m_Jobs == nullptr)
+	{
+		for (int i = 0; i < count; ++i)
+			QueryFrustum(planes + i * 6, results[i]);
+		return;
+	}
+
+	m_Jobs->ParallelFor(count, 1, [&](int begin, int end, int)
+	{
+		std::vector<int> stack;
+		stack.reserve(128);
+		for (int i = begin; i < end; ++i)
+			QueryFrustumInternal(planes + i * 6, results[i], stack);
+	});
+}
+
+void AabbTreeClass::RayCasts(const RayType* rays, int count, RayHitType* hits)
+{
+	if (m_Jobs == nullptr)
+	{
+		for (int i = 0; i < count; ++i)
+			RayCast(rays[i], hits[i]);
+		return;
+	}
+
+	m_Jobs->ParallelFor(count, 64, [&](int begin, int end, int)
+	{
+		std::vector<int> stack;
+		stack.reserve(64);
+		for (int i = begin; i < end; ++i)
+			RayCastInternal(rays[i], hits[i], stack);
+	});
+}
+
+int AabbTreeClass::GetProxyCount()
+{
+	return m_proxyCount;
+}
+
+int AabbTreeClass::GetNodeCount()
+{
+	return (int)(m_nodes.size() - m_freeNodes.size());
+}
+
+int AabbTreeClass::GetHeight()
+{
+	return HeightRecursive(m_root);
+}
+
+float AabbTreeClass::GetCost()
+{
+	if (m_root == -1)
+		return 0.0f;
+
+	// Expected number of inner nodes a random ray/query visits, relative to the root
+	float total = 0.0f;
+	const float rootArea = HalfArea(m_nodes[m_root].min, m_nodes[m_root].max);
+	std::vector<int> stack;
+	stack.push_back(m_root);
+	while (stack.empty() == false)
+	{
+		const NodeType& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.child1 == -1)
+			continue;
+
+		total += HalfArea(node.min, node.max);
+		stack.push_back(node.child1);
+		stack.push_back(node.child2);
+	}
+
+	return rootArea > 0.0f ? total / rootArea : 0.0f;
+}
+
+int AabbTreeClass::GetRebuildCount()
+{
+	return m_rebuildCount;
+}
+
+int AabbTreeClass::AllocateNode()
+{
+	if (m_freeNodes.empty() == false)
+	{
+		const int index = m_freeNodes.back();
+		m_freeNodes.pop_back();
+		m_parents[index] = -1;
+		return index;
+	}
+
+	m_nodes.push_back(NodeType());
+	m_parents.push_back(-1);
+	return (int)m_nodes.size() - 1;
+}
+
+void AabbTreeClass::FreeNode(int index)
+{
+	m_parents[index] = -1;
+	m_freeNodes.push_back(index);
+}
+
+void AabbTreeClass::InsertLeaf(int leaf)
+{
+	if (m_root == -1)
+	{
+		m_root = leaf;
+		m_parents[leaf] = -1;
+		return;
+	}
+
+	/*
+		Walk down picking the child that grows the least (Box2D's insertion heuristic).
+		Stop when making a new parent right here is cheaper than pushing the leaf further down.
+	*/
+	const XMFLOAT3 leafMin = m_nodes[leaf].min;
+	const XMFLOAT3 leafMax = m_nodes[leaf].max;
+	int index = m_root;
+	while (m_nodes[index].child1 != -1)
+	{
+		const NodeType& node = m_nodes[index];
+		XMFLOAT3 min, max;
+		Union(node.min, node.max, leafMin, leafMax, min, max);
+
+		const float area = HalfArea(node.min, node.max);
+		const float combinedArea = HalfArea(min, max);
+		const float cost = 2.0f * combinedArea;
+		const float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		const int children[2] = { node.child1, node.child2 };
+		for (int c = 0; c < 2; ++c)
+		{
+			const NodeType& child = m_nodes[children[c]];
+			Union(child.min, child.max, leafMin, leafMax, min, max);
+			childCost[c] = HalfArea(min, max) + inheritanceCost;
+			if (child.child1 != -1)
+				childCost[c] -= HalfArea(child.min, child.max);
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	const int sibling = index;
+	const int oldParent = m_parents[sibling];
+	const int newParent = AllocateNode();
+
+	NodeType& parentNode = m_nodes[newParent];
+	Union(m_nodes[sibling].min, m_nodes[sibling].max, leafMin, leafMax, parentNode.min, parentNode.max);
+	parentNode.child1 = sibling;
+	parentNode.child2 = leaf;
+	m_parents[newParent] = oldParent;
+	m_parents[sibling] = newParent;
+	m_parents[leaf] = newParent;
+
+	if (oldParent == -1)
+	{
+		m_root = newParent;
+		return;
+	}
+
+	if (m_nodes[oldParent].child1 == sibling)
+		m_nodes[oldParent].child1 = newParent;
+	else
+		m_nodes[oldParent].child2 = newParent;
+
+	RefitUpwards(oldParent);
+}
+
+void AabbTreeClass::RemoveLeaf(int leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = -1;
+		return;
+	}
+
+	// The parent goes away and the sibling takes its place
+	const int parent = m_parents[leaf];
+	const int grandParent = m_parents[parent];
+	const int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	if (grandParent == -1)
+	{
+		m_root = sibling;
+		m_parents[sibling] = -1;
+		FreeNode(parent);
+		return;
+	}
+
+	if (m_nodes[grandParent].child1 == parent)
+		m_nodes[grandParent].child1 = sibling;
+	else
+		m_nodes[grandParent].child2 = sibling;
+
+	m_parents[sibling] = grandParent;
+	FreeNode(parent);
+	RefitUpwards(grandParent);
+}
+
+void AabbTreeClass::RefitUpwards(int index)
+{
+	while (index != -1)
+	{
+		NodeType& node = m_nodes[index];
+		XMFLOAT3 min, max;
+		Union(m_nodes[node.child1].min, m_nodes[node.child1].max, m_nodes[node.child2].min, m_nodes[node.child2].max, min, max);
+
+		// Nothing changed here so nothing above can change either
+		if (min.x == node.min.x && min.y == node.min.y && min.z == node.min.z &&
+			max.x == node.max.x && max.y == node.max.y && max.z == node.max.z)
+			return;
+
+		node.min = min;
+		node.max = max;
+		index = m_parents[index];
+	}
+}
+
+void AabbTreeClass::MarkDirty(int proxyId)
+{
+	if (m_building == false || m_proxies[proxyId].dirty)
+		return;
+
+	m_proxies[proxyId].dirty = true;
+	m_dirtyProxies.push_back(proxyId);
+}
+
+void AabbTreeClass::StartRebuild()
+{
+	// Snapshot every live proxy, from here on the rebuild only looks at m_build*
+	m_buildItems.clear();
+	m_buildItems.reserve(m_proxyCount);
+	for (int i = 0; i < (int)m_proxies.size(); ++i)
+	{
+		ProxyType& proxy = m_proxies[i];
+		proxy.dirty = false;
+		if (proxy.alive == false)
+			continue;
+
+		BuildItemType item;
+		item.box = proxy.fatBox;
+		item.centroid = XMFLOAT3((proxy.fatBox.min.x + proxy.fatBox.max.x) * 0.5f,
+			(proxy.fatBox.min.y + proxy.fatBox.max.y) * 0.5f,
+			(proxy.fatBox.min.z + proxy.fatBox.max.z) * 0.5f);
+		item.proxy = i;
+		m_buildItems.push_back(item);
+	}
+
+	m_dirtyProxies.clear();
+	m_refitCount = 0;
+	m_building = true;
+	m_buildDone = false;
+
+	if (m_Jobs == nullptr)
+	{
+		RunRebuild();
+		m_buildDone = true;
+		return;
+	}
+
+	m_Jobs->Run([this]()
+	{
+		RunRebuild();
+		m_buildDone = true;
+	}, &m_buildCounter);
+}
+
+void AabbTreeClass::RunRebuild()
+{
+	m_buildNodes.clear();
+	m_buildTasks.clear();
+	m_buildRoot = -1;
+
+	const int count = (int)m_buildItems.size();
+	if (count == 0)
+		return;
+
+	if (m_Jobs == nullptr || count < AABB_TREE_PARALLEL_LEAVES)
+	{
+		m_buildNodes.reserve(count * 2);
+		m_buildRoot = BuildRecursive(m_buildNodes, 0, count);
+		return;
+	}
+
+	/*
+		Split the top few levels here, then build every subtree that's left on its own job into its own node array
+		and splice them in afterwards. Subtrees never share items so the jobs don't need any locking.
+	*/
+	CollectSubtrees(0, count, -1, false, 0);
+
+	m_Jobs->ParallelFor((int)m_buildTasks.size(), 1, [this](int begin, int end, int)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			SubtreeTaskType& task = m_buildTasks[i];
+			task.nodes.reserve((task.end - task.begin) * 2);
+			BuildRecursive(task.nodes, task.begin, task.end);
+		}
+	});
+
+	m_buildNodes.reserve(count * 2);
+	for (SubtreeTaskType& task : m_buildTasks)
+	{
+		const int offset = (int)m_buildNodes.size();
+		for (NodeType node : task.nodes)
+		{
+			if (node.child1 != -1)
+			{
+				node.child1 += offset;
+				node.child2 += offset;
+			}
+
+			m_buildNodes.push_back(node);
+		}
+
+		if (task.parentNode == -1)
+			m_buildRoot = offset;
+		else if (task.isChild1)
+			m_buildNodes[task.parentNode].child1 = offset;
+		else
+			m_buildNodes[task.parentNode].child2 = offset;
+	}
+
+	m_buildTasks.clear();
+}
+
+void AabbTreeClass::FinishRebuild()
+{
+	m_nodes.swap(m_buildNodes);
+	m_buildNodes.clear();
+	m_root = m_buildRoot;
+	m_freeNodes.clear();
+
+	// Parents and proxy -> leaf links weren't built by the job, fill them in now
+	m_parents.assign(m_nodes.size(), -1);
+	for (ProxyType& proxy : m_proxies)
+		proxy.node = -1;
+
+	for (int i = 0; i < (int)m_nodes.size(); ++i)
+	{
+		const NodeType& node = m_nodes[i];
+		if (node.child1 == -1)
+		{
+			m_proxies[node.child2].node = i;
+		}
+		else
+		{
+			m_parents[node.child1] = i;
+			m_parents[node.child2] = i;
+		}
+	}
+
+	// The new tree matches the snapshot, replay whatever changed since then
+	m_building = false;
+	for (int proxyId : m_dirtyProxies)
+	{
+		ProxyType& proxy = m_proxies[proxyId];
+		proxy.dirty = false;
+
+		if (proxy.alive && proxy.node == -1)
+		{
+			const int leaf = AllocateNode();
+			m_nodes[leaf].min = proxy.fatBox.min;
+			m_nodes[leaf].max = proxy.fatBox.max;
+			m_nodes[leaf].child1 = -1;
+			m_nodes[leaf].child2 = proxyId;
+			proxy.node = leaf;
+			InsertLeaf(leaf);
+		}
+		else if (proxy.alive == false && proxy.node != -1)
+		{
+			RemoveLeaf(proxy.node);
+			FreeNode(proxy.node);
+			proxy.node = -1;
+		}
+		else if (proxy.alive)
+		{
+			m_nodes[proxy.node].min = proxy.fatBox.min;
+			m_nodes[proxy.node].max = proxy.fatBox.max;
+			RefitUpwards(m_parents[proxy.node]);
+		}
+	}
+
+	m_dirtyProxies.clear();
+	m_buildItems.clear();
+	++m_rebuildCount;
+}
+
+int AabbTreeClass::BuildRecursive(std::vector<NodeType>& nodes, int begin, int end)
+{
+	const int index = (int)nodes.size();
+	nodes.push_back(NodeType());
+
+	if (end - begin == 1)
+	{
+		const BuildItemType& item = m_buildItems[begin];
+		nodes[index].min = item.box.min;
+		nodes[index].max = item.box.max;
+		nodes[index].child1 = -1;
+		nodes[index].child2 = item.proxy;
+		return index;
+	}
+
+	const int mid = SplitItems(begin, end);
+	const int child1 = BuildRecursive(nodes, begin, mid);
+	const int child2 = BuildRecursive(nodes, mid, end);
+
+	// push_back above may have moved the array, index again
+	NodeType& node = nodes[index];
+	node.child1 = child1;
+	node.child2 = child2;
+	Union(nodes[child1].min, nodes[child1].max, nodes[child2].min, nodes[child2].max, node.min, node.max);
+	return index;
+}
+
+int AabbTreeClass::SplitItems(int begin, int end)
+{
+	// Split along the longest axis of the centroids
+	XMFLOAT3 cmin = m_buildItems[begin].centroid;
+	XMFLOAT3 cmax = cmin;
+	for (int i = begin + 1; i < end; ++i)
+		Union(cmin, cmax, m_buildItems[i].centroid, m_buildItems[i].centroid, cmin, cmax);
+
+	const float extents[3] = { cmax.x - cmin.x, cmax.y - cmin.y, cmax.z - cmin.z };
+	int axis = 0;
+	if (extents[1] > extents[axis])
+		axis = 1;
+	if (extents[2] > extents[axis])
+		axis = 2;
+
+	const int mid = (begin + end) / 2;
+	if (extents[axis] <= 1e-6f)
+		return mid;
+
+	/*
+		Binned SAH: drop centroids into buckets along the axis, then sweep from both sides
+		to find the bucket boundary with the smallest area * count on each side.
+	*/
+	const float axisMin = Component(cmin, axis);
+	const float scale = AABB_TREE_SAH_BINS / extents[axis];
+
+	int binCounts[AABB_TREE_SAH_BINS] = {};
+	XMFLOAT3 binMin[AABB_TREE_SAH_BINS];
+	XMFLOAT3 binMax[AABB_TREE_SAH_BINS];
+	for (int b = 0; b < AABB_TREE_SAH_BINS; ++b)
+	{
+		binMin[b] = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		binMax[b] = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	}
+
+	for (int i = begin; i < end; ++i)
+	{
+		const BuildItemType& item = m_buildItems[i];
+		int b = (int)((Component(item.centroid, axis) - axisMin) * scale);
+		if (b >= AABB_TREE_SAH_BINS)
+			b = AABB_TREE_SAH_BINS - 1;
+
+		++binCounts[b];
+		Union(binMin[b], binMax[b], item.box.min, item.box.max, binMin[b], binMax[b]);
+	}
+
+	float leftCost[AABB_TREE_SAH_BINS];
+	XMFLOAT3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	int count = 0;
+	for (int b = 0; b < AABB_TREE_SAH_BINS - 1; ++b)
+	{
+		count += binCounts[b];
+		if (binCounts[b] > 0)
+			Union(min, max, binMin[b], binMax[b], min, max);
+		leftCost[b] = count > 0 ? HalfArea(min, max) * count : 0.0f;
+	}
+
+	int bestSplit = -1;
+	float bestCost = FLT_MAX;
+	min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	count = 0;
+	for (int b = AABB_TREE_SAH_BINS - 1; b > 0; --b)
+	{
+		count += binCounts[b];
+		if (binCounts[b] > 0)
+			Union(min, max, binMin[b], binMax[b], min, max);
+
+		// Split between bucket b - 1 and b, both sides must have something in them
+		if (count == 0 || count == end - begin)
+			continue;
+
+		const float cost = leftCost[b - 1] + HalfArea(min, max) * count;
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = b;
+		}
+	}
+
+	if (bestSplit == -1)
+		return mid;
+
+	BuildItemType* first = &m_buildItems[0];
+	BuildItemType* split = std::partition(first + begin, first + end, [=](const BuildItemType& item)
+	{
+		int b = (int)((Component(item.centroid, axis) - axisMin) * scale);
+		return b < bestSplit;
+	});
+
+	const int result = (int)(split - first);
+	if (result == begin || result == end)
+		return mid;
+
+	return result;
+}
+
+void AabbTreeClass::CollectSubtrees(int begin, int end, int parentNode, bool isChild1, int depth)
+{
+	// Small enough, or we already have plenty of subtrees to hand out
+	if (end - begin < AABB_TREE_PARALLEL_LEAVES || depth >= 6)
+	{
+		SubtreeTaskType task;
+		task.begin = begin;
+		task.end = end;
+		task.parentNode = parentNode;
+		task.isChild1 = isChild1;
+		m_buildTasks.push_back(std::move(task));
+		return;
+	}
+
+	// Inner node whose children get patched in when the subtrees are spliced
+	const int index = (int)m_buildNodes.size();
+	NodeType node;
+	node.min = m_buildItems[begin].box.min;
+	node.max = m_buildItems[begin].box.max;
+	for (int i = begin + 1; i < end; ++i)
+		Union(node.min, node.max, m_buildItems[i].box.min, m_buildItems[i].box.max, node.min, node.max);
+	node.child1 = -1;
+	node.child2 = -1;
+	m_buildNodes.push_back(node);
+
+	if (parentNode == -1)
+		m_buildRoot = index;
+	else if (isChild1)
+		m_buildNodes[parentNode].child1 = index;
+	else
+		m_buildNodes[parentNode].child2 = index;
+
+	const int mid = SplitItems(begin, end);
+	CollectSubtrees(begin, mid, index, true, depth + 1);
+	CollectSubtrees(mid, end, index, false, depth + 1);
+}
+
+void AabbTreeClass::QueryBoxInternal(const AabbType& box, std::vector<unsigned int>& results, std::vector<int>& stack)
+{
+	results.clear();
+	if (m_root == -1)
+		return;
+
+	stack.clear();
+	stack.push_back(m_root);
+	while (stack.empty() == false)
+	{
+		const NodeType& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (Overlaps(node.min, node.max, box.min, box.max) == false)
+			continue;
+
+		if (node.child1 == -1)
+		{
+			// Fat boxes are only for the tree, test the real one before reporting a hit
+			const ProxyType& proxy = m_proxies[node.child2];
+			if (Overlaps(proxy.box.min, proxy.box.max, box.min, box.max))
+				results.push_back(proxy.userData);
+			continue;
+		}
+
+		stack.push_back(node.child1);
+		stack.push_back(node.child2);
+	}
+}
+
+void AabbTreeClass::QueryFrustumInternal(const XMFLOAT4* planes, std::vector<unsigned int>& results, std::vector<int>& stack)
+{
+	results.clear();
+	if (m_root == -1)
+		return;
+
+	/*
+		Stack holds (node, plane mask) pairs. A plane the parent is completely inside of
+		can't cut any child so it's dropped from the mask, once the mask is empty the
+		whole subtree is visible and we just collect leaves.
+	*/
+	stack.clear();
+	stack.push_back(m_root);
+	stack.push_back(0x3f);
+	while (stack.empty() == false)
+	{
+		int mask = stack.back();
+		stack.pop_back();
+		const NodeType& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		bool outside = false;
+		for (int p = 0; p < 6 && mask != 0; ++p)
+		{
+			if ((mask & (1 << p)) == 0)
+				continue;
+
+			const XMFLOAT4& plane = planes[p];
+			const float px = plane.x >= 0.0f ? node.max.x : node.min.x;
+			const float py = plane.y >= 0.0f ? node.max.y : node.min.y;
+			const float pz = plane.z >= 0.0f ? node.max.z : node.min.z;
+			if (plane.x * px + plane.y * py + plane.z * pz + plane.w < 0.0f)
+			{
+				outside = true;
+				break;
+			}
+
+			const float nx = plane.x >= 0.0f ? node.min.x : node.max.x;
+			const float ny = plane.y >= 0.0f ? node.min.y : node.max.y;
+			const float nz = plane.z >= 0.0f ? node.min.z : node.max.z;
+			if (plane.x * nx + plane.y * ny + plane.z * nz + plane.w >= 0.0f)
+				mask &= ~(1 << p);
+		}
+
+		if (outside)
+			continue;
+
+		if (node.child1 == -1)
+		{
+			results.push_back(m_proxies[node.child2].userData);
+			continue;
+		}
+
+		stack.push_back(node.child1);
+		stack.push_back(mask);
+		stack.push_back(node.child2);
+		stack.push_back(mask);
+	}
+}
+
+bool AabbTreeClass::RayCastInternal(const RayType& ray, RayHitType& hit, std::vector<int>& stack)
+{
+	hit.hit = false;
+	hit.userData = 0;
+	hit.distance = ray.maxDistance;
+	if (m_root == -1)
+		return false;
+
+	// 1/0 gives infinity which the slab test handles fine
+	const XMFLOAT3 invDirection(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+
+	stack.clear();
+	if (RayBox(ray.origin, invDirection, hit.distance, m_nodes[m_root].min, m_nodes[m_root].max) != FLT_MAX)
+		stack.push_back(m_root);
+
+	while (stack.empty() == false)
+	{
+		const NodeType& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.child1 == -1)
+		{
+			const ProxyType& proxy = m_proxies[node.child2];
+			const float t = RayBox(ray.origin, invDirection, hit.distance, proxy.box.min, proxy.box.max);
+			if (t != FLT_MAX)
+			{
+				hit.hit = true;
+				hit.distance = t;
+				hit.userData = proxy.userData;
+			}
+			continue;
+		}
+
+		// Visit the nearer child first (pushed last) so the hit distance shrinks as early as possible
+		const float t1 = RayBox(ray.origin, invDirection, hit.distance, m_nodes[node.child1].min, m_nodes[node.child1].max);
+		const float t2 = RayBox(ray.origin, invDirection, hit.distance, m_nodes[node.child2].min, m_nodes[node.child2].max);
+		const int nearChild = t1 <= t2 ? node.child1 : node.child2;
+		const int farChild = t1 <= t2 ? node.child2 : node.child1;
+		const float nearT = t1 <= t2 ? t1 : t2;
+		const float farT = t1 <= t2 ? t2 : t1;
+
+		if (farT != FLT_MAX && (hit.hit == false || farT < hit.distance))
+			stack.push_back(farChild);
+
+		if (nearT != FLT_MAX && (hit.hit == false || nearT < hit.distance))
+			stack.push_back(nearChild);
+	}
+
+	return hit.hit;
+}
+
+int AabbTreeClass::HeightRecursive(int index)
+{
+	if (index == -1 || m_nodes[index].child1 == -1)
+		return 0;
+
+	const int height1 = HeightRecursive(m_nodes[index].child1);
+	const int height2 = HeightRecursive(m_nodes[index].child2);
+	return 1 + (height1 > height2 ? height1 : height2);
+}
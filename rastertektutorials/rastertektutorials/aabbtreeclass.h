@@ -0,0 +1,165 @@
+#pragma once
+
+#include <directxmath.h>
+#include <atomic>
+#include <vector>
+#include "jobsystemclass.h"
+
+using namespace DirectX;
+
+/*
+	Dynamic AABB tree (bounding volume hierarchy) for visibility, picking and proximity queries.
+	Objects are proxies with stable ids. Each proxy stores a "fat" box a bit bigger than the object so small
+	movements don't touch the tree at all, bigger ones just refit the leaf and its parents.
+	Refitting is cheap but the tree slowly gets worse, so after enough refits the whole thing is rebuilt with
+	binned SAH on the job threads from a snapshot and swapped in at the next Update(). Changes made while
+	the rebuild runs are replayed on top of the new tree.
+	Nodes are 32 bytes (box + two ints) so traversal stays in as few cache lines as possible,
+	parents and per proxy data live in separate arrays since queries never look at them.
+	Not thread safe, queries (including the batched ones, which block) can't overlap changes to the tree.
+*/
+
+const float AABB_TREE_MARGIN = 0.1f;
+const float AABB_TREE_REBUILD_RATIO = 0.25f; // rebuild once refits reach this fraction of the proxy count
+const int AABB_TREE_MIN_REBUILD = 64;
+const int AABB_TREE_SAH_BINS = 16;
+const int AABB_TREE_PARALLEL_LEAVES = 4096; // subtrees smaller than this are built on one thread
+
+struct AabbType
+{
+	XMFLOAT3 min;
+	XMFLOAT3 max;
+};
+
+struct RayType
+{
+	XMFLOAT3 origin;
+	XMFLOAT3 direction;
+	float maxDistance;
+};
+
+struct RayHitType
+{
+	unsigned int userData;
+	float distance;
+	bool hit;
+};
+
+class AabbTreeClass
+{
+public:
+	AabbTreeClass();
+	AabbTreeClass(const AabbTreeClass&);
+	~AabbTreeClass();
+
+	// Job system can be nullptr, rebuilds then happen inline on the calling thread
+	bool Initialize(JobSystemClass*);
+	void Shutdown();
+
+	int CreateProxy(const AabbType&, unsigned int);
+	void DestroyProxy(int);
+	// Returns true if the tree had to change, destroyed proxies are ignored
+	bool MoveProxy(int, const AabbType&);
+	unsigned int GetUserData(int);
+	const AabbType& GetFatAabb(int);
+
+	// Once a frame from the thread that owns the tree, swaps in finished rebuilds and starts new ones
+	void Update();
+	void Rebuild(bool);
+
+	// Queries append the user data of every hit
+	void QueryBox(const AabbType&, std::vector<unsigned int>&);
+	// Planes are (normal, d) with dot(normal, p) + d >= 0 inside
+	void QueryFrustum(const XMFLOAT4*, std::vector<unsigned int>&);
+	bool RayCast(const RayType&, RayHitType&);
+
+	// Batched versions, spread across the job threads when there is a job system
+	void QueryBoxes(const AabbType*, int, std::vector<unsigned int>*);
+	void QueryFrustums(const XMFLOAT4*, int, std::vector<unsigned int>*);
+	void RayCasts(const RayType*, int, RayHitType*);
+
+	int GetProxyCount();
+	int GetNodeCount();
+	int GetHeight();
+	float GetCost(); // SAH cost of the whole tree, lower is better
+	int GetRebuildCount();
+
+private:
+	struct NodeType
+	{
+		XMFLOAT3 min;
+		int child1; // -1 for leaves
+		XMFLOAT3 max;
+		int child2; // proxy id for leaves
+	};
+
+	struct ProxyType
+	{
+		AabbType box; // tight box, used for exact ray hits
+		AabbType fatBox;
+		int node;
+		unsigned int userData;
+		bool alive;
+		bool dirty; // changed while a rebuild was in flight
+	};
+
+	struct BuildItemType
+	{
+		AabbType box;
+		XMFLOAT3 centroid;
+		int proxy;
+	};
+
+	struct SubtreeTaskType
+	{
+		int begin;
+		int end;
+		int parentNode;
+		bool isChild1;
+		std::vector<NodeType> nodes;
+	};
+
+	int AllocateNode();
+	void FreeNode(int);
+	void InsertLeaf(int);
+	void RemoveLeaf(int);
+	void RefitUpwards(int);
+	void MarkDirty(int);
+
+	void StartRebuild();
+	void RunRebuild();
+	void FinishRebuild();
+	int BuildRecursive(std::vector<NodeType>&, int, int);
+	int SplitItems(int, int);
+	void CollectSubtrees(int, int, int, bool, int);
+
+	void QueryBoxInternal(const AabbType&, std::vector<unsigned int>&, std::vector<int>&);
+	void QueryFrustumInternal(const XMFLOAT4*, std::vector<unsigned int>&, std::vector<int>&);
+	bool RayCastInternal(const RayType&, RayHitType&, std::vector<int>&);
+	int HeightRecursive(int);
+
+private:
+	JobSystemClass* m_Jobs;
+
+	// Live tree
+	std::vector<NodeType> m_nodes;
+	std::vector<int> m_parents;
+	std::vector<int> m_freeNodes;
+	int m_root;
+
+	std::vector<ProxyType> m_proxies;
+	std::vector<int> m_freeProxies;
+	int m_proxyCount;
+	int m_refitCount;
+	int m_rebuildCount;
+
+	// Rebuild in flight, only the rebuild job touches these until m_buildDone is set
+	std::vector<BuildItemType> m_buildItems;
+	std::vector<NodeType> m_buildNodes;
+	std::vector<SubtreeTaskType> m_buildTasks;
+	int m_buildRoot;
+	std::atomic<bool> m_buildDone;
+	JobCounter m_buildCounter;
+	bool m_building;
+	std::vector<int> m_dirtyProxies;
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+	Aligned heap blocks for the SoA arrays and entity chunks. _aligned_malloc on Windows, posix_memalign elsewhere so the
+	headless parts (particles, entity store) don't need the Windows CRT. Alignment is a power of two and at least
+	sizeof(void*). Blocks from AlignedAlloc have to go back through AlignedFree, never free or delete.
+*/
+
+// nullptr if out of memory
+void* AlignedAlloc(size_t, size_t);
+void AlignedFree(void*);
@@ -0,0 +1,91 @@
+#include "allocationcounter.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+static std::atomic<unsigned long long> g_allocationCount(0);
+static std::atomic<unsigned long long> g_allocationBytes(0);
+static thread_local unsigned long long t_allocationCount = 0;
+static thread_local unsigned long long t_allocationBytes = 0;
+
+static void* CountedAllocate(size_t size)
+{
+	g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	g_allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	++t_allocationCount;
+	t_allocationBytes += size;
+
+	// malloc(0) is allowed to return nullptr, new never is
+	return malloc(size ? size : 1);
+}
+
+void GetAllocationCounts(AllocationCountType& counts)
+{
+	counts.count = g_allocationCount.load(std::memory_order_relaxed);
+	counts.bytes = g_allocationBytes.load(std::memory_order_relaxed);
+}
+
+void GetThreadAllocationCounts(AllocationCountType& counts)
+{
+	counts.count = t_allocationCount;
+	counts.bytes = t_allocationBytes;
+}
+
+void* operator new(size_t size)
+{
+	void* memory = CountedAllocate(size);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	void* memory = CountedAllocate(size);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+}
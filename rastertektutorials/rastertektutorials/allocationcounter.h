@@ -0,0 +1,18 @@
+#pragma once
+
+/*
+	Counts every heap allocation made through operator new (the global operator new/delete are replaced in
+	allocationcounter.cpp). Only counts, doesn't track what's live, so it costs an increment or two per allocation.
+	The benchmarks use it to check frames don't allocate once a scene has settled.
+*/
+
+struct AllocationCountType
+{
+	unsigned long long count;
+	unsigned long long bytes;
+};
+
+// Every thread since startup
+void GetAllocationCounts(AllocationCountType&);
+// Only the calling thread since it started
+void GetThreadAllocationCounts(AllocationCountType&);
@@ -0,0 +1,173 @@
+#include "atlasclass.h"
+
+#include <string.h>
+
+AtlasClass::AtlasClass() :
+	m_width(0),
+	m_height(0),
+	m_shelfX(0),
+	m_shelfY(0),
+	m_shelfHeight(0),
+	m_usedTexels(0),
+	m_dirty(false),
+	m_texture(nullptr),
+	m_textureView(nullptr)
+{
+	ZeroMemory(&m_whiteRegion, sizeof(m_whiteRegion));
+}
+
+AtlasClass::AtlasClass(const AtlasClass&)
+{
+}
+
+AtlasClass::~AtlasClass()
+{
+}
+
+bool AtlasClass::Initialize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_shelfX = 0;
+	m_shelfY = 0;
+	m_shelfHeight = 0;
+	m_usedTexels = 0;
+	m_pixels.assign((size_t)width * height * 4, 0);
+
+	// First thing in is the white patch. 3x3 with the uvs on the middle texel so filtering never sees anything else
+	unsigned char white[3 * 3 * 4];
+	memset(white, 0xFF, sizeof(white));
+	AtlasRegionType region;
+	if (AddImage(white, 3, 3, 3 * 4, region) == false)
+		return false;
+
+	const float texelU = (region.u1 - region.u0) / 3.0f;
+	const float texelV = (region.v1 - region.v0) / 3.0f;
+	m_whiteRegion.u0 = region.u0 + texelU * 1.5f;
+	m_whiteRegion.v0 = region.v0 + texelV * 1.5f;
+	m_whiteRegion.u1 = m_whiteRegion.u0;
+	m_whiteRegion.v1 = m_whiteRegion.v0;
+	m_whiteRegion.width = 1;
+	m_whiteRegion.height = 1;
+	return true;
+}
+
+void AtlasClass::Shutdown()
+{
+	if (m_textureView)
+	{
+		m_textureView->Release();
+		m_textureView = nullptr;
+	}
+
+	if (m_texture)
+	{
+		m_texture->Release();
+		m_texture = nullptr;
+	}
+
+	m_pixels.clear();
+}
+
+bool AtlasClass::AddImage(const unsigned char* pixels, int width, int height, int pitch, AtlasRegionType& region)
+{
+	const int paddedWidth = width + ATLAS_PADDING * 2;
+	const int paddedHeight = height + ATLAS_PADDING * 2;
+	if (paddedWidth > m_width)
+		return false;
+
+	// Doesn't fit on this shelf, start a new one under it
+	if (m_shelfX + paddedWidth > m_width)
+	{
+		m_shelfY += m_shelfHeight;
+		m_shelfX = 0;
+		m_shelfHeight = 0;
+	}
+
+	if (m_shelfY + paddedHeight > m_height)
+		return false;
+
+	const int x = m_shelfX + ATLAS_PADDING;
+	const int y = m_shelfY + ATLAS_PADDING;
+	for (int row = 0; row < height; ++row)
+		memcpy(&m_pixels[((size_t)(y + row) * m_width + x) * 4], pixels + (size_t)row * pitch, (size_t)width * 4);
+
+	m_shelfX += paddedWidth;
+	if (paddedHeight > m_shelfHeight)
+		m_shelfHeight = paddedHeight;
+
+	m_usedTexels += paddedWidth * paddedHeight;
+	m_dirty = true;
+
+	region.u0 = (float)x / (float)m_width;
+	region.v0 = (float)y / (float)m_height;
+	region.u1 = (float)(x + width) / (float)m_width;
+	region.v1 = (float)(y + height) / (float)m_height;
+	region.width = width;
+	region.height = height;
+	return true;
+}
+
+bool AtlasClass::Upload(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
+{
+	if (m_texture == nullptr)
+	{
+		D3D11_TEXTURE2D_DESC textureDesc;
+		ZeroMemory(&textureDesc, sizeof(textureDesc));
+		textureDesc.Width = m_width;
+		textureDesc.Height = m_height;
+		textureDesc.MipLevels = 1; // no mips, overlay is always drawn 1:1
+		textureDesc.ArraySize = 1;
+		textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		D3D11_SUBRESOURCE_DATA data;
+		data.pSysMem = m_pixels.data();
+		data.SysMemPitch = m_width * 4;
+		data.SysMemSlicePitch = 0;
+
+		if (FAILED(device->CreateTexture2D(&textureDesc, &data, &m_texture)))
+			return false;
+
+		if (FAILED(device->CreateShaderResourceView(m_texture, nullptr, &m_textureView)))
+			return false;
+
+		m_dirty = false;
+		return true;
+	}
+
+	if (m_dirty)
+	{
+		deviceContext->UpdateSubresource(m_texture, 0, nullptr, m_pixels.data(), m_width * 4, 0);
+		m_dirty = false;
+	}
+
+	return true;
+}
+
+ID3D11ShaderResourceView* AtlasClass::GetTexture()
+{
+	return m_textureView;
+}
+
+const AtlasRegionType& AtlasClass::GetWhiteRegion()
+{
+	return m_whiteRegion;
+}
+
+int AtlasClass::GetWidth()
+{
+	return m_width;
+}
+
+int AtlasClass::GetHeight()
+{
+	return m_height;
+}
+
+float AtlasClass::GetUsage()
+{
+	return (float)m_usedTexels / (float)(m_width * m_height);
+}
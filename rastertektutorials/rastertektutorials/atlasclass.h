@@ -0,0 +1,56 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+
+/*
+	One RGBA texture that glyphs and sprites get packed into, so a whole overlay can be drawn from a single texture.
+	Images are copied into a cpu side copy with shelf packing (left to right, new shelf when a row is full)
+	and the texture is (re)uploaded on the render thread the next time Upload is called after something was added.
+	Nothing is ever removed, it's meant for small stuff that lives as long as the app.
+*/
+
+const int ATLAS_PADDING = 1; // empty texels around each image so linear filtering doesn't bleed neighbours in
+
+struct AtlasRegionType
+{
+	float u0, v0, u1, v1;
+	int width, height; // in texels
+};
+
+class AtlasClass
+{
+public:
+	AtlasClass();
+	AtlasClass(const AtlasClass&);
+	~AtlasClass();
+
+	bool Initialize(int, int);
+	void Shutdown();
+
+	// RGBA8 pixels with the given row pitch in bytes, returns false when the atlas is full
+	bool AddImage(const unsigned char*, int, int, int, AtlasRegionType&);
+
+	// Creates the texture the first time, afterwards only uploads if something was added. Render thread only.
+	bool Upload(ID3D11Device*, ID3D11DeviceContext*);
+	ID3D11ShaderResourceView* GetTexture();
+
+	// A solid white patch, for untextured rectangles that still want to go in the same batch as text
+	const AtlasRegionType& GetWhiteRegion();
+	int GetWidth();
+	int GetHeight();
+	float GetUsage();
+
+private:
+	std::vector<unsigned char> m_pixels;
+	int m_width;
+	int m_height;
+	int m_shelfX;
+	int m_shelfY;
+	int m_shelfHeight;
+	int m_usedTexels;
+	bool m_dirty;
+	AtlasRegionType m_whiteRegion;
+	ID3D11Texture2D* m_texture;
+	ID3D11ShaderResourceView* m_textureView;
+};
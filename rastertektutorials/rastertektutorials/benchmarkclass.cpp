@@ -0,0 +1,993 @@
+#include "benchmarkclass.h"
+#include "meshbuilderclass.h"
+
+#include <windows.h>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const char* const SCENARIO_NAMES[SCENARIO_COUNT] =
+{
+	"idle",
+	"drift",
+	"ecs_iterate",
+	"ecs_churn",
+	"bvh_query",
+	"overlay",
+	"lights_256",
+	"lights_1024",
+	"lights_4096",
+	"shadows",
+	"lods",
+	"shader_reload",
+};
+
+// Scenario sizes
+static const int ITERATE_ENTITIES = 100000;
+static const int CHURN_ENTITIES = 20000;
+static const int CHURN_PER_FRAME = 1000;
+static const int QUERY_PROXIES = 100000;
+static const int QUERY_CREATE_RUNS = 10; // bulk creates timed after the frames (FinishRun)
+static const int QUERY_BOXES = 256;
+static const int QUERY_RAYS = 256;
+static const unsigned int OVERLAY_QUADS = 10000;
+static const int LIGHTS_SMALL = 256;
+static const int LIGHTS_MEDIUM = 1024;
+static const int LIGHTS_LARGE = 4096;
+static const int SHADOW_STATIC_ENTITIES = 20000;
+static const int SHADOW_DYNAMIC_ENTITIES = 2000;
+static const float SHADOW_CAMERA_SPEED = 8.0f; // units per second along the path
+static const int LOD_ENTITIES = 20000;
+static const float LOD_FIELD_DEPTH = 800.0f; // most of the way to the far plane
+static const float LOD_CAMERA_SPEED = 20.0f;
+static const int LOD_SPHERE_RINGS = 64; // 64 * 128 segments is about 16k triangles at full detail
+static const double RELOAD_PERIOD_MS = 250.0; // well past FILE_WATCHER_DEBOUNCE_MS plus a compile, or the edits never settle
+static const char* const RELOAD_FILES[] = { "sprite.vs", "sprite.ps" }; // the overlay's shaders, drawn every frame
+static const char* const SHADER_FILE_PATTERNS[] = { "*.vs", "*.ps", "*.hlsli" }; // everything the cache compiles, includes too
+static const float WORLD_SIZE = 200.0f;
+
+// Metrics in the json, in the order they're written and compared
+static const char* const METRIC_NAMES[] = { "frameMs", "simulationMs", "renderMs", "gpuMs", "reloadMs", "bvhCreateMs", "bvhMoveMs", "bvhQueryMs",
+	"allocations", "allocatedBytes", "processAllocations", "cascadesRedrawn", "castersSubmitted", "trianglesSubmitted" };
+static const bool METRIC_IS_TIME[] = { true, true, true, true, true, true, true, true, false, false, false, false, false, false };
+// Process wide allocations depend on how the job threads got scheduled, reported but not gated on
+static const bool METRIC_IS_GATED[] = { true, true, true, true, true, true, true, true, true, true, false, true, true, true };
+// A hitch now and then (a reload stalling the render thread) doesn't move the median, whole frame times gate p99 and max too
+static const bool METRIC_GATES_TAIL[] = { true, false, false, false, false, false, false, false, false, false, false, false, false, false };
+// Only some frames or scenarios have these, the rest are -1 and left out. No samples at all shows up as missing in a comparison
+static const bool METRIC_IS_SPARSE[] = { false, false, false, true, true, true, true, true, false, false, false, false, false, false };
+static const int METRIC_COUNT = sizeof(METRIC_NAMES) / sizeof(METRIC_NAMES[0]);
+
+static unsigned int NextRandom(unsigned int& state)
+{
+	// xorshift32, same sequence every run so builds get the same scenario
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static float RandomFloat(unsigned int& state, float low, float high)
+{
+	return low + (high - low) * (float)(NextRandom(state) & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+static void BuildSphere(std::vector<SourceVertexType>& vertices)
+{
+	// UV sphere of radius 1, three vertices per triangle for MeshBuilderClass::LoadTriangles
+	const int segments = LOD_SPHERE_RINGS * 2;
+	vertices.clear();
+	vertices.reserve(LOD_SPHERE_RINGS * segments * 6);
+
+	for (int ring = 0; ring < LOD_SPHERE_RINGS; ++ring)
+	{
+		for (int segment = 0; segment < segments; ++segment)
+		{
+			SourceVertexType corners[4];
+			for (int corner = 0; corner < 4; ++corner)
+			{
+				const float v = (float)(ring + (corner == 1 || corner == 2 ? 1 : 0)) / LOD_SPHERE_RINGS;
+				const float u = (float)(segment + (corner >= 2 ? 1 : 0)) / segments;
+				const float theta = v * XM_PI;
+				const float phi = u * XM_2PI;
+
+				// One shared vertex at each pole, a fan of copies with different u would all be seams the simplifier can't touch
+				const bool pole = v == 0.0f || v == 1.0f;
+				SourceVertexType& vertex = corners[corner];
+				vertex.normal = pole ? XMFLOAT3(0.0f, v == 0.0f ? 1.0f : -1.0f, 0.0f) : XMFLOAT3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+				vertex.position = vertex.normal;
+				vertex.texture = XMFLOAT2(pole ? 0.5f : u, v);
+			}
+
+			// The rows touching the poles are fans, their other triangle would have no area
+			if (ring != 0)
+			{
+				vertices.push_back(corners[0]);
+				vertices.push_back(corners[2]);
+				vertices.push_back(corners[1]);
+			}
+
+			if (ring != LOD_SPHERE_RINGS - 1)
+			{
+				vertices.push_back(corners[0]);
+				vertices.push_back(corners[3]);
+				vertices.push_back(corners[2]);
+			}
+		}
+	}
+
+}
+
+static double Percentile(std::vector<double>& sorted, double percentile)
+{
+	if (sorted.empty())
+		return 0.0;
+
+	const double position = percentile * (sorted.size() - 1);
+	const size_t index = (size_t)position;
+	const double fraction = position - index;
+	if (index + 1 >= sorted.size())
+		return sorted.back();
+
+	return sorted[index] + (sorted[index + 1] - sorted[index]) * fraction;
+}
+
+static double Quantile(std::vector<double>& values, double quantile)
+{
+	// Nearest rank, same partial sort as Median
+	if (values.empty())
+		return 0.0;
+
+	const size_t rank = (size_t)(quantile * (values.size() - 1) + 0.5);
+	std::nth_element(values.begin(), values.begin() + rank, values.end());
+	return values[rank];
+}
+
+static double Median(std::vector<double>& values)
+{
+	// Partial sort is enough, this runs a few thousand times per metric while bootstrapping
+	if (values.empty())
+		return 0.0;
+
+	const size_t middle = values.size() / 2;
+	std::nth_element(values.begin(), values.begin() + middle, values.end());
+	const double upper = values[middle];
+	if (values.size() % 2)
+		return upper;
+
+	return (upper + *std::max_element(values.begin(), values.begin() + middle)) * 0.5;
+}
+
+// Reads "name": [ numbers ] out of one of our own result files, not a general json parser
+static bool ReadMetric(const std::string& json, const char* name, std::vector<double>& values)
+{
+	const std::string key = std::string("\"") + name + "\": [";
+	size_t position = json.find(key);
+	if (position == std::string::npos)
+		return false;
+
+	const char* c = json.c_str() + position + key.size();
+	for (;;)
+	{
+		while (*c == ' ' || *c == ',' || *c == '\n' || *c == '\r' || *c == '\t')
+			++c;
+
+		if (*c == ']' || *c == '\0')
+			break;
+
+		char* end = nullptr;
+		const double value = strtod(c, &end);
+		if (end == c)
+			return false;
+
+		values.push_back(value);
+		c = end;
+	}
+
+	return *c == ']';
+}
+
+static std::string ReadString(const std::string& json, const char* name)
+{
+	const std::string key = std::string("\"") + name + "\": \"";
+	const size_t position = json.find(key);
+	if (position == std::string::npos)
+		return "?";
+
+	const size_t start = position + key.size();
+	const size_t end = json.find('"', start);
+	return end == std::string::npos ? "?" : json.substr(start, end - start);
+}
+
+static double ReadNumber(const std::string& json, const char* name)
+{
+	const std::string key = std::string("\"") + name + "\": ";
+	const size_t position = json.find(key);
+	return position == std::string::npos ? 0.0 : atof(json.c_str() + position + key.size());
+}
+
+static bool ReadFile(const std::string& filename, std::string& contents)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename.c_str(), "rb") != 0 || file == nullptr)
+		return false;
+
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		contents.append(buffer, read);
+
+	fclose(file);
+	return true;
+}
+
+static bool WriteFile(const std::string& filename, const std::string& contents)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename.c_str(), "wb") != 0 || file == nullptr)
+		return false;
+
+	const bool result = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	fclose(file);
+	return result;
+}
+
+BenchmarkClass::BenchmarkClass() :
+	m_Scene(nullptr),
+	m_Jobs(nullptr),
+	m_framesProduced(0),
+	m_frequency(1),
+	m_frameStart(0),
+	m_lastFrameStart(0),
+	m_random(0x2545F491),
+	m_startupMs(0.0),
+	m_timeToFirstFrameMs(0.0),
+	m_Tree(nullptr),
+	m_lastShaderWrite(0),
+	m_shaderWrites(0),
+	m_reloadCount(0)
+{
+	ZeroMemory(&m_threadStart, sizeof(m_threadStart));
+	ZeroMemory(&m_processStart, sizeof(m_processStart));
+}
+
+BenchmarkClass::BenchmarkClass(const BenchmarkClass&)
+{
+}
+
+BenchmarkClass::~BenchmarkClass()
+{
+}
+
+void BenchmarkClass::GetDefaultSettings(BenchmarkSettingsType& settings)
+{
+	settings.scenario = SCENARIO_IDLE;
+	settings.warmupFrames = BENCHMARK_DEFAULT_WARMUP;
+	settings.measuredFrames = BENCHMARK_DEFAULT_FRAMES;
+	settings.threshold = BENCHMARK_DEFAULT_THRESHOLD;
+	settings.output.clear();
+	settings.baseline.clear();
+	settings.candidate.clear();
+	settings.lodsDisabled = false;
+}
+
+bool BenchmarkClass::FindScenario(const std::string& name, BenchmarkScenario& scenario)
+{
+	for (int i = 0; i < SCENARIO_COUNT; ++i)
+	{
+		if (name == SCENARIO_NAMES[i])
+		{
+			scenario = (BenchmarkScenario)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* BenchmarkClass::GetScenarioName(BenchmarkScenario scenario)
+{
+	return scenario >= 0 && scenario < SCENARIO_COUNT ? SCENARIO_NAMES[scenario] : "?";
+}
+
+bool BenchmarkClass::Initialize(const BenchmarkSettingsType& settings, SceneClass* scene, JobSystemClass* jobs)
+{
+	m_settings = settings;
+	m_Scene = scene;
+	m_Jobs = jobs;
+	m_framesProduced = 0;
+
+	FrameRecordType empty;
+	ZeroMemory(&empty, sizeof(empty));
+	empty.gpuMs = -1.0;
+	empty.reloadMs = -1.0;
+	empty.bvhMoveMs = -1.0;
+	empty.bvhQueryMs = -1.0;
+	m_frames.assign(m_settings.warmupFrames + m_settings.measuredFrames, empty);
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	m_frequency = frequency.QuadPart;
+
+	return SetupScenario();
+}
+
+void BenchmarkClass::Shutdown()
+{
+	m_shaderWrites = 0;
+
+	if (m_Tree)
+	{
+		m_Tree->Shutdown();
+		delete m_Tree;
+		m_Tree = nullptr;
+	}
+
+	m_frames.clear();
+	m_queryProxies.clear();
+	m_createSamples.clear();
+	m_entities.clear();
+	m_queryBoxes.clear();
+	m_queryRays.clear();
+	m_queryResults.clear();
+	m_rayHits.clear();
+	m_Scene = nullptr;
+	m_Jobs = nullptr;
+}
+
+void BenchmarkClass::BeginFrame()
+{
+	LARGE_INTEGER time;
+	QueryPerformanceCounter(&time);
+	m_lastFrameStart = m_frameStart;
+	m_frameStart = time.QuadPart;
+
+	AllocationCountType process;
+	GetAllocationCounts(process);
+	GetThreadAllocationCounts(m_threadStart);
+
+	// Whole frame numbers go from the previous frame start to this one, so they land on the previous frame
+	if (m_framesProduced > 0 && m_framesProduced <= m_frames.size())
+	{
+		FrameRecordType& previous = m_frames[(size_t)m_framesProduced - 1];
+		previous.frameMs = (double)(m_frameStart - m_lastFrameStart) * 1000.0 / (double)m_frequency;
+		previous.processAllocations = process.count - m_processStart.count;
+	}
+
+	m_processStart = process;
+}
+
+void BenchmarkClass::UpdateScenario(FramePacket& packet)
+{
+	packet.overlayStressQuads = 0;
+
+	switch (m_settings.scenario)
+	{
+		case SCENARIO_ECS_CHURN:
+		{
+			/*
+				Swap out a slice of the population every frame through the command buffer, the same way
+				a gameplay system would from inside iteration. Victims are a run of live entity indices from a random start,
+				freed indices get reused so they all stay below the population plus one frame's worth.
+			*/
+			EntityCommandBufferClass* commands = m_Scene->GetCommands();
+			EntityStoreClass* entities = m_Scene->GetEntities();
+			const unsigned int indexRange = CHURN_ENTITIES + CHURN_PER_FRAME;
+			const unsigned int start = NextRandom(m_random) % indexRange;
+			int destroyed = 0;
+			for (unsigned int i = 0; i < indexRange && destroyed < CHURN_PER_FRAME; ++i)
+			{
+				const EntityId victim = entities->GetEntity((start + i) % indexRange);
+				if (victim != INVALID_ENTITY)
+				{
+					commands->DestroyEntity(victim);
+					++destroyed;
+				}
+			}
+
+			for (int i = 0; i < destroyed; ++i)
+			{
+				const EntityId entity = commands->CreateEntity(COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_VELOCITY) |
+					COMPONENT_BIT(COMPONENT_BOUNDS) | COMPONENT_BIT(COMPONENT_RENDERABLE));
+
+				TransformComponent transform;
+				transform.position = XMFLOAT3(RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f, RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f,
+					RandomFloat(m_random, 0.0f, WORLD_SIZE));
+				transform.scale = 1.0f;
+				transform.rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+				commands->Set(entity, transform);
+
+				VelocityComponent velocity;
+				velocity.linear = XMFLOAT3(RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f));
+				velocity.spin = 0.0f;
+				commands->Set(entity, velocity);
+
+				BoundsComponent bounds;
+				bounds.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+				bounds.radius = 0.5f;
+				bounds.proxy = 0;
+				commands->Set(entity, bounds);
+
+				RenderableComponent renderable;
+				renderable.mesh = NextRandom(m_random) % SCENE_MESH_COUNT;
+				renderable.material = 0;
+				renderable.flags = RENDERABLE_CAST_SHADOWS;
+				renderable.lod = 0;
+				commands->Set(entity, renderable);
+			}
+			break;
+		}
+		case SCENARIO_BVH_QUERY:
+		{
+			/*
+				Every proxy drifts and bounces off the edges of the world, only the MoveProxy calls and the tree's Update are
+				timed as the move (small moves stay inside the fat box, the rest refit, and enough refits start a rebuild),
+				then the batched queries against the result. Both land in this frame's simulation time as well.
+			*/
+			const float halfSize = WORLD_SIZE * 0.5f;
+			for (QueryProxyType& proxy : m_queryProxies)
+			{
+				float* center = &proxy.center.x;
+				float* velocity = &proxy.velocity.x;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const float low = axis == 2 ? 0.0f : -halfSize;
+					const float high = axis == 2 ? WORLD_SIZE : halfSize;
+					center[axis] += velocity[axis] * BENCHMARK_TIME_STEP;
+					if ((center[axis] < low && velocity[axis] < 0.0f) || (center[axis] > high && velocity[axis] > 0.0f))
+						velocity[axis] = -velocity[axis];
+				}
+			}
+
+			LARGE_INTEGER start, moved, queried;
+			QueryPerformanceCounter(&start);
+
+			for (const QueryProxyType& proxy : m_queryProxies)
+			{
+				AabbType box;
+				box.min = XMFLOAT3(proxy.center.x - proxy.radius, proxy.center.y - proxy.radius, proxy.center.z - proxy.radius);
+				box.max = XMFLOAT3(proxy.center.x + proxy.radius, proxy.center.y + proxy.radius, proxy.center.z + proxy.radius);
+				m_Tree->MoveProxy(proxy.proxy, box);
+			}
+
+			m_Tree->Update();
+			QueryPerformanceCounter(&moved);
+
+			for (AabbType& box : m_queryBoxes)
+			{
+				const XMFLOAT3 center(RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f, RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f,
+					RandomFloat(m_random, 0.0f, WORLD_SIZE));
+				box.min = XMFLOAT3(center.x - 5.0f, center.y - 5.0f, center.z - 5.0f);
+				box.max = XMFLOAT3(center.x + 5.0f, center.y + 5.0f, center.z + 5.0f);
+			}
+
+			for (RayType& ray : m_queryRays)
+			{
+				ray.origin = XMFLOAT3(RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f, RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f, -10.0f);
+				XMStoreFloat3(&ray.direction, XMVector3Normalize(XMVectorSet(RandomFloat(m_random, -0.3f, 0.3f), RandomFloat(m_random, -0.3f, 0.3f), 1.0f, 0.0f)));
+				ray.maxDistance = WORLD_SIZE * 2.0f;
+			}
+
+			for (std::vector<unsigned int>& results : m_queryResults)
+				results.clear();
+
+			LARGE_INTEGER queryStart;
+			QueryPerformanceCounter(&queryStart);
+			m_Tree->QueryBoxes(m_queryBoxes.data(), (int)m_queryBoxes.size(), m_queryResults.data());
+			m_Tree->RayCasts(m_queryRays.data(), (int)m_queryRays.size(), m_rayHits.data());
+			QueryPerformanceCounter(&queried);
+
+			if (packet.frameIndex < m_frames.size())
+			{
+				FrameRecordType& frame = m_frames[(size_t)packet.frameIndex];
+				frame.bvhMoveMs = (double)(moved.QuadPart - start.QuadPart) * 1000.0 / (double)m_frequency;
+				frame.bvhQueryMs = (double)(queried.QuadPart - queryStart.QuadPart) * 1000.0 / (double)m_frequency;
+			}
+			break;
+		}
+		case SCENARIO_OVERLAY:
+		{
+			packet.overlayStressQuads = OVERLAY_QUADS;
+			break;
+		}
+		case SCENARIO_SHADOWS:
+		{
+			// Slow loop through the world, turning the whole time so the cascades slide sideways as well as forwards
+			const float time = (float)packet.frameIndex * BENCHMARK_TIME_STEP;
+			const float angle = time * SHADOW_CAMERA_SPEED / (WORLD_SIZE * 0.25f);
+			CameraClass* camera = m_Scene->GetCamera();
+			camera->SetPosition(sinf(angle) * WORLD_SIZE * 0.25f, 10.0f, WORLD_SIZE * 0.5f - cosf(angle) * WORLD_SIZE * 0.25f);
+			camera->SetRotation(10.0f, XMConvertToDegrees(angle) + 90.0f, 0.0f);
+			break;
+		}
+		case SCENARIO_LODS:
+		{
+			// Into the field and back out, so every object goes through its whole chain both ways
+			const float time = (float)packet.frameIndex * BENCHMARK_TIME_STEP;
+			const float travel = fmodf(time * LOD_CAMERA_SPEED, LOD_FIELD_DEPTH * 2.0f);
+			const float z = travel < LOD_FIELD_DEPTH ? travel : LOD_FIELD_DEPTH * 2.0f - travel;
+			CameraClass* camera = m_Scene->GetCamera();
+			camera->SetPosition(0.0f, 0.0f, z - 10.0f);
+			camera->SetRotation(0.0f, 0.0f, 0.0f);
+			break;
+		}
+		case SCENARIO_SHADER_RELOAD:
+		{
+			/*
+				Saves one of the overlay's shaders like an editor would, taking turns between the two. Real time rather than
+				frames, the watcher only reports a file once it's been quiet for its debounce time. The write is small but it
+				does land in this frame's simulation time.
+			*/
+			if ((double)(m_frameStart - m_lastShaderWrite) * 1000.0 / (double)m_frequency >= RELOAD_PERIOD_MS)
+			{
+				const int file = m_shaderWrites % 2;
+				char edit[64];
+				sprintf_s(edit, sizeof(edit), "\n// benchmark reload %d\n", m_shaderWrites);
+				WriteFile(std::string(BENCHMARK_SHADER_DIRECTORY) + "/" + RELOAD_FILES[file], m_shaderSources[file] + edit);
+
+				m_lastShaderWrite = m_frameStart;
+				++m_shaderWrites;
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void BenchmarkClass::EndFrame(const FramePacket& packet)
+{
+	const unsigned long long frameIndex = packet.frameIndex;
+
+	LARGE_INTEGER time;
+	QueryPerformanceCounter(&time);
+
+	AllocationCountType thread;
+	GetThreadAllocationCounts(thread);
+
+	if (frameIndex < m_frames.size())
+	{
+		FrameRecordType& frame = m_frames[(size_t)frameIndex];
+		frame.simulationMs = (double)(time.QuadPart - m_frameStart) * 1000.0 / (double)m_frequency;
+		frame.allocations = thread.count - m_threadStart.count;
+		frame.allocatedBytes = thread.bytes - m_threadStart.bytes;
+		frame.cascadesRedrawn = (unsigned int)packet.shadows.cascadesRedrawn;
+		frame.castersSubmitted = (unsigned int)packet.shadows.castersSubmitted;
+		frame.trianglesSubmitted = packet.trianglesSubmitted;
+	}
+
+	++m_framesProduced;
+}
+
+void BenchmarkClass::RecordRenderTime(unsigned long long frameIndex, double milliseconds)
+{
+	// Each frame's slot is only written by one thread, and the render thread is joined before anything reads it
+	if (frameIndex < m_frames.size())
+		m_frames[(size_t)frameIndex].renderMs = milliseconds;
+}
+
+void BenchmarkClass::RecordGpuTime(unsigned long long frameIndex, double milliseconds)
+{
+	if (frameIndex < m_frames.size())
+		m_frames[(size_t)frameIndex].gpuMs = milliseconds;
+}
+
+void BenchmarkClass::RecordReloads(unsigned long long frameIndex, int reloadCount, double milliseconds)
+{
+	// Reloads are swapped in at the start of a frame, the one that went in this frame goes with it
+	if (reloadCount != m_reloadCount && frameIndex < m_frames.size())
+		m_frames[(size_t)frameIndex].reloadMs = milliseconds;
+
+	m_reloadCount = reloadCount;
+}
+
+bool BenchmarkClass::WriteMesh(const char* filename)
+{
+	// Same steps as -buildmesh, so the chains the scene picks from are the ones in the file that gets drawn
+	std::vector<SourceVertexType> vertices;
+	BuildSphere(vertices);
+
+	MeshBuilderClass builder;
+	if (builder.LoadTriangles(vertices) == false)
+		return false;
+
+	builder.GenerateLods(MESH_MAX_LODS);
+	builder.OptimizeVertexCache();
+	builder.OptimizeOverdraw(MESH_OVERDRAW_THRESHOLD);
+	builder.OptimizeVertexFetch();
+	return builder.Write(filename);
+}
+
+bool BenchmarkClass::WriteShaders(const char* directory)
+{
+	if (CreateDirectoryA(directory, nullptr) == FALSE && GetLastError() != ERROR_ALREADY_EXISTS)
+		return false;
+
+	// Fresh copies every run, so edits a previous run left behind don't carry over
+	for (const char* pattern : SHADER_FILE_PATTERNS)
+	{
+		WIN32_FIND_DATAA findData;
+		HANDLE find = FindFirstFileA(pattern, &findData);
+		if (find == INVALID_HANDLE_VALUE)
+			continue;
+
+		bool result = true;
+		do
+		{
+			if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+				result = CopyFileA(findData.cFileName, (std::string(directory) + "\\" + findData.cFileName).c_str(), FALSE) != FALSE;
+		} while (result && FindNextFileA(find, &findData));
+		FindClose(find);
+
+		if (result == false)
+			return false;
+	}
+
+	return true;
+}
+
+void BenchmarkClass::SetStartupTimes(double startupMs, double timeToFirstFrameMs)
+{
+	m_startupMs = startupMs;
+	m_timeToFirstFrameMs = timeToFirstFrameMs;
+}
+
+void BenchmarkClass::FinishRun()
+{
+	if (m_settings.scenario != SCENARIO_BVH_QUERY || m_Tree == nullptr)
+		return;
+
+	// Bulk insert into an empty tree, a few times over for a spread to compare. The frames are done with the tree
+	for (int run = 0; run < QUERY_CREATE_RUNS; ++run)
+	{
+		m_Tree->Shutdown();
+		if (m_Tree->Initialize(m_Jobs) == false)
+			return;
+
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter(&start);
+		CreateQueryProxies();
+		QueryPerformanceCounter(&end);
+
+		m_createSamples.push_back((double)(end.QuadPart - start.QuadPart) * 1000.0 / (double)m_frequency);
+	}
+}
+
+bool BenchmarkClass::IsFinished()
+{
+	return m_framesProduced >= m_frames.size();
+}
+
+bool BenchmarkClass::WriteResults()
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, m_settings.output.c_str(), "w") != 0 || file == nullptr)
+		return false;
+
+#ifdef _DEBUG
+	const char* configuration = "Debug";
+#else
+	const char* configuration = "Release";
+#endif
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"scenario\": \"%s\",\n", GetScenarioName(m_settings.scenario));
+	fprintf(file, "  \"build\": \"%s %s %s\",\n", configuration, __DATE__, __TIME__);
+	fprintf(file, "  \"threads\": %d,\n", m_Jobs ? m_Jobs->GetThreadCount() : 1);
+	fprintf(file, "  \"lods\": \"%s\",\n", m_settings.lodsDisabled ? "off" : "on");
+	fprintf(file, "  \"warmupFrames\": %d,\n", m_settings.warmupFrames);
+	fprintf(file, "  \"measuredFrames\": %d,\n", m_settings.measuredFrames);
+	fprintf(file, "  \"startupMs\": %.3f,\n", m_startupMs);
+	fprintf(file, "  \"timeToFirstFrameMs\": %.3f,\n", m_timeToFirstFrameMs);
+	fprintf(file, "  \"metrics\": {\n");
+
+	// Only the measured frames. The very last frame has no whole frame time (there's no next frame start), it repeats the one before
+	const size_t first = (size_t)m_settings.warmupFrames;
+	const size_t count = m_frames.size() - first;
+	std::vector<double> values;
+	for (int metric = 0; metric < METRIC_COUNT; ++metric)
+	{
+		values.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const FrameRecordType& frame = m_frames[first + i];
+			switch (metric)
+			{
+				case 0: values[i] = frame.frameMs; break;
+				case 1: values[i] = frame.simulationMs; break;
+				case 2: values[i] = frame.renderMs; break;
+				case 3: values[i] = frame.gpuMs; break;
+				case 4: values[i] = frame.reloadMs; break;
+				case 5: values[i] = -1.0; break;
+				case 6: values[i] = frame.bvhMoveMs; break;
+				case 7: values[i] = frame.bvhQueryMs; break;
+				case 8: values[i] = (double)frame.allocations; break;
+				case 9: values[i] = (double)frame.allocatedBytes; break;
+				case 10: values[i] = (double)frame.processAllocations; break;
+				case 11: values[i] = (double)frame.cascadesRedrawn; break;
+				case 12: values[i] = (double)frame.castersSubmitted; break;
+				default: values[i] = (double)frame.trianglesSubmitted; break;
+			}
+		}
+
+		if (metric == 0 && count > 1)
+			values[count - 1] = values[count - 2];
+
+		// Bulk creates aren't per frame, one sample per FinishRun run
+		if (metric == 5)
+			values = m_createSamples;
+
+		// E.g. frames the profiler dropped, or hadn't read back yet when the run ended, have no gpu time
+		if (METRIC_IS_SPARSE[metric])
+			values.erase(std::remove_if(values.begin(), values.end(), [](double value) { return value < 0.0; }), values.end());
+
+		WriteMetric(file, METRIC_NAMES[metric], values, metric + 1 == METRIC_COUNT);
+	}
+
+	fprintf(file, "  }\n}\n");
+	fclose(file);
+	return true;
+}
+
+void BenchmarkClass::WriteMetric(FILE* file, const char* name, const std::vector<double>& values, bool last)
+{
+	std::vector<double> sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+
+	double mean = 0.0;
+	for (double value : values)
+		mean += value;
+	mean /= values.empty() ? 1.0 : (double)values.size();
+
+	double variance = 0.0;
+	for (double value : values)
+		variance += (value - mean) * (value - mean);
+	variance /= values.size() > 1 ? (double)(values.size() - 1) : 1.0;
+
+	fprintf(file, "    \"%s\": {\n", name);
+	fprintf(file, "      \"mean\": %.6f, \"median\": %.6f, \"stddev\": %.6f, \"min\": %.6f, \"p95\": %.6f, \"p99\": %.6f, \"max\": %.6f,\n",
+		mean, Percentile(sorted, 0.5), sqrt(variance), sorted.empty() ? 0.0 : sorted.front(), Percentile(sorted, 0.95), Percentile(sorted, 0.99),
+		sorted.empty() ? 0.0 : sorted.back());
+	fprintf(file, "      \"%s\": [", name);
+	for (size_t i = 0; i < values.size(); ++i)
+		fprintf(file, "%s%.6g", i ? ", " : "", values[i]);
+	fprintf(file, "]\n    }%s\n", last ? "" : ",");
+}
+
+bool BenchmarkClass::SetupScenario()
+{
+	int objectCount = 0;
+	int lightCount = 0;
+	switch (m_settings.scenario)
+	{
+		case SCENARIO_DRIFT:
+		case SCENARIO_SHADER_RELOAD: m_Scene->CreateDemoObjects(); break;
+		case SCENARIO_ECS_ITERATE: objectCount = ITERATE_ENTITIES; break;
+		case SCENARIO_ECS_CHURN: objectCount = CHURN_ENTITIES; break;
+		case SCENARIO_LIGHTS_256: lightCount = LIGHTS_SMALL; break;
+		case SCENARIO_LIGHTS_1024: lightCount = LIGHTS_MEDIUM; break;
+		case SCENARIO_LIGHTS_4096: lightCount = LIGHTS_LARGE; break;
+		case SCENARIO_SHADOWS: objectCount = SHADOW_STATIC_ENTITIES + SHADOW_DYNAMIC_ENTITIES; break;
+		default: break;
+	}
+
+	m_Scene->GetLods()->SetEnabled(m_settings.lodsDisabled == false);
+
+	// The chains come from the mesh pass's own file (WriteMesh), the LOD picked here is the one that gets drawn
+	if (m_settings.scenario == SCENARIO_LODS)
+	{
+		// Standing still so the only thing changing from frame to frame is the distance to the camera
+		for (int i = 0; i < LOD_ENTITIES; ++i)
+		{
+			const XMFLOAT3 position(RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.25f, RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.25f,
+				RandomFloat(m_random, 0.0f, LOD_FIELD_DEPTH));
+			m_entities.push_back(m_Scene->CreateObject(position, 1.0f, NextRandom(m_random) % SCENE_MESH_COUNT, XMFLOAT3(0.0f, 0.0f, 0.0f)));
+		}
+	}
+
+	for (int i = 0; i < objectCount; ++i)
+	{
+		const XMFLOAT3 position(RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f, RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f,
+			RandomFloat(m_random, 0.0f, WORLD_SIZE));
+		// Shadows: the first ones stand still, which makes them static casters
+		const bool still = m_settings.scenario == SCENARIO_SHADOWS && i < SHADOW_STATIC_ENTITIES;
+		const XMFLOAT3 velocity = still ? XMFLOAT3(0.0f, 0.0f, 0.0f) :
+			XMFLOAT3(RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f));
+		m_entities.push_back(m_Scene->CreateObject(position, RandomFloat(m_random, 0.25f, 1.0f), NextRandom(m_random) % SCENE_MESH_COUNT, velocity));
+	}
+
+	// Spread through the part of the view the clusters cover, a quarter of them spots pointing every which way
+	for (int i = 0; i < lightCount; ++i)
+	{
+		const XMFLOAT3 position(RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.25f, RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.15f,
+			RandomFloat(m_random, 0.0f, WORLD_SIZE));
+		const XMFLOAT3 color(RandomFloat(m_random, 0.2f, 1.0f), RandomFloat(m_random, 0.2f, 1.0f), RandomFloat(m_random, 0.2f, 1.0f));
+		const XMFLOAT3 direction(RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f));
+		const float spotAngle = NextRandom(m_random) % 4 == 0 ? RandomFloat(m_random, 0.2f, 0.8f) : 0.0f;
+		const XMFLOAT3 velocity(RandomFloat(m_random, -2.0f, 2.0f), RandomFloat(m_random, -2.0f, 2.0f), RandomFloat(m_random, -2.0f, 2.0f));
+		m_entities.push_back(m_Scene->CreateLight(position, color, RandomFloat(m_random, 2.0f, 8.0f), direction, spotAngle, velocity));
+	}
+
+	if (m_settings.scenario == SCENARIO_BVH_QUERY)
+	{
+		// Sized once so the measured frames only measure the tree
+		m_queryBoxes.resize(QUERY_BOXES);
+		m_queryRays.resize(QUERY_RAYS);
+		m_queryResults.resize(QUERY_BOXES);
+		m_rayHits.resize(QUERY_RAYS);
+		for (std::vector<unsigned int>& results : m_queryResults)
+			results.reserve(1024);
+
+		// Its own tree rather than the scene's, so the proxies aren't entities and only the tree's own work gets timed
+		m_Tree = new AabbTreeClass();
+		if (m_Tree == nullptr)
+			return false;
+
+		m_queryProxies.resize(QUERY_PROXIES);
+		for (QueryProxyType& proxy : m_queryProxies)
+		{
+			proxy.center = XMFLOAT3(RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f, RandomFloat(m_random, -WORLD_SIZE, WORLD_SIZE) * 0.5f,
+				RandomFloat(m_random, 0.0f, WORLD_SIZE));
+			proxy.radius = RandomFloat(m_random, 0.25f, 1.0f);
+			proxy.velocity = XMFLOAT3(RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f));
+			proxy.proxy = -1;
+		}
+
+		if (m_Tree->Initialize(m_Jobs) == false)
+			return false;
+
+		// Not timed here, it would count towards startup. FinishRun times it once the frames are done
+		CreateQueryProxies();
+
+		// Start from a fully built tree rather than measuring the first rebuild
+		m_Tree->Rebuild(true);
+	}
+
+	// Every edit is the copy WriteShaders made plus a comment, the shaders in the asset directory are never touched
+	if (m_settings.scenario == SCENARIO_SHADER_RELOAD)
+	{
+		for (int file = 0; file < 2; ++file)
+		{
+			m_shaderSources[file].clear();
+			if (ReadFile(std::string(BENCHMARK_SHADER_DIRECTORY) + "/" + RELOAD_FILES[file], m_shaderSources[file]) == false)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void BenchmarkClass::CreateQueryProxies()
+{
+	for (size_t i = 0; i < m_queryProxies.size(); ++i)
+	{
+		QueryProxyType& proxy = m_queryProxies[i];
+		AabbType box;
+		box.min = XMFLOAT3(proxy.center.x - proxy.radius, proxy.center.y - proxy.radius, proxy.center.z - proxy.radius);
+		box.max = XMFLOAT3(proxy.center.x + proxy.radius, proxy.center.y + proxy.radius, proxy.center.z + proxy.radius);
+		proxy.proxy = m_Tree->CreateProxy(box, (unsigned int)i);
+	}
+}
+
+int BenchmarkClass::Compare(const BenchmarkSettingsType& settings)
+{
+	std::string baseline, candidate;
+	if (ReadFile(settings.baseline, baseline) == false || ReadFile(settings.candidate, candidate) == false)
+		return 2;
+
+	FILE* report = nullptr;
+	if (fopen_s(&report, settings.output.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	fprintf(report, "baseline  %s: %s (%s, lods %s)\n", settings.baseline.c_str(), ReadString(baseline, "scenario").c_str(), ReadString(baseline, "build").c_str(),
+		ReadString(baseline, "lods").c_str());
+	fprintf(report, "candidate %s: %s (%s, lods %s)\n", settings.candidate.c_str(), ReadString(candidate, "scenario").c_str(), ReadString(candidate, "build").c_str(),
+		ReadString(candidate, "lods").c_str());
+	if (ReadString(baseline, "scenario") != ReadString(candidate, "scenario"))
+		fprintf(report, "WARNING: different scenarios, the comparison is meaningless\n");
+
+	fprintf(report, "threshold %.2f%%, medians (and frame time p99/max) with bootstrap 95%% confidence intervals (%d resamples)\n\n",
+		settings.threshold, BENCHMARK_BOOTSTRAP_SAMPLES);
+	fprintf(report, "%-20s %14s %14s %10s %24s  %s\n", "metric", "baseline", "candidate", "change", "95% interval", "verdict");
+
+	int exitCode = 0;
+	unsigned int random = 0x9E3779B9;
+	for (int metric = 0; metric < METRIC_COUNT; ++metric)
+	{
+		std::vector<double> base, test;
+		if (ReadMetric(baseline, METRIC_NAMES[metric], base) == false || ReadMetric(candidate, METRIC_NAMES[metric], test) == false ||
+			base.empty() || test.empty())
+		{
+			fprintf(report, "%-20s missing\n", METRIC_NAMES[metric]);
+			continue;
+		}
+
+		std::vector<double> scratch = base;
+		const double baseMedian = Median(scratch);
+		scratch = test;
+		const double testMedian = Median(scratch);
+
+		/*
+			Counts (allocations) are usually 0 so a relative change is meaningless, any increase in the median is a regression.
+			Times: resample both runs with replacement, take the relative change of the statistic (median, p99, max) each time,
+			the 2.5th and 97.5th percentiles of those are the interval.
+		*/
+		if (METRIC_IS_TIME[metric] == false)
+		{
+			const bool worse = testMedian > baseMedian && METRIC_IS_GATED[metric];
+			fprintf(report, "%-20s %14.1f %14.1f %10s %24s  %s\n", METRIC_NAMES[metric], baseMedian, testMedian, "", "",
+				worse ? "REGRESSION" : METRIC_IS_GATED[metric] ? "ok" : "info");
+			if (worse)
+				exitCode = 1;
+			continue;
+		}
+
+		const char* const statisticNames[] = { "", " p99", " max" };
+		const double quantiles[] = { 0.5, 0.99, 1.0 };
+		const int statisticCount = METRIC_GATES_TAIL[metric] ? 3 : 1;
+		for (int statistic = 0; statistic < statisticCount; ++statistic)
+		{
+			const double quantile = quantiles[statistic];
+			scratch = base;
+			const double baseValue = statistic == 0 ? baseMedian : Quantile(scratch, quantile);
+			scratch = test;
+			const double testValue = statistic == 0 ? testMedian : Quantile(scratch, quantile);
+
+			std::vector<double> changes(BENCHMARK_BOOTSTRAP_SAMPLES);
+			std::vector<double> baseSample(base.size()), testSample(test.size());
+			for (int sample = 0; sample < BENCHMARK_BOOTSTRAP_SAMPLES; ++sample)
+			{
+				for (double& value : baseSample)
+					value = base[NextRandom(random) % base.size()];
+				for (double& value : testSample)
+					value = test[NextRandom(random) % test.size()];
+
+				const double sampleBase = statistic == 0 ? Median(baseSample) : Quantile(baseSample, quantile);
+				const double sampleTest = statistic == 0 ? Median(testSample) : Quantile(testSample, quantile);
+				changes[sample] = sampleBase > 0.0 ? (sampleTest - sampleBase) / sampleBase * 100.0 : 0.0;
+			}
+
+			std::sort(changes.begin(), changes.end());
+			const double low = Percentile(changes, 0.025);
+			const double high = Percentile(changes, 0.975);
+			const double change = baseValue > 0.0 ? (testValue - baseValue) / baseValue * 100.0 : 0.0;
+
+			const char* verdict = "no change";
+			if (low > settings.threshold)
+			{
+				verdict = "REGRESSION";
+				exitCode = 1;
+			}
+			else if (high < -settings.threshold)
+			{
+				verdict = "improvement";
+			}
+			else if (low > 0.0 || high < 0.0)
+			{
+				verdict = "within threshold";
+			}
+
+			const std::string name = std::string(METRIC_NAMES[metric]) + statisticNames[statistic];
+			char interval[64];
+			sprintf_s(interval, sizeof(interval), "[%+.2f%%, %+.2f%%]", low, high);
+			fprintf(report, "%-20s %14.4f %14.4f %+9.2f%% %24s  %s\n", name.c_str(), baseValue, testValue, change, interval, verdict);
+		}
+	}
+
+	/*
+		One sample per run so there's no interval to gate on, startup is reported for tracking only.
+		Run the same build a few times to see how much it moves on its own before reading anything into it.
+	*/
+	fprintf(report, "\n");
+	const char* const startupNames[] = { "startupMs", "timeToFirstFrameMs" };
+	for (const char* name : startupNames)
+	{
+		const double base = ReadNumber(baseline, name);
+		const double test = ReadNumber(candidate, name);
+		fprintf(report, "%-20s %14.1f %14.1f %+9.2f%% %24s  %s\n", name, base, test, base > 0.0 ? (test - base) / base * 100.0 : 0.0, "", "info");
+	}
+
+	fclose(report);
+	return exitCode;
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "allocationcounter.h"
+#include "aabbtreeclass.h"
+#include "framequeueclass.h"
+#include "sceneclass.h"
+
+/*
+	Benchmark runs and comparing them, main.cpp picks these out of the command line:
+
+		-benchmark <scenario> [-warmup N] [-frames N] [-nolod] [-out results.json]
+		-compare <baseline.json> <candidate.json> [-threshold percent] [-out report.txt]
+
+	A run boots the engine with a hidden window, vsync off and a fixed time step, sets up the named scenario,
+	throws away the warmup frames and records per frame cpu times (simulation on the main thread, render thread,
+	whole frame) and allocation counts for the measured ones, then writes them as json and quits. Gpu frame time comes
+	from the profiler's timestamps, a few frames late, frames it dropped are left out.
+	Startup time and time to first frame go in too, one number per run.
+	Every run draws the same generated sphere (BENCHMARK_MESH_FILE) instead of the mesh files in the asset directory.
+	-nolod draws everything at full detail and without the triangle budget, run the lods scenario with and without it
+	and compare gpuMs of the two to see what the LODs are worth.
+	bvh_query splits the tree's cost three ways: bvhCreateMs is a bulk CreateProxy of every proxy into an empty tree,
+	timed several times after the last frame so it stays out of the startup numbers, bvhMoveMs is each frame's MoveProxy calls plus Update, and bvhQueryMs
+	each frame's batched box queries and ray casts.
+	shader_reload compiles and watches copies of the shaders in BENCHMARK_SHADER_DIRECTORY and saves its sprite.vs and
+	sprite.ps in turn every quarter second while it runs, the real ones are never touched. reloadMs is the shader
+	cache's reload latency with one sample per reload.
+	Compare reads two of those files and for every metric works out the relative change of the median with a
+	bootstrap 95% confidence interval (frame times are skewed and have outliers, a t-test on the mean would lie).
+	Whole frame time gets the same for its p99 and max, a reload that stalls the odd frame doesn't move the median.
+	A metric only counts as a regression if the whole interval is above the threshold, the exit code is 1 then
+	so a build script can gate on it.
+*/
+
+const int BENCHMARK_DEFAULT_WARMUP = 120;
+const int BENCHMARK_DEFAULT_FRAMES = 1000;
+const double BENCHMARK_DEFAULT_THRESHOLD = 2.0; // percent
+const int BENCHMARK_BOOTSTRAP_SAMPLES = 2000;
+const float BENCHMARK_TIME_STEP = 1.0f / 60.0f;
+const char* const BENCHMARK_DEFAULT_OUTPUT = "benchmark.json";
+const char* const BENCHMARK_DEFAULT_REPORT = "benchmark_compare.txt";
+const char* const BENCHMARK_MESH_FILE = "benchmark_sphere.mesh";
+const char* const BENCHMARK_SHADER_DIRECTORY = "benchmark_shaders"; // shader_reload's copies of the shaders
+
+enum BenchmarkScenario
+{
+	SCENARIO_IDLE, // empty scene, fixed per frame overhead
+	SCENARIO_DRIFT, // the demo scene
+	SCENARIO_ECS_ITERATE, // lots of moving entities, movement/bounds/render systems
+	SCENARIO_ECS_CHURN, // entities created and destroyed through a command buffer every frame
+	SCENARIO_BVH_QUERY, // 100k moving proxies in a tree of their own, moves, refits and rebuilds plus batched box queries and ray casts
+	SCENARIO_OVERLAY, // thousands of overlay quads, sprite batch throughput
+	SCENARIO_LIGHTS_256, // moving point and spot lights binned into the clusters every frame
+	SCENARIO_LIGHTS_1024,
+	SCENARIO_LIGHTS_4096,
+	SCENARIO_SHADOWS, // mostly static scene under a flying camera, shadow cascade caching
+	SCENARIO_LODS, // a long field of detailed spheres with LOD chains, the camera flying through it
+	SCENARIO_SHADER_RELOAD, // the demo scene while the overlay's shaders are saved over and over, hot reload under churn
+	SCENARIO_COUNT
+};
+
+// What -benchmark and -compare take, output is the results file of a run or the report of a comparison
+struct BenchmarkSettingsType
+{
+	BenchmarkScenario scenario;
+	int warmupFrames;
+	int measuredFrames;
+	double threshold;
+	std::string output;
+	std::string baseline;
+	std::string candidate;
+	bool lodsDisabled;
+};
+
+class BenchmarkClass
+{
+private:
+	struct FrameRecordType
+	{
+		double simulationMs;
+		double renderMs;
+		double gpuMs; // -1 until the profiler reads the frame back
+		double reloadMs; // latency of the shader reload swapped in this frame, -1 if there wasn't one
+		double bvhMoveMs; // bvh_query only, -1 otherwise
+		double bvhQueryMs;
+		double frameMs;
+		unsigned long long allocations; // main thread, while simulating
+		unsigned long long allocatedBytes;
+		unsigned long long processAllocations; // every thread, frame start to frame start
+		unsigned int cascadesRedrawn;
+		unsigned int castersSubmitted;
+		unsigned int trianglesSubmitted;
+	};
+
+	struct QueryProxyType
+	{
+		XMFLOAT3 center;
+		float radius;
+		XMFLOAT3 velocity;
+		int proxy;
+	};
+
+public:
+	BenchmarkClass();
+	BenchmarkClass(const BenchmarkClass&);
+	~BenchmarkClass();
+
+	// Everything at its default, output left empty
+	static void GetDefaultSettings(BenchmarkSettingsType&);
+	// False if there's no scenario by that name
+	static bool FindScenario(const std::string&, BenchmarkScenario&);
+	// Returns the process exit code, 0 = fine, 1 = regression, 2 = couldn't read the inputs
+	static int Compare(const BenchmarkSettingsType&);
+	static const char* GetScenarioName(BenchmarkScenario);
+	// The sphere every run draws through the mesh pass, LOD chain included, written before the meshes are loaded
+	static bool WriteMesh(const char*);
+	// Copies every shader source into this directory, shader_reload points the cache and the watcher at it
+	static bool WriteShaders(const char*);
+
+	// Scene and job system for the scenarios
+	bool Initialize(const BenchmarkSettingsType&, SceneClass*, JobSystemClass*);
+	void Shutdown();
+
+	// Main thread, brackets producing one packet. UpdateScenario does the scenario's own per frame work
+	void BeginFrame();
+	void UpdateScenario(FramePacket&);
+	void EndFrame(const FramePacket&);
+	// Render thread
+	void RecordRenderTime(unsigned long long, double);
+	void RecordGpuTime(unsigned long long, double);
+	// The shader cache's reload count and last latency after the frame, a count that changed means a reload went in
+	void RecordReloads(unsigned long long, int, double);
+	// Startup graph finished and first Present returned, both ms from startup (StartupGraphClass)
+	void SetStartupTimes(double, double);
+	// Main thread, after the last frame and with the render thread gone. Timings that would otherwise land in startup
+	void FinishRun();
+
+	// Every warmup and measured packet has been produced
+	bool IsFinished();
+	bool WriteResults();
+
+private:
+	// False if the scenario couldn't be set up
+	bool SetupScenario();
+	// bvh_query: every proxy into m_Tree at its current position
+	void CreateQueryProxies();
+	void WriteMetric(FILE*, const char*, const std::vector<double>&, bool);
+
+private:
+	BenchmarkSettingsType m_settings;
+	SceneClass* m_Scene;
+	JobSystemClass* m_Jobs;
+	std::vector<FrameRecordType> m_frames; // warmup + measured, preallocated so recording doesn't allocate
+	unsigned long long m_framesProduced;
+	long long m_frequency;
+	long long m_frameStart;
+	long long m_lastFrameStart;
+	AllocationCountType m_threadStart;
+	AllocationCountType m_processStart;
+	unsigned int m_random;
+	double m_startupMs;
+	double m_timeToFirstFrameMs;
+
+	// Scenario state
+	std::vector<EntityId> m_entities;
+	std::vector<AabbType> m_queryBoxes;
+	std::vector<RayType> m_queryRays;
+	std::vector<std::vector<unsigned int>> m_queryResults;
+	std::vector<RayHitType> m_rayHits;
+	AabbTreeClass* m_Tree; // bvh_query's
+	std::vector<QueryProxyType> m_queryProxies;
+	std::vector<double> m_createSamples; // ms per bulk create
+	std::string m_shaderSources[2]; // the reload scenario's copies as WriteShaders made them
+	long long m_lastShaderWrite;
+	int m_shaderWrites;
+	int m_reloadCount; // render thread
+};
@@ -0,0 +1,626 @@
+#include "blockcompress.h"
+
+#include <emmintrin.h>
+#include <float.h>
+#include <string.h>
+
+// One block's texels as floats 0-255, a register per row of four texels, four registers per channel (r, g, b, a)
+struct BlockTexelsType
+{
+	__m128 channels[4][4];
+};
+
+static const unsigned int BC1_INDICES[4] = { 0, 2, 3, 1 }; // steps from color0 to color1 as BC1 indices
+static const unsigned int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static void LoadBlock(const unsigned char* texels, BlockTexelsType& block)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	for (int row = 0; row < 4; ++row)
+	{
+		const __m128i rgba = _mm_loadu_si128((const __m128i*)(texels + row * 16));
+		block.channels[0][row] = _mm_cvtepi32_ps(_mm_and_si128(rgba, mask));
+		block.channels[1][row] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgba, 8), mask));
+		block.channels[2][row] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgba, 16), mask));
+		block.channels[3][row] = _mm_cvtepi32_ps(_mm_srli_epi32(rgba, 24));
+	}
+}
+
+static float HorizontalSum(__m128 value)
+{
+	value = _mm_add_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+	value = _mm_add_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(value);
+}
+
+static void ChannelRange(const __m128* channel, float& low, float& high)
+{
+	__m128 minimum = _mm_min_ps(_mm_min_ps(channel[0], channel[1]), _mm_min_ps(channel[2], channel[3]));
+	__m128 maximum = _mm_max_ps(_mm_max_ps(channel[0], channel[1]), _mm_max_ps(channel[2], channel[3]));
+	minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+	minimum = _mm_min_ps(minimum, _mm_shuffle_ps(minimum, minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+	maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+	maximum = _mm_max_ps(maximum, _mm_shuffle_ps(maximum, maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+	low = _mm_cvtss_f32(minimum);
+	high = _mm_cvtss_f32(maximum);
+}
+
+static void StoreSteps(const __m128* steps, int* output)
+{
+	for (int row = 0; row < 4; ++row)
+		_mm_storeu_si128((__m128i*)(output + row * 4), _mm_cvtps_epi32(steps[row]));
+}
+
+/*
+	Starting line for the endpoints: the bounding box shrunk by its size / inset at both ends (the outliers are rarely
+	worth an endpoint), corner to corner along the diagonal the texels follow. Start is the high end of the widest
+	channel, every other channel that falls while that one rises has its ends swapped.
+*/
+static void BoundingLine(const BlockTexelsType& block, int channelCount, float inset, float* start, float* end)
+{
+	int widest = 0;
+	float widestRange = -1.0f;
+	for (int c = 0; c < channelCount; ++c)
+	{
+		float low, high;
+		ChannelRange(block.channels[c], low, high);
+		const float shrink = (high - low) / inset;
+		start[c] = high - shrink;
+		end[c] = low + shrink;
+
+		if (high - low > widestRange)
+		{
+			widest = c;
+			widestRange = high - low;
+		}
+	}
+
+	const __m128 widestCenter = _mm_set1_ps((start[widest] + end[widest]) * 0.5f);
+	for (int c = 0; c < channelCount; ++c)
+	{
+		if (c == widest)
+			continue;
+
+		const __m128 center = _mm_set1_ps((start[c] + end[c]) * 0.5f);
+		__m128 covariance = _mm_setzero_ps();
+		for (int row = 0; row < 4; ++row)
+			covariance = _mm_add_ps(covariance, _mm_mul_ps(_mm_sub_ps(block.channels[c][row], center), _mm_sub_ps(block.channels[widest][row], widestCenter)));
+
+		if (HorizontalSum(covariance) < 0.0f)
+		{
+			const float swap = start[c];
+			start[c] = end[c];
+			end[c] = swap;
+		}
+	}
+}
+
+// For every texel the nearest of steps + 1 evenly spaced points from start to end, as a step number. Returns the squared error
+static float FitSteps(const BlockTexelsType& block, int channelCount, const float* start, const float* end, float steps, __m128* output)
+{
+	__m128 origin[4], direction[4];
+	float lengthSq = 0.0f;
+	for (int c = 0; c < channelCount; ++c)
+	{
+		origin[c] = _mm_set1_ps(start[c]);
+		direction[c] = _mm_set1_ps(end[c] - start[c]);
+		lengthSq += (end[c] - start[c]) * (end[c] - start[c]);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 scale = _mm_set1_ps(lengthSq > 0.0f ? steps / lengthSq : 0.0f);
+	const __m128 last = _mm_set1_ps(steps);
+	const __m128 stepSize = _mm_set1_ps(1.0f / steps);
+	__m128 error = zero;
+
+	for (int row = 0; row < 4; ++row)
+	{
+		__m128 projection = zero;
+		for (int c = 0; c < channelCount; ++c)
+			projection = _mm_add_ps(projection, _mm_mul_ps(_mm_sub_ps(block.channels[c][row], origin[c]), direction[c]));
+
+		// cvtps rounds to nearest
+		const __m128 step = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(projection, scale), zero), last)));
+		output[row] = step;
+
+		const __m128 weight = _mm_mul_ps(step, stepSize);
+		for (int c = 0; c < channelCount; ++c)
+		{
+			const __m128 difference = _mm_sub_ps(block.channels[c][row], _mm_add_ps(origin[c], _mm_mul_ps(direction[c], weight)));
+			error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+		}
+	}
+
+	return HorizontalSum(error);
+}
+
+// Least squares endpoints for the steps the texels got, false when they all got the same one and there's no line to fit
+static bool RefineLine(const BlockTexelsType& block, int channelCount, const __m128* steps, float stepCount, float* start, float* end)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 stepSize = _mm_set1_ps(1.0f / stepCount);
+	__m128 aa = _mm_setzero_ps(), ab = _mm_setzero_ps(), bb = _mm_setzero_ps();
+	__m128 ax[4], bx[4];
+	for (int c = 0; c < channelCount; ++c)
+	{
+		ax[c] = _mm_setzero_ps();
+		bx[c] = _mm_setzero_ps();
+	}
+
+	for (int row = 0; row < 4; ++row)
+	{
+		const __m128 b = _mm_mul_ps(steps[row], stepSize);
+		const __m128 a = _mm_sub_ps(one, b);
+		aa = _mm_add_ps(aa, _mm_mul_ps(a, a));
+		ab = _mm_add_ps(ab, _mm_mul_ps(a, b));
+		bb = _mm_add_ps(bb, _mm_mul_ps(b, b));
+
+		for (int c = 0; c < channelCount; ++c)
+		{
+			ax[c] = _mm_add_ps(ax[c], _mm_mul_ps(a, block.channels[c][row]));
+			bx[c] = _mm_add_ps(bx[c], _mm_mul_ps(b, block.channels[c][row]));
+		}
+	}
+
+	const float sumAA = HorizontalSum(aa);
+	const float sumAB = HorizontalSum(ab);
+	const float sumBB = HorizontalSum(bb);
+	const float determinant = sumAA * sumBB - sumAB * sumAB;
+	if (determinant < 1e-4f)
+		return false;
+
+	for (int c = 0; c < channelCount; ++c)
+	{
+		const float sumAX = HorizontalSum(ax[c]);
+		const float sumBX = HorizontalSum(bx[c]);
+		const float first = (sumBB * sumAX - sumAB * sumBX) / determinant;
+		const float second = (sumAA * sumBX - sumAB * sumAX) / determinant;
+		start[c] = first < 0.0f ? 0.0f : (first > 255.0f ? 255.0f : first);
+		end[c] = second < 0.0f ? 0.0f : (second > 255.0f ? 255.0f : second);
+	}
+
+	return true;
+}
+
+static unsigned int Quantize565(const float* color)
+{
+	const unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+	const unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+	const unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+	return (r << 11) | (g << 5) | b;
+}
+
+static void Expand565(unsigned int packed, float* color)
+{
+	const unsigned int r = (packed >> 11) & 31;
+	const unsigned int g = (packed >> 5) & 63;
+	const unsigned int b = packed & 31;
+	color[0] = (float)((r << 3) | (r >> 2));
+	color[1] = (float)((g << 2) | (g >> 4));
+	color[2] = (float)((b << 3) | (b >> 2));
+}
+
+// 7 bits per channel plus the p-bit the four channels share as their lowest bit, whichever p-bit lands closer
+static void QuantizeBc7Endpoint(const float* color, unsigned int* quantized, unsigned int& pbit, float* expanded)
+{
+	float bestError = FLT_MAX;
+	for (unsigned int p = 0; p < 2; ++p)
+	{
+		unsigned int candidate[4];
+		float error = 0.0f;
+		for (int c = 0; c < 4; ++c)
+		{
+			const int value = (int)((color[c] - (float)p) * 0.5f + 0.5f);
+			candidate[c] = value < 0 ? 0 : (value > 127 ? 127 : value);
+			const float difference = color[c] - (float)((candidate[c] << 1) | p);
+			error += difference * difference;
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			pbit = p;
+			for (int c = 0; c < 4; ++c)
+			{
+				quantized[c] = candidate[c];
+				expanded[c] = (float)((candidate[c] << 1) | p);
+			}
+		}
+	}
+}
+
+static void WriteBits(unsigned long long* bits, int& position, unsigned int value, int count)
+{
+	const int word = position >> 6;
+	const int shift = position & 63;
+	bits[word] |= (unsigned long long)value << shift;
+	if (shift + count > 64)
+		bits[word + 1] |= (unsigned long long)value >> (64 - shift);
+
+	position += count;
+}
+
+static unsigned int ReadBits(const unsigned long long* bits, int& position, int count)
+{
+	const int word = position >> 6;
+	const int shift = position & 63;
+	unsigned long long value = bits[word] >> shift;
+	if (shift + count > 64)
+		value |= bits[word + 1] << (64 - shift);
+
+	position += count;
+	return (unsigned int)(value & ((1ull << count) - 1));
+}
+
+static void EncodeColor(const BlockTexelsType& block, unsigned char* output)
+{
+	float start[3], end[3];
+	BoundingLine(block, 3, 16.0f, start, end);
+
+	unsigned int color0 = Quantize565(start);
+	unsigned int color1 = Quantize565(end);
+	Expand565(color0, start);
+	Expand565(color1, end);
+
+	__m128 steps[4];
+	const float error = FitSteps(block, 3, start, end, 3.0f, steps);
+
+	// One least squares pass, kept if it beats the bounding box after quantizing
+	float refinedStart[3], refinedEnd[3];
+	if (RefineLine(block, 3, steps, 3.0f, refinedStart, refinedEnd))
+	{
+		const unsigned int refined0 = Quantize565(refinedStart);
+		const unsigned int refined1 = Quantize565(refinedEnd);
+		Expand565(refined0, refinedStart);
+		Expand565(refined1, refinedEnd);
+
+		__m128 refinedSteps[4];
+		if (FitSteps(block, 3, refinedStart, refinedEnd, 3.0f, refinedSteps) < error)
+		{
+			color0 = refined0;
+			color1 = refined1;
+			memcpy(steps, refinedSteps, sizeof(steps));
+		}
+	}
+
+	int texelSteps[16];
+	StoreSteps(steps, texelSteps);
+
+	// Four color mode needs color0 > color1, swapping them runs the steps the other way. Equal endpoints only have index 0
+	const bool flip = color0 < color1;
+	if (flip)
+	{
+		const unsigned int swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+
+	unsigned int indices = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		const int step = color0 == color1 ? 0 : (flip ? 3 - texelSteps[i] : texelSteps[i]);
+		indices |= BC1_INDICES[step] << (i * 2);
+	}
+
+	output[0] = (unsigned char)(color0 & 0xFF);
+	output[1] = (unsigned char)(color0 >> 8);
+	output[2] = (unsigned char)(color1 & 0xFF);
+	output[3] = (unsigned char)(color1 >> 8);
+	memcpy(output + 4, &indices, 4);
+}
+
+static void EncodeChannel(const __m128* channel, unsigned char* output)
+{
+	// Texels are whole numbers so the extremes are exact endpoints, and with eight evenly spaced values rounding finds the nearest
+	float low, high;
+	ChannelRange(channel, low, high);
+	const unsigned int value0 = (unsigned int)(high + 0.5f);
+	const unsigned int value1 = (unsigned int)(low + 0.5f);
+
+	unsigned long long indices = 0;
+	if (value0 > value1)
+	{
+		// Step 0 is value0 (index 0), 7 is value1 (index 1), the six in between are indices 2-7
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 top = _mm_set1_ps((float)value0);
+		const __m128 scale = _mm_set1_ps(7.0f / (float)(value0 - value1));
+		const __m128 last = _mm_set1_ps(7.0f);
+
+		int steps[16];
+		for (int row = 0; row < 4; ++row)
+		{
+			const __m128 step = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(top, channel[row]), scale), zero), last);
+			_mm_storeu_si128((__m128i*)(steps + row * 4), _mm_cvtps_epi32(step));
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const unsigned long long index = steps[i] == 0 ? 0 : (steps[i] == 7 ? 1 : steps[i] + 1);
+			indices |= index << (i * 3);
+		}
+	}
+
+	output[0] = (unsigned char)value0;
+	output[1] = (unsigned char)value1;
+	for (int b = 0; b < 6; ++b)
+		output[2 + b] = (unsigned char)(indices >> (b * 8));
+}
+
+static void EncodeBc7(const BlockTexelsType& block, unsigned char* output)
+{
+	float start[4], end[4];
+	BoundingLine(block, 4, 64.0f, start, end);
+
+	unsigned int quantized0[4], quantized1[4], pbit0, pbit1;
+	float endpoint0[4], endpoint1[4];
+	QuantizeBc7Endpoint(start, quantized0, pbit0, endpoint0);
+	QuantizeBc7Endpoint(end, quantized1, pbit1, endpoint1);
+
+	// Mode 6's weights are within a fraction of a step of evenly spaced, so the steps are the indices
+	__m128 steps[4];
+	const float error = FitSteps(block, 4, endpoint0, endpoint1, 15.0f, steps);
+
+	float refinedStart[4], refinedEnd[4];
+	if (RefineLine(block, 4, steps, 15.0f, refinedStart, refinedEnd))
+	{
+		unsigned int refined0[4], refined1[4], refinedPbit0, refinedPbit1;
+		QuantizeBc7Endpoint(refinedStart, refined0, refinedPbit0, refinedStart);
+		QuantizeBc7Endpoint(refinedEnd, refined1, refinedPbit1, refinedEnd);
+
+		__m128 refinedSteps[4];
+		if (FitSteps(block, 4, refinedStart, refinedEnd, 15.0f, refinedSteps) < error)
+		{
+			memcpy(quantized0, refined0, sizeof(quantized0));
+			memcpy(quantized1, refined1, sizeof(quantized1));
+			pbit0 = refinedPbit0;
+			pbit1 = refinedPbit1;
+			memcpy(steps, refinedSteps, sizeof(steps));
+		}
+	}
+
+	int indices[16];
+	StoreSteps(steps, indices);
+
+	// The first texel's index is stored without its top bit (it's implied 0), if it would be 1 swap the endpoints
+	if (indices[0] >= 8)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			const unsigned int swap = quantized0[c];
+			quantized0[c] = quantized1[c];
+			quantized1[c] = swap;
+		}
+
+		const unsigned int swap = pbit0;
+		pbit0 = pbit1;
+		pbit1 = swap;
+
+		for (int i = 0; i < 16; ++i)
+			indices[i] = 15 - indices[i];
+	}
+
+	unsigned long long bits[2] = { 0, 0 };
+	int position = 0;
+	WriteBits(bits, position, 1 << 6, 7); // mode 6
+	for (int c = 0; c < 4; ++c)
+	{
+		WriteBits(bits, position, quantized0[c], 7);
+		WriteBits(bits, position, quantized1[c], 7);
+	}
+
+	WriteBits(bits, position, pbit0, 1);
+	WriteBits(bits, position, pbit1, 1);
+	WriteBits(bits, position, indices[0], 3);
+	for (int i = 1; i < 16; ++i)
+		WriteBits(bits, position, indices[i], 4);
+
+	memcpy(output, bits, 16);
+}
+
+static void DecodeColor(const unsigned char* block, unsigned char* texels, bool fourColorOnly)
+{
+	const unsigned int color0 = block[0] | (block[1] << 8);
+	const unsigned int color1 = block[2] | (block[3] << 8);
+	float endpoint0[3], endpoint1[3];
+	Expand565(color0, endpoint0);
+	Expand565(color1, endpoint1);
+
+	unsigned char palette[4][4];
+	for (int c = 0; c < 3; ++c)
+	{
+		const int value0 = (int)endpoint0[c];
+		const int value1 = (int)endpoint1[c];
+		palette[0][c] = (unsigned char)value0;
+		palette[1][c] = (unsigned char)value1;
+		if (color0 > color1 || fourColorOnly)
+		{
+			palette[2][c] = (unsigned char)((value0 * 2 + value1 + 1) / 3);
+			palette[3][c] = (unsigned char)((value0 + value1 * 2 + 1) / 3);
+		}
+		else
+		{
+			palette[2][c] = (unsigned char)((value0 + value1) / 2);
+			palette[3][c] = 0;
+		}
+	}
+
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	palette[3][3] = (color0 > color1 || fourColorOnly) ? 255 : 0;
+
+	unsigned int indices;
+	memcpy(&indices, block + 4, 4);
+	for (int i = 0; i < 16; ++i)
+		memcpy(texels + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+}
+
+// Writes every fourth byte, so it can fill any one channel of the texels
+static void DecodeChannel(const unsigned char* block, unsigned char* texels)
+{
+	const int value0 = block[0];
+	const int value1 = block[1];
+
+	unsigned char palette[8];
+	palette[0] = (unsigned char)value0;
+	palette[1] = (unsigned char)value1;
+	if (value0 > value1)
+	{
+		for (int i = 2; i < 8; ++i)
+			palette[i] = (unsigned char)(((8 - i) * value0 + (i - 1) * value1 + 3) / 7);
+	}
+	else
+	{
+		for (int i = 2; i < 6; ++i)
+			palette[i] = (unsigned char)(((6 - i) * value0 + (i - 1) * value1 + 2) / 5);
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	unsigned long long indices = 0;
+	for (int b = 0; b < 6; ++b)
+		indices |= (unsigned long long)block[2 + b] << (b * 8);
+
+	for (int i = 0; i < 16; ++i)
+		texels[i * 4] = palette[(indices >> (i * 3)) & 7];
+}
+
+static void DecodeBc7(const unsigned char* block, unsigned char* texels)
+{
+	unsigned long long bits[2];
+	memcpy(bits, block, 16);
+
+	int position = 0;
+	if (ReadBits(bits, position, 7) != (1 << 6))
+	{
+		memset(texels, 0, 64);
+		return;
+	}
+
+	unsigned int endpoint0[4], endpoint1[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		endpoint0[c] = ReadBits(bits, position, 7) << 1;
+		endpoint1[c] = ReadBits(bits, position, 7) << 1;
+	}
+
+	const unsigned int pbit0 = ReadBits(bits, position, 1);
+	const unsigned int pbit1 = ReadBits(bits, position, 1);
+	for (int c = 0; c < 4; ++c)
+	{
+		endpoint0[c] |= pbit0;
+		endpoint1[c] |= pbit1;
+	}
+
+	for (int i = 0; i < 16; ++i)
+	{
+		const unsigned int weight = BC7_WEIGHTS[ReadBits(bits, position, i == 0 ? 3 : 4)];
+		for (int c = 0; c < 4; ++c)
+			texels[i * 4 + c] = (unsigned char)(((64 - weight) * endpoint0[c] + weight * endpoint1[c] + 32) >> 6);
+	}
+}
+
+void EncodeBlock(TextureFormatType format, const unsigned char* texels, unsigned char* output)
+{
+	BlockTexelsType block;
+	LoadBlock(texels, block);
+
+	switch (format)
+	{
+		case TEXTURE_BC1:
+			EncodeColor(block, output);
+			break;
+		case TEXTURE_BC3:
+			EncodeChannel(block.channels[3], output);
+			EncodeColor(block, output + 8);
+			break;
+		case TEXTURE_BC5:
+			EncodeChannel(block.channels[0], output);
+			EncodeChannel(block.channels[1], output + 8);
+			break;
+		default:
+			EncodeBc7(block, output);
+			break;
+	}
+}
+
+void DecodeBlock(TextureFormatType format, const unsigned char* block, unsigned char* texels)
+{
+	switch (format)
+	{
+		case TEXTURE_BC1:
+			DecodeColor(block, texels, false);
+			break;
+		case TEXTURE_BC3:
+			DecodeColor(block + 8, texels, true);
+			DecodeChannel(block, texels + 3);
+			break;
+		case TEXTURE_BC5:
+			for (int i = 0; i < 16; ++i)
+			{
+				texels[i * 4 + 2] = 0;
+				texels[i * 4 + 3] = 255;
+			}
+			DecodeChannel(block, texels);
+			DecodeChannel(block + 8, texels + 1);
+			break;
+		default:
+			DecodeBc7(block, texels);
+			break;
+	}
+}
+
+void EncodeImage(TextureFormatType format, const unsigned char* pixels, int width, int height, int pitch, unsigned char* output, JobSystemClass* jobs)
+{
+	const int blocksWide = (width + 3) / 4;
+	const int blocksHigh = (height + 3) / 4;
+	const unsigned int blockBytes = TextureBlockBytes(format);
+	const size_t rowBytes = (size_t)blocksWide * blockBytes;
+
+	auto encodeRows = [=](int begin, int end, int)
+	{
+		unsigned char texels[64];
+		for (int by = begin; by < end; ++by)
+		{
+			for (int bx = 0; bx < blocksWide; ++bx)
+			{
+				for (int y = 0; y < 4; ++y)
+				{
+					const int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+					for (int x = 0; x < 4; ++x)
+					{
+						const int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+						memcpy(texels + (y * 4 + x) * 4, pixels + (size_t)sy * pitch + sx * 4, 4);
+					}
+				}
+
+				EncodeBlock(format, texels, output + by * rowBytes + bx * blockBytes);
+			}
+		}
+	};
+
+	if (jobs)
+		jobs->ParallelFor(blocksHigh, BLOCK_ROWS_PER_JOB, encodeRows);
+	else
+		encodeRows(0, blocksHigh, 0);
+}
+
+void DecodeImage(TextureFormatType format, const unsigned char* blocks, int width, int height, unsigned char* pixels, int pitch)
+{
+	const int blocksWide = (width + 3) / 4;
+	const int blocksHigh = (height + 3) / 4;
+	const unsigned int blockBytes = TextureBlockBytes(format);
+
+	unsigned char texels[64];
+	for (int by = 0; by < blocksHigh; ++by)
+	{
+		for (int bx = 0; bx < blocksWide; ++bx)
+		{
+			DecodeBlock(format, blocks + ((size_t)by * blocksWide + bx) * blockBytes, texels);
+
+			for (int y = 0; y < 4 && by * 4 + y < height; ++y)
+			{
+				for (int x = 0; x < 4 && bx * 4 + x < width; ++x)
+					memcpy(pixels + (size_t)(by * 4 + y) * pitch + (bx * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+			}
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "jobsystemclass.h"
+#include "texturefile.h"
+
+/*
+	BC1, BC3, BC5 and BC7 block encoders for the offline texture build, SSE2 throughout.
+	Every format takes the same route, after "Real-Time DXT Compression" (van Waveren): the bounding box of the block's
+	texels, inset a little, with its endpoints flipped per channel onto the diagonal the texels actually run along.
+	Each texel is projected onto the line between the endpoints for its index, then one least squares pass refits the
+	endpoints to those indices and is kept if it comes out better. The texels are handled as four rows of four in
+	SSE registers, a channel per set of registers, so the per texel work is all vector math.
+	BC1 and the color half of BC3 always use four color mode (no 1 bit alpha). BC3's alpha and both BC5 channels are
+	BC4 blocks in eight value mode. BC7 only uses mode 6 (one subset, rgba endpoints with a p-bit, 4 bit indices),
+	which is what a fast BC7 encoder leans on for most blocks anyway.
+	The decoders are plain scalar code for measuring the encoders, DecodeBlock only knows the BC7 mode 6 it writes.
+*/
+
+const int BLOCK_ROWS_PER_JOB = 4; // rows of 4x4 blocks handed to each job by EncodeImage
+
+// 16 RGBA8 texels row by row (64 bytes) into one block of TextureBlockBytes
+void EncodeBlock(TextureFormatType, const unsigned char*, unsigned char*);
+// And back, 16 RGBA8 texels. Formats without alpha decode it as 255, BC5 as red and green with blue 0
+void DecodeBlock(TextureFormatType, const unsigned char*, unsigned char*);
+
+/*
+	RGBA8 image (width, height, row pitch in bytes) into rows of blocks, edge blocks repeat the last row and column.
+	The output needs ceil(width / 4) * ceil(height / 4) * TextureBlockBytes bytes.
+	Rows of blocks are spread over the job system if there is one, nullptr encodes on the calling thread
+*/
+void EncodeImage(TextureFormatType, const unsigned char*, int, int, int, unsigned char*, JobSystemClass*);
+// Rows of blocks back to an RGBA8 image with the given row pitch
+void DecodeImage(TextureFormatType, const unsigned char*, int, int, unsigned char*, int);
@@ -0,0 +1,72 @@
+#include "cameraclass.h"
+
+CameraClass::CameraClass() :
+	m_positionX(0.0f),
+	m_positionY(0.0f),
+	m_positionZ(0.0f),
+	m_rotationX(0.0f),
+	m_rotationY(0.0f),
+	m_rotationZ(0.0f)
+{
+	m_viewMatrix = XMMatrixIdentity();
+}
+
+CameraClass::CameraClass(const CameraClass&)
+{
+}
+
+CameraClass::~CameraClass()
+{
+}
+
+void CameraClass::SetPosition(float x, float y, float z)
+{
+	m_positionX = x;
+	m_positionY = y;
+	m_positionZ = z;
+}
+
+void CameraClass::SetRotation(float x, float y, float z)
+{
+	m_rotationX = x;
+	m_rotationY = y;
+	m_rotationZ = z;
+}
+
+XMFLOAT3 CameraClass::GetPosition()
+{
+	return XMFLOAT3(m_positionX, m_positionY, m_positionZ);
+}
+
+XMFLOAT3 CameraClass::GetRotation()
+{
+	return XMFLOAT3(m_rotationX, m_rotationY, m_rotationZ);
+}
+
+// Builds the view matrix from the position and rotation, call it whenever either one changed
+void CameraClass::Render()
+{
+	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	XMVECTOR position = XMVectorSet(m_positionX, m_positionY, m_positionZ, 1.0f);
+
+	// By default the camera looks down +z (left handed)
+	XMVECTOR lookAt = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+
+	// Pitch (x), yaw (y) and roll (z) in radians
+	const float pitch = XMConvertToRadians(m_rotationX);
+	const float yaw = XMConvertToRadians(m_rotationY);
+	const float roll = XMConvertToRadians(m_rotationZ);
+	XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(pitch, yaw, roll);
+
+	// Rotate the look at and up vectors so the view is rotated correctly at the origin, then move the target to the camera
+	lookAt = XMVector3TransformCoord(lookAt, rotationMatrix);
+	up = XMVector3TransformCoord(up, rotationMatrix);
+	lookAt = XMVectorAdd(position, lookAt);
+
+	m_viewMatrix = XMMatrixLookAtLH(position, lookAt, up);
+}
+
+void CameraClass::GetViewMatrix(XMMATRIX& viewMatrix)
+{
+	viewMatrix = m_viewMatrix;
+}
@@ -0,0 +1,386 @@
+#include "clusteredlightingclass.h"
+
+#include <math.h>
+#include <string.h>
+#include <xmmintrin.h>
+
+ClusteredLightingClass::ClusteredLightingClass() :
+	m_Jobs(nullptr),
+	m_near(0.1f),
+	m_far(CLUSTER_MAX_DEPTH),
+	m_zScale(0.0f),
+	m_zBias(0.0f),
+	m_overflow(0)
+{
+}
+
+ClusteredLightingClass::ClusteredLightingClass(const ClusteredLightingClass&)
+{
+}
+
+ClusteredLightingClass::~ClusteredLightingClass()
+{
+}
+
+bool ClusteredLightingClass::Initialize(JobSystemClass* jobs, XMMATRIX projectionMatrix)
+{
+	m_Jobs = jobs;
+
+	// Near and far back out of a left handed perspective matrix: _33 = f / (f - n), _43 = -n * f / (f - n)
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, projectionMatrix);
+	if (projection._33 == 0.0f || projection._33 == 1.0f || projection._11 == 0.0f || projection._22 == 0.0f)
+		return false;
+
+	m_near = -projection._43 / projection._33;
+	m_far = projection._43 / (1.0f - projection._33);
+	if (m_near <= 0.0f || m_far <= m_near)
+		return false;
+
+	BuildClusterBounds(projectionMatrix);
+
+	m_slices.resize(CLUSTER_GRID_Z);
+	for (SliceType& slice : m_slices)
+	{
+		memset(slice.counts, 0, sizeof(slice.counts));
+		slice.indices.resize(CLUSTER_SLICE_SIZE * CLUSTER_MAX_LIGHTS_PER_CLUSTER);
+		slice.candidates.reserve(CLUSTER_MAX_LIGHTS);
+		slice.overflow = 0;
+	}
+
+	return true;
+}
+
+void ClusteredLightingClass::Shutdown()
+{
+	m_slices.clear();
+	m_minX.clear();
+	m_minY.clear();
+	m_minZ.clear();
+	m_maxX.clear();
+	m_maxY.clear();
+	m_maxZ.clear();
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_radius.clear();
+	m_sliceNear.clear();
+	m_sliceFar.clear();
+	m_Jobs = nullptr;
+}
+
+void ClusteredLightingClass::BuildClusterBounds(XMMATRIX projectionMatrix)
+{
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, projectionMatrix);
+
+	// Exponential slices between near and CLUSTER_MAX_DEPTH, the last one stretches to the far plane so every pixel has a cluster
+	const float clusterFar = m_far < CLUSTER_MAX_DEPTH ? m_far : CLUSTER_MAX_DEPTH;
+	const float logRange = logf(clusterFar / m_near);
+	m_zScale = CLUSTER_GRID_Z / logRange;
+	m_zBias = -CLUSTER_GRID_Z * logf(m_near) / logRange;
+
+	m_sliceNear.resize(CLUSTER_GRID_Z);
+	m_sliceFar.resize(CLUSTER_GRID_Z);
+	for (int z = 0; z < CLUSTER_GRID_Z; ++z)
+	{
+		m_sliceNear[z] = m_near * powf(clusterFar / m_near, (float)z / CLUSTER_GRID_Z);
+		m_sliceFar[z] = z + 1 == CLUSTER_GRID_Z ? m_far : m_near * powf(clusterFar / m_near, (float)(z + 1) / CLUSTER_GRID_Z);
+	}
+
+	std::vector<float>* arrays[] = { &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY, &m_maxZ, &m_centerX, &m_centerY, &m_centerZ, &m_radius };
+	for (std::vector<float>* values : arrays)
+		values->resize(CLUSTER_COUNT);
+
+	/*
+		Tile edges in ndc, y flipped so tile row 0 is the top of the screen like SV_Position.
+		A view space point at depth z lands on ndc x = x * _11 / z, so the edge at ndc x is the line x = ndc * z / _11,
+		the box corners are the edges at the slice's near and far depth.
+	*/
+	for (int z = 0; z < CLUSTER_GRID_Z; ++z)
+	{
+		const float zNear = m_sliceNear[z];
+		const float zFar = m_sliceFar[z];
+
+		for (int y = 0; y < CLUSTER_GRID_Y; ++y)
+		{
+			const float ndcTop = 1.0f - 2.0f * y / CLUSTER_GRID_Y;
+			const float ndcBottom = 1.0f - 2.0f * (y + 1) / CLUSTER_GRID_Y;
+
+			for (int x = 0; x < CLUSTER_GRID_X; ++x)
+			{
+				const float ndcLeft = -1.0f + 2.0f * x / CLUSTER_GRID_X;
+				const float ndcRight = -1.0f + 2.0f * (x + 1) / CLUSTER_GRID_X;
+
+				const float xs[4] = { ndcLeft * zNear, ndcLeft * zFar, ndcRight * zNear, ndcRight * zFar };
+				const float ys[4] = { ndcBottom * zNear, ndcBottom * zFar, ndcTop * zNear, ndcTop * zFar };
+
+				float minX = xs[0], maxX = xs[0], minY = ys[0], maxY = ys[0];
+				for (int i = 1; i < 4; ++i)
+				{
+					minX = xs[i] < minX ? xs[i] : minX;
+					maxX = xs[i] > maxX ? xs[i] : maxX;
+					minY = ys[i] < minY ? ys[i] : minY;
+					maxY = ys[i] > maxY ? ys[i] : maxY;
+				}
+
+				const int cluster = (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+				m_minX[cluster] = minX / projection._11;
+				m_maxX[cluster] = maxX / projection._11;
+				m_minY[cluster] = minY / projection._22;
+				m_maxY[cluster] = maxY / projection._22;
+				m_minZ[cluster] = zNear;
+				m_maxZ[cluster] = zFar;
+
+				// Bounding sphere of the box for the cone test
+				const float halfX = (m_maxX[cluster] - m_minX[cluster]) * 0.5f;
+				const float halfY = (m_maxY[cluster] - m_minY[cluster]) * 0.5f;
+				const float halfZ = (zFar - zNear) * 0.5f;
+				m_centerX[cluster] = m_minX[cluster] + halfX;
+				m_centerY[cluster] = m_minY[cluster] + halfY;
+				m_centerZ[cluster] = zNear + halfZ;
+				m_radius[cluster] = sqrtf(halfX * halfX + halfY * halfY + halfZ * halfZ);
+			}
+		}
+	}
+}
+
+void ClusteredLightingClass::Build(const LightType* lights, int lightCount, ClusterListType& list)
+{
+	lightCount = lightCount < CLUSTER_MAX_LIGHTS ? lightCount : CLUSTER_MAX_LIGHTS;
+	list.lights.assign(lights, lights + lightCount);
+	list.zScale = m_zScale;
+	list.zBias = m_zBias;
+
+	// One depth slice per job, slices write to their own scratch so there's nothing to lock
+	if (m_Jobs)
+	{
+		m_Jobs->ParallelFor(CLUSTER_GRID_Z, 1, [this, lights, lightCount](int begin, int end, int)
+		{
+			for (int z = begin; z < end; ++z)
+				BinSlice(z, lights, lightCount);
+		});
+	}
+	else
+	{
+		for (int z = 0; z < CLUSTER_GRID_Z; ++z)
+			BinSlice(z, lights, lightCount);
+	}
+
+	m_overflow = 0;
+	for (int z = 0; z < CLUSTER_GRID_Z; ++z)
+	{
+		Compact(z, list);
+		m_overflow += m_slices[z].overflow;
+	}
+}
+
+void ClusteredLightingClass::BinSlice(int z, const LightType* lights, int lightCount)
+{
+	SliceType& slice = m_slices[z];
+	memset(slice.counts, 0, sizeof(slice.counts));
+	slice.overflow = 0;
+
+	/*
+		Depth test first, most lights don't reach most slices. Slightly looser than the box test below
+		so rounding can never make this throw away a light the box test would keep.
+	*/
+	slice.candidates.clear();
+	const float sliceNear = m_sliceNear[z];
+	const float sliceFar = m_sliceFar[z];
+	for (int i = 0; i < lightCount; ++i)
+	{
+		const float reach = lights[i].range * 1.001f + 1e-4f;
+		if (sliceNear - lights[i].position.z > reach || lights[i].position.z - sliceFar > reach)
+			continue;
+
+		slice.candidates.push_back(i);
+	}
+
+	const int first = z * CLUSTER_SLICE_SIZE;
+	const __m128 zero = _mm_setzero_ps();
+
+	// Lights in order so every cluster's list comes out sorted, same as the reference
+	for (int lightIndex : slice.candidates)
+	{
+		const LightType& light = lights[lightIndex];
+		const __m128 px = _mm_set1_ps(light.position.x);
+		const __m128 py = _mm_set1_ps(light.position.y);
+		const __m128 pz = _mm_set1_ps(light.position.z);
+		const __m128 rangeSq = _mm_set1_ps(light.range * light.range);
+
+		const bool spot = light.kind == LIGHT_SPOT;
+		const float sinAngle = sqrtf(1.0f - light.cosAngle * light.cosAngle);
+		const __m128 range = _mm_set1_ps(light.range);
+		const __m128 dirX = _mm_set1_ps(light.direction.x);
+		const __m128 dirY = _mm_set1_ps(light.direction.y);
+		const __m128 dirZ = _mm_set1_ps(light.direction.z);
+		const __m128 cosA = _mm_set1_ps(light.cosAngle);
+		const __m128 sinA = _mm_set1_ps(sinAngle);
+
+		for (int c = 0; c < CLUSTER_SLICE_SIZE; c += 4)
+		{
+			const int cluster = first + c;
+
+			// Sphere vs box: squared distance from the light to the closest point of each box
+			__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minX[cluster]), px), zero), _mm_max_ps(_mm_sub_ps(px, _mm_loadu_ps(&m_maxX[cluster])), zero));
+			__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minY[cluster]), py), zero), _mm_max_ps(_mm_sub_ps(py, _mm_loadu_ps(&m_maxY[cluster])), zero));
+			__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minZ[cluster]), pz), zero), _mm_max_ps(_mm_sub_ps(pz, _mm_loadu_ps(&m_maxZ[cluster])), zero));
+			__m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			__m128 hit = _mm_cmple_ps(distanceSq, rangeSq);
+
+			if (_mm_movemask_ps(hit) == 0)
+				continue;
+
+			if (spot)
+			{
+				/*
+					Cone vs the cluster's bounding sphere. v is light to sphere center, v1 its length along the cone axis.
+					The sphere is outside if it's past the cone's side (closest distance to the cone surface > radius),
+					entirely beyond the range, or entirely behind the light.
+				*/
+				const __m128 radius = _mm_loadu_ps(&m_radius[cluster]);
+				const __m128 vx = _mm_sub_ps(_mm_loadu_ps(&m_centerX[cluster]), px);
+				const __m128 vy = _mm_sub_ps(_mm_loadu_ps(&m_centerY[cluster]), py);
+				const __m128 vz = _mm_sub_ps(_mm_loadu_ps(&m_centerZ[cluster]), pz);
+				const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+				const __m128 v1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, dirX), _mm_mul_ps(vy, dirY)), _mm_mul_ps(vz, dirZ));
+				const __m128 side = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(lengthSq, _mm_mul_ps(v1, v1)), zero));
+				const __m128 closest = _mm_sub_ps(_mm_mul_ps(cosA, side), _mm_mul_ps(v1, sinA));
+
+				const __m128 angleCull = _mm_cmpgt_ps(closest, radius);
+				const __m128 frontCull = _mm_cmpgt_ps(v1, _mm_add_ps(radius, range));
+				const __m128 backCull = _mm_cmplt_ps(v1, _mm_sub_ps(zero, radius));
+				hit = _mm_andnot_ps(_mm_or_ps(angleCull, _mm_or_ps(frontCull, backCull)), hit);
+			}
+
+			const int mask = _mm_movemask_ps(hit);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if ((mask & (1 << lane)) == 0)
+					continue;
+
+				const int local = c + lane;
+				unsigned short& count = slice.counts[local];
+				if (count < CLUSTER_MAX_LIGHTS_PER_CLUSTER)
+					slice.indices[local * CLUSTER_MAX_LIGHTS_PER_CLUSTER + count++] = (unsigned short)lightIndex;
+				else
+					++slice.overflow;
+			}
+		}
+	}
+}
+
+void ClusteredLightingClass::Compact(int z, ClusterListType& list)
+{
+	// Fixed size per cluster scratch into one tight list, the first slice starts the list over
+	if (z == 0)
+	{
+		list.clusters.resize(CLUSTER_COUNT * 2);
+		list.indices.clear();
+	}
+
+	const SliceType& slice = m_slices[z];
+	for (int c = 0; c < CLUSTER_SLICE_SIZE; ++c)
+	{
+		const int cluster = z * CLUSTER_SLICE_SIZE + c;
+		const unsigned int count = slice.counts[c];
+		list.clusters[cluster * 2 + 0] = (unsigned int)list.indices.size();
+		list.clusters[cluster * 2 + 1] = count;
+
+		const unsigned short* indices = &slice.indices[c * CLUSTER_MAX_LIGHTS_PER_CLUSTER];
+		list.indices.insert(list.indices.end(), indices, indices + count);
+	}
+}
+
+bool ClusteredLightingClass::TestLight(int cluster, const LightType& light)
+{
+	// Same math as the SIMD loop in BinSlice, same operation order so the results match exactly
+	const float dx = fmaxf(m_minX[cluster] - light.position.x, 0.0f) + fmaxf(light.position.x - m_maxX[cluster], 0.0f);
+	const float dy = fmaxf(m_minY[cluster] - light.position.y, 0.0f) + fmaxf(light.position.y - m_maxY[cluster], 0.0f);
+	const float dz = fmaxf(m_minZ[cluster] - light.position.z, 0.0f) + fmaxf(light.position.z - m_maxZ[cluster], 0.0f);
+	if (dx * dx + dy * dy + dz * dz > light.range * light.range)
+		return false;
+
+	if (light.kind != LIGHT_SPOT)
+		return true;
+
+	const float sinAngle = sqrtf(1.0f - light.cosAngle * light.cosAngle);
+	const float radius = m_radius[cluster];
+	const float vx = m_centerX[cluster] - light.position.x;
+	const float vy = m_centerY[cluster] - light.position.y;
+	const float vz = m_centerZ[cluster] - light.position.z;
+	const float lengthSq = vx * vx + vy * vy + vz * vz;
+	const float v1 = vx * light.direction.x + vy * light.direction.y + vz * light.direction.z;
+	const float closest = light.cosAngle * sqrtf(fmaxf(lengthSq - v1 * v1, 0.0f)) - v1 * sinAngle;
+
+	return (closest > radius || v1 > radius + light.range || v1 < 0.0f - radius) == false;
+}
+
+void ClusteredLightingClass::BuildReference(const LightType* lights, int lightCount, ClusterListType& list)
+{
+	lightCount = lightCount < CLUSTER_MAX_LIGHTS ? lightCount : CLUSTER_MAX_LIGHTS;
+	list.lights.assign(lights, lights + lightCount);
+	list.zScale = m_zScale;
+	list.zBias = m_zBias;
+	list.clusters.resize(CLUSTER_COUNT * 2);
+	list.indices.clear();
+
+	// Every light against every cluster, no shortcuts
+	for (int cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+	{
+		list.clusters[cluster * 2 + 0] = (unsigned int)list.indices.size();
+
+		unsigned int count = 0;
+		for (int i = 0; i < lightCount && count < CLUSTER_MAX_LIGHTS_PER_CLUSTER; ++i)
+		{
+			if (TestLight(cluster, lights[i]))
+			{
+				list.indices.push_back(i);
+				++count;
+			}
+		}
+
+		list.clusters[cluster * 2 + 1] = count;
+	}
+}
+
+int ClusteredLightingClass::Validate(const LightType* lights, int lightCount, const ClusterListType& list)
+{
+	ClusterListType reference;
+	BuildReference(lights, lightCount, reference);
+
+	if (list.clusters.size() != reference.clusters.size())
+		return CLUSTER_COUNT;
+
+	int mismatches = 0;
+	for (int cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+	{
+		const unsigned int count = list.clusters[cluster * 2 + 1];
+		if (count != reference.clusters[cluster * 2 + 1])
+		{
+			++mismatches;
+			continue;
+		}
+
+		if (count > 0 && memcmp(&list.indices[list.clusters[cluster * 2]], &reference.indices[reference.clusters[cluster * 2]], count * sizeof(unsigned int)) != 0)
+			++mismatches;
+	}
+
+	return mismatches;
+}
+
+int ClusteredLightingClass::GetOverflowCount()
+{
+	return m_overflow;
+}
+
+float ClusteredLightingClass::GetNear()
+{
+	return m_near;
+}
+
+float ClusteredLightingClass::GetFar()
+{
+	return m_far;
+}
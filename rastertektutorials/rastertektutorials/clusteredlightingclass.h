@@ -0,0 +1,103 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+#include "jobsystemclass.h"
+
+using namespace DirectX;
+
+/*
+	Clustered light binning. The view frustum is cut into CLUSTER_GRID_X * CLUSTER_GRID_Y screen tiles and
+	CLUSTER_GRID_Z depth slices (exponential, so near slices are thin and far ones thick), every cluster gets the list
+	of lights that touch it. A pixel shader finds its cluster from screen position and view depth and only loops over that list.
+	Binning runs on the job threads, one depth slice per job. Each light is tested against four clusters at a time with SSE:
+	sphere vs cluster box for every light, then cone vs cluster bounding sphere for spot lights.
+	BuildReference() does the same tests one at a time with plain floats, it's what the SIMD path is checked against.
+	Everything is in view space, lights have to be transformed before Build().
+*/
+
+const int CLUSTER_GRID_X = 16;
+const int CLUSTER_GRID_Y = 9;
+const int CLUSTER_GRID_Z = 24;
+const int CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+const int CLUSTER_SLICE_SIZE = CLUSTER_GRID_X * CLUSTER_GRID_Y; // clusters per depth slice, multiple of 4 for the SIMD loop
+const int CLUSTER_MAX_LIGHTS = 4096; // lights past this are dropped
+const int CLUSTER_MAX_LIGHTS_PER_CLUSTER = 256; // indices past this are dropped, see GetOverflowCount
+const float CLUSTER_MAX_DEPTH = 300.0f; // last slice ends here even if the far plane is further, lights that far out are too small to matter
+
+enum LightKind
+{
+	LIGHT_POINT,
+	LIGHT_SPOT
+};
+
+// Same layout as the Light struct in clusters.hlsli
+struct LightType
+{
+	XMFLOAT3 position; // view space
+	float range;
+	XMFLOAT3 direction; // view space, spot only
+	float cosAngle; // cosine of the spot half angle
+	XMFLOAT3 color;
+	unsigned int kind;
+};
+
+// One frame's worth of binned lights, goes to the render thread in the frame packet
+struct ClusterListType
+{
+	std::vector<LightType> lights;
+	std::vector<unsigned int> clusters; // two per cluster: offset into indices, count
+	std::vector<unsigned int> indices; // into lights
+	float zScale; // slice = log(viewZ) * zScale + zBias
+	float zBias;
+};
+
+class ClusteredLightingClass
+{
+public:
+	ClusteredLightingClass();
+	ClusteredLightingClass(const ClusteredLightingClass&);
+	~ClusteredLightingClass();
+
+	// Job system can be nullptr, then binning runs on the calling thread. Projection has to be a perspective one (D3DClass's)
+	bool Initialize(JobSystemClass*, XMMATRIX);
+	void Shutdown();
+
+	// Lights are copied into the list, only the first CLUSTER_MAX_LIGHTS are used
+	void Build(const LightType*, int, ClusterListType&);
+	void BuildReference(const LightType*, int, ClusterListType&);
+	// Runs the reference on the same lights and compares cluster by cluster, returns the number of clusters that differ
+	int Validate(const LightType*, int, const ClusterListType&);
+
+	int GetOverflowCount();
+	float GetNear();
+	float GetFar();
+
+private:
+	struct SliceType
+	{
+		unsigned short counts[CLUSTER_SLICE_SIZE];
+		std::vector<unsigned short> indices; // CLUSTER_MAX_LIGHTS_PER_CLUSTER per cluster
+		std::vector<int> candidates;
+		int overflow;
+	};
+
+	void BuildClusterBounds(XMMATRIX);
+	void BinSlice(int, const LightType*, int);
+	void Compact(int, ClusterListType&);
+	bool TestLight(int, const LightType&);
+
+private:
+	JobSystemClass* m_Jobs;
+	float m_near;
+	float m_far;
+	float m_zScale;
+	float m_zBias;
+	// Cluster bounds in view space, structure of arrays so four clusters load with one instruction
+	std::vector<float> m_minX, m_minY, m_minZ;
+	std::vector<float> m_maxX, m_maxY, m_maxZ;
+	std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+	std::vector<float> m_sliceNear, m_sliceFar;
+	std::vector<SliceType> m_slices;
+	int m_overflow;
+};
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: clusters.hlsli
+// Clustered light lookup for pixel shaders, the gpu side of LightBufferClass.
+// #include it and call AccumulateLights with the pixel's SV_Position and view space
+// position and normal. Layout has to match LightType and ClusterConstantsType.
+////////////////////////////////////////////////////////////////////////////////
+
+#define LIGHT_POINT 0
+#define LIGHT_SPOT 1
+#define LIGHT_SIZE 48 // bytes per light in the raw buffer
+
+// lights, then (offset, count) per cluster, then light indices, see lightbufferclass.h
+ByteAddressBuffer clusterData : register(t8);
+
+cbuffer ClusterBuffer : register(b1)
+{
+	float2 tileScale; // clusters per pixel
+	float zScale;
+	float zBias;
+	uint3 clusterGrid;
+	uint lightCount;
+	uint clusterOffset;
+	uint indexOffset;
+	uint2 clusterPadding;
+};
+
+struct Light
+{
+	float3 position; // view space
+	float range;
+	float3 direction;
+	float cosAngle;
+	float3 color;
+	uint kind;
+};
+
+Light LoadLight(uint index)
+{
+	uint address = index * LIGHT_SIZE;
+	uint4 a = clusterData.Load4(address);
+	uint4 b = clusterData.Load4(address + 16);
+	uint4 c = clusterData.Load4(address + 32);
+
+	Light light;
+	light.position = asfloat(a.xyz);
+	light.range = asfloat(a.w);
+	light.direction = asfloat(b.xyz);
+	light.cosAngle = asfloat(b.w);
+	light.color = asfloat(c.xyz);
+	light.kind = c.w;
+	return light;
+}
+
+// Same slice formula as ClusteredLightingClass, pixels past the last slice use the last one
+uint ClusterIndex(float2 pixel, float viewZ)
+{
+	uint2 tile = min((uint2)(pixel * tileScale), clusterGrid.xy - 1);
+	uint slice = (uint)clamp(log(viewZ) * zScale + zBias, 0.0f, (float)(clusterGrid.z - 1));
+	return (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+}
+
+float3 AccumulateLights(float2 pixel, float3 viewPosition, float3 viewNormal)
+{
+	uint2 cluster = clusterData.Load2(clusterOffset + ClusterIndex(pixel, viewPosition.z) * 8);
+	float3 result = 0.0f;
+
+	for (uint i = 0; i < cluster.y; ++i)
+	{
+		Light light = LoadLight(clusterData.Load(indexOffset + (cluster.x + i) * 4));
+
+		float3 toLight = light.position - viewPosition;
+		float distance = length(toLight);
+		toLight /= max(distance, 0.0001f);
+
+		// Smooth falloff that reaches zero at the range the light was binned with
+		float falloff = saturate(1.0f - distance / light.range);
+		falloff *= falloff;
+
+		if (light.kind == LIGHT_SPOT)
+			falloff *= smoothstep(light.cosAngle, lerp(light.cosAngle, 1.0f, 0.1f), dot(-toLight, light.direction));
+
+		result += light.color * saturate(dot(viewNormal, toLight)) * falloff;
+	}
+
+	return result;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <directxmath.h>
+
+using namespace DirectX;
+
+/*
+	Components for the entity store, plain data only.
+	To add one: write the struct, give it an id in ComponentId and a COMPONENT_TRAITS line below.
+	The store uses the traits to lay out its chunks, systems use them to find their arrays.
+*/
+
+enum ComponentId
+{
+	COMPONENT_TRANSFORM,
+	COMPONENT_VELOCITY,
+	COMPONENT_BOUNDS,
+	COMPONENT_RENDERABLE,
+	COMPONENT_LIGHT,
+	COMPONENT_COUNT
+};
+
+// Mask bit for a component
+#define COMPONENT_BIT(id) (1u << (id))
+
+struct TransformComponent
+{
+	XMFLOAT3 position;
+	float scale;
+	XMFLOAT4 rotation; // quaternion
+};
+
+struct VelocityComponent
+{
+	XMFLOAT3 linear;
+	float spin; // radians per second around y
+};
+
+struct BoundsComponent
+{
+	XMFLOAT3 center; // local space bounding sphere
+	float radius;
+	int proxy; // AabbTreeClass proxy + 1, 0 if not in the tree yet so a zeroed component starts out of the tree
+};
+
+// RenderableComponent flags
+const unsigned int RENDERABLE_CAST_SHADOWS = 1;
+const unsigned int RENDERABLE_STATIC = 2; // never moves, goes into the cached shadow maps
+
+struct RenderableComponent
+{
+	unsigned int mesh;
+	unsigned int material;
+	unsigned int flags;
+	unsigned int lod; // last frame's pick, the selector needs it for the hysteresis
+};
+
+struct LightComponent
+{
+	XMFLOAT3 color;
+	float range;
+	XMFLOAT3 direction; // local space, rotated by the transform
+	float spotAngle; // half angle in radians, 0 for a point light
+};
+
+template<typename T> struct ComponentTraits;
+
+#define COMPONENT_TRAITS(type, componentId) \
+	template<> struct ComponentTraits<type> { static const int id = componentId; };
+
+COMPONENT_TRAITS(TransformComponent, COMPONENT_TRANSFORM)
+COMPONENT_TRAITS(VelocityComponent, COMPONENT_VELOCITY)
+COMPONENT_TRAITS(BoundsComponent, COMPONENT_BOUNDS)
+COMPONENT_TRAITS(RenderableComponent, COMPONENT_RENDERABLE)
+COMPONENT_TRAITS(LightComponent, COMPONENT_LIGHT)
+
+// Sizes in ComponentId order, the store needs them at runtime
+const unsigned int COMPONENT_SIZES[COMPONENT_COUNT] =
+{
+	sizeof(TransformComponent),
+	sizeof(VelocityComponent),
+	sizeof(BoundsComponent),
+	sizeof(RenderableComponent),
+	sizeof(LightComponent),
+};
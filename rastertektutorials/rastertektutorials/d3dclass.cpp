@@ -1,14 +1,19 @@
 #include "d3dclass.h"
 
 D3DClass::D3DClass() :
+	m_factory(nullptr),
+	m_adapter(nullptr),
 	m_swapChain(nullptr),
 	m_device(nullptr),
 	m_deviceContext(nullptr),
 	m_renderTargetView(nullptr),
 	m_depthStencilBuffer(nullptr),
 	m_depthStencilState(nullptr),
+	m_depthDisabledStencilState(nullptr),
 	m_depthStencilView(nullptr),
-	m_rasterState(nullptr)
+	m_rasterState(nullptr),
+	m_alphaEnableBlendingState(nullptr),
+	m_alphaDisableBlendingState(nullptr)
 {
 }
 
@@ -30,7 +35,21 @@ bool D3DClass::Initialize(
 	float screenNear
 )
 {
-	m_vsync_enabled = vsync;
+	// All the stages back to back, the startup graph in SystemClass runs them separately so they overlap other startup work
+	if (EnumerateAdapter() == false)
+		return false;
+
+	if (CreateDevice() == false)
+		return false;
+
+	if (CreateSwapChain(screenWidth, screenHeight, vsync, hwnd, fullscreen) == false)
+		return false;
+
+	return CreateViews(screenWidth, screenHeight, screenDepth, screenNear);
+}
+
+bool D3DClass::EnumerateAdapter()
+{
 	HRESULT result;
 
 	/*
@@ -44,56 +63,50 @@ bool D3DClass::Initialize(
 		will degrade performance and give us annoying errors in the debug output.
 	*/
 
-
-	// Create a DirectX graphics interface factory.
-	IDXGIFactory* factory;
-	if (FAILED(CreateDXGIFactory(__uuidof(IDXGIFactory), (void**)&factory)))
+	// Create a DirectX graphics interface factory. Kept until the swap chain exists, it has to come from the same factory as the adapter
+	if (FAILED(CreateDXGIFactory(__uuidof(IDXGIFactory), (void**)&m_factory)))
 		return false;
 
-	// Use the factory to create an adapter for the primary graphics interface (video card)
-	IDXGIAdapter* adapter;
-	if (FAILED(factory->EnumAdapters(0, &adapter)))
+	// Use the factory to create an adapter for the primary graphics interface (video card), CreateDevice uses it
+	if (FAILED(m_factory->EnumAdapters(0, &m_adapter)))
 		return false;
 
 	// Enumerate the primary adapter output (monitor)
 	IDXGIOutput* adapterOutput;
-	if (FAILED(adapter->EnumOutputs(0, &adapterOutput)))
+	if (FAILED(m_adapter->EnumOutputs(0, &adapterOutput)))
 		return false;
 
-	// Get the number of modes that fit the DXGI_FORMAT_R8G8B8A8_UNORM display format for the adapter output (monitor).
-	unsigned int numModes = 0;
-	result = adapterOutput->GetDisplayModeList(DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numModes, NULL);
-	if(FAILED(result))
-		return false;
+	/*
+		Get the display modes that fit the DXGI_FORMAT_R8G8B8A8_UNORM display format for the adapter output (monitor).
+		The tutorial asks for the count and then the list, every call goes to the driver so we start with a list
+		that's big enough for almost every monitor and only ask for the count if it wasn't.
+		The window size isn't known yet, CreateSwapChain picks the refresh rate out of the list.
+	*/
+	unsigned int numModes = DISPLAY_MODE_GUESS;
+	m_displayModes.resize(numModes);
+	result = adapterOutput->GetDisplayModeList(DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numModes, m_displayModes.data());
+	if (result == DXGI_ERROR_MORE_DATA)
+	{
+		result = adapterOutput->GetDisplayModeList(DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numModes, nullptr);
+		if (FAILED(result))
+			return false;
 
-	// Create a list to hold all the possible display modes for this monitor/video card combination.
-	DXGI_MODE_DESC* displayModeList = new DXGI_MODE_DESC[numModes];
-	if (displayModeList == nullptr)
-		return false;
+		m_displayModes.resize(numModes);
+		result = adapterOutput->GetDisplayModeList(DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numModes, m_displayModes.data());
+	}
 
-	// Get the number of modes that fit the DXGI_FORMAT_R8G8B8A8_UNORM
-	// display format for the adapter output (monitor)
-	result = adapterOutput->GetDisplayModeList(DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numModes, displayModeList);
 	if (FAILED(result))
 		return false;
 
-	// Now go through all the display modes and find the one that matches the screen width and height.
-	// When a match is found store the numerator and denominator of the refresh rate for that monitor.
-	unsigned int numerator = 0;
-	unsigned int denominator = 1;
-	for (unsigned int i = 0; i < numModes; i++)
-	{
-		if (displayModeList[i].Width == (unsigned int)screenWidth &&
-			displayModeList[i].Height == (unsigned int)screenHeight)
-		{
-			numerator = displayModeList[i].RefreshRate.Numerator;
-			denominator = displayModeList[i].RefreshRate.Denominator;
-		}
-	}
+	m_displayModes.resize(numModes);
+
+	// Release the adapter output
+	adapterOutput->Release();
+	adapterOutput = nullptr;
 
 	// Name of the video card and the amount of video memory. 
 	DXGI_ADAPTER_DESC adapterDesc;
-	if (FAILED(adapter->GetDesc(&adapterDesc)))
+	if (FAILED(m_adapter->GetDesc(&adapterDesc)))
 		return false;
 
 	// Returns bytes but we want to store dedicated video card memory in megabytes
@@ -104,24 +117,60 @@ bool D3DClass::Initialize(
 	if (wcstombs_s(&stringLength, m_videoCardDescription, 128, adapterDesc.Description, 128) != 0)
 		return false;
 
-	// Now that we have stored the numerator and denominator for the refresh rate
-	// and the video card information we can release the structures and interfaces used to get that information.
+	return true;
+}
 
-	// Release the display mode list
-	delete[] displayModeList;
-	displayModeList = nullptr;
+bool D3DClass::CreateDevice()
+{
+	// The device only needs one variable set up, the feature level.
+	// This variable tells DirectX what version we plan to use. Here we set the feature level to 11.0 which is DirectX 11.
+	// You can set this to 10 or 9 to use a lower level version of DirectX if you plan on 
+	// supporting multiple versions or running on lower end hardware. 
 
-	// Release the adapter output
-	adapterOutput->Release();
-	adapterOutput = nullptr;
+	// Set the feature level to DirectX 11.
+	D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_1;
 
-	// Release the adapter.
-	adapter->Release();
-	adapter = nullptr;
+	/*
+		Now that the feature level has been filled out we can create
+		the Direct3D device, and the Direct3D device context. The Direct3D device and Direct3D device 
+		context are very important, they are the interface to all of the Direct3D functions.
+		We will use the device and device context for almost everything from this point forward. 
+		Those of you reading this who are familiar with the previous versions of DirectX will recognize the 
+		Direct3D device but will be unfamiliar with the new Direct3D device context.
+		Basically they took the functionality of the Direct3D device and split it up into two different devices so you need to use both now.
+		Note that if the user does not have a DirectX 11 video card this function call will fail to create the device and device context.
+		Also if you are testing DirectX 11 functionality yourself and don't have a DirectX 11 video card then you can replace D3D_DRIVER_TYPE_HARDWARE with D3D_DRIVER_TYPE_REFERENCE and DirectX will use your CPU to draw instead of the video card hardware.
+		Note that this runs 1/1000 the speed but it is good for people who don't have DirectX 11 video cards yet on all their machines. 
+	*/
 
-	// Release the factory
-	factory->Release();
-	factory = nullptr;
+	// Create the Direct3D device and Direct3D device context. No window needed, the swap chain comes later.
+	// With an explicit adapter the driver type has to be unknown, the adapter decides
+	const HRESULT result = D3D11CreateDevice(m_adapter, D3D_DRIVER_TYPE_UNKNOWN, nullptr, 0, &featureLevel, 1,
+		D3D11_SDK_VERSION, &m_device, nullptr, &m_deviceContext);
+
+	if (FAILED(result))
+		return false;
+
+	return true;
+}
+
+bool D3DClass::CreateSwapChain(int screenWidth, int screenHeight, bool vsync, HWND hwnd, bool fullscreen)
+{
+	m_vsync_enabled = vsync;
+
+	// Now go through all the display modes and find the one that matches the screen width and height.
+	// When a match is found store the numerator and denominator of the refresh rate for that monitor.
+	unsigned int numerator = 0;
+	unsigned int denominator = 1;
+	for (const DXGI_MODE_DESC& mode : m_displayModes)
+	{
+		if (mode.Width == (unsigned int)screenWidth &&
+			mode.Height == (unsigned int)screenHeight)
+		{
+			numerator = mode.RefreshRate.Numerator;
+			denominator = mode.RefreshRate.Denominator;
+		}
+	}
 
 	/*
 		Note the authors comment isn't completely accurate, at least not for all api's, theres a dx mode that does copy forward but the screenbuffer is not wrapped to the last buffer.
@@ -185,33 +234,28 @@ bool D3DClass::Initialize(
 	// Don't set the advanced flags.
 	swapChainDesc.Flags = 0;
 
-	// After setting up the swap chain description we also need to setup one more variable called the feature level.
-	// This variable tells DirectX what version we plan to use. Here we set the feature level to 11.0 which is DirectX 11.
-	// You can set this to 10 or 9 to use a lower level version of DirectX if you plan on 
-	// supporting multiple versions or running on lower end hardware. 
+	// Create the swap chain for the device we already have
+	if (FAILED(m_factory->CreateSwapChain(m_device, &swapChainDesc, &m_swapChain)))
+		return false;
 
-	// Set the feature level to DirectX 11.
-	D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_1;
+	// Now that we have the swap chain we can release the structures and interfaces used to get there.
+	m_displayModes.clear();
+	m_displayModes.shrink_to_fit();
 
-	/*
-		Now that the swap chain description and feature level have been filled out we can create the swap chain,
-		the Direct3D device, and the Direct3D device context. The Direct3D device and Direct3D device 
-		context are very important, they are the interface to all of the Direct3D functions.
-		We will use the device and device context for almost everything from this point forward. 
-		Those of you reading this who are familiar with the previous versions of DirectX will recognize the 
-		Direct3D device but will be unfamiliar with the new Direct3D device context.
-		Basically they took the functionality of the Direct3D device and split it up into two different devices so you need to use both now.
-		Note that if the user does not have a DirectX 11 video card this function call will fail to create the device and device context.
-		Also if you are testing DirectX 11 functionality yourself and don't have a DirectX 11 video card then you can replace D3D_DRIVER_TYPE_HARDWARE with D3D_DRIVER_TYPE_REFERENCE and DirectX will use your CPU to draw instead of the video card hardware.
-		Note that this runs 1/1000 the speed but it is good for people who don't have DirectX 11 video cards yet on all their machines. 
-	*/
+	// Release the adapter.
+	m_adapter->Release();
+	m_adapter = nullptr;
 
-	// Create the swap chain, Direct3D device, and Direct3D device context.
-	result = D3D11CreateDeviceAndSwapChain(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, &featureLevel, 1,
-		D3D11_SDK_VERSION, &swapChainDesc, &m_swapChain, &m_device, nullptr, &m_deviceContext);
+	// Release the factory
+	m_factory->Release();
+	m_factory = nullptr;
 
-	if (FAILED(result))
-		return false;
+	return true;
+}
+
+bool D3DClass::CreateViews(int screenWidth, int screenHeight, float screenDepth, float screenNear)
+{
+	HRESULT result;
 
 	/*
 		Sometimes this call to create the device will fail if the primary video card is not compatible with DirectX 11.
@@ -219,6 +263,7 @@ bool D3DClass::Initialize(
 		Also some hybrid graphics cards work that way with the primary being the low power Intel card and the secondary being the high power Nvidia card.
 		To get around this you will need to not use the default device and instead enumerate all the
 		video cards in the machine and have the user choose which one to use and then specify that card when creating the device. 
+		(EnumerateAdapter picks adapter 0 and CreateDevice uses it, which is what passing nullptr used to do.)
 		Now that we have a swap chain we need to get a pointer to the back buffer and then attach it to the swap chain.
 		We'll use the CreateRenderTargetView function to attach the back buffer to our swap chain.
 	*/
@@ -290,6 +335,12 @@ bool D3DClass::Initialize(
 
 	m_deviceContext->OMSetDepthStencilState(m_depthStencilState, 1);
 
+	// Same thing with depth turned off for 2D, only difference is DepthEnable
+	depthStencilDesc.DepthEnable = false;
+	result = m_device->CreateDepthStencilState(&depthStencilDesc, &m_depthDisabledStencilState);
+	if (FAILED(result))
+		return false;
+
 	// Set up the stencil view so dx knows that its at
 	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc;
 	ZeroMemory(&depthStencilViewDesc, sizeof(depthStencilViewDesc));
@@ -330,16 +381,39 @@ bool D3DClass::Initialize(
 	m_deviceContext->RSSetState(m_rasterState);
 
 	// The view port also needs to be set up so that dx can map clip space coordinates to the render target space. set this to be the entire size of the window.
-	D3D11_VIEWPORT viewport;
-	viewport.Width = (float)screenWidth;
-	viewport.Height = (float)screenWidth;
-	viewport.MinDepth = 0.0f; // Near
-	viewport.MaxDepth = 1.0f; // Far
-	viewport.TopLeftX = 0.0f; 
-	viewport.TopLeftY = 0.0f;
+	m_viewport.Width = (float)screenWidth;
+	m_viewport.Height = (float)screenHeight;
+	m_viewport.MinDepth = 0.0f; // Near
+	m_viewport.MaxDepth = 1.0f; // Far
+	m_viewport.TopLeftX = 0.0f; 
+	m_viewport.TopLeftY = 0.0f;
+
+	// Create the viewport, kept around so it can be put back after rendering to a texture
+	m_deviceContext->RSSetViewports(1, &m_viewport);
+
+	/*
+		Blend states for 2D. Enabled is regular alpha blending: src * srcAlpha + dest * (1 - srcAlpha),
+		disabled is the same desc with BlendEnable off which is what the pipeline does by default.
+	*/
+	D3D11_BLEND_DESC blendStateDesc;
+	ZeroMemory(&blendStateDesc, sizeof(blendStateDesc));
+	blendStateDesc.RenderTarget[0].BlendEnable = TRUE;
+	blendStateDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	blendStateDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	blendStateDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blendStateDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blendStateDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+	blendStateDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blendStateDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+	result = m_device->CreateBlendState(&blendStateDesc, &m_alphaEnableBlendingState);
+	if (FAILED(result))
+		return false;
 
-	// Create the viewport
-	m_deviceContext->RSSetViewports(1, &viewport);
+	blendStateDesc.RenderTarget[0].BlendEnable = FALSE;
+	result = m_device->CreateBlendState(&blendStateDesc, &m_alphaDisableBlendingState);
+	if (FAILED(result))
+		return false;
 
 	// Projection and world matrix
 	float fieldOfView = 3.141592654f / 4.0f;
@@ -354,6 +428,19 @@ bool D3DClass::Initialize(
 
 void D3DClass::Shutdown()
 {
+	// Only still around if startup failed between EnumerateAdapter and CreateSwapChain
+	if (m_adapter)
+	{
+		m_adapter->Release();
+		m_adapter = nullptr;
+	}
+
+	if (m_factory)
+	{
+		m_factory->Release();
+		m_factory = nullptr;
+	}
+
 	/*
 		Before cleaning up everything from Initialize, I put in a call to force the swap chain to go into windowed 
 		mode first before releasing any pointers. If this is not done and you try to release the 
@@ -366,6 +453,18 @@ void D3DClass::Shutdown()
         m_swapChain->SetFullscreenState(false, nullptr);
     }
 
+    if (m_alphaEnableBlendingState)
+    {
+        m_alphaEnableBlendingState->Release();
+        m_alphaEnableBlendingState = nullptr;
+    }
+
+    if (m_alphaDisableBlendingState)
+    {
+        m_alphaDisableBlendingState->Release();
+        m_alphaDisableBlendingState = nullptr;
+    }
+
     if (m_rasterState)
     {
         m_rasterState->Release();
@@ -378,6 +477,12 @@ void D3DClass::Shutdown()
         m_depthStencilView = nullptr;
     }
 
+    if (m_depthDisabledStencilState)
+    {
+        m_depthDisabledStencilState->Release();
+        m_depthDisabledStencilState = nullptr;
+    }
+
     if (m_depthStencilState)
     {
         m_depthStencilState->Release();
@@ -471,4 +576,40 @@ void D3DClass::GetVideoCardInfo(char* cardName, int& memory)
 {
 	strcpy_s(cardName, 128, m_videoCardDescription);
 	memory = m_videoCardMemory;
-}
\ No newline at end of file
+}
+void D3DClass::TurnZBufferOn()
+{
+	m_deviceContext->OMSetDepthStencilState(m_depthStencilState, 1);
+}
+
+void D3DClass::TurnZBufferOff()
+{
+	m_deviceContext->OMSetDepthStencilState(m_depthDisabledStencilState, 1);
+}
+
+void D3DClass::TurnOnAlphaBlending()
+{
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	m_deviceContext->OMSetBlendState(m_alphaEnableBlendingState, blendFactor, 0xffffffff);
+}
+
+void D3DClass::TurnOffAlphaBlending()
+{
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	m_deviceContext->OMSetBlendState(m_alphaDisableBlendingState, blendFactor, 0xffffffff);
+}
+
+void D3DClass::SetBackBufferRenderTarget()
+{
+	m_deviceContext->OMSetRenderTargets(1, &m_renderTargetView, m_depthStencilView);
+}
+
+void D3DClass::ResetViewport()
+{
+	m_deviceContext->RSSetViewports(1, &m_viewport);
+}
+
+void D3DClass::ResetRasterState()
+{
+	m_deviceContext->RSSetState(m_rasterState);
+}
@@ -10,9 +10,12 @@
 
 #include <d3d11.h>
 #include <directxmath.h>
+#include <vector>
 
 using namespace DirectX; // XMMATRIX, etc., uncomment to see the dx stuff
 
+const unsigned int DISPLAY_MODE_GUESS = 256; // display modes asked for in one go, most monitors have fewer
+
 class D3DClass
 {
 public:
@@ -21,6 +24,14 @@ public:
 	~D3DClass();
 
 	bool Initialize(int, int, bool, HWND, bool, float, float);
+	/*
+		Initialize in stages, in this order. Adapter and device don't need the window so startup runs them on
+		another thread while the window is created, the swap chain needs both and goes on the window's thread.
+	*/
+	bool EnumerateAdapter();
+	bool CreateDevice();
+	bool CreateSwapChain(int, int, bool, HWND, bool);
+	bool CreateViews(int, int, float, float);
 	void Shutdown();
 
 	void BeginScene(float, float, float, float);
@@ -34,18 +45,36 @@ public:
 	void GetOrthoMatrix(XMMATRIX&);
 
 	void GetVideoCardInfo(char*, int&);
+
+	// 2D stuff (overlay, text) is drawn with depth off and alpha blending on, then both get switched back
+	void TurnZBufferOn();
+	void TurnZBufferOff();
+	void TurnOnAlphaBlending();
+	void TurnOffAlphaBlending();
+
+	// Back to drawing on the screen after rendering into something else (shadow maps)
+	void SetBackBufferRenderTarget();
+	void ResetViewport();
+	void ResetRasterState();
 private:
 	bool m_vsync_enabled;
 	int m_videoCardMemory;
 	char m_videoCardDescription[128];
+	IDXGIFactory* m_factory; // only between EnumerateAdapter and CreateSwapChain
+	IDXGIAdapter* m_adapter;
+	std::vector<DXGI_MODE_DESC> m_displayModes;
 	IDXGISwapChain* m_swapChain;
 	ID3D11Device* m_device;
 	ID3D11DeviceContext* m_deviceContext;
 	ID3D11RenderTargetView* m_renderTargetView;
 	ID3D11Texture2D* m_depthStencilBuffer;
 	ID3D11DepthStencilState* m_depthStencilState;
+	ID3D11DepthStencilState* m_depthDisabledStencilState;
 	ID3D11DepthStencilView* m_depthStencilView;
 	ID3D11RasterizerState* m_rasterState;
+	ID3D11BlendState* m_alphaEnableBlendingState;
+	ID3D11BlendState* m_alphaDisableBlendingState;
+	D3D11_VIEWPORT m_viewport;
 	XMMATRIX m_projectionMatrix;
 	XMMATRIX m_worldMatrix;
 	XMMATRIX m_orthoMatrix;
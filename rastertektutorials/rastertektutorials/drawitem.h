@@ -0,0 +1,16 @@
+#pragma once
+
+#include <directxmath.h>
+
+using namespace DirectX;
+
+// One mesh instance for the render thread, what the scene hands over for every visible renderable and shadow caster
+struct DrawItemType
+{
+	XMFLOAT4X4 world;
+	unsigned int mesh;
+	unsigned int material;
+	unsigned int lod; // index into the mesh's LOD chain, 0 is full detail
+	float lodPixels; // pixels per model unit of error where it stands, how big it is on screen
+	float screenSize; // pixels across its bounding sphere covers, what texture streaming picks mips from
+};
@@ -0,0 +1,408 @@
+#include "entitybenchmarkclass.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+static unsigned int NextRandom(unsigned int& state)
+{
+	// xorshift32, same sequence every run so runs can be compared
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static float RandomFloat(unsigned int& state, float low, float high)
+{
+	return low + (high - low) * (float)(NextRandom(state) & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+static long long Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double Milliseconds(long long start, long long end)
+{
+	return (double)(end - start) / 1000000.0;
+}
+
+static const unsigned int MOVING_MASK = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_VELOCITY) |
+	COMPONENT_BIT(COMPONENT_BOUNDS) | COMPONENT_BIT(COMPONENT_RENDERABLE);
+
+EntityBenchmarkClass::EntityBenchmarkClass() :
+	m_Jobs(nullptr),
+	m_random(0x3C6EF372),
+	m_checksum(0.0)
+{
+}
+
+EntityBenchmarkClass::EntityBenchmarkClass(const EntityBenchmarkClass&)
+{
+}
+
+EntityBenchmarkClass::~EntityBenchmarkClass()
+{
+}
+
+int EntityBenchmarkClass::Run(const std::string& reportName)
+{
+	EntityBenchmarkClass benchmark;
+	if (benchmark.Initialize() == false)
+		return 2;
+
+	ResultType results[2];
+	const bool result = benchmark.MeasureIterate(results[0]) && benchmark.MeasureChurn(results[1]);
+
+	const int threads = benchmark.m_Jobs->GetThreadCount();
+	benchmark.Shutdown();
+	if (result == false)
+		return 2;
+
+	FILE* report = fopen(reportName.c_str(), "w");
+	if (report == nullptr)
+		return 2;
+
+	fprintf(report, "entity store, %d threads, %d measured frames at a fixed %.4f s step, median / p95 in ms\n\n", threads, ENTITY_BENCHMARK_FRAMES,
+		ENTITY_BENCHMARK_TIME_STEP);
+	fprintf(report, "%-10s %10s %-10s %16s %-10s %16s  %s\n", "run", "entities", "phase", "", "phase", "", "checks");
+
+	bool passed = true;
+	for (const ResultType& run : results)
+	{
+		char first[32], second[32];
+		snprintf(first, sizeof(first), "%.3f / %.3f", run.median[0], run.p95[0]);
+		snprintf(second, sizeof(second), "%.3f / %.3f", run.median[1], run.p95[1]);
+		fprintf(report, "%-10s %10d %-10s %16s %-10s %16s  %s\n", run.name, run.entities, run.phases[0], first, run.phases[1], second,
+			Passed(run) ? "passed" : "FAILED");
+
+		if (run.missedFrames)
+			fprintf(report, "  %d frames where the read pass didn't visit every entity\n", run.missedFrames);
+		if (run.countFrames)
+			fprintf(report, "  %d frames where the entity count wasn't %d\n", run.countFrames, run.entities);
+		if (run.sparseFrames)
+			fprintf(report, "  %d frames with a chunk that isn't full before the last one of its archetype\n", run.sparseFrames);
+		if (run.misplaced)
+			fprintf(report, "  %d of %d sampled entities not where their velocity puts them\n", run.misplaced, ENTITY_BENCHMARK_SAMPLES);
+		if (run.unset)
+			fprintf(report, "  %d created entities missing the components they were given\n", run.unset);
+		if (run.slots > (unsigned int)(run.entities + ENTITY_BENCHMARK_CHURN_PER_FRAME))
+			fprintf(report, "  %u entity slots, freed indices aren't being reused\n", run.slots);
+
+		passed = passed && Passed(run);
+	}
+
+	fprintf(report, "\nchecksum %.3f\n", benchmark.m_checksum);
+	fprintf(report, "\n%s\n", passed ? "all checks passed" : "FAILED");
+	fclose(report);
+
+	return passed ? 0 : 1;
+}
+
+bool EntityBenchmarkClass::Initialize()
+{
+	m_Jobs = new JobSystemClass();
+	if (m_Jobs == nullptr)
+		return false;
+
+	return m_Jobs->Initialize(0);
+}
+
+void EntityBenchmarkClass::Shutdown()
+{
+	if (m_Jobs)
+	{
+		m_Jobs->Shutdown();
+		delete m_Jobs;
+		m_Jobs = nullptr;
+	}
+}
+
+bool EntityBenchmarkClass::MeasureIterate(ResultType& result)
+{
+	EntityStoreClass* entities = new EntityStoreClass();
+	if (entities == nullptr)
+		return false;
+
+	if (entities->Initialize(m_Jobs) == false)
+	{
+		delete entities;
+		return false;
+	}
+
+	memset(&result, 0, sizeof(result));
+	result.name = "iterate";
+	result.phases[0] = "movement";
+	result.phases[1] = "read";
+	result.entities = ENTITY_BENCHMARK_ITERATE;
+
+	// Remember where some of them start so the movement can be checked at the end
+	std::vector<EntityId> samples;
+	std::vector<XMFLOAT3> starts, velocities;
+	for (int i = 0; i < ENTITY_BENCHMARK_ITERATE; ++i)
+	{
+		const EntityId entity = CreateMoving(entities);
+		if (i % (ENTITY_BENCHMARK_ITERATE / ENTITY_BENCHMARK_SAMPLES) == 0 && (int)samples.size() < ENTITY_BENCHMARK_SAMPLES)
+		{
+			samples.push_back(entity);
+			starts.push_back(entities->Get<TransformComponent>(entity)->position);
+			velocities.push_back(entities->Get<VelocityComponent>(entity)->linear);
+		}
+	}
+
+	std::vector<double> movement, read;
+	for (int i = 0; i < ENTITY_BENCHMARK_WARMUP + ENTITY_BENCHMARK_FRAMES; ++i)
+	{
+		long long start = Now();
+		Move(entities, ENTITY_BENCHMARK_TIME_STEP);
+		const double moveMs = Milliseconds(start, Now());
+
+		start = Now();
+		const int visited = Read(entities);
+		const double readMs = Milliseconds(start, Now());
+
+		if (i < ENTITY_BENCHMARK_WARMUP)
+			continue;
+
+		movement.push_back(moveMs);
+		read.push_back(readMs);
+		result.missedFrames += visited != ENTITY_BENCHMARK_ITERATE ? 1 : 0;
+		result.countFrames += entities->GetEntityCount() != ENTITY_BENCHMARK_ITERATE ? 1 : 0;
+		result.sparseFrames += IsDense(entities) ? 0 : 1;
+	}
+
+	// A few hundred float adds, allow for the rounding
+	const float elapsed = ENTITY_BENCHMARK_TIME_STEP * (ENTITY_BENCHMARK_WARMUP + ENTITY_BENCHMARK_FRAMES);
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		const XMFLOAT3& position = entities->Get<TransformComponent>(samples[i])->position;
+		const float dx = position.x - (starts[i].x + velocities[i].x * elapsed);
+		const float dy = position.y - (starts[i].y + velocities[i].y * elapsed);
+		const float dz = position.z - (starts[i].z + velocities[i].z * elapsed);
+		result.misplaced += sqrtf(dx * dx + dy * dy + dz * dz) > 0.01f ? 1 : 0;
+	}
+
+	result.slots = entities->GetSlotCount();
+	Percentiles(movement, result.median[0], result.p95[0]);
+	Percentiles(read, result.median[1], result.p95[1]);
+
+	entities->Shutdown();
+	delete entities;
+	return true;
+}
+
+bool EntityBenchmarkClass::MeasureChurn(ResultType& result)
+{
+	EntityStoreClass* entities = new EntityStoreClass();
+	if (entities == nullptr)
+		return false;
+
+	if (entities->Initialize(m_Jobs) == false)
+	{
+		delete entities;
+		return false;
+	}
+
+	EntityCommandBufferClass* commands = new EntityCommandBufferClass();
+	if (commands == nullptr)
+	{
+		entities->Shutdown();
+		delete entities;
+		return false;
+	}
+
+	memset(&result, 0, sizeof(result));
+	result.name = "churn";
+	result.phases[0] = "record";
+	result.phases[1] = "playback";
+	result.entities = ENTITY_BENCHMARK_CHURN;
+
+	for (int i = 0; i < ENTITY_BENCHMARK_CHURN; ++i)
+		CreateMoving(entities);
+
+	std::vector<double> record, playback;
+	const unsigned int indexRange = ENTITY_BENCHMARK_CHURN + ENTITY_BENCHMARK_CHURN_PER_FRAME;
+	for (int frame = 0; frame < ENTITY_BENCHMARK_WARMUP + ENTITY_BENCHMARK_FRAMES; ++frame)
+	{
+		// Same as the ecs_churn scenario: a run of live indices from a random start goes, as many new ones come in
+		long long start = Now();
+		const unsigned int first = NextRandom(m_random) % indexRange;
+		int destroyed = 0;
+		for (unsigned int i = 0; i < indexRange && destroyed < ENTITY_BENCHMARK_CHURN_PER_FRAME; ++i)
+		{
+			const EntityId victim = entities->GetEntity((first + i) % indexRange);
+			if (victim != INVALID_ENTITY)
+			{
+				commands->DestroyEntity(victim);
+				++destroyed;
+			}
+		}
+
+		// The frame number in the material marks this frame's entities for the check below
+		for (int i = 0; i < destroyed; ++i)
+		{
+			const EntityId entity = commands->CreateEntity(MOVING_MASK);
+
+			TransformComponent transform;
+			transform.position = XMFLOAT3(RandomFloat(m_random, -ENTITY_BENCHMARK_WORLD_SIZE, ENTITY_BENCHMARK_WORLD_SIZE),
+				RandomFloat(m_random, -ENTITY_BENCHMARK_WORLD_SIZE, ENTITY_BENCHMARK_WORLD_SIZE), RandomFloat(m_random, 0.0f, ENTITY_BENCHMARK_WORLD_SIZE));
+			transform.scale = 1.0f;
+			transform.rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			commands->Set(entity, transform);
+
+			VelocityComponent velocity;
+			velocity.linear = XMFLOAT3(RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f));
+			velocity.spin = 0.0f;
+			commands->Set(entity, velocity);
+
+			BoundsComponent bounds;
+			bounds.center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			bounds.radius = 0.5f;
+			bounds.proxy = 0;
+			commands->Set(entity, bounds);
+
+			RenderableComponent renderable;
+			renderable.mesh = 0;
+			renderable.material = (unsigned int)frame + 1;
+			renderable.flags = 0;
+			renderable.lod = 0;
+			commands->Set(entity, renderable);
+		}
+		const double recordMs = Milliseconds(start, Now());
+
+		start = Now();
+		entities->Playback(*commands);
+		const double playbackMs = Milliseconds(start, Now());
+		commands->Clear();
+
+		Move(entities, ENTITY_BENCHMARK_TIME_STEP);
+		const int visited = Read(entities);
+
+		if (frame < ENTITY_BENCHMARK_WARMUP)
+			continue;
+
+		record.push_back(recordMs);
+		playback.push_back(playbackMs);
+		result.missedFrames += visited != ENTITY_BENCHMARK_CHURN ? 1 : 0;
+		result.countFrames += entities->GetEntityCount() != ENTITY_BENCHMARK_CHURN ? 1 : 0;
+		result.sparseFrames += IsDense(entities) ? 0 : 1;
+
+		// Everything this frame's buffer made is there with what it was given
+		int created = 0;
+		const unsigned int marker = (unsigned int)frame + 1;
+		entities->ForEachChunk(MOVING_MASK, [&created, marker](ChunkType& chunk)
+		{
+			const TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+			const BoundsComponent* bounds = EntityStoreClass::GetArray<BoundsComponent>(chunk);
+			const RenderableComponent* renderables = EntityStoreClass::GetArray<RenderableComponent>(chunk);
+			for (int i = 0; i < chunk.count; ++i)
+				created += renderables[i].material == marker && transforms[i].scale == 1.0f && bounds[i].radius == 0.5f ? 1 : 0;
+		});
+		result.unset += created > destroyed ? created - destroyed : destroyed - created;
+	}
+
+	result.slots = entities->GetSlotCount();
+	Percentiles(record, result.median[0], result.p95[0]);
+	Percentiles(playback, result.median[1], result.p95[1]);
+
+	delete commands;
+	entities->Shutdown();
+	delete entities;
+	return true;
+}
+
+EntityId EntityBenchmarkClass::CreateMoving(EntityStoreClass* entities)
+{
+	const EntityId entity = entities->CreateEntity(MOVING_MASK);
+
+	TransformComponent* transform = entities->Get<TransformComponent>(entity);
+	transform->position = XMFLOAT3(RandomFloat(m_random, -ENTITY_BENCHMARK_WORLD_SIZE, ENTITY_BENCHMARK_WORLD_SIZE),
+		RandomFloat(m_random, -ENTITY_BENCHMARK_WORLD_SIZE, ENTITY_BENCHMARK_WORLD_SIZE), RandomFloat(m_random, 0.0f, ENTITY_BENCHMARK_WORLD_SIZE));
+	transform->scale = RandomFloat(m_random, 0.25f, 1.0f);
+	transform->rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	VelocityComponent* velocity = entities->Get<VelocityComponent>(entity);
+	velocity->linear = XMFLOAT3(RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f));
+	velocity->spin = RandomFloat(m_random, -1.0f, 1.0f);
+
+	BoundsComponent* bounds = entities->Get<BoundsComponent>(entity);
+	bounds->radius = 1.0f;
+
+	return entity;
+}
+
+void EntityBenchmarkClass::Move(EntityStoreClass* entities, float deltaTime)
+{
+	// SceneClass::MovementSystem
+	const unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_VELOCITY);
+	entities->ParallelForEachChunk(mask, [deltaTime](ChunkType& chunk, int)
+	{
+		TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+		const VelocityComponent* velocities = EntityStoreClass::GetArray<VelocityComponent>(chunk);
+
+		for (int i = 0; i < chunk.count; ++i)
+		{
+			TransformComponent& transform = transforms[i];
+			const VelocityComponent& velocity = velocities[i];
+			transform.position.x += velocity.linear.x * deltaTime;
+			transform.position.y += velocity.linear.y * deltaTime;
+			transform.position.z += velocity.linear.z * deltaTime;
+
+			if (velocity.spin != 0.0f)
+			{
+				XMVECTOR spin = XMQuaternionRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), velocity.spin * deltaTime);
+				XMStoreFloat4(&transform.rotation, XMQuaternionNormalize(XMQuaternionMultiply(XMLoadFloat4(&transform.rotation), spin)));
+			}
+		}
+	});
+}
+
+int EntityBenchmarkClass::Read(EntityStoreClass* entities)
+{
+	// The bounds system's reads without the tree, world sphere per entity
+	int visited = 0;
+	double sum = 0.0;
+	const unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BOUNDS);
+	entities->ForEachChunk(mask, [&visited, &sum](ChunkType& chunk)
+	{
+		const TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+		const BoundsComponent* bounds = EntityStoreClass::GetArray<BoundsComponent>(chunk);
+		for (int i = 0; i < chunk.count; ++i)
+			sum += transforms[i].position.x + transforms[i].position.y + transforms[i].position.z + bounds[i].radius * transforms[i].scale;
+
+		visited += chunk.count;
+	});
+
+	m_checksum += sum;
+	return visited;
+}
+
+bool EntityBenchmarkClass::IsDense(EntityStoreClass* entities)
+{
+	for (ArchetypeType* archetype : entities->GetArchetypes())
+	{
+		for (size_t i = 0; i < archetype->chunks.size(); ++i)
+		{
+			const int count = archetype->chunks[i]->count;
+			if (count <= 0 || (i + 1 < archetype->chunks.size() && count != archetype->capacity))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void EntityBenchmarkClass::Percentiles(std::vector<double>& values, double& median, double& p95)
+{
+	std::sort(values.begin(), values.end());
+	median = values[values.size() / 2];
+	p95 = values[(values.size() * 95) / 100];
+}
+
+bool EntityBenchmarkClass::Passed(const ResultType& result)
+{
+	return result.missedFrames == 0 && result.countFrames == 0 && result.sparseFrames == 0 && result.misplaced == 0 && result.unset == 0 &&
+		result.slots <= (unsigned int)(result.entities + ENTITY_BENCHMARK_CHURN_PER_FRAME);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "entitystoreclass.h"
+#include "jobsystemclass.h"
+
+/*
+	Entity store benchmark, run with -ecs [-out report.txt]. Windowless, no device, just EntityStoreClass on the job system,
+	so the ecs_iterate and ecs_churn numbers can be had without a scene or a renderer. Both run at a fixed time step,
+	ENTITY_BENCHMARK_WARMUP frames and then ENTITY_BENCHMARK_FRAMES measured ones, median and p95 of each phase:
+		iterate - ENTITY_BENCHMARK_ITERATE moving entities.
+			movement: the scene's movement system, transforms + velocities on every runner (ParallelForEachChunk)
+			read: one thread walking transforms + bounds (ForEachChunk), the way the bounds system does
+		churn - ENTITY_BENCHMARK_CHURN entities, ENTITY_BENCHMARK_CHURN_PER_FRAME of them swapped out every frame
+			record: destroys and creates with all four components set, into an EntityCommandBufferClass
+			playback: EntityStoreClass::Playback of that buffer
+	Checked outside the timing, exit code 1 if any of it is off: every frame the read pass has to visit every entity,
+	the count has to stay put, and every chunk but the last of each archetype has to be full. After the run a sample of
+	entities has to be where their velocity says, every entity a frame's buffer created has to have the components it
+	was given, and freed indices have to be reused so the slots never grow past the population plus one frame's worth.
+*/
+
+const int ENTITY_BENCHMARK_ITERATE = 100000;
+const int ENTITY_BENCHMARK_CHURN = 20000;
+const int ENTITY_BENCHMARK_CHURN_PER_FRAME = 1000;
+const int ENTITY_BENCHMARK_WARMUP = 30;
+const int ENTITY_BENCHMARK_FRAMES = 300;
+const int ENTITY_BENCHMARK_SAMPLES = 1000; // entities whose positions are checked after the iterate run
+const float ENTITY_BENCHMARK_TIME_STEP = 1.0f / 60.0f;
+const float ENTITY_BENCHMARK_WORLD_SIZE = 100.0f;
+const char* const ENTITY_BENCHMARK_DEFAULT_REPORT = "entities.txt";
+
+class EntityBenchmarkClass
+{
+private:
+	struct ResultType
+	{
+		const char* name;
+		const char* phases[2];
+		int entities;
+		double median[2];
+		double p95[2];
+		int missedFrames; // read pass didn't visit every entity
+		int countFrames; // entity count wasn't the population
+		int sparseFrames; // a chunk other than an archetype's last wasn't full
+		int misplaced; // iterate: sampled entities not where their velocity puts them
+		int unset; // churn: created entities without the components they were given
+		unsigned int slots;
+	};
+
+public:
+	EntityBenchmarkClass();
+	EntityBenchmarkClass(const EntityBenchmarkClass&);
+	~EntityBenchmarkClass();
+
+	// Report file, returns the process exit code, 0 = fine, 1 = a check failed, 2 = couldn't set up or write the report
+	static int Run(const std::string&);
+
+	bool Initialize();
+	void Shutdown();
+
+private:
+	bool MeasureIterate(ResultType&);
+	bool MeasureChurn(ResultType&);
+	EntityId CreateMoving(EntityStoreClass*);
+	void Move(EntityStoreClass*, float);
+	int Read(EntityStoreClass*);
+	static bool IsDense(EntityStoreClass*);
+	static void Percentiles(std::vector<double>&, double&, double&);
+	static bool Passed(const ResultType&);
+
+private:
+	JobSystemClass* m_Jobs;
+	unsigned int m_random;
+	double m_checksum; // keeps the read pass from being optimized away
+};
@@ -0,0 +1,580 @@
+#include "entitystoreclass.h"
+#include "alignedmemory.h"
+
+#include <string.h>
+
+// Entity ids are (generation << 32) | index, placeholders from a command buffer use a generation real entities never get
+static const unsigned int PENDING_GENERATION = 0xFFFFFFFFu;
+static const unsigned int MAX_GENERATION = 0x7FFFFFFFu;
+
+static unsigned int EntityIndex(EntityId entity)
+{
+	return (unsigned int)(entity & 0xFFFFFFFFull);
+}
+
+static unsigned int EntityGeneration(EntityId entity)
+{
+	return (unsigned int)(entity >> 32);
+}
+
+static EntityId MakeEntity(unsigned int index, unsigned int generation)
+{
+	return ((EntityId)generation << 32) | index;
+}
+
+static int AlignUp(int value, int alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+EntityStoreClass::EntityStoreClass() :
+	m_Jobs(nullptr),
+	m_entityCount(0),
+	m_chunkCount(0)
+{
+}
+
+EntityStoreClass::EntityStoreClass(const EntityStoreClass&)
+{
+}
+
+EntityStoreClass::~EntityStoreClass()
+{
+}
+
+bool EntityStoreClass::Initialize(JobSystemClass* jobs)
+{
+	m_Jobs = jobs;
+	m_entityCount = 0;
+	m_chunkCount = 0;
+	return true;
+}
+
+void EntityStoreClass::Shutdown()
+{
+	for (ArchetypeType* archetype : m_archetypes)
+	{
+		for (ChunkType* chunk : archetype->chunks)
+		{
+			if (chunk->owned)
+				AlignedFree(chunk->data);
+			delete chunk;
+		}
+
+		delete archetype;
+	}
+
+	for (ChunkType* chunk : m_freeChunks)
+	{
+		if (chunk->owned)
+			AlignedFree(chunk->data);
+		delete chunk;
+	}
+
+	m_archetypes.clear();
+	m_archetypeLookup.clear();
+	m_entities.clear();
+	m_freeEntities.clear();
+	m_freeChunks.clear();
+	m_entityCount = 0;
+	m_chunkCount = 0;
+}
+
+EntityId EntityStoreClass::CreateEntity(unsigned int mask)
+{
+	unsigned int index;
+	if (m_freeEntities.empty() == false)
+	{
+		index = m_freeEntities.back();
+		m_freeEntities.pop_back();
+	}
+	else
+	{
+		index = (unsigned int)m_entities.size();
+		EntityRecordType record = { nullptr, -1, -1, 0 };
+		m_entities.push_back(record);
+	}
+
+	ArchetypeType* archetype = GetArchetype(mask);
+	int chunkIndex, row;
+	AllocateRow(archetype, chunkIndex, row);
+
+	EntityRecordType& record = m_entities[index];
+	record.archetype = archetype;
+	record.chunk = chunkIndex;
+	record.row = row;
+
+	const EntityId entity = MakeEntity(index, record.generation);
+	GetEntities(*archetype->chunks[chunkIndex])[row] = entity;
+
+	++m_entityCount;
+	return entity;
+}
+
+void EntityStoreClass::DestroyEntity(EntityId entity)
+{
+	EntityRecordType* record = GetRecord(entity);
+	if (record == nullptr)
+		return;
+
+	if (m_removeCallback)
+		m_removeCallback(entity, record->archetype->mask);
+
+	RemoveRow(record->archetype, record->chunk, record->row);
+
+	// Bumping the generation makes every id still pointing at this slot invalid
+	record->archetype = nullptr;
+	record->generation = record->generation >= MAX_GENERATION ? 0 : record->generation + 1;
+	m_freeEntities.push_back(EntityIndex(entity));
+	--m_entityCount;
+}
+
+bool EntityStoreClass::IsAlive(EntityId entity)
+{
+	return GetRecord(entity) != nullptr;
+}
+
+EntityId EntityStoreClass::GetEntity(unsigned int index)
+{
+	if (index >= m_entities.size() || m_entities[index].archetype == nullptr)
+		return INVALID_ENTITY;
+
+	return MakeEntity(index, m_entities[index].generation);
+}
+
+void EntityStoreClass::AddComponents(EntityId entity, unsigned int mask)
+{
+	EntityRecordType* record = GetRecord(entity);
+	if (record == nullptr || (record->archetype->mask & mask) == mask)
+		return;
+
+	MoveEntity(entity, record->archetype->mask | mask);
+}
+
+void EntityStoreClass::RemoveComponents(EntityId entity, unsigned int mask)
+{
+	EntityRecordType* record = GetRecord(entity);
+	if (record == nullptr || (record->archetype->mask & mask) == 0)
+		return;
+
+	if (m_removeCallback)
+		m_removeCallback(entity, record->archetype->mask & mask);
+
+	MoveEntity(entity, record->archetype->mask & ~mask);
+}
+
+unsigned int EntityStoreClass::GetMask(EntityId entity)
+{
+	EntityRecordType* record = GetRecord(entity);
+	return record ? record->archetype->mask : 0;
+}
+
+void* EntityStoreClass::GetComponent(EntityId entity, int component)
+{
+	EntityRecordType* record = GetRecord(entity);
+	if (record == nullptr)
+		return nullptr;
+
+	ArchetypeType* archetype = record->archetype;
+	if (archetype->offsets[component] < 0)
+		return nullptr;
+
+	return archetype->chunks[record->chunk]->data + archetype->offsets[component] + record->row * COMPONENT_SIZES[component];
+}
+
+void EntityStoreClass::SetRemoveCallback(const std::function<void(EntityId, unsigned int)>& callback)
+{
+	m_removeCallback = callback;
+}
+
+void EntityStoreClass::Playback(EntityCommandBufferClass& buffer)
+{
+	// Placeholder index -> the entity it turned into
+	std::vector<EntityId> created(buffer.m_pendingCount, INVALID_ENTITY);
+
+	for (const EntityCommandBufferClass::CommandType& command : buffer.m_commands)
+	{
+		// Placeholders only mean something to the buffer that made them, one from another buffer is just dropped
+		EntityId entity = command.entity;
+		if (command.kind != EntityCommandBufferClass::COMMAND_CREATE && EntityGeneration(entity) == PENDING_GENERATION)
+			entity = EntityIndex(entity) < created.size() ? created[EntityIndex(entity)] : INVALID_ENTITY;
+
+		switch (command.kind)
+		{
+			case EntityCommandBufferClass::COMMAND_CREATE:
+			{
+				if (EntityIndex(command.entity) < created.size())
+					created[EntityIndex(command.entity)] = CreateEntity(command.mask);
+				break;
+			}
+			case EntityCommandBufferClass::COMMAND_DESTROY:
+			{
+				DestroyEntity(entity);
+				break;
+			}
+			case EntityCommandBufferClass::COMMAND_ADD:
+			{
+				AddComponents(entity, command.mask);
+				break;
+			}
+			case EntityCommandBufferClass::COMMAND_REMOVE:
+			{
+				RemoveComponents(entity, command.mask);
+				break;
+			}
+			case EntityCommandBufferClass::COMMAND_SET:
+			{
+				void* component = GetComponent(entity, command.component);
+				if (component)
+					memcpy(component, &buffer.m_data[command.dataOffset], command.dataSize);
+				break;
+			}
+		}
+	}
+
+	buffer.Clear();
+}
+
+void EntityStoreClass::GetChunks(unsigned int mask, std::vector<ChunkType*>& chunks)
+{
+	chunks.clear();
+	ForEachChunk(mask, [&chunks](ChunkType& chunk) { chunks.push_back(&chunk); });
+}
+
+void EntityStoreClass::ParallelForEachChunk(unsigned int mask, const std::function<void(ChunkType&, int)>& function)
+{
+	GetChunks(mask, m_chunkScratch);
+	if (m_Jobs == nullptr)
+	{
+		for (ChunkType* chunk : m_chunkScratch)
+			function(*chunk, 0);
+		return;
+	}
+
+	// A full chunk is a few hundred entities which is already a decent sized job
+	std::vector<ChunkType*>& chunks = m_chunkScratch;
+	m_Jobs->ParallelFor((int)chunks.size(), 1, [&chunks, &function](int begin, int end, int runner)
+	{
+		for (int i = begin; i < end; ++i)
+			function(*chunks[i], runner);
+	});
+}
+
+int EntityStoreClass::GetThreadCount()
+{
+	return m_Jobs ? m_Jobs->GetThreadCount() : 1;
+}
+
+int EntityStoreClass::GetEntityCount()
+{
+	return m_entityCount;
+}
+
+int EntityStoreClass::GetChunkCount()
+{
+	return m_chunkCount;
+}
+
+int EntityStoreClass::GetArchetypeCount()
+{
+	return (int)m_archetypes.size();
+}
+
+bool EntityStoreClass::AttachChunk(unsigned int mask, int capacity, unsigned char* data, int count, unsigned int slotCount)
+{
+	ArchetypeType* archetype = GetArchetype(mask);
+	if (archetype->capacity != capacity || count < 1 || count > capacity || ((size_t)data & (ENTITY_CHUNK_ALIGNMENT - 1)) != 0)
+		return false;
+
+	// Dense archetypes only have room at the end, so only the last chunk of each may be partly full
+	if (archetype->chunks.empty() == false && archetype->chunks.back()->count != archetype->capacity)
+		return false;
+
+	ChunkType* chunk = new ChunkType();
+	chunk->data = data;
+	chunk->count = count;
+	chunk->archetype = archetype;
+	chunk->owned = false;
+	archetype->chunks.push_back(chunk);
+	++m_chunkCount;
+
+	// The records are rebuilt from the ids, nothing else in the store knows where the entities are
+	const EntityId* entities = GetEntities(*chunk);
+	const int chunkIndex = (int)archetype->chunks.size() - 1;
+	for (int row = 0; row < count; ++row)
+	{
+		const unsigned int index = EntityIndex(entities[row]);
+		if (index >= slotCount)
+			return false;
+
+		if (index >= m_entities.size())
+		{
+			EntityRecordType record = { nullptr, -1, -1, 0 };
+			m_entities.resize(index + 1, record);
+		}
+
+		EntityRecordType& record = m_entities[index];
+		if (record.archetype != nullptr || EntityGeneration(entities[row]) > MAX_GENERATION)
+			return false;
+
+		record.archetype = archetype;
+		record.chunk = chunkIndex;
+		record.row = row;
+		record.generation = EntityGeneration(entities[row]);
+		++m_entityCount;
+	}
+
+	return true;
+}
+
+bool EntityStoreClass::AttachSlots(unsigned int slotCount, const unsigned int* generations)
+{
+	if (slotCount < m_entities.size())
+		return false;
+
+	EntityRecordType empty = { nullptr, -1, -1, 0 };
+	m_entities.resize(slotCount, empty);
+
+	// Backwards so the lowest free index is the first one handed out again
+	m_freeEntities.clear();
+	for (unsigned int index = slotCount; index-- > 0;)
+	{
+		if (m_entities[index].archetype != nullptr)
+			continue;
+
+		m_entities[index].generation = generations[index] > MAX_GENERATION ? 0 : generations[index];
+		m_freeEntities.push_back(index);
+	}
+
+	return true;
+}
+
+const std::vector<ArchetypeType*>& EntityStoreClass::GetArchetypes()
+{
+	return m_archetypes;
+}
+
+unsigned int EntityStoreClass::GetSlotCount()
+{
+	return (unsigned int)m_entities.size();
+}
+
+unsigned int EntityStoreClass::GetGeneration(unsigned int index)
+{
+	return index < m_entities.size() ? m_entities[index].generation : 0;
+}
+
+ArchetypeType* EntityStoreClass::GetArchetype(unsigned int mask)
+{
+	std::unordered_map<unsigned int, ArchetypeType*>::iterator it = m_archetypeLookup.find(mask);
+	if (it != m_archetypeLookup.end())
+		return it->second;
+
+	ArchetypeType* archetype = new ArchetypeType();
+	archetype->mask = mask;
+
+	/*
+		Work out how many entities fit in a chunk: every array is aligned to 16 bytes so
+		SIMD loads work straight out of the chunk, which wastes up to 15 bytes per array.
+	*/
+	int bytesPerEntity = sizeof(EntityId);
+	int arrayCount = 1;
+	for (int c = 0; c < COMPONENT_COUNT; ++c)
+	{
+		if (mask & COMPONENT_BIT(c))
+		{
+			bytesPerEntity += COMPONENT_SIZES[c];
+			++arrayCount;
+		}
+	}
+
+	archetype->capacity = (ENTITY_CHUNK_SIZE - arrayCount * 15) / bytesPerEntity;
+
+	int offset = 0;
+	for (int c = 0; c < COMPONENT_COUNT; ++c)
+	{
+		if ((mask & COMPONENT_BIT(c)) == 0)
+		{
+			archetype->offsets[c] = -1;
+			continue;
+		}
+
+		archetype->offsets[c] = offset;
+		offset = AlignUp(offset + archetype->capacity * COMPONENT_SIZES[c], 16);
+	}
+
+	archetype->entityOffset = offset;
+
+	m_archetypes.push_back(archetype);
+	m_archetypeLookup[mask] = archetype;
+	return archetype;
+}
+
+void EntityStoreClass::AllocateRow(ArchetypeType* archetype, int& chunkIndex, int& row)
+{
+	// Archetypes are dense so only the last chunk can have room
+	if (archetype->chunks.empty() || archetype->chunks.back()->count >= archetype->capacity)
+	{
+		ChunkType* chunk;
+		if (m_freeChunks.empty() == false)
+		{
+			chunk = m_freeChunks.back();
+			m_freeChunks.pop_back();
+		}
+		else
+		{
+			chunk = new ChunkType();
+			chunk->data = (unsigned char*)AlignedAlloc(ENTITY_CHUNK_SIZE, ENTITY_CHUNK_ALIGNMENT);
+			chunk->owned = true;
+		}
+
+		chunk->count = 0;
+		chunk->archetype = archetype;
+		archetype->chunks.push_back(chunk);
+		++m_chunkCount;
+	}
+
+	chunkIndex = (int)archetype->chunks.size() - 1;
+	ChunkType* chunk = archetype->chunks[chunkIndex];
+	row = chunk->count++;
+
+	for (int c = 0; c < COMPONENT_COUNT; ++c)
+	{
+		if (archetype->offsets[c] >= 0)
+			memset(chunk->data + archetype->offsets[c] + row * COMPONENT_SIZES[c], 0, COMPONENT_SIZES[c]);
+	}
+}
+
+void EntityStoreClass::RemoveRow(ArchetypeType* archetype, int chunkIndex, int row)
+{
+	// Fill the hole with the archetype's very last entity so the chunks stay packed
+	ChunkType* chunk = archetype->chunks[chunkIndex];
+	ChunkType* lastChunk = archetype->chunks.back();
+	const int lastRow = lastChunk->count - 1;
+
+	if (chunk != lastChunk || row != lastRow)
+	{
+		for (int c = 0; c < COMPONENT_COUNT; ++c)
+		{
+			const int offset = archetype->offsets[c];
+			if (offset < 0)
+				continue;
+
+			memcpy(chunk->data + offset + row * COMPONENT_SIZES[c], lastChunk->data + offset + lastRow * COMPONENT_SIZES[c], COMPONENT_SIZES[c]);
+		}
+
+		const EntityId moved = GetEntities(*lastChunk)[lastRow];
+		GetEntities(*chunk)[row] = moved;
+
+		EntityRecordType& record = m_entities[EntityIndex(moved)];
+		record.chunk = chunkIndex;
+		record.row = row;
+	}
+
+	if (--lastChunk->count == 0)
+	{
+		archetype->chunks.pop_back();
+		m_freeChunks.push_back(lastChunk);
+		--m_chunkCount;
+	}
+}
+
+void EntityStoreClass::MoveEntity(EntityId entity, unsigned int mask)
+{
+	EntityRecordType& record = m_entities[EntityIndex(entity)];
+	ArchetypeType* oldArchetype = record.archetype;
+	ArchetypeType* newArchetype = GetArchetype(mask);
+
+	int chunkIndex, row;
+	AllocateRow(newArchetype, chunkIndex, row);
+
+	// Copy whatever both archetypes have, the new components were zeroed by AllocateRow
+	ChunkType* oldChunk = oldArchetype->chunks[record.chunk];
+	ChunkType* newChunk = newArchetype->chunks[chunkIndex];
+	for (int c = 0; c < COMPONENT_COUNT; ++c)
+	{
+		if (oldArchetype->offsets[c] < 0 || newArchetype->offsets[c] < 0)
+			continue;
+
+		memcpy(newChunk->data + newArchetype->offsets[c] + row * COMPONENT_SIZES[c],
+			oldChunk->data + oldArchetype->offsets[c] + record.row * COMPONENT_SIZES[c], COMPONENT_SIZES[c]);
+	}
+
+	GetEntities(*newChunk)[row] = entity;
+	RemoveRow(oldArchetype, record.chunk, record.row);
+
+	record.archetype = newArchetype;
+	record.chunk = chunkIndex;
+	record.row = row;
+}
+
+EntityStoreClass::EntityRecordType* EntityStoreClass::GetRecord(EntityId entity)
+{
+	const unsigned int index = EntityIndex(entity);
+	if (entity == INVALID_ENTITY || index >= m_entities.size())
+		return nullptr;
+
+	EntityRecordType& record = m_entities[index];
+	if (record.archetype == nullptr || record.generation != EntityGeneration(entity))
+		return nullptr;
+
+	return &record;
+}
+
+EntityCommandBufferClass::EntityCommandBufferClass() :
+	m_pendingCount(0)
+{
+}
+
+EntityCommandBufferClass::EntityCommandBufferClass(const EntityCommandBufferClass&)
+{
+}
+
+EntityCommandBufferClass::~EntityCommandBufferClass()
+{
+}
+
+EntityId EntityCommandBufferClass::CreateEntity(unsigned int mask)
+{
+	const EntityId placeholder = MakeEntity(m_pendingCount++, PENDING_GENERATION);
+	CommandType command = { COMMAND_CREATE, -1, placeholder, mask, 0, 0 };
+	m_commands.push_back(command);
+	return placeholder;
+}
+
+void EntityCommandBufferClass::DestroyEntity(EntityId entity)
+{
+	CommandType command = { COMMAND_DESTROY, -1, entity, 0, 0, 0 };
+	m_commands.push_back(command);
+}
+
+void EntityCommandBufferClass::AddComponents(EntityId entity, unsigned int mask)
+{
+	CommandType command = { COMMAND_ADD, -1, entity, mask, 0, 0 };
+	m_commands.push_back(command);
+}
+
+void EntityCommandBufferClass::RemoveComponents(EntityId entity, unsigned int mask)
+{
+	CommandType command = { COMMAND_REMOVE, -1, entity, mask, 0, 0 };
+	m_commands.push_back(command);
+}
+
+void EntityCommandBufferClass::SetComponent(EntityId entity, int component, const void* data, unsigned int size)
+{
+	CommandType command = { COMMAND_SET, component, entity, 0, (unsigned int)m_data.size(), size };
+	m_commands.push_back(command);
+	m_data.insert(m_data.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+}
+
+bool EntityCommandBufferClass::IsEmpty()
+{
+	return m_commands.empty();
+}
+
+void EntityCommandBufferClass::Clear()
+{
+	m_commands.clear();
+	m_data.clear();
+	m_pendingCount = 0;
+}
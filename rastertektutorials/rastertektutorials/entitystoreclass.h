@@ -0,0 +1,211 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "components.h"
+#include "jobsystemclass.h"
+
+/*
+	Archetype based entity-component store.
+	Every distinct set of components (archetype) gets its own list of 16 KB chunks. Inside a chunk each component
+	is its own tightly packed array (SoA) so a system that only wants transforms and velocities only streams those.
+	Archetypes are kept dense: destroying an entity moves the archetype's last entity into the hole, so every chunk
+	but the last is full and iteration is linear.
+	Structural changes (create, destroy, add/remove components) move entities between chunks, so they're not allowed
+	while iterating. Record them in an EntityCommandBufferClass instead and play it back afterwards.
+*/
+
+typedef unsigned long long EntityId;
+
+const EntityId INVALID_ENTITY = ~0ull;
+const int ENTITY_CHUNK_SIZE = 16 * 1024;
+const int ENTITY_CHUNK_ALIGNMENT = 64;
+
+class EntityCommandBufferClass;
+
+struct ArchetypeType;
+
+struct ChunkType
+{
+	unsigned char* data;
+	int count;
+	ArchetypeType* archetype;
+	bool owned; // false when the memory is someone else's (a mapped scene snapshot), the store never frees it
+};
+
+struct ArchetypeType
+{
+	unsigned int mask;
+	int capacity; // entities per chunk
+	int entityOffset;
+	int offsets[COMPONENT_COUNT]; // start of each component array inside the chunk, -1 if not part of the archetype
+	std::vector<ChunkType*> chunks;
+};
+
+class EntityStoreClass
+{
+public:
+	EntityStoreClass();
+	EntityStoreClass(const EntityStoreClass&);
+	~EntityStoreClass();
+
+	// Job system can be nullptr, then parallel iteration just runs on the calling thread
+	bool Initialize(JobSystemClass*);
+	void Shutdown();
+
+	// New components are zeroed
+	EntityId CreateEntity(unsigned int);
+	void DestroyEntity(EntityId);
+	bool IsAlive(EntityId);
+	// Full id of whatever currently lives at an index, INVALID_ENTITY if nothing does
+	EntityId GetEntity(unsigned int);
+	void AddComponents(EntityId, unsigned int);
+	void RemoveComponents(EntityId, unsigned int);
+	unsigned int GetMask(EntityId);
+	void* GetComponent(EntityId, int);
+
+	template<typename T> T* Get(EntityId entity)
+	{
+		return (T*)GetComponent(entity, ComponentTraits<T>::id);
+	}
+
+	// Called right before an entity or some of its components go away, with the mask of the ones going.
+	// Used to clean up things that point at them (tree proxies etc.)
+	void SetRemoveCallback(const std::function<void(EntityId, unsigned int)>&);
+
+	void Playback(EntityCommandBufferClass&);
+
+	// Every chunk whose archetype has all the components in the mask
+	void GetChunks(unsigned int, std::vector<ChunkType*>&);
+
+	// f(ChunkType&)
+	template<typename F> void ForEachChunk(unsigned int mask, F function)
+	{
+		for (ArchetypeType* archetype : m_archetypes)
+		{
+			if ((archetype->mask & mask) != mask)
+				continue;
+
+			for (ChunkType* chunk : archetype->chunks)
+				function(*chunk);
+		}
+	}
+
+	// f(ChunkType&, runner index), one chunk per job, runner index is in [0, GetThreadCount())
+	void ParallelForEachChunk(unsigned int, const std::function<void(ChunkType&, int)>&);
+	int GetThreadCount();
+
+	static void* GetArray(ChunkType& chunk, int component)
+	{
+		const int offset = chunk.archetype->offsets[component];
+		return offset < 0 ? nullptr : chunk.data + offset;
+	}
+
+	template<typename T> static T* GetArray(ChunkType& chunk)
+	{
+		return (T*)GetArray(chunk, ComponentTraits<T>::id);
+	}
+
+	static EntityId* GetEntities(ChunkType& chunk)
+	{
+		return (EntityId*)(chunk.data + chunk.archetype->entityOffset);
+	}
+
+	int GetEntityCount();
+	int GetChunkCount();
+	int GetArchetypeCount();
+
+	/*
+		Scene snapshots (SceneSnapshotClass). Attaching only works on an empty store: chunks are handed over whole with
+		their entity ids, the memory has to be writable and outlive the store. Mask, the archetype capacity the chunk
+		was laid out for (false if this build lays it out differently), the entity count and the snapshot's slot count,
+		an id with an index past it is false rather than growing the slots to whatever the file says.
+		AttachSlots goes last with the slot count and every slot's generation, the ones no chunk claimed become free.
+	*/
+	bool AttachChunk(unsigned int, int, unsigned char*, int, unsigned int);
+	bool AttachSlots(unsigned int, const unsigned int*);
+	const std::vector<ArchetypeType*>& GetArchetypes();
+	unsigned int GetSlotCount();
+	unsigned int GetGeneration(unsigned int);
+
+private:
+	struct EntityRecordType
+	{
+		ArchetypeType* archetype;
+		int chunk;
+		int row;
+		unsigned int generation;
+	};
+
+	ArchetypeType* GetArchetype(unsigned int);
+	void AllocateRow(ArchetypeType*, int&, int&);
+	void RemoveRow(ArchetypeType*, int, int);
+	void MoveEntity(EntityId, unsigned int);
+	EntityRecordType* GetRecord(EntityId);
+
+private:
+	JobSystemClass* m_Jobs;
+	std::vector<ArchetypeType*> m_archetypes;
+	std::unordered_map<unsigned int, ArchetypeType*> m_archetypeLookup;
+	std::vector<EntityRecordType> m_entities;
+	std::vector<unsigned int> m_freeEntities;
+	std::vector<ChunkType*> m_freeChunks;
+	std::vector<ChunkType*> m_chunkScratch;
+	std::function<void(EntityId, unsigned int)> m_removeCallback;
+	int m_entityCount;
+	int m_chunkCount;
+};
+
+/*
+	Records structural changes so they can be made from inside iteration, or from job threads (one buffer per runner).
+	Entities created through the buffer don't exist until playback, CreateEntity returns a placeholder id
+	that only means something to SetComponent/AddComponents/... on the same buffer.
+*/
+class EntityCommandBufferClass
+{
+public:
+	EntityCommandBufferClass();
+	EntityCommandBufferClass(const EntityCommandBufferClass&);
+	~EntityCommandBufferClass();
+
+	EntityId CreateEntity(unsigned int);
+	void DestroyEntity(EntityId);
+	void AddComponents(EntityId, unsigned int);
+	void RemoveComponents(EntityId, unsigned int);
+	void SetComponent(EntityId, int, const void*, unsigned int);
+
+	template<typename T> void Set(EntityId entity, const T& value)
+	{
+		SetComponent(entity, ComponentTraits<T>::id, &value, sizeof(T));
+	}
+
+	bool IsEmpty();
+	void Clear();
+
+private:
+	friend class EntityStoreClass;
+
+	enum CommandKind
+	{
+		COMMAND_CREATE,
+		COMMAND_DESTROY,
+		COMMAND_ADD,
+		COMMAND_REMOVE,
+		COMMAND_SET
+	};
+
+	struct CommandType
+	{
+		CommandKind kind;
+		int component;
+		EntityId entity;
+		unsigned int mask;
+		unsigned int dataOffset;
+		unsigned int dataSize;
+	};
+
+	std::vector<CommandType> m_commands;
+	std::vector<unsigned char> m_data;
+	unsigned int m_pendingCount;
+};
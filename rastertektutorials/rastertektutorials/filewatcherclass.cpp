@@ -0,0 +1,164 @@
+#include "filewatcherclass.h"
+
+#include <ctype.h>
+
+FileWatcherClass::FileWatcherClass() :
+	m_directory(INVALID_HANDLE_VALUE),
+	m_stopEvent(nullptr),
+	m_frequency(1),
+	m_debounceTicks(0)
+{
+}
+
+FileWatcherClass::FileWatcherClass(const FileWatcherClass&)
+{
+}
+
+FileWatcherClass::~FileWatcherClass()
+{
+}
+
+bool FileWatcherClass::Initialize(const char* directory, int debounceMs)
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	m_frequency = frequency.QuadPart;
+	m_debounceTicks = m_frequency * debounceMs / 1000;
+
+	// FILE_FLAG_OVERLAPPED so the thread can wait on the change and the stop event at the same time
+	m_directory = CreateFile(directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (m_directory == INVALID_HANDLE_VALUE)
+		return false;
+
+	m_stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	if (m_stopEvent == nullptr)
+		return false;
+
+	m_thread = std::thread(&FileWatcherClass::WatchThread, this);
+	return true;
+}
+
+void FileWatcherClass::Shutdown()
+{
+	if (m_stopEvent)
+		SetEvent(m_stopEvent);
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	if (m_stopEvent)
+	{
+		CloseHandle(m_stopEvent);
+		m_stopEvent = nullptr;
+	}
+
+	if (m_directory != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_directory);
+		m_directory = INVALID_HANDLE_VALUE;
+	}
+
+	m_pending.clear();
+}
+
+void FileWatcherClass::GetChanges(std::vector<std::string>& changes)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (std::unordered_map<std::string, long long>::iterator it = m_pending.begin(); it != m_pending.end();)
+	{
+		if (now.QuadPart - it->second >= m_debounceTicks)
+		{
+			changes.push_back(it->first);
+			it = m_pending.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+std::string FileWatcherClass::NormalizePath(const std::string& path)
+{
+	std::string normalized = path;
+	for (char& c : normalized)
+		c = c == '\\' ? '/' : (char)tolower((unsigned char)c);
+
+	// "./sprite.vs" and "sprite.vs" are the same file
+	while (normalized.compare(0, 2, "./") == 0)
+		normalized.erase(0, 2);
+
+	return normalized;
+}
+
+void FileWatcherClass::WatchThread()
+{
+	// FILE_NOTIFY_INFORMATION has to be DWORD aligned
+	std::vector<DWORD> buffer(FILE_WATCHER_BUFFER_SIZE / sizeof(DWORD));
+
+	OVERLAPPED overlapped;
+	ZeroMemory(&overlapped, sizeof(overlapped));
+	overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	if (overlapped.hEvent == nullptr)
+		return;
+
+	HANDLE events[2] = { overlapped.hEvent, m_stopEvent };
+	const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+
+	for (;;)
+	{
+		ResetEvent(overlapped.hEvent);
+		if (ReadDirectoryChangesW(m_directory, buffer.data(), (DWORD)(buffer.size() * sizeof(DWORD)), TRUE, filter, nullptr, &overlapped, nullptr) == FALSE)
+			break;
+
+		const DWORD signaled = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+		if (signaled != WAIT_OBJECT_0)
+		{
+			// Stopping, the read is still pending and owns the buffer so wait for the cancel to land
+			CancelIoEx(m_directory, &overlapped);
+			DWORD ignored;
+			GetOverlappedResult(m_directory, &overlapped, &ignored, TRUE);
+			break;
+		}
+
+		DWORD bytes = 0;
+		if (GetOverlappedResult(m_directory, &overlapped, &bytes, FALSE) == FALSE)
+			break;
+
+		// 0 bytes means the buffer overflowed and the changes are lost, nothing to do but wait for the next ones
+		if (bytes == 0)
+			continue;
+
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const unsigned char* entry = (const unsigned char*)buffer.data();
+		for (;;)
+		{
+			const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)entry;
+			if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+			{
+				char name[MAX_PATH * 4];
+				const int length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, (int)(info->FileNameLength / sizeof(WCHAR)),
+					name, sizeof(name) - 1, nullptr, nullptr);
+				if (length > 0)
+				{
+					name[length] = '\0';
+					m_pending[NormalizePath(name)] = now.QuadPart;
+				}
+			}
+
+			if (info->NextEntryOffset == 0)
+				break;
+
+			entry += info->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+}
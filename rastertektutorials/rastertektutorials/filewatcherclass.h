@@ -0,0 +1,49 @@
+#pragma once
+
+#include <windows.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+	Watches a directory tree on a background thread with ReadDirectoryChangesW.
+	Editors tend to save a file in several steps (truncate, write, rename over) so each change just (re)starts a timer
+	for that file, it's only reported once it's been quiet for the debounce time. Paths come back relative
+	to the watched directory, lower case with forward slashes, so they can be compared against whatever the caches stored.
+	GetChanges never blocks, call it whenever convenient (once a frame).
+*/
+
+const int FILE_WATCHER_DEBOUNCE_MS = 100;
+const int FILE_WATCHER_BUFFER_SIZE = 64 * 1024;
+
+class FileWatcherClass
+{
+public:
+	FileWatcherClass();
+	FileWatcherClass(const FileWatcherClass&);
+	~FileWatcherClass();
+
+	// Directory and debounce time in ms
+	bool Initialize(const char*, int);
+	void Shutdown();
+
+	// Appends every file that settled since the last call
+	void GetChanges(std::vector<std::string>&);
+
+	// Same normalization the watcher uses, lower case and forward slashes
+	static std::string NormalizePath(const std::string&);
+
+private:
+	void WatchThread();
+
+private:
+	HANDLE m_directory;
+	HANDLE m_stopEvent;
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::unordered_map<std::string, long long> m_pending; // path -> time of its last change
+	long long m_frequency;
+	long long m_debounceTicks;
+};
@@ -0,0 +1,146 @@
+#include "fontclass.h"
+
+#include <vector>
+
+FontClass::FontClass() :
+	m_Atlas(nullptr),
+	m_lineHeight(0.0f)
+{
+	ZeroMemory(m_glyphs, sizeof(m_glyphs));
+}
+
+FontClass::FontClass(const FontClass&)
+{
+}
+
+FontClass::~FontClass()
+{
+}
+
+bool FontClass::Initialize(AtlasClass* atlas, const char* faceName, int height)
+{
+	m_Atlas = atlas;
+
+	HDC dc = CreateCompatibleDC(nullptr);
+	if (dc == nullptr)
+		return false;
+
+	// ANTIALIASED_QUALITY instead of ClearType, subpixel colour fringes would look wrong once it's tinted
+	HFONT font = CreateFont(-height, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
+		CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, faceName);
+	if (font == nullptr)
+	{
+		DeleteDC(dc);
+		return false;
+	}
+
+	HFONT oldFont = (HFONT)SelectObject(dc, font);
+
+	TEXTMETRIC metrics;
+	GetTextMetrics(dc, &metrics);
+	m_lineHeight = (float)metrics.tmHeight;
+
+	// One scratch bitmap big enough for the widest glyph, every glyph gets drawn into its top left corner
+	const int cellWidth = metrics.tmMaxCharWidth + 2;
+	const int cellHeight = metrics.tmHeight;
+
+	BITMAPINFO bitmapInfo;
+	ZeroMemory(&bitmapInfo, sizeof(bitmapInfo));
+	bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bitmapInfo.bmiHeader.biWidth = cellWidth;
+	bitmapInfo.bmiHeader.biHeight = -cellHeight; // top down
+	bitmapInfo.bmiHeader.biPlanes = 1;
+	bitmapInfo.bmiHeader.biBitCount = 32;
+	bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+	unsigned char* bits = nullptr;
+	HBITMAP bitmap = CreateDIBSection(dc, &bitmapInfo, DIB_RGB_COLORS, (void**)&bits, nullptr, 0);
+	if (bitmap == nullptr)
+	{
+		SelectObject(dc, oldFont);
+		DeleteObject(font);
+		DeleteDC(dc);
+		return false;
+	}
+
+	HBITMAP oldBitmap = (HBITMAP)SelectObject(dc, bitmap);
+	SetTextColor(dc, RGB(255, 255, 255));
+	SetBkColor(dc, RGB(0, 0, 0));
+	SetBkMode(dc, OPAQUE);
+
+	std::vector<unsigned char> glyphPixels((size_t)cellWidth * cellHeight * 4);
+	bool result = true;
+	for (int c = FONT_FIRST_CHAR; c <= FONT_LAST_CHAR && result; ++c)
+	{
+		const char character = (char)c;
+		SIZE size;
+		GetTextExtentPoint32(dc, &character, 1, &size);
+
+		RECT rect = { 0, 0, cellWidth, cellHeight };
+		ExtTextOut(dc, 0, 0, ETO_OPAQUE, &rect, &character, 1, nullptr);
+		GdiFlush();
+
+		// White text on black, so any channel is the coverage
+		const int width = size.cx < cellWidth ? size.cx : cellWidth;
+		for (int y = 0; y < cellHeight; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				unsigned char* pixel = &glyphPixels[((size_t)y * width + x) * 4];
+				pixel[0] = 255;
+				pixel[1] = 255;
+				pixel[2] = 255;
+				pixel[3] = bits[((size_t)y * cellWidth + x) * 4 + 1];
+			}
+		}
+
+		GlyphType& glyph = m_glyphs[c - FONT_FIRST_CHAR];
+		glyph.advance = (float)size.cx;
+		if (width > 0)
+			result = m_Atlas->AddImage(glyphPixels.data(), width, cellHeight, width * 4, glyph.region);
+	}
+
+	SelectObject(dc, oldBitmap);
+	SelectObject(dc, oldFont);
+	DeleteObject(bitmap);
+	DeleteObject(font);
+	DeleteDC(dc);
+	return result;
+}
+
+void FontClass::Shutdown()
+{
+	// The atlas belongs to whoever passed it in
+	m_Atlas = nullptr;
+}
+
+const GlyphType* FontClass::GetGlyph(char character)
+{
+	if (character < FONT_FIRST_CHAR || character > FONT_LAST_CHAR)
+		return nullptr;
+
+	return &m_glyphs[character - FONT_FIRST_CHAR];
+}
+
+float FontClass::GetLineHeight()
+{
+	return m_lineHeight;
+}
+
+float FontClass::MeasureString(const char* text)
+{
+	float width = 0.0f;
+	for (const char* c = text; *c; ++c)
+	{
+		const GlyphType* glyph = GetGlyph(*c);
+		if (glyph)
+			width += glyph->advance;
+	}
+
+	return width;
+}
+
+AtlasClass* FontClass::GetAtlas()
+{
+	return m_Atlas;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <windows.h>
+#include "atlasclass.h"
+
+/*
+	Bitmap font generated at startup with GDI from any installed font, so there's no font texture to ship.
+	Printable ascii (32-126) is rendered grayscale antialiased and packed into an AtlasClass as white
+	with the coverage in alpha, the sprite shader tints it with the vertex color.
+*/
+
+const int FONT_FIRST_CHAR = 32;
+const int FONT_LAST_CHAR = 126;
+
+struct GlyphType
+{
+	AtlasRegionType region;
+	float advance; // pixels to move right after this glyph
+};
+
+class FontClass
+{
+public:
+	FontClass();
+	FontClass(const FontClass&);
+	~FontClass();
+
+	// Face name and pixel height
+	bool Initialize(AtlasClass*, const char*, int);
+	void Shutdown();
+
+	// nullptr for anything outside the printable range
+	const GlyphType* GetGlyph(char);
+	float GetLineHeight();
+	float MeasureString(const char*);
+	AtlasClass* GetAtlas();
+
+private:
+	AtlasClass* m_Atlas;
+	GlyphType m_glyphs[FONT_LAST_CHAR - FONT_FIRST_CHAR + 1];
+	float m_lineHeight;
+};
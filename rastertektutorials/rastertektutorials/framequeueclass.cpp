@@ -0,0 +1,133 @@
+#include "framequeueclass.h"
+
+FrameQueueClass::FrameQueueClass() :
+	m_frameLag(0),
+	m_readIndex(0),
+	m_writeIndex(0),
+	m_count(0),
+	m_writing(false),
+	m_reading(false),
+	m_closed(false),
+	m_spaceEvent(nullptr)
+{
+}
+
+FrameQueueClass::FrameQueueClass(const FrameQueueClass&)
+{
+}
+
+FrameQueueClass::~FrameQueueClass()
+{
+}
+
+bool FrameQueueClass::Initialize(int frameLag)
+{
+	if (frameLag < 1)
+		frameLag = 1;
+
+	if (frameLag > FRAME_QUEUE_MAX_LAG)
+		frameLag = FRAME_QUEUE_MAX_LAG;
+
+	m_frameLag = frameLag;
+	m_readIndex = 0;
+	m_writeIndex = 0;
+	m_count = 0;
+	m_writing = false;
+	m_reading = false;
+	m_closed = false;
+
+	// Auto reset, the producer only cares that at least one packet freed up since it last looked
+	m_spaceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (m_spaceEvent == nullptr)
+		return false;
+
+	return true;
+}
+
+void FrameQueueClass::Shutdown()
+{
+	Close();
+
+	if (m_spaceEvent)
+	{
+		CloseHandle(m_spaceEvent);
+		m_spaceEvent = nullptr;
+	}
+}
+
+FramePacket* FrameQueueClass::BeginWrite()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Full means the render thread is m_frameLag frames behind, the caller has to wait for space
+	if (m_closed || m_writing || m_count >= m_frameLag)
+		return nullptr;
+
+	m_writing = true;
+	return &m_packets[m_writeIndex];
+}
+
+void FrameQueueClass::EndWrite()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_writing == false)
+			return;
+
+		m_writing = false;
+		m_writeIndex = (m_writeIndex + 1) % m_frameLag;
+		++m_count;
+	}
+
+	m_packetReady.notify_one();
+}
+
+FramePacket* FrameQueueClass::BeginRead()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_packetReady.wait(lock, [this]() { return m_count > 0 || m_closed; });
+
+	// Anything already queued still gets drawn, closing only stops new packets from coming in
+	if (m_count == 0)
+		return nullptr;
+
+	m_reading = true;
+	return &m_packets[m_readIndex];
+}
+
+void FrameQueueClass::EndRead()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_reading == false)
+			return;
+
+		m_reading = false;
+		m_readIndex = (m_readIndex + 1) % m_frameLag;
+		--m_count;
+	}
+
+	SetEvent(m_spaceEvent);
+}
+
+void FrameQueueClass::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+	}
+
+	m_packetReady.notify_all();
+	if (m_spaceEvent)
+		SetEvent(m_spaceEvent);
+}
+
+HANDLE FrameQueueClass::GetSpaceEvent()
+{
+	return m_spaceEvent;
+}
+
+int FrameQueueClass::GetFrameLag()
+{
+	return m_frameLag;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <windows.h>
+#include <directxmath.h>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "clusteredlightingclass.h"
+#include "drawitem.h"
+#include "particlesystemclass.h"
+#include "shadowcascadeclass.h"
+
+using namespace DirectX;
+
+/*
+	Hand off from the main (message + simulation) thread to the render thread.
+	The main thread fills in a FramePacket with everything the render thread needs for that frame,
+	the render thread never reads anything the main thread is still writing. The queue is a fixed ring
+	of packets so its size is the frame lag, 2 = double buffered: the main thread can be building frame N+1
+	while the render thread draws frame N, and has to wait if it gets further ahead than that.
+*/
+
+const int FRAME_QUEUE_MAX_LAG = 4;
+
+/*
+	Packets are reused round robin so their vectors keep their capacity,
+	once the scene settles down producing a packet doesn't allocate.
+*/
+struct FramePacket
+{
+	unsigned long long frameIndex;
+	double deltaTime; // seconds since the previous packet
+	double totalTime; // seconds since the first packet
+	float clearColor[4];
+	XMFLOAT4X4 view;
+	XMFLOAT3 cameraPosition;
+	std::vector<DrawItemType> drawItems; // visible renderables sorted by mesh, material, then LOD
+	unsigned int trianglesSubmitted; // drawItems added up over their LODs, meshes without a chain count as 0
+	ClusterListType lightClusters; // lights in view space binned into the cluster grid
+	ShadowFrameType shadows; // cascade matrices and shadow casters
+	ParticleFrameType particles; // visible particles as vertices, back to front
+	unsigned int sceneEntityCount;
+	unsigned int overlayStressQuads; // benchmark only, extra overlay quads to push through the sprite batch
+};
+
+class FrameQueueClass
+{
+public:
+	FrameQueueClass();
+	FrameQueueClass(const FrameQueueClass&);
+	~FrameQueueClass();
+
+	// Frame lag is clamped to [1, FRAME_QUEUE_MAX_LAG]
+	bool Initialize(int);
+	void Shutdown();
+
+	// Producer side, BeginWrite returns nullptr when the queue is full instead of blocking
+	// so the message thread can go back to pumping messages
+	FramePacket* BeginWrite();
+	void EndWrite();
+
+	// Consumer side, BeginRead blocks until a packet is ready and returns nullptr once the queue is closed and empty
+	FramePacket* BeginRead();
+	void EndRead();
+
+	// Wakes the consumer up for good
+	void Close();
+
+	// Signaled whenever the consumer frees a packet, the producer waits on this together with its message queue
+	HANDLE GetSpaceEvent();
+	int GetFrameLag();
+
+private:
+	FramePacket m_packets[FRAME_QUEUE_MAX_LAG];
+	int m_frameLag;
+	int m_readIndex;
+	int m_writeIndex;
+	int m_count;
+	bool m_writing;
+	bool m_reading;
+	bool m_closed;
+	std::mutex m_mutex;
+	std::condition_variable m_packetReady;
+	HANDLE m_spaceEvent;
+};
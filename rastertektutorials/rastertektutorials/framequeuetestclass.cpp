@@ -0,0 +1,229 @@
+#include "framequeuetestclass.h"
+#include "graphicsclass.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+FrameQueueTestClass::FrameQueueTestClass()
+{
+}
+
+FrameQueueTestClass::FrameQueueTestClass(const FrameQueueTestClass&)
+{
+}
+
+FrameQueueTestClass::~FrameQueueTestClass()
+{
+}
+
+int FrameQueueTestClass::Run(const std::string& reportName)
+{
+	FILE* report = nullptr;
+	if (fopen_s(&report, reportName.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	// All of them run whatever happens so the report is complete
+	FrameQueueTestClass test;
+	bool passed = test.TestFull(report);
+	for (int lag = 1; lag <= FRAME_QUEUE_MAX_LAG; ++lag)
+		passed = test.TestProducerConsumer(report, lag) && passed;
+	passed = test.TestClose(report) && passed;
+
+	fprintf(report, "\n%s\n", passed ? "passed" : "FAILED");
+	fclose(report);
+	return passed ? 0 : 1;
+}
+
+bool FrameQueueTestClass::TestFull(FILE* report)
+{
+	FrameQueueClass queue;
+	if (queue.Initialize(RENDER_FRAME_LAG) == false)
+	{
+		fprintf(report, "full: couldn't create the queue\n  FAILED\n\n");
+		return false;
+	}
+
+	// Fill it without reading anything, a second BeginWrite while one is open doesn't get a packet either
+	int handedOut = 0;
+	int nestedWrites = 0;
+	for (int i = 0; i <= FRAME_QUEUE_MAX_LAG; ++i)
+	{
+		FramePacket* packet = queue.BeginWrite();
+		if (packet == nullptr)
+			break;
+
+		nestedWrites += queue.BeginWrite() != nullptr ? 1 : 0;
+		packet->frameIndex = i;
+		queue.EndWrite();
+		++handedOut;
+	}
+
+	const bool fullReturnsNull = queue.BeginWrite() == nullptr;
+	const bool signaledEarly = WaitForSingleObject(queue.GetSpaceEvent(), 0) == WAIT_OBJECT_0;
+
+	// Reading the oldest one frees its packet for the producer
+	FramePacket* read = queue.BeginRead();
+	const bool readFirst = read != nullptr && read->frameIndex == 0;
+	queue.EndRead();
+	const bool signaled = WaitForSingleObject(queue.GetSpaceEvent(), 0) == WAIT_OBJECT_0;
+	FramePacket* freed = queue.BeginWrite();
+	if (freed)
+		queue.EndWrite();
+
+	queue.Shutdown();
+
+	const bool passed = handedOut == RENDER_FRAME_LAG && nestedWrites == 0 && fullReturnsNull && signaledEarly == false && readFirst &&
+		signaled && freed != nullptr;
+	fprintf(report, "full: lag %d, %d packets handed out, %d nested writes, BeginWrite when full %s\n", RENDER_FRAME_LAG, handedOut,
+		nestedWrites, fullReturnsNull ? "nullptr" : "got a packet");
+	fprintf(report, "  space event before a read %s, after one %s, BeginWrite after the read %s\n", signaledEarly ? "set" : "not set",
+		signaled ? "set" : "not set", freed ? "got a packet" : "nullptr");
+	fprintf(report, "  %s\n\n", passed ? "passed" : "FAILED");
+	return passed;
+}
+
+bool FrameQueueTestClass::TestProducerConsumer(FILE* report, int lag)
+{
+	FrameQueueClass queue;
+	if (queue.Initialize(lag) == false)
+	{
+		fprintf(report, "producer/consumer lag %d: couldn't create the queue\n  FAILED\n\n", lag);
+		return false;
+	}
+
+	// Counted before EndRead so the producer never sees a packet freed that the consumer still counts as unread
+	std::atomic<int> released(0);
+	std::atomic<int> received(0);
+	std::atomic<int> outOfOrder(0);
+	std::thread consumer([&]()
+	{
+		unsigned long long expected = 0;
+		for (;;)
+		{
+			FramePacket* packet = queue.BeginRead();
+			if (packet == nullptr)
+				break;
+
+			outOfOrder += packet->frameIndex != expected ? 1 : 0;
+			expected = packet->frameIndex + 1;
+			++received;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_QUEUE_TEST_CONSUMER_MS));
+			++released;
+			queue.EndRead();
+		}
+	});
+
+	int fullCount = 0;
+	int maxAhead = 0;
+	bool timedOut = false;
+	for (int frame = 0; frame < FRAME_QUEUE_TEST_FRAMES; )
+	{
+		FramePacket* packet = queue.BeginWrite();
+		if (packet == nullptr)
+		{
+			// Same wait as SystemClass, minus the message queue
+			++fullCount;
+			if (WaitForSingleObject(queue.GetSpaceEvent(), FRAME_QUEUE_TEST_TIMEOUT_MS) == WAIT_TIMEOUT)
+			{
+				timedOut = true;
+				break;
+			}
+
+			continue;
+		}
+
+		const int ahead = frame + 1 - released;
+		maxAhead = ahead > maxAhead ? ahead : maxAhead;
+
+		packet->frameIndex = frame;
+		packet->deltaTime = 1.0 / 60.0;
+		packet->totalTime = frame / 60.0;
+		queue.EndWrite();
+		++frame;
+	}
+
+	// Whatever is still queued gets read before the consumer sees nullptr
+	queue.Close();
+	consumer.join();
+	queue.Shutdown();
+
+	const bool passed = timedOut == false && received == FRAME_QUEUE_TEST_FRAMES && outOfOrder == 0 && maxAhead <= lag && fullCount > 0;
+	fprintf(report, "producer/consumer lag %d%s: %d of %d packets read, %d out of order, at most %d ahead, found full %d times%s\n", lag,
+		lag == RENDER_FRAME_LAG ? " (RENDER_FRAME_LAG)" : "", received.load(), FRAME_QUEUE_TEST_FRAMES, outOfOrder.load(), maxAhead, fullCount,
+		timedOut ? ", timed out waiting for space" : "");
+	fprintf(report, "  %s\n\n", passed ? "passed" : "FAILED");
+	return passed;
+}
+
+bool FrameQueueTestClass::TestClose(FILE* report)
+{
+	// Packets written before the close are still read, then nullptr, and nothing new gets in
+	FrameQueueClass drained;
+	bool drainedPassed = drained.Initialize(RENDER_FRAME_LAG);
+	if (drainedPassed)
+	{
+		FramePacket* packet = drained.BeginWrite();
+		if (packet)
+		{
+			packet->frameIndex = 7;
+			drained.EndWrite();
+		}
+
+		drained.Close();
+		const bool writeAfterClose = drained.BeginWrite() != nullptr;
+		FramePacket* queued = drained.BeginRead();
+		drainedPassed = packet != nullptr && queued != nullptr && queued->frameIndex == 7 && writeAfterClose == false;
+		drained.EndRead();
+		drainedPassed = drainedPassed && drained.BeginRead() == nullptr;
+	}
+	drained.Shutdown();
+
+	/*
+		A reader waiting on an empty queue. On the heap because if Close doesn't wake it the thread is left behind
+		still waiting on the queue, better to leak both than destroy it under the thread.
+	*/
+	FrameQueueClass* queue = new FrameQueueClass();
+	if (queue == nullptr || queue->Initialize(RENDER_FRAME_LAG) == false)
+	{
+		delete queue;
+		fprintf(report, "close: couldn't create the queue\n  FAILED\n");
+		return false;
+	}
+
+	std::atomic<int> state(0); // 0 still waiting, 1 got nullptr, 2 got a packet
+	std::thread reader([queue, &state]()
+	{
+		FramePacket* packet = queue->BeginRead();
+		state = packet ? 2 : 1;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_QUEUE_TEST_BLOCK_MS));
+	const bool blocked = state == 0;
+
+	const std::chrono::steady_clock::time_point closed = std::chrono::steady_clock::now();
+	queue->Close();
+	while (state == 0 && std::chrono::steady_clock::now() - closed < std::chrono::milliseconds(FRAME_QUEUE_TEST_TIMEOUT_MS))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	const double releaseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - closed).count();
+	const int result = state;
+	if (result != 0)
+	{
+		reader.join();
+		queue->Shutdown();
+		delete queue;
+	}
+	else
+	{
+		reader.detach();
+	}
+
+	const bool passed = drainedPassed && blocked && result == 1;
+	fprintf(report, "close: queued packet read after close %s\n", drainedPassed ? "yes" : "no");
+	fprintf(report, "  reader blocked for %d ms %s, after Close it %s (%.2f ms)\n", FRAME_QUEUE_TEST_BLOCK_MS, blocked ? "yes" : "no",
+		result == 1 ? "got nullptr" : (result == 2 ? "got a packet" : "never came back"), releaseMs);
+	fprintf(report, "  %s\n", passed ? "passed" : "FAILED");
+	return passed;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include "framequeueclass.h"
+
+/*
+	Headless frame queue tests, run with -framequeuetest [-out report.txt]. No window and no device, just the
+	FrameQueueClass the main and render threads share. Exit code 0 if everything passed and 1 if anything didn't.
+		- Full: with nothing being read, BeginWrite hands out exactly the frame lag's worth of packets and then returns
+		  nullptr straight away, also while a packet is still being written. Reading one frees one and signals the space event.
+		- Producer/consumer: this thread writes FRAME_QUEUE_TEST_FRAMES numbered packets, waiting on the space event
+		  like SystemClass does, while a consumer thread reads them and takes FRAME_QUEUE_TEST_CONSUMER_MS over each.
+		  Packets have to arrive in order with none missing, the producer can never be more than the frame lag ahead,
+		  and it has to have found the queue full (the consumer is the slow one). Run for every lag up to
+		  FRAME_QUEUE_MAX_LAG, RENDER_FRAME_LAG included.
+		- Close: a reader blocked on an empty queue comes back with nullptr when the queue is closed, and packets
+		  written before the close are still read first.
+	Nothing waits forever, anything that takes longer than FRAME_QUEUE_TEST_TIMEOUT_MS fails.
+*/
+
+const char* const FRAME_QUEUE_TEST_DEFAULT_REPORT = "frame_queue_test.txt";
+const int FRAME_QUEUE_TEST_FRAMES = 200;
+const int FRAME_QUEUE_TEST_CONSUMER_MS = 2;
+const int FRAME_QUEUE_TEST_BLOCK_MS = 50; // how long the reader has to stay blocked before the queue is closed
+const int FRAME_QUEUE_TEST_TIMEOUT_MS = 2000;
+
+class FrameQueueTestClass
+{
+public:
+	FrameQueueTestClass();
+	FrameQueueTestClass(const FrameQueueTestClass&);
+	~FrameQueueTestClass();
+
+	// Returns the process exit code, 0 = passed, 1 = failed, 2 = couldn't write the report
+	static int Run(const std::string&);
+
+	bool TestFull(FILE*);
+	bool TestProducerConsumer(FILE*, int);
+	bool TestClose(FILE*);
+};
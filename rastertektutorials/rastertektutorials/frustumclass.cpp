@@ -0,0 +1,73 @@
+#include "frustumclass.h"
+
+FrustumClass::FrustumClass()
+{
+}
+
+FrustumClass::FrustumClass(const FrustumClass&)
+{
+}
+
+FrustumClass::~FrustumClass()
+{
+}
+
+void FrustumClass::ConstructFrustum(XMMATRIX projectionMatrix, XMMATRIX viewMatrix)
+{
+	/*
+		Pull the planes straight out of the combined view * projection matrix (Gribb/Hartmann).
+		With row vectors clip = p * M, so x_clip >= -w_clip is column 4 + column 1 and so on.
+		D3D clip space z goes from 0 to w so the near plane is just column 3.
+	*/
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(viewMatrix, projectionMatrix));
+
+	m_planes[0] = XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41); // left
+	m_planes[1] = XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41); // right
+	m_planes[2] = XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42); // bottom
+	m_planes[3] = XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42); // top
+	m_planes[4] = XMFLOAT4(m._13, m._23, m._33, m._43); // near
+	m_planes[5] = XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43); // far
+
+	// Normalize so plane distances are real distances, the sphere test needs that
+	for (int i = 0; i < 6; ++i)
+		XMStoreFloat4(&m_planes[i], XMPlaneNormalize(XMLoadFloat4(&m_planes[i])));
+}
+
+bool FrustumClass::CheckPoint(float x, float y, float z)
+{
+	return CheckSphere(x, y, z, 0.0f);
+}
+
+bool FrustumClass::CheckSphere(float xCenter, float yCenter, float zCenter, float radius)
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		const XMFLOAT4& plane = m_planes[i];
+		if (plane.x * xCenter + plane.y * yCenter + plane.z * zCenter + plane.w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool FrustumClass::CheckBox(const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	// Only the corner furthest along the plane normal needs testing
+	for (int i = 0; i < 6; ++i)
+	{
+		const XMFLOAT4& plane = m_planes[i];
+		const float x = plane.x >= 0.0f ? max.x : min.x;
+		const float y = plane.y >= 0.0f ? max.y : min.y;
+		const float z = plane.z >= 0.0f ? max.z : min.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+const XMFLOAT4* FrustumClass::GetPlanes()
+{
+	return m_planes;
+}
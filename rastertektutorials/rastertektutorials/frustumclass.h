@@ -0,0 +1,29 @@
+#pragma once
+
+#include <directxmath.h>
+
+using namespace DirectX;
+
+/*
+	The six planes of the view frustum, used to throw away anything that can't be on screen before it gets drawn.
+	Planes point inwards: dot(normal, p) + d >= 0 means p is on the visible side.
+*/
+class FrustumClass
+{
+public:
+	FrustumClass();
+	FrustumClass(const FrustumClass&);
+	~FrustumClass();
+
+	void ConstructFrustum(XMMATRIX, XMMATRIX);
+
+	bool CheckPoint(float, float, float);
+	bool CheckSphere(float, float, float, float);
+	bool CheckBox(const XMFLOAT3&, const XMFLOAT3&);
+
+	// Left, right, bottom, top, near, far
+	const XMFLOAT4* GetPlanes();
+
+private:
+	XMFLOAT4 m_planes[6];
+};
@@ -1,8 +1,35 @@
 #include "graphicsclass.h"
 
+#include <algorithm>
+#include <stdio.h>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+
 GraphicsClass::GraphicsClass() :
-	m_Direct3D(nullptr)
+	m_Direct3D(nullptr),
+	m_Profiler(nullptr),
+	m_FileWatcher(nullptr),
+	m_ShaderCache(nullptr),
+	m_Atlas(nullptr),
+	m_Font(nullptr),
+	m_SpriteBatch(nullptr),
+	m_SpriteShader(nullptr),
+	m_LightBuffer(nullptr),
+	m_Meshes(nullptr),
+	m_MeshShader(nullptr),
+	m_ParticleBuffer(nullptr),
+	m_ParticleShader(nullptr),
+	m_ShadowMap(nullptr),
+	m_Textures(nullptr),
+	m_screenWidth(0),
+	m_screenHeight(0),
+	m_videoCardMemory(0),
+	m_lastDrawCount(0),
+	m_meshDrawCount(0),
+	m_shaderDirectory(ASSET_DIRECTORY)
 {
+	m_videoCardName[0] = '\0';
 
 }
 
@@ -14,21 +41,168 @@ GraphicsClass::~GraphicsClass()
 {
 }
 
-bool GraphicsClass::Initialize(int screenWidth, int screenHeight, HWND hwnd)
+bool GraphicsClass::Initialize(int screenWidth, int screenHeight, HWND hwnd, bool vsync)
+{
+	// All the stages back to back, SystemClass's startup graph runs them as separate tasks instead
+	if (CreateDevice() == false)
+		return false;
+
+	if (LoadFont() == false)
+		return false;
+
+	if (CreateResources(hwnd) == false)
+		return false;
+
+	return CreateSwapChain(screenWidth, screenHeight, hwnd, vsync);
+}
+
+bool GraphicsClass::CreateDevice()
 {
 	m_Direct3D = new D3DClass();
 	if (m_Direct3D == nullptr)
 		return false;
 
-	const bool result = m_Direct3D->Initialize(
-		screenWidth, 
-		screenHeight,
-		VSYNC_ENABLED,
-		hwnd,
-		FULL_SCREEN,
-		SCREEN_DEPTH,
-		SCREEN_NEAR
-	);
+	if (m_Direct3D->EnumerateAdapter() == false || m_Direct3D->CreateDevice() == false)
+	{
+		MessageBox(nullptr, "Could not create the Direct3D device", "Error", MB_OK);
+		return false;
+	}
+
+	m_Direct3D->GetVideoCardInfo(m_videoCardName, m_videoCardMemory);
+	return true;
+}
+
+bool GraphicsClass::LoadFont()
+{
+	// 2D overlay: font glyphs go in the atlas, the atlas texture itself gets created on the first frame
+	m_Atlas = new AtlasClass();
+	if (m_Atlas == nullptr)
+		return false;
+
+	if (m_Atlas->Initialize(OVERLAY_ATLAS_SIZE, OVERLAY_ATLAS_SIZE) == false)
+		return false;
+
+	m_Font = new FontClass();
+	if (m_Font == nullptr)
+		return false;
+
+	if (m_Font->Initialize(m_Atlas, HUD_FONT, HUD_FONT_SIZE) == false)
+	{
+		MessageBox(nullptr, "Could not initialize the font", "Error", MB_OK);
+		return false;
+	}
+
+	return true;
+}
+
+bool GraphicsClass::CreateResources(HWND hwnd)
+{
+	m_ShaderCache = new ShaderCacheClass();
+	if (m_ShaderCache == nullptr)
+		return false;
+
+	if (m_ShaderCache->Initialize(m_Direct3D->GetDevice(), m_shaderDirectory.c_str()) == false)
+		return false;
+
+	// Hot reload is a convenience, if the directory can't be watched we just run without it
+	if (HOT_RELOAD)
+	{
+		m_FileWatcher = new FileWatcherClass();
+		if (m_FileWatcher == nullptr)
+			return false;
+
+		if (m_FileWatcher->Initialize(m_shaderDirectory.c_str(), FILE_WATCHER_DEBOUNCE_MS) == false)
+		{
+			m_FileWatcher->Shutdown();
+			delete m_FileWatcher;
+			m_FileWatcher = nullptr;
+		}
+	}
+
+	m_SpriteBatch = new SpriteBatchClass();
+	if (m_SpriteBatch == nullptr)
+		return false;
+
+	if (m_SpriteBatch->Initialize(m_Direct3D->GetDevice(), SPRITE_BATCH_MAX_QUADS) == false)
+		return false;
+
+	m_LightBuffer = new LightBufferClass();
+	if (m_LightBuffer == nullptr)
+		return false;
+
+	if (m_LightBuffer->Initialize(m_Direct3D->GetDevice()) == false)
+		return false;
+
+	m_ParticleBuffer = new ParticleBufferClass();
+	if (m_ParticleBuffer == nullptr)
+		return false;
+
+	if (m_ParticleBuffer->Initialize(m_Direct3D->GetDevice()) == false)
+		return false;
+
+	m_ShadowMap = new ShadowMapClass();
+	if (m_ShadowMap == nullptr)
+		return false;
+
+	if (m_ShadowMap->Initialize(m_Direct3D->GetDevice()) == false)
+		return false;
+
+	// Budget comes out of the adapter's dedicated memory
+	m_Textures = new TextureStreamerClass();
+	if (m_Textures == nullptr)
+		return false;
+
+	if (m_Textures->Initialize(m_videoCardMemory) == false || LoadTextures() == false)
+		return false;
+
+	m_Meshes = new MeshLibraryClass();
+	if (m_Meshes == nullptr)
+		return false;
+
+	if (m_Meshes->Initialize() == false || LoadMeshes() == false)
+		return false;
+
+	// Compiles the shaders, the slow part of this stage
+	m_SpriteShader = new SpriteShaderClass();
+	if (m_SpriteShader == nullptr)
+		return false;
+
+	if (m_SpriteShader->Initialize(m_ShaderCache, m_Direct3D->GetDevice(), hwnd) == false)
+	{
+		MessageBox(hwnd, "Could not initialize the sprite shader", "Error", MB_OK);
+		return false;
+	}
+
+	m_MeshShader = new MeshShaderClass();
+	if (m_MeshShader == nullptr)
+		return false;
+
+	if (m_MeshShader->Initialize(m_ShaderCache, m_Direct3D->GetDevice(), hwnd) == false)
+	{
+		MessageBox(hwnd, "Could not initialize the mesh shader", "Error", MB_OK);
+		return false;
+	}
+
+	m_ParticleShader = new ParticleShaderClass();
+	if (m_ParticleShader == nullptr)
+		return false;
+
+	if (m_ParticleShader->Initialize(m_ShaderCache, m_Direct3D->GetDevice(), hwnd) == false)
+	{
+		MessageBox(hwnd, "Could not initialize the particle shader", "Error", MB_OK);
+		return false;
+	}
+
+	return true;
+}
+
+bool GraphicsClass::CreateSwapChain(int screenWidth, int screenHeight, HWND hwnd, bool vsync)
+{
+	m_screenWidth = screenWidth;
+	m_screenHeight = screenHeight;
+
+	const bool result = m_Direct3D->CreateSwapChain(screenWidth, screenHeight, vsync, hwnd, FULL_SCREEN) &&
+		m_Direct3D->CreateViews(screenWidth, screenHeight, SCREEN_DEPTH, SCREEN_NEAR);
 
 	if (result == false)
 	{
@@ -36,11 +210,121 @@ bool GraphicsClass::Initialize(int screenWidth, int screenHeight, HWND hwnd)
 		return false;
 	}
 
+	m_Profiler = new ProfilerClass();
+	if (m_Profiler == nullptr)
+		return false;
+
+	if (m_Profiler->Initialize(m_Direct3D->GetDevice(), m_Direct3D->GetDeviceContext()) == false)
+	{
+		MessageBox(hwnd, "Could not initialize the profiler", "Error", MB_OK);
+		return false;
+	}
+
 	return true;
 }
 
 void GraphicsClass::Shutdown()
 {
+	if (m_Meshes)
+	{
+		m_Meshes->Shutdown();
+		delete m_Meshes;
+		m_Meshes = nullptr;
+	}
+
+	if (m_Textures)
+	{
+		m_Textures->Shutdown();
+		delete m_Textures;
+		m_Textures = nullptr;
+	}
+
+	if (m_ShadowMap)
+	{
+		m_ShadowMap->Shutdown();
+		delete m_ShadowMap;
+		m_ShadowMap = nullptr;
+	}
+
+	if (m_LightBuffer)
+	{
+		m_LightBuffer->Shutdown();
+		delete m_LightBuffer;
+		m_LightBuffer = nullptr;
+	}
+
+	if (m_MeshShader)
+	{
+		m_MeshShader->Shutdown();
+		delete m_MeshShader;
+		m_MeshShader = nullptr;
+	}
+
+	if (m_ParticleShader)
+	{
+		m_ParticleShader->Shutdown();
+		delete m_ParticleShader;
+		m_ParticleShader = nullptr;
+	}
+
+	if (m_ParticleBuffer)
+	{
+		m_ParticleBuffer->Shutdown();
+		delete m_ParticleBuffer;
+		m_ParticleBuffer = nullptr;
+	}
+
+	if (m_SpriteShader)
+	{
+		m_SpriteShader->Shutdown();
+		delete m_SpriteShader;
+		m_SpriteShader = nullptr;
+	}
+
+	if (m_SpriteBatch)
+	{
+		m_SpriteBatch->Shutdown();
+		delete m_SpriteBatch;
+		m_SpriteBatch = nullptr;
+	}
+
+	if (m_Font)
+	{
+		m_Font->Shutdown();
+		delete m_Font;
+		m_Font = nullptr;
+	}
+
+	if (m_Atlas)
+	{
+		m_Atlas->Shutdown();
+		delete m_Atlas;
+		m_Atlas = nullptr;
+	}
+
+	// Watcher first so nothing new gets queued while the cache is going away
+	if (m_FileWatcher)
+	{
+		m_FileWatcher->Shutdown();
+		delete m_FileWatcher;
+		m_FileWatcher = nullptr;
+	}
+
+	if (m_ShaderCache)
+	{
+		m_ShaderCache->Shutdown();
+		delete m_ShaderCache;
+		m_ShaderCache = nullptr;
+	}
+
+	if (m_Profiler)
+	{
+		m_Profiler->WriteTrace(PROFILER_TRACE_FILE);
+		m_Profiler->Shutdown();
+		delete m_Profiler;
+		m_Profiler = nullptr;
+	}
+
 	if (m_Direct3D)
 	{
 		m_Direct3D->Shutdown();
@@ -49,20 +333,312 @@ void GraphicsClass::Shutdown()
 	}
 }
 
-bool GraphicsClass::Frame()
+bool GraphicsClass::Frame(const FramePacket& packet)
 {
-	if (Render() == false)
-		return false;
+	// Results show up PROFILER_FRAME_LATENCY frames later, BeginFrame picks up whatever is ready
+	m_Profiler->BeginFrame();
 
-	return true;
+	// Frame boundary, the only place reloaded resources get swapped in
+	ApplyReloads();
+
+	m_Profiler->BeginCpuZone("Render");
+	const bool result = Render(packet);
+	m_Profiler->EndCpuZone();
+
+	m_Profiler->EndFrame();
+	return result;
+}
+
+ProfilerClass* GraphicsClass::GetProfiler()
+{
+	return m_Profiler;
 }
 
-bool GraphicsClass::Render()
+ShaderCacheClass* GraphicsClass::GetShaderCache()
+{
+	return m_ShaderCache;
+}
+
+MeshLibraryClass* GraphicsClass::GetMeshes()
+{
+	return m_Meshes;
+}
+
+void GraphicsClass::SetMeshFiles(const std::vector<std::string>& files)
+{
+	m_meshFiles = files;
+}
+
+void GraphicsClass::SetShaderDirectory(const std::string& directory)
+{
+	m_shaderDirectory = directory;
+}
+
+void GraphicsClass::GetProjectionMatrix(XMMATRIX& projectionMatrix)
+{
+	m_Direct3D->GetProjectionMatrix(projectionMatrix);
+}
+
+bool GraphicsClass::Render(const FramePacket& packet)
 {
 	// Clear buffers to begin scene
-	m_Direct3D->BeginScene(0.5f, 0.5f, 0.5f, 1.0f);
+	m_Profiler->BeginPass("Clear");
+	m_Direct3D->BeginScene(packet.clearColor[0], packet.clearColor[1], packet.clearColor[2], packet.clearColor[3]);
+	m_Profiler->EndPass();
+
+	// Cached static depth gets copied in and only the dynamic casters are drawn, unless the scene says a cascade moved
+	m_Profiler->BeginPass("Shadows");
+	const bool shadowResult = m_ShadowMap->Render(m_Direct3D->GetDeviceContext(), packet.shadows, m_Meshes, m_MeshShader);
+	m_Direct3D->SetBackBufferRenderTarget();
+	m_Direct3D->ResetViewport();
+	m_Direct3D->ResetRasterState();
+	m_ShadowMap->Bind(m_Direct3D->GetDeviceContext());
+	m_Profiler->EndPass();
+
+	if (shadowResult == false)
+		return false;
+
+	// Binned on the main thread, this just copies the lists up and binds them for the lit passes
+	m_Profiler->BeginPass("Lights");
+	if (m_LightBuffer->Upload(m_Direct3D->GetDevice(), m_Direct3D->GetDeviceContext(), packet.lightClusters, m_screenWidth, m_screenHeight) == false)
+	{
+		m_Profiler->EndPass();
+		return false;
+	}
+	m_LightBuffer->Bind(m_Direct3D->GetDeviceContext());
+	m_Profiler->EndPass();
+
+	// Mips for what's about to be drawn, loaded and evicted before anything samples them
+	m_Profiler->BeginPass("Textures");
+	const bool textureResult = StreamTextures(packet);
+	m_Profiler->EndPass();
+
+	if (textureResult == false)
+		return false;
+
+	// Culled, LOD picked and sorted by mesh on the main thread, one DrawIndexed per item
+	m_Profiler->BeginPass("Meshes");
+	const bool meshResult = RenderMeshes(packet);
+	m_Profiler->EndPass();
 
-	// Present
+	if (meshResult == false)
+		return false;
+
+	m_Profiler->BeginPass("Particles");
+	const bool particleResult = RenderParticles(packet);
+	m_Profiler->EndPass();
+
+	if (particleResult == false)
+		return false;
+
+	m_Profiler->BeginPass("Overlay");
+	const bool result = RenderOverlay(packet);
+	m_Profiler->EndPass();
+
+	if (result == false)
+		return false;
+
+	// Present, timed on the cpu since the gpu side of it isn't something a timestamp can see
+	m_Profiler->BeginCpuZone("Present");
 	m_Direct3D->EndScene();
+	m_Profiler->EndCpuZone();
+	return true;
+}
+
+void GraphicsClass::ApplyReloads()
+{
+	if (m_FileWatcher)
+	{
+		m_changedFiles.clear();
+		m_FileWatcher->GetChanges(m_changedFiles);
+
+		// Only shaders and their includes hot reload, .mesh and .tex changes show up here too but need a restart
+		if (m_changedFiles.empty() == false)
+			m_ShaderCache->Reload(m_changedFiles);
+	}
+
+	// Swaps pointers and releases the old objects, the compiling already happened on the cache's thread
+	m_ShaderCache->ApplyPending();
+}
+
+bool GraphicsClass::RenderMeshes(const FramePacket& packet)
+{
+	m_meshDrawCount = 0;
+	if (m_Meshes->GetMeshCount() == 0 || packet.drawItems.empty())
+		return true;
+
+	XMMATRIX projectionMatrix;
+	m_Direct3D->GetProjectionMatrix(projectionMatrix);
+	if (m_MeshShader->SetShaderParameters(m_Direct3D->GetDeviceContext(), XMLoadFloat4x4(&packet.view), projectionMatrix) == false)
+		return false;
+
+	m_meshDrawCount = m_Meshes->Render(m_Direct3D->GetDeviceContext(), m_MeshShader, packet.drawItems, m_Textures);
+	return m_meshDrawCount >= 0;
+}
+
+bool GraphicsClass::RenderParticles(const FramePacket& packet)
+{
+	// Culled, sorted and turned into vertices on the main thread's jobs, all that's left is one copy and one draw
+	if (m_ParticleBuffer->Upload(m_Direct3D->GetDevice(), m_Direct3D->GetDeviceContext(), packet.particles) == false)
+		return false;
+
+	if (m_ParticleBuffer->GetDrawCount() == 0)
+		return true;
+
+	XMMATRIX projectionMatrix;
+	m_Direct3D->GetProjectionMatrix(projectionMatrix);
+	if (m_ParticleShader->SetShaderParameters(m_Direct3D->GetDeviceContext(), XMLoadFloat4x4(&packet.view), projectionMatrix) == false)
+		return false;
+
+	// Depth tested against the scene, back to front so blending comes out right without turning depth writes off
+	m_Direct3D->TurnOnAlphaBlending();
+	m_ParticleBuffer->Draw(m_Direct3D->GetDeviceContext());
+	m_Direct3D->TurnOffAlphaBlending();
 	return true;
 }
+
+bool GraphicsClass::RenderOverlay(const FramePacket& packet)
+{
+	// Picks up anything added to the atlas since last frame, first call creates the texture
+	if (m_Atlas->Upload(m_Direct3D->GetDevice(), m_Direct3D->GetDeviceContext()) == false)
+		return false;
+
+	m_SpriteBatch->Begin(m_screenWidth, m_screenHeight);
+
+	// Benchmark load, a grid of small quads under the hud
+	m_SpriteBatch->SetLayer(0);
+	for (unsigned int i = 0; i < packet.overlayStressQuads; ++i)
+	{
+		const float x = (float)(i % 100) * 8.0f;
+		const float y = (float)(i / 100 % 75) * 8.0f;
+		m_SpriteBatch->DrawRect(m_Atlas, x, y, 6.0f, 6.0f, SpriteColor((i % 7) / 7.0f, (i % 5) / 5.0f, (i % 3) / 3.0f, 0.5f));
+	}
+
+	if (SHOW_HUD)
+		BuildHud(packet);
+	m_SpriteBatch->End();
+
+	XMMATRIX orthoMatrix;
+	m_Direct3D->GetOrthoMatrix(orthoMatrix);
+
+	m_Direct3D->TurnZBufferOff();
+	m_Direct3D->TurnOnAlphaBlending();
+
+	const bool result = m_SpriteBatch->Render(m_Direct3D->GetDeviceContext(), m_SpriteShader, orthoMatrix);
+
+	m_Direct3D->TurnOffAlphaBlending();
+	m_Direct3D->TurnZBufferOn();
+
+	m_lastDrawCount = m_ShadowMap->GetDrawCount() + m_meshDrawCount + m_SpriteBatch->GetBatchCount();
+	return result;
+}
+
+void GraphicsClass::BuildHud(const FramePacket& packet)
+{
+	/*
+		Timings are from the last frame the profiler resolved (a few frames old) and the draw count
+		is last frame's, this frame's isn't known until the batch is done. Good enough for a readout.
+	*/
+	PROCESS_MEMORY_COUNTERS memory;
+	ZeroMemory(&memory, sizeof(memory));
+	GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory));
+	const ResidencyStatsType& residency = m_Textures->GetResidency()->GetStats();
+
+	char text[640];
+	sprintf_s(text, sizeof(text),
+		"%s (%d MB)\n"
+		"Frame %llu  cpu %.2f ms  gpu %.2f ms\n"
+		"Draws %d  visible %u / %u  triangles %u\n"
+		"Lights %u  cluster indices %u (%u KB)\n"
+		"Shadow cascades redrawn %d  casters %d  drawn %d\n"
+		"Textures %d  resident %.1f / %.0f MB  loads %u  evictions %u\n"
+		"Particles %u  drawn %u (%u KB)\n"
+		"Memory %.1f MB  atlas %.0f%%\n"
+		"Shader reloads %d (%.1f ms)  failed %d",
+		m_videoCardName, m_videoCardMemory,
+		packet.frameIndex, m_Profiler->GetCpuFrameTime(), m_Profiler->GetGpuFrameTime(),
+		m_lastDrawCount, (unsigned int)packet.drawItems.size(), packet.sceneEntityCount, packet.trianglesSubmitted,
+		m_LightBuffer->GetLightCount(), m_LightBuffer->GetIndexCount(), m_LightBuffer->GetBufferSize() / 1024,
+		packet.shadows.cascadesRedrawn, packet.shadows.castersSubmitted, m_ShadowMap->GetDrawCount(),
+		m_Textures->GetTextureCount(), residency.residentBytes / (1024.0 * 1024.0), m_Textures->GetResidency()->GetBudget() / (1024.0 * 1024.0),
+		residency.mipsLoaded, residency.mipsEvicted,
+		packet.particles.alive, packet.particles.count, m_ParticleBuffer->GetBufferSize() / 1024,
+		memory.WorkingSetSize / (1024.0 * 1024.0), m_Atlas->GetUsage() * 100.0f,
+		m_ShaderCache->GetReloadCount(), m_ShaderCache->GetLastReloadLatency(), m_ShaderCache->GetFailedReloadCount());
+
+	// Text and panel both come from the atlas so it's all one draw call, -overlaytest checks that
+	const float margin = 8.0f;
+	m_SpriteBatch->SetLayer(0);
+	m_SpriteBatch->DrawTextPanel(m_Font, m_Atlas, margin, margin, margin, text, SpriteColor(1.0f, 1.0f, 1.0f, 1.0f), SpriteColor(0.0f, 0.0f, 0.0f, 0.6f));
+}
+
+bool GraphicsClass::LoadTextures()
+{
+	// Sorted so texture indices don't depend on the order the file system lists them in
+	std::vector<std::string> files;
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((std::string(ASSET_DIRECTORY) + "\\" + TEXTURE_FILE_PATTERN).c_str(), &findData);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+				files.push_back(std::string(ASSET_DIRECTORY) + "\\" + findData.cFileName);
+		} while (FindNextFileA(find, &findData));
+		FindClose(find);
+	}
+	std::sort(files.begin(), files.end());
+
+	// Stale or broken files are skipped rather than stopping startup, rebuilding them fixes it
+	for (const std::string& file : files)
+	{
+		if (m_Textures->Load(m_Direct3D->GetDevice(), file.c_str()) < 0)
+			OutputDebugString(("Skipped texture " + file + "\n").c_str());
+	}
+
+	return true;
+}
+
+bool GraphicsClass::LoadMeshes()
+{
+	// A benchmark hands in its own files, they go in the order given
+	std::vector<std::string> files = m_meshFiles;
+	if (files.empty())
+	{
+		// Sorted like the textures, mesh ids shouldn't depend on the file system either
+		WIN32_FIND_DATAA findData;
+		HANDLE find = FindFirstFileA((std::string(ASSET_DIRECTORY) + "\\" + MESH_FILE_PATTERN).c_str(), &findData);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+					files.push_back(std::string(ASSET_DIRECTORY) + "\\" + findData.cFileName);
+			} while (FindNextFileA(find, &findData));
+			FindClose(find);
+		}
+		std::sort(files.begin(), files.end());
+	}
+
+	// Same as textures, a stale file is skipped, no meshes just means nothing but particles and the overlay
+	for (const std::string& file : files)
+	{
+		if (m_Meshes->Load(m_Direct3D->GetDevice(), file.c_str()) < 0)
+			OutputDebugString(("Skipped mesh " + file + "\n").c_str());
+	}
+
+	return true;
+}
+
+bool GraphicsClass::StreamTextures(const FramePacket& packet)
+{
+	// Materials map onto the loaded textures until there's a material system, each texture spread once over the object
+	const int textureCount = m_Textures->GetTextureCount();
+	if (textureCount > 0)
+	{
+		for (const DrawItemType& item : packet.drawItems)
+			m_Textures->Request((int)(item.material % textureCount), item.screenSize);
+	}
+
+	return m_Textures->Update(m_Direct3D->GetDevice(), m_Direct3D->GetDeviceContext());
+}
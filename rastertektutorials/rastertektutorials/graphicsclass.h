@@ -2,12 +2,37 @@
 
 #include <windows.h>
 #include "d3dclass.h"
+#include "profilerclass.h"
+#include "framequeueclass.h"
+#include "atlasclass.h"
+#include "filewatcherclass.h"
+#include "shadercacheclass.h"
+#include "fontclass.h"
+#include "lightbufferclass.h"
+#include "meshlibraryclass.h"
+#include "meshshaderclass.h"
+#include "particlebufferclass.h"
+#include "particleshaderclass.h"
+#include "shadowmapclass.h"
+#include "spritebatchclass.h"
+#include "spriteshaderclass.h"
+#include "texturestreamerclass.h"
 
 // GLOBALS
 const bool FULL_SCREEN = false;
 const bool VSYNC_ENABLED = true;
 const float SCREEN_DEPTH = 1000.0f;
 const float SCREEN_NEAR = 0.1f;
+const int RENDER_FRAME_LAG = 2; // frames the main thread may run ahead of the render thread
+const char* const PROFILER_TRACE_FILE = "profile_trace.json"; // open in chrome://tracing
+const bool SHOW_HUD = true;
+const char* const HUD_FONT = "Consolas";
+const int HUD_FONT_SIZE = 16;
+const int OVERLAY_ATLAS_SIZE = 512;
+const bool HOT_RELOAD = true; // watch ASSET_DIRECTORY and rebuild shaders when they're saved
+const char* const ASSET_DIRECTORY = ".";
+const char* const TEXTURE_FILE_PATTERN = "*.tex"; // texture files in ASSET_DIRECTORY streamed in at startup, see -buildtexture
+const char* const MESH_FILE_PATTERN = "*.mesh"; // mesh files in ASSET_DIRECTORY, loaded at startup, see -buildmesh
 
 class GraphicsClass
 {
@@ -16,14 +41,65 @@ public:
 	GraphicsClass(const GraphicsClass&);
 	~GraphicsClass();
 
-	bool Initialize(int, int, HWND);
+	bool Initialize(int, int, HWND, bool);
+	/*
+		Initialize in stages for the startup graph. CreateDevice and LoadFont need nothing and can run on any thread,
+		CreateResources (shader compiles, buffers) needs the device, CreateSwapChain needs the device and the window
+		and has to run on the window's thread.
+	*/
+	bool CreateDevice();
+	bool LoadFont();
+	bool CreateResources(HWND);
+	bool CreateSwapChain(int, int, HWND, bool);
 	void Shutdown();
-	bool Frame();
+	// Called on the render thread
+	bool Frame(const FramePacket&);
+
+	ProfilerClass* GetProfiler();
+	ShaderCacheClass* GetShaderCache();
+	// After CreateResources, for registering the LOD chains with the scene
+	MeshLibraryClass* GetMeshes();
+	// Before CreateResources, loads these mesh files instead of the ones in ASSET_DIRECTORY
+	void SetMeshFiles(const std::vector<std::string>&);
+	// Before CreateResources, shaders are compiled from and watched in this directory instead of ASSET_DIRECTORY
+	void SetShaderDirectory(const std::string&);
+	void GetProjectionMatrix(XMMATRIX&);
 
 private:
-	bool Render();
+	bool Render(const FramePacket&);
+	void ApplyReloads();
+	bool RenderMeshes(const FramePacket&);
+	bool RenderParticles(const FramePacket&);
+	bool RenderOverlay(const FramePacket&);
+	void BuildHud(const FramePacket&);
+	bool LoadTextures();
+	bool LoadMeshes();
+	bool StreamTextures(const FramePacket&);
 
 private:
 	D3DClass* m_Direct3D;
+	ProfilerClass* m_Profiler;
+	FileWatcherClass* m_FileWatcher;
+	ShaderCacheClass* m_ShaderCache;
+	AtlasClass* m_Atlas;
+	FontClass* m_Font;
+	SpriteBatchClass* m_SpriteBatch;
+	SpriteShaderClass* m_SpriteShader;
+	LightBufferClass* m_LightBuffer;
+	MeshLibraryClass* m_Meshes;
+	MeshShaderClass* m_MeshShader;
+	ParticleBufferClass* m_ParticleBuffer;
+	ParticleShaderClass* m_ParticleShader;
+	ShadowMapClass* m_ShadowMap;
+	TextureStreamerClass* m_Textures;
+	int m_screenWidth;
+	int m_screenHeight;
+	char m_videoCardName[128];
+	int m_videoCardMemory;
+	int m_lastDrawCount;
+	int m_meshDrawCount;
+	std::vector<std::string> m_changedFiles;
+	std::vector<std::string> m_meshFiles; // empty loads every MESH_FILE_PATTERN file
+	std::string m_shaderDirectory;
 };
 
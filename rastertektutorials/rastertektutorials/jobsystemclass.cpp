@@ -0,0 +1,169 @@
+#include "jobsystemclass.h"
+
+JobSystemClass::JobSystemClass() :
+	m_quit(false)
+{
+}
+
+JobSystemClass::JobSystemClass(const JobSystemClass&)
+{
+}
+
+JobSystemClass::~JobSystemClass()
+{
+}
+
+bool JobSystemClass::Initialize(int threadCount)
+{
+	if (threadCount <= 0)
+	{
+		// hardware_concurrency can return 0 if it doesn't know
+		threadCount = (int)std::thread::hardware_concurrency() - 1;
+		if (threadCount < 1)
+			threadCount = 1;
+	}
+
+	m_quit = false;
+	m_workers.reserve(threadCount);
+	for (int i = 0; i < threadCount; ++i)
+		m_workers.push_back(std::thread(&JobSystemClass::WorkerThread, this));
+
+	return true;
+}
+
+void JobSystemClass::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+
+	m_jobReady.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+
+	m_workers.clear();
+	m_jobs.clear();
+}
+
+void JobSystemClass::Run(const std::function<void()>& function, JobCounter* counter)
+{
+	if (counter)
+		counter->pending.fetch_add(1);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Job job = { function, counter };
+		m_jobs.push_back(job);
+	}
+
+	m_jobReady.notify_one();
+}
+
+void JobSystemClass::Wait(JobCounter* counter)
+{
+	if (counter == nullptr)
+		return;
+
+	/*
+		Help out until our jobs are done. Only our own jobs though, picking up some other long job
+		(an AABB tree rebuild say) would keep us busy long after our own work finished.
+		If none of ours are left in the queue they're running on workers, just spin politely.
+	*/
+	while (counter->pending.load() > 0)
+	{
+		if (RunOne(counter) == false)
+			std::this_thread::yield();
+	}
+}
+
+void JobSystemClass::ParallelFor(int count, int batchSize, const std::function<void(int, int, int)>& function)
+{
+	if (count <= 0)
+		return;
+
+	if (batchSize < 1)
+		batchSize = 1;
+
+	/*
+		One runner per thread, each runner keeps grabbing the next batch until there are none left.
+		That way runner indices are unique per call so callers can keep per runner scratch data,
+		even when the waiting thread ends up helping with someone else's ParallelFor.
+	*/
+	const int batchCount = (count + batchSize - 1) / batchSize;
+	int runnerCount = GetThreadCount();
+	if (runnerCount > batchCount)
+		runnerCount = batchCount;
+
+	std::atomic<int> nextBatch(0);
+	auto runner = [&, count, batchSize, batchCount](int runnerIndex)
+	{
+		int batch;
+		while ((batch = nextBatch.fetch_add(1)) < batchCount)
+		{
+			const int begin = batch * batchSize;
+			const int end = begin + batchSize < count ? begin + batchSize : count;
+			function(begin, end, runnerIndex);
+		}
+	};
+
+	JobCounter counter;
+	for (int i = 1; i < runnerCount; ++i)
+		Run([&runner, i]() { runner(i); }, &counter);
+
+	runner(0);
+	Wait(&counter);
+}
+
+int JobSystemClass::GetThreadCount()
+{
+	return (int)m_workers.size() + 1;
+}
+
+void JobSystemClass::WorkerThread()
+{
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobReady.wait(lock, [this]() { return m_quit || m_jobs.empty() == false; });
+
+			if (m_quit && m_jobs.empty())
+				return;
+
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		job.function();
+		if (job.counter)
+			job.counter->pending.fetch_sub(1);
+	}
+}
+
+bool JobSystemClass::RunOne(JobCounter* counter)
+{
+	Job job;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::deque<Job>::iterator it = m_jobs.begin();
+		while (it != m_jobs.end() && it->counter != counter)
+			++it;
+
+		if (it == m_jobs.end())
+			return false;
+
+		job = *it;
+		m_jobs.erase(it);
+	}
+
+	job.function();
+	if (job.counter)
+		job.counter->pending.fetch_sub(1);
+
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Small worker thread pool. Jobs are plain std::functions pulled off one shared queue.
+	A JobCounter tracks a group of jobs, Wait() on it helps run the group's queued jobs instead of sleeping
+	so it's safe to wait from inside a job and the waiting thread isn't wasted.
+*/
+
+struct JobCounter
+{
+	JobCounter() : pending(0) {}
+	std::atomic<int> pending;
+};
+
+class JobSystemClass
+{
+public:
+	JobSystemClass();
+	JobSystemClass(const JobSystemClass&);
+	~JobSystemClass();
+
+	// 0 = one worker per hardware thread minus the calling thread
+	bool Initialize(int);
+	void Shutdown();
+
+	// Counter can be nullptr for fire and forget
+	void Run(const std::function<void()>&, JobCounter*);
+	void Wait(JobCounter*);
+
+	// Splits [0, count) into batches of batchSize and blocks until they're all done, the calling thread helps.
+	// The function gets (begin, end, runner index), runner index is unique within the call and in [0, GetThreadCount())
+	void ParallelFor(int, int, const std::function<void(int, int, int)>&);
+
+	// Workers plus the calling thread, use it to size per thread scratch data
+	int GetThreadCount();
+
+private:
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	void WorkerThread();
+	bool RunOne(JobCounter*);
+
+private:
+	std::vector<std::thread> m_workers;
+	std::deque<Job> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobReady;
+	bool m_quit;
+};
@@ -0,0 +1,166 @@
+#include "lightbufferclass.h"
+
+#include <string.h>
+
+LightBufferClass::LightBufferClass() :
+	m_buffer(nullptr),
+	m_bufferView(nullptr),
+	m_constantBuffer(nullptr),
+	m_bufferSize(0),
+	m_lightCount(0),
+	m_indexCount(0)
+{
+}
+
+LightBufferClass::LightBufferClass(const LightBufferClass&)
+{
+}
+
+LightBufferClass::~LightBufferClass()
+{
+}
+
+bool LightBufferClass::Initialize(ID3D11Device* device)
+{
+	D3D11_BUFFER_DESC constantBufferDesc;
+	constantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	constantBufferDesc.ByteWidth = sizeof(ClusterConstantsType);
+	constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	constantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	constantBufferDesc.MiscFlags = 0;
+	constantBufferDesc.StructureByteStride = 0;
+
+	if (FAILED(device->CreateBuffer(&constantBufferDesc, nullptr, &m_constantBuffer)))
+		return false;
+
+	return CreateBuffer(device, LIGHT_BUFFER_INITIAL_SIZE);
+}
+
+void LightBufferClass::Shutdown()
+{
+	ReleaseBuffer();
+
+	if (m_constantBuffer)
+	{
+		m_constantBuffer->Release();
+		m_constantBuffer = nullptr;
+	}
+}
+
+bool LightBufferClass::CreateBuffer(ID3D11Device* device, unsigned int size)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = size;
+	bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	bufferDesc.StructureByteStride = 0;
+
+	if (FAILED(device->CreateBuffer(&bufferDesc, nullptr, &m_buffer)))
+		return false;
+
+	// Raw views are always R32_TYPELESS, elements are 4 bytes
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+	ZeroMemory(&viewDesc, sizeof(viewDesc));
+	viewDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+	viewDesc.BufferEx.FirstElement = 0;
+	viewDesc.BufferEx.NumElements = size / 4;
+	viewDesc.BufferEx.Flags = D3D11_BUFFEREX_SRV_FLAG_RAW;
+
+	if (FAILED(device->CreateShaderResourceView(m_buffer, &viewDesc, &m_bufferView)))
+		return false;
+
+	m_bufferSize = size;
+	return true;
+}
+
+void LightBufferClass::ReleaseBuffer()
+{
+	if (m_bufferView)
+	{
+		m_bufferView->Release();
+		m_bufferView = nullptr;
+	}
+
+	if (m_buffer)
+	{
+		m_buffer->Release();
+		m_buffer = nullptr;
+	}
+
+	m_bufferSize = 0;
+}
+
+bool LightBufferClass::Upload(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const ClusterListType& list, int screenWidth, int screenHeight)
+{
+	const unsigned int lightBytes = (unsigned int)(list.lights.size() * sizeof(LightType));
+	const unsigned int clusterBytes = (unsigned int)(list.clusters.size() * sizeof(unsigned int));
+	const unsigned int indexBytes = (unsigned int)(list.indices.size() * sizeof(unsigned int));
+	const unsigned int needed = lightBytes + clusterBytes + indexBytes;
+
+	// Grow by half again so a slowly rising light count doesn't recreate the buffer every frame
+	if (needed > m_bufferSize)
+	{
+		ReleaseBuffer();
+		if (CreateBuffer(device, needed + needed / 2) == false)
+			return false;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext->Map(m_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		return false;
+
+	unsigned char* data = (unsigned char*)mappedResource.pData;
+	if (lightBytes)
+		memcpy(data, list.lights.data(), lightBytes);
+	if (clusterBytes)
+		memcpy(data + lightBytes, list.clusters.data(), clusterBytes);
+	if (indexBytes)
+		memcpy(data + lightBytes + clusterBytes, list.indices.data(), indexBytes);
+	deviceContext->Unmap(m_buffer, 0);
+
+	if (FAILED(deviceContext->Map(m_constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		return false;
+
+	ClusterConstantsType* constants = (ClusterConstantsType*)mappedResource.pData;
+	constants->tileScaleX = screenWidth > 0 ? (float)CLUSTER_GRID_X / screenWidth : 0.0f;
+	constants->tileScaleY = screenHeight > 0 ? (float)CLUSTER_GRID_Y / screenHeight : 0.0f;
+	constants->zScale = list.zScale;
+	constants->zBias = list.zBias;
+	constants->gridX = CLUSTER_GRID_X;
+	constants->gridY = CLUSTER_GRID_Y;
+	constants->gridZ = CLUSTER_GRID_Z;
+	constants->lightCount = (unsigned int)list.lights.size();
+	constants->clusterOffset = lightBytes;
+	constants->indexOffset = lightBytes + clusterBytes;
+	constants->padding[0] = 0;
+	constants->padding[1] = 0;
+	deviceContext->Unmap(m_constantBuffer, 0);
+
+	m_lightCount = (unsigned int)list.lights.size();
+	m_indexCount = (unsigned int)list.indices.size();
+	return true;
+}
+
+void LightBufferClass::Bind(ID3D11DeviceContext* deviceContext)
+{
+	deviceContext->PSSetShaderResources(LIGHT_BUFFER_SLOT, 1, &m_bufferView);
+	deviceContext->PSSetConstantBuffers(LIGHT_CONSTANT_SLOT, 1, &m_constantBuffer);
+}
+
+unsigned int LightBufferClass::GetLightCount()
+{
+	return m_lightCount;
+}
+
+unsigned int LightBufferClass::GetIndexCount()
+{
+	return m_indexCount;
+}
+
+unsigned int LightBufferClass::GetBufferSize()
+{
+	return m_bufferSize;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <d3d11.h>
+#include "clusteredlightingclass.h"
+
+/*
+	Gets a frame's ClusterListType onto the gpu. Lights, cluster ranges and light indices all go into one
+	dynamic raw (ByteAddressBuffer) buffer, back to back, so a frame is one Map and one shader resource:
+
+		[lights: 12 uints each][clusters: offset, count per cluster][indices: one uint each]
+
+	The constant buffer says where each part starts (in bytes) and how to find a pixel's cluster.
+	clusters.hlsli is the shader side of this, keep the two in step.
+	The buffer grows when a frame needs more room and never shrinks.
+*/
+
+const int LIGHT_BUFFER_SLOT = 8; // t8
+const int LIGHT_CONSTANT_SLOT = 1; // b1
+const unsigned int LIGHT_BUFFER_INITIAL_SIZE = 256 * 1024;
+
+class LightBufferClass
+{
+private:
+	// Matches cbuffer ClusterBuffer in clusters.hlsli
+	struct ClusterConstantsType
+	{
+		float tileScaleX; // clusters per pixel
+		float tileScaleY;
+		float zScale;
+		float zBias;
+		unsigned int gridX;
+		unsigned int gridY;
+		unsigned int gridZ;
+		unsigned int lightCount;
+		unsigned int clusterOffset;
+		unsigned int indexOffset;
+		unsigned int padding[2];
+	};
+
+public:
+	LightBufferClass();
+	LightBufferClass(const LightBufferClass&);
+	~LightBufferClass();
+
+	bool Initialize(ID3D11Device*);
+	void Shutdown();
+
+	// Screen size is what the clusters are spread over
+	bool Upload(ID3D11Device*, ID3D11DeviceContext*, const ClusterListType&, int, int);
+	// Pixel shader slots LIGHT_BUFFER_SLOT and LIGHT_CONSTANT_SLOT
+	void Bind(ID3D11DeviceContext*);
+
+	unsigned int GetLightCount();
+	unsigned int GetIndexCount();
+	unsigned int GetBufferSize();
+
+private:
+	bool CreateBuffer(ID3D11Device*, unsigned int);
+	void ReleaseBuffer();
+
+private:
+	ID3D11Buffer* m_buffer;
+	ID3D11ShaderResourceView* m_bufferView;
+	ID3D11Buffer* m_constantBuffer;
+	unsigned int m_bufferSize;
+	unsigned int m_lightCount;
+	unsigned int m_indexCount;
+};
@@ -0,0 +1,188 @@
+#include "lodselectorclass.h"
+
+#include <algorithm>
+
+LodSelectorClass::LodSelectorClass() :
+	m_pixelScale(1.0f),
+	m_errorScale(1.0f),
+	m_enabled(true),
+	m_budget(LOD_DEFAULT_TRIANGLE_BUDGET),
+	m_triangles(0),
+	m_forced(0)
+{
+}
+
+LodSelectorClass::LodSelectorClass(const LodSelectorClass&)
+{
+}
+
+LodSelectorClass::~LodSelectorClass()
+{
+}
+
+bool LodSelectorClass::Initialize(XMMATRIX projectionMatrix, int screenHeight)
+{
+	if (screenHeight < 1)
+		return false;
+
+	// _22 is cot(fov / 2), one world unit at distance 1 covers that much of half the screen height
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, projectionMatrix);
+	m_pixelScale = projection._22 * (float)screenHeight * 0.5f;
+
+	m_errorScale = 1.0f;
+	m_triangles = 0;
+	m_forced = 0;
+	return true;
+}
+
+void LodSelectorClass::Shutdown()
+{
+	m_chains.clear();
+	m_order.clear();
+}
+
+void LodSelectorClass::SetChain(unsigned int mesh, const LodChainType& chain)
+{
+	if (mesh >= m_chains.size())
+	{
+		LodChainType single;
+		single.count = 1;
+		single.triangles[0] = 0;
+		single.error[0] = 0.0f;
+		m_chains.resize(mesh + 1, single);
+	}
+
+	m_chains[mesh] = chain;
+	m_chains[mesh].count = chain.count < 1 ? 1 : (chain.count > MESH_MAX_LODS ? MESH_MAX_LODS : chain.count);
+}
+
+unsigned int LodSelectorClass::GetChainCount()
+{
+	return (unsigned int)m_chains.size();
+}
+
+const LodChainType& LodSelectorClass::GetChain(unsigned int mesh)
+{
+	return m_chains[mesh];
+}
+
+void LodSelectorClass::SetEnabled(bool enabled)
+{
+	m_enabled = enabled;
+	m_errorScale = 1.0f;
+}
+
+bool LodSelectorClass::IsEnabled()
+{
+	return m_enabled;
+}
+
+void LodSelectorClass::SetTriangleBudget(unsigned int budget)
+{
+	m_budget = budget;
+}
+
+int LodSelectorClass::Select(unsigned int mesh, float distance, float scale, int current, float& pixelsPerUnit)
+{
+	pixelsPerUnit = m_pixelScale * scale / (distance > LOD_MIN_DISTANCE ? distance : LOD_MIN_DISTANCE);
+
+	if (m_enabled == false || mesh >= m_chains.size() || m_chains[mesh].count < 2)
+		return 0;
+
+	const LodChainType& chain = m_chains[mesh];
+	const float allowance = LOD_PIXEL_ERROR * m_errorScale;
+
+	// Coarsest LOD within the allowance, and the coarsest one within the stricter going-coarser allowance
+	int fits = 0;
+	int fitsEasily = 0;
+	for (int lod = 1; lod < chain.count; ++lod)
+	{
+		const float pixels = chain.error[lod] * pixelsPerUnit;
+		fits = pixels <= allowance ? lod : fits;
+		fitsEasily = pixels <= allowance * LOD_HYSTERESIS ? lod : fitsEasily;
+	}
+
+	current = current < 0 ? 0 : (current >= chain.count ? chain.count - 1 : current);
+
+	if (current > fits)
+		return fits;
+
+	return fitsEasily > current ? fitsEasily : current;
+}
+
+unsigned int LodSelectorClass::ApplyBudget(std::vector<DrawItemType>& items)
+{
+	unsigned int total = 0;
+	for (const DrawItemType& item : items)
+		total += GetTriangles(item);
+
+	m_forced = 0;
+
+	if (m_enabled == false)
+	{
+		m_triangles = total;
+		return total;
+	}
+
+	// Steer the allowance so next frame's selection lands under the budget by itself
+	if (total > m_budget)
+		m_errorScale = m_errorScale * 1.25f < LOD_MAX_ERROR_SCALE ? m_errorScale * 1.25f : LOD_MAX_ERROR_SCALE;
+	else if ((float)total < (float)m_budget * LOD_HYSTERESIS && m_errorScale > 1.0f)
+		m_errorScale = m_errorScale / 1.1f > 1.0f ? m_errorScale / 1.1f : 1.0f;
+
+	if (total > m_budget)
+	{
+		// Smallest on screen first, one level at a time round the whole list until it fits or nothing can go coarser
+		m_order.resize(items.size());
+		for (size_t i = 0; i < items.size(); ++i)
+			m_order[i] = (unsigned int)i;
+
+		std::sort(m_order.begin(), m_order.end(), [&items](unsigned int a, unsigned int b) { return items[a].lodPixels < items[b].lodPixels; });
+
+		bool progress = true;
+		while (total > m_budget && progress)
+		{
+			progress = false;
+			for (size_t i = 0; i < m_order.size() && total > m_budget; ++i)
+			{
+				DrawItemType& item = items[m_order[i]];
+				if (item.mesh >= m_chains.size() || (int)item.lod + 1 >= m_chains[item.mesh].count)
+					continue;
+
+				const LodChainType& chain = m_chains[item.mesh];
+				total -= chain.triangles[item.lod] - chain.triangles[item.lod + 1];
+				++item.lod;
+				++m_forced;
+				progress = true;
+			}
+		}
+	}
+
+	m_triangles = total;
+	return total;
+}
+
+unsigned int LodSelectorClass::GetTriangles(const DrawItemType& item)
+{
+	if (item.mesh >= m_chains.size())
+		return 0;
+
+	const LodChainType& chain = m_chains[item.mesh];
+	return chain.triangles[(int)item.lod < chain.count ? item.lod : chain.count - 1];
+}
+
+unsigned int LodSelectorClass::GetTriangleCount()
+{
+	return m_triangles;
+}
+
+unsigned int LodSelectorClass::GetForcedCount()
+{
+	return m_forced;
+}
+
+float LodSelectorClass::GetErrorScale()
+{
+	return m_errorScale;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+#include "drawitem.h"
+#include "meshfile.h"
+
+using namespace DirectX;
+
+/*
+	Picks a LOD for every visible renderable from how big its mesh's simplification error would be on screen.
+	A LOD's error is in model units (MeshLodHeaderType::error), times the object's scale it's world units, and at
+	distance d the projection turns that into error * projection._22 * screenHeight / 2 / d pixels.
+	The coarsest LOD within LOD_PIXEL_ERROR pixels wins.
+	Hysteresis: an object only goes coarser once that LOD fits in LOD_HYSTERESIS of the allowance, so one sitting right
+	at a switching distance doesn't flip between two LODs every frame. Going finer happens straight away.
+	Triangle budget: if the visible set still has more triangles than the budget, the objects smallest on screen are
+	pushed coarser until it fits, and the allowance goes up for the following frames (and eases back once there's room)
+	so the forced pass stays the exception.
+	Meshes nobody registered a chain for have one LOD and don't count towards the budget.
+*/
+
+const float LOD_PIXEL_ERROR = 1.0f;
+const float LOD_HYSTERESIS = 0.75f;
+const float LOD_MIN_DISTANCE = 0.1f; // the near plane, anything closer gets the finest LOD anyway
+const float LOD_MAX_ERROR_SCALE = 16.0f; // budget pressure raises the allowance to at most this many times LOD_PIXEL_ERROR
+const unsigned int LOD_DEFAULT_TRIANGLE_BUDGET = 4000000;
+
+struct LodChainType
+{
+	int count;
+	unsigned int triangles[MESH_MAX_LODS];
+	float error[MESH_MAX_LODS]; // model space, never decreasing
+};
+
+class LodSelectorClass
+{
+public:
+	LodSelectorClass();
+	LodSelectorClass(const LodSelectorClass&);
+	~LodSelectorClass();
+
+	// Projection and back buffer height, together they give pixels per world unit at a distance
+	bool Initialize(XMMATRIX, int);
+	void Shutdown();
+
+	void SetChain(unsigned int, const LodChainType&);
+	// Meshes up to the highest one with a chain, the rest have the single LOD default
+	unsigned int GetChainCount();
+	const LodChainType& GetChain(unsigned int);
+	// Off means LOD 0 for everything and no budget, to measure what the LODs buy
+	void SetEnabled(bool);
+	bool IsEnabled();
+	void SetTriangleBudget(unsigned int);
+
+	/*
+		Safe to call from the render system's jobs, nothing in here changes until ApplyBudget.
+		Mesh, distance from the camera to the bounding sphere, object scale, the LOD it had last frame.
+		Returns this frame's LOD, and the pixels per model unit of error at that distance for ApplyBudget
+	*/
+	int Select(unsigned int, float, float, int, float&);
+	// Main thread once all of the frame's items are in, returns the triangles they add up to
+	unsigned int ApplyBudget(std::vector<DrawItemType>&);
+
+	// From the last ApplyBudget
+	unsigned int GetTriangleCount();
+	unsigned int GetForcedCount();
+	float GetErrorScale();
+
+private:
+	unsigned int GetTriangles(const DrawItemType&);
+
+private:
+	std::vector<LodChainType> m_chains; // by mesh id
+	std::vector<unsigned int> m_order; // ApplyBudget scratch
+	float m_pixelScale;
+	float m_errorScale;
+	bool m_enabled;
+	unsigned int m_budget;
+	unsigned int m_triangles;
+	unsigned int m_forced;
+};
@@ -1,18 +1,347 @@
 #include "systemclass.h"
+#include "benchmarkclass.h"
+#include "meshbuilderclass.h"
+#include "texturebuilderclass.h"
+#include "texturetestclass.h"
+#include "sceneloadbenchmarkclass.h"
+#include "particlebenchmarkclass.h"
+#include "shadowtestclass.h"
+#include "overlaytestclass.h"
+#include "framequeuetestclass.h"
+#include "profilertestclass.h"
+#include "entitybenchmarkclass.h"
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/*
+	The normal demo unless the command line asks for something else:
+
+		-benchmark <scenario> [-warmup N] [-frames N] [-nolod] [-out results.json]
+		-compare <baseline.json> <candidate.json> [-threshold percent] [-out report.txt]
+		-buildmesh <model.txt> <output.mesh> [-out report.txt]
+		-buildtexture <image.tga> <output.tex> [-format bc1|bc3|bc5|bc7] [-out report.txt]
+		-texturetest [-out report.txt]
+		-sceneload [-entities N] [-out report.txt]
+		-particles [-out report.txt]
+		-shadowtest [-out report.txt]
+		-overlaytest [-out report.txt]
+		-framequeuetest [-out report.txt]
+		-profilertest [-out report.txt]
+		-ecs [-out report.txt]
+		-scene <file.snapshot>
+
+	-benchmark and -compare are BenchmarkClass's. Buildmesh and buildtexture are windowless asset builds, see
+	MeshBuilderClass and TextureBuilderClass. Texturetest, sceneload, particles, ecs, shadowtest, overlaytest,
+	framequeuetest and profilertest are headless tests and benchmarks (TextureTestClass, SceneLoadBenchmarkClass,
+	ParticleBenchmarkClass, EntityBenchmarkClass, ShadowTestClass, OverlayTestClass, FrameQueueTestClass,
+	ProfilerTestClass) that exit with 1 if a check fails.
+	-scene isn't a mode, it starts the normal demo with a saved scene instead of the demo objects.
+*/
+
+enum RunMode
+{
+	MODE_DEMO,
+	MODE_BENCHMARK,
+	MODE_COMPARE,
+	MODE_BUILD_MESH,
+	MODE_BUILD_TEXTURE,
+	MODE_TEXTURE_TEST,
+	MODE_SCENE_LOAD,
+	MODE_PARTICLES,
+	MODE_SHADOW_TEST,
+	MODE_OVERLAY_TEST,
+	MODE_FRAME_QUEUE_TEST,
+	MODE_PROFILER_TEST,
+	MODE_ENTITIES
+};
+
+struct CommandLineType
+{
+	RunMode mode;
+	BenchmarkSettingsType benchmark; // -benchmark and -compare
+	std::string output; // report of the other modes
+	std::string meshSource;
+	std::string meshOutput;
+	std::string textureSource;
+	std::string textureOutput;
+	TextureFormatType textureFormat;
+	std::string scene;
+	int sceneEntities;
+};
+
+static void SplitCommandLine(const char* commandLine, std::vector<std::string>& arguments)
+{
+	// Whitespace separated, double quotes group paths with spaces in them
+	std::string current;
+	bool quoted = false;
+	bool any = false;
+	for (const char* c = commandLine ? commandLine : ""; *c; ++c)
+	{
+		if (*c == '"')
+		{
+			quoted = !quoted;
+			any = true;
+		}
+		else if ((*c == ' ' || *c == '\t') && quoted == false)
+		{
+			if (any)
+				arguments.push_back(current);
+
+			current.clear();
+			any = false;
+		}
+		else
+		{
+			current += *c;
+			any = true;
+		}
+	}
+
+	if (any)
+		arguments.push_back(current);
+}
+
+// Returns false if the command line doesn't make sense
+static bool ParseCommandLine(const char* commandLine, CommandLineType& settings)
+{
+	settings.mode = MODE_DEMO;
+	BenchmarkClass::GetDefaultSettings(settings.benchmark);
+	settings.output.clear();
+	settings.meshSource.clear();
+	settings.meshOutput.clear();
+	settings.textureSource.clear();
+	settings.textureOutput.clear();
+	settings.textureFormat = TEXTURE_BC7;
+	settings.scene.clear();
+	settings.sceneEntities = SCENE_LOAD_DEFAULT_ENTITIES;
+
+	std::vector<std::string> arguments;
+	SplitCommandLine(commandLine, arguments);
+
+	for (size_t i = 0; i < arguments.size(); ++i)
+	{
+		const std::string& argument = arguments[i];
+		const bool hasValue = i + 1 < arguments.size();
+
+		if (argument == "-benchmark" && hasValue)
+		{
+			settings.mode = MODE_BENCHMARK;
+			if (BenchmarkClass::FindScenario(arguments[++i], settings.benchmark.scenario) == false)
+				return false;
+		}
+		else if (argument == "-compare" && i + 2 < arguments.size())
+		{
+			settings.mode = MODE_COMPARE;
+			settings.benchmark.baseline = arguments[++i];
+			settings.benchmark.candidate = arguments[++i];
+		}
+		else if (argument == "-buildmesh" && i + 2 < arguments.size())
+		{
+			settings.mode = MODE_BUILD_MESH;
+			settings.meshSource = arguments[++i];
+			settings.meshOutput = arguments[++i];
+		}
+		else if (argument == "-buildtexture" && i + 2 < arguments.size())
+		{
+			settings.mode = MODE_BUILD_TEXTURE;
+			settings.textureSource = arguments[++i];
+			settings.textureOutput = arguments[++i];
+		}
+		else if (argument == "-texturetest")
+		{
+			settings.mode = MODE_TEXTURE_TEST;
+		}
+		else if (argument == "-sceneload")
+		{
+			settings.mode = MODE_SCENE_LOAD;
+		}
+		else if (argument == "-particles")
+		{
+			settings.mode = MODE_PARTICLES;
+		}
+		else if (argument == "-shadowtest")
+		{
+			settings.mode = MODE_SHADOW_TEST;
+		}
+		else if (argument == "-overlaytest")
+		{
+			settings.mode = MODE_OVERLAY_TEST;
+		}
+		else if (argument == "-framequeuetest")
+		{
+			settings.mode = MODE_FRAME_QUEUE_TEST;
+		}
+		else if (argument == "-profilertest")
+		{
+			settings.mode = MODE_PROFILER_TEST;
+		}
+		else if (argument == "-ecs")
+		{
+			settings.mode = MODE_ENTITIES;
+		}
+		else if (argument == "-entities" && hasValue)
+		{
+			settings.sceneEntities = atoi(arguments[++i].c_str());
+		}
+		else if (argument == "-scene" && hasValue)
+		{
+			settings.scene = arguments[++i];
+		}
+		else if (argument == "-format" && hasValue)
+		{
+			const std::string& name = arguments[++i];
+
+			int format = 0;
+			while (format < TEXTURE_FORMAT_COUNT && name != TextureBuilderClass::GetFormatName((TextureFormatType)format))
+				++format;
+
+			if (format == TEXTURE_FORMAT_COUNT)
+				return false;
+
+			settings.textureFormat = (TextureFormatType)format;
+		}
+		else if (argument == "-warmup" && hasValue)
+		{
+			settings.benchmark.warmupFrames = atoi(arguments[++i].c_str());
+		}
+		else if (argument == "-frames" && hasValue)
+		{
+			settings.benchmark.measuredFrames = atoi(arguments[++i].c_str());
+		}
+		else if (argument == "-threshold" && hasValue)
+		{
+			settings.benchmark.threshold = atof(arguments[++i].c_str());
+		}
+		else if (argument == "-nolod")
+		{
+			settings.benchmark.lodsDisabled = true;
+		}
+		else if (argument == "-out" && hasValue)
+		{
+			settings.output = arguments[++i];
+		}
+		else if (argument.empty() == false && argument[0] == '-')
+		{
+			// Something we don't know, don't silently run the wrong thing
+			return false;
+		}
+	}
+
+	if (settings.benchmark.warmupFrames < 0 || settings.benchmark.measuredFrames < 1 || settings.sceneEntities < 1)
+		return false;
+
+	// Every mode has its own default file name
+	if (settings.output.empty())
+	{
+		switch (settings.mode)
+		{
+			case MODE_BENCHMARK: settings.output = BENCHMARK_DEFAULT_OUTPUT; break;
+			case MODE_COMPARE: settings.output = BENCHMARK_DEFAULT_REPORT; break;
+			case MODE_BUILD_MESH: settings.output = MESH_DEFAULT_REPORT; break;
+			case MODE_BUILD_TEXTURE: settings.output = TEXTURE_DEFAULT_REPORT; break;
+			case MODE_TEXTURE_TEST: settings.output = TEXTURE_TEST_DEFAULT_REPORT; break;
+			case MODE_SCENE_LOAD: settings.output = SCENE_LOAD_DEFAULT_REPORT; break;
+			case MODE_PARTICLES: settings.output = PARTICLE_BENCHMARK_DEFAULT_REPORT; break;
+			case MODE_SHADOW_TEST: settings.output = SHADOW_TEST_DEFAULT_REPORT; break;
+			case MODE_OVERLAY_TEST: settings.output = OVERLAY_TEST_DEFAULT_REPORT; break;
+			case MODE_FRAME_QUEUE_TEST: settings.output = FRAME_QUEUE_TEST_DEFAULT_REPORT; break;
+			case MODE_PROFILER_TEST: settings.output = PROFILER_TEST_DEFAULT_REPORT; break;
+			case MODE_ENTITIES: settings.output = ENTITY_BENCHMARK_DEFAULT_REPORT; break;
+			default: break;
+		}
+	}
+
+	settings.benchmark.output = settings.output;
+	return true;
+}
 
 int WINAPI WinMain(
 	HINSTANCE hINstance,
-	HINSTANCE hPrevInstance, 
-	PSTR pScmdline, 
+	HINSTANCE hPrevInstance,
+	PSTR pScmdline,
 	int iCmdshow
 )
 {
+	CommandLineType settings;
+	if (ParseCommandLine(pScmdline, settings) == false)
+	{
+		MessageBox(nullptr,
+			"-benchmark <idle|drift|ecs_iterate|ecs_churn|bvh_query|overlay|lights_256|lights_1024|lights_4096|shadows|lods|shader_reload> [-warmup N] [-frames N] [-nolod] [-out results.json]\n"
+			"-compare <baseline.json> <candidate.json> [-threshold percent] [-out report.txt]\n"
+			"-buildmesh <model.txt> <output.mesh> [-out report.txt]\n"
+			"-buildtexture <image.tga> <output.tex> [-format bc1|bc3|bc5|bc7] [-out report.txt]\n"
+			"-texturetest [-out report.txt]\n"
+			"-sceneload [-entities N] [-out report.txt]\n"
+			"-particles [-out report.txt]\n"
+			"-shadowtest [-out report.txt]\n"
+			"-overlaytest [-out report.txt]\n"
+			"-framequeuetest [-out report.txt]\n"
+			"-profilertest [-out report.txt]\n"
+			"-ecs [-out report.txt]\n"
+			"-scene <file.snapshot>",
+			"Usage", MB_OK);
+		return 2;
+	}
+
+	switch (settings.mode)
+	{
+		// Comparing is just reading two files, no window needed. Exit code 1 means a regression, for scripts
+		case MODE_COMPARE:
+			return BenchmarkClass::Compare(settings.benchmark);
+
+		// Offline mesh build, writes the mesh file and a before/after report
+		case MODE_BUILD_MESH:
+			return MeshBuilderClass::Build(settings.meshSource, settings.meshOutput, settings.output);
+
+		// Same for textures, block compressed mips and a throughput/quality report
+		case MODE_BUILD_TEXTURE:
+			return TextureBuilderClass::Build(settings.textureSource, settings.textureOutput, settings.textureFormat, settings.output);
+
+		// Headless, exit code 1 if a test failed
+		case MODE_TEXTURE_TEST:
+			return TextureTestClass::Run(settings.output);
+
+		// Headless too, exit code 1 if the snapshot and text loads don't come out the same
+		case MODE_SCENE_LOAD:
+			return SceneLoadBenchmarkClass::Run(settings.sceneEntities, settings.output);
+
+		// And this one, exit code 1 if the particles come out unsorted, behind a plane or culled wrong
+		case MODE_PARTICLES:
+			return ParticleBenchmarkClass::Run(settings.output);
+
+		// Shadow cache redraws, coverage, snapping and invalidation, exit code 1 if any of them are off
+		case MODE_SHADOW_TEST:
+			return ShadowTestClass::Run(settings.output);
+
+		// Sprite batch counts, HUD batching and End() throughput, exit code 1 if the batching is off
+		case MODE_OVERLAY_TEST:
+			return OverlayTestClass::Run(settings.output);
+
+		// Frame queue ordering, lag, full ring and Close with a slow consumer thread, exit code 1 if any of it is off
+		case MODE_FRAME_QUEUE_TEST:
+			return FrameQueueTestClass::Run(settings.output);
+
+		// Profiler nesting past its limits and the trace file, headless, exit code 1 if either is off
+		case MODE_PROFILER_TEST:
+			return ProfilerTestClass::Run(settings.output);
+
+		// Entity store iteration and command buffer playback without a scene or device, exit code 1 if a check fails
+		case MODE_ENTITIES:
+			return EntityBenchmarkClass::Run(settings.output);
+
+		default:
+			break;
+	}
+
 	SystemClass* System = new SystemClass();
 
 	if (System == nullptr)
 		return 1;
 
-	if (System->Initialize() == false)
+	// The demo or a benchmark run, both go through the whole engine
+	if (System->Initialize(settings.mode == MODE_BENCHMARK ? &settings.benchmark : nullptr, settings.scene) == false)
 		return 1;
 
 	System->Run();
@@ -20,4 +349,4 @@ int WINAPI WinMain(
 	delete System; System = nullptr;
 
 	return 0;
-}
\ No newline at end of file
+}
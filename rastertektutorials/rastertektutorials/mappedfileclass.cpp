@@ -0,0 +1,79 @@
+#include "mappedfileclass.h"
+
+MappedFileClass::MappedFileClass() :
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr),
+	m_data(nullptr),
+	m_size(0),
+	m_copyOnWrite(false)
+{
+}
+
+MappedFileClass::MappedFileClass(const MappedFileClass&)
+{
+}
+
+MappedFileClass::~MappedFileClass()
+{
+}
+
+bool MappedFileClass::Initialize(const char* filename, bool copyOnWrite)
+{
+	m_copyOnWrite = copyOnWrite;
+
+	m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(m_file, &size) == FALSE || size.QuadPart == 0)
+		return false;
+
+	m_size = (unsigned long long)size.QuadPart;
+
+	// The file is only ever opened for reading, copy on write pages are the process's own
+	m_mapping = CreateFileMappingA(m_file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+		return false;
+
+	m_data = (const unsigned char*)MapViewOfFile(m_mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	return m_data != nullptr;
+}
+
+void MappedFileClass::Shutdown()
+{
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+
+	m_size = 0;
+}
+
+const unsigned char* MappedFileClass::GetData()
+{
+	return m_data;
+}
+
+unsigned char* MappedFileClass::GetWritableData()
+{
+	return m_copyOnWrite ? (unsigned char*)m_data : nullptr;
+}
+
+unsigned long long MappedFileClass::GetSize()
+{
+	return m_size;
+}
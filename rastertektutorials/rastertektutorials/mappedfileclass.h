@@ -0,0 +1,35 @@
+#pragma once
+
+#include <windows.h>
+
+/*
+	A whole file mapped read only into the address space. Nothing is read up front, pages come in from the
+	file (or the system cache) the first time they're touched, so pulling one mip out of a texture file only costs
+	that mip's pages.
+	Copy on write mappings can be written to, a page gets its own private copy the first time that happens and the
+	file itself never changes. That's how a scene snapshot is used in place and still simulated.
+*/
+
+class MappedFileClass
+{
+public:
+	MappedFileClass();
+	MappedFileClass(const MappedFileClass&);
+	~MappedFileClass();
+
+	// False if the file can't be opened or is empty. True for a copy on write mapping
+	bool Initialize(const char*, bool);
+	void Shutdown();
+
+	const unsigned char* GetData();
+	// nullptr unless it's mapped copy on write
+	unsigned char* GetWritableData();
+	unsigned long long GetSize();
+
+private:
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const unsigned char* m_data;
+	unsigned long long m_size;
+	bool m_copyOnWrite;
+};
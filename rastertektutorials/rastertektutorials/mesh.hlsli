@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: mesh.hlsli
+// Vertex shader side of MeshVertexFormat (vertexformat.h). The input assembler
+// already turns the unorm/snorm/half attributes into floats, these undo the
+// per mesh position quantization and the octahedral normal encoding.
+////////////////////////////////////////////////////////////////////////////////
+
+struct MeshVertexInput
+{
+	float4 position : POSITION; // 0..1 inside the mesh bounds, w unused
+	float2 normal : NORMAL; // octahedral
+	float2 tex : TEXCOORD0;
+};
+
+// scale and bias are MeshClass::GetPositionScale/GetPositionBias
+float3 DecodePosition(float4 position, float3 scale, float3 bias)
+{
+	return position.xyz * scale + bias;
+}
+
+float3 DecodeNormal(float2 encoded)
+{
+	// Upper half as is, the lower half was folded over the diagonals
+	float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-normal.z);
+	normal.xy += normal.xy >= 0.0f ? -fold : fold;
+	return normalize(normal);
+}
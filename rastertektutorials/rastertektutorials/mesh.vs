@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: mesh.vs
+// MeshClass vertices, decoded with mesh.hlsli. Also the shadow caster shader,
+// MeshShaderClass sets view to identity and projection to the cascade matrix.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mesh.hlsli"
+
+cbuffer FrameBuffer : register(b0)
+{
+	matrix viewMatrix;
+	matrix projectionMatrix;
+};
+
+cbuffer ObjectBuffer : register(b3)
+{
+	matrix worldMatrix;
+	float3 positionScale;
+	float textured;
+	float3 positionBias;
+	float objectPadding;
+};
+
+struct PixelInputType
+{
+	float4 position : SV_POSITION;
+	float2 tex : TEXCOORD0;
+	float3 worldPosition : TEXCOORD1;
+	float3 viewPosition : TEXCOORD2;
+	float3 worldNormal : TEXCOORD3;
+	float3 viewNormal : NORMAL;
+};
+
+PixelInputType MeshVertexShader(MeshVertexInput input)
+{
+	PixelInputType output;
+
+	float4 worldPosition = mul(float4(DecodePosition(input.position, positionScale, positionBias), 1.0f), worldMatrix);
+	float4 viewPosition = mul(worldPosition, viewMatrix);
+
+	output.position = mul(viewPosition, projectionMatrix);
+	output.tex = input.tex;
+	output.worldPosition = worldPosition.xyz;
+	output.viewPosition = viewPosition.xyz;
+
+	// Objects only get uniform scales so the world matrix does for normals too
+	output.worldNormal = normalize(mul(DecodeNormal(input.normal), (float3x3)worldMatrix));
+	output.viewNormal = mul(output.worldNormal, (float3x3)viewMatrix);
+
+	return output;
+}
@@ -0,0 +1,1084 @@
+#include "meshbuilderclass.h"
+
+#include <windows.h>
+#include <directxpackedvector.h>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace DirectX::PackedVector;
+
+static_assert(sizeof(SourceVertexType) == SourceVertexFormat::stride, "SourceVertexType doesn't match SourceVertexFormat");
+
+// Forsyth's scoring constants, the values from his write up
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static const unsigned int NO_VERTEX = 0xFFFFFFFF;
+
+static float VertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+	// Nothing left to draw with it, it shouldn't pull anything in
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The last triangle's vertices get a fixed score so the next one doesn't just reuse the same edge forever
+		if (cachePosition < 3)
+			score = LAST_TRIANGLE_SCORE;
+		else
+			score = powf(1.0f - (float)(cachePosition - 3) / (float)(MESH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+	}
+
+	// Vertices with few triangles left get finished off before they leave lonely triangles behind
+	return score + VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+}
+
+static bool ReadFile(const char* filename, std::string& contents)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "rb") != 0 || file == nullptr)
+		return false;
+
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		contents.append(buffer, read);
+
+	fclose(file);
+	return true;
+}
+
+static void EncodeOctahedral(const XMFLOAT3& normal, short* encoded)
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1, fold the lower half over the upper one
+	float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	float x = length > 0.0f ? normal.x / length : 0.0f;
+	float y = length > 0.0f ? normal.y / length : 0.0f;
+
+	if (normal.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = (short)floorf(x * 32767.0f + 0.5f);
+	encoded[1] = (short)floorf(y * 32767.0f + 0.5f);
+}
+
+static bool WritePadding(FILE* file, long alignedPosition)
+{
+	static const char zeros[MESH_FILE_ALIGNMENT] = {};
+
+	long position = ftell(file);
+	return position <= alignedPosition && fwrite(zeros, 1, alignedPosition - position, file) == (size_t)(alignedPosition - position);
+}
+
+static unsigned int AlignOffset(unsigned int offset)
+{
+	return (offset + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
+}
+
+static void AddPlane(QuadricType& quadric, double a, double b, double c, double d, double weight)
+{
+	quadric.xx += weight * a * a; quadric.xy += weight * a * b; quadric.xz += weight * a * c; quadric.xw += weight * a * d;
+	quadric.yy += weight * b * b; quadric.yz += weight * b * c; quadric.yw += weight * b * d;
+	quadric.zz += weight * c * c; quadric.zw += weight * c * d;
+	quadric.ww += weight * d * d;
+	quadric.weight += weight;
+}
+
+static void AddQuadric(QuadricType& quadric, const QuadricType& other)
+{
+	quadric.xx += other.xx; quadric.xy += other.xy; quadric.xz += other.xz; quadric.xw += other.xw;
+	quadric.yy += other.yy; quadric.yz += other.yz; quadric.yw += other.yw;
+	quadric.zz += other.zz; quadric.zw += other.zw;
+	quadric.ww += other.ww;
+	quadric.weight += other.weight;
+}
+
+// Squared distance from the point to the quadric's planes, averaged by their weights
+static double QuadricError(const QuadricType& quadric, const XMFLOAT3& point)
+{
+	const double x = point.x, y = point.y, z = point.z;
+	const double error = quadric.xx * x * x + quadric.yy * y * y + quadric.zz * z * z + quadric.ww +
+		2.0 * (quadric.xy * x * y + quadric.xz * x * z + quadric.yz * y * z + quadric.xw * x + quadric.yw * y + quadric.zw * z);
+	return quadric.weight > 0.0 ? (error > 0.0 ? error : 0.0) / quadric.weight : 0.0;
+}
+
+static XMVECTOR TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+	XMVECTOR origin = XMLoadFloat3(&a);
+	return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b), origin), XMVectorSubtract(XMLoadFloat3(&c), origin));
+}
+
+static unsigned int CountVertices(const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	std::vector<bool> used(vertexCount, false);
+	unsigned int count = 0;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		count += used[indices[i]] ? 0 : 1;
+		used[indices[i]] = true;
+	}
+
+	return count;
+}
+
+MeshBuilderClass::MeshBuilderClass() :
+	m_boundsMin(0.0f, 0.0f, 0.0f),
+	m_boundsMax(0.0f, 0.0f, 0.0f),
+	m_boundsCenter(0.0f, 0.0f, 0.0f),
+	m_boundsRadius(0.0f)
+{
+}
+
+MeshBuilderClass::MeshBuilderClass(const MeshBuilderClass&)
+{
+}
+
+MeshBuilderClass::~MeshBuilderClass()
+{
+}
+
+int MeshBuilderClass::Build(const std::string& source, const std::string& output, const std::string& reportName)
+{
+	MeshBuilderClass builder;
+	if (builder.LoadModel(source.c_str()) == false)
+		return 2;
+
+	MeshStatsType before;
+	builder.Measure(before);
+
+	builder.GenerateLods(MESH_MAX_LODS);
+	builder.OptimizeVertexCache();
+	builder.OptimizeOverdraw(MESH_OVERDRAW_THRESHOLD);
+	builder.OptimizeVertexFetch();
+
+	if (builder.Write(output.c_str()) == false)
+		return 2;
+
+	MeshStatsType after;
+	builder.Measure(after);
+
+	FILE* report = nullptr;
+	if (fopen_s(&report, reportName.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	fprintf(report, "mesh %s -> %s\n", source.c_str(), output.c_str());
+	fprintf(report, "acmr/atvr for a %d entry fifo, raster %dx%d from %d directions, %d passes\n\n", MESH_MEASURE_CACHE_SIZE,
+		MESH_RASTER_SIZE, MESH_RASTER_SIZE, MESH_RASTER_VIEWS, MESH_RASTER_PASSES);
+	fprintf(report, "%-20s %14s %14s\n", "", "input", "built");
+	fprintf(report, "%-20s %14u %14u\n", "vertices", before.vertexCount, after.vertexCount);
+	fprintf(report, "%-20s %14u %14u\n", "triangles", before.triangleCount, after.triangleCount);
+	fprintf(report, "%-20s %14.3f %14.3f\n", "acmr", before.acmr, after.acmr);
+	fprintf(report, "%-20s %14.3f %14.3f\n", "atvr", before.atvr, after.atvr);
+	fprintf(report, "%-20s %14u %14u\n", "bytes per vertex", before.bytesPerVertex, after.bytesPerVertex);
+	fprintf(report, "%-20s %14u %14u\n", "vertex bytes", before.vertexBytes, after.vertexBytes);
+	fprintf(report, "%-20s %14u %14u\n", "index bytes", before.indexBytes, after.indexBytes);
+	fprintf(report, "%-20s %14.3f %14.3f\n", "overdraw", before.overdraw, after.overdraw);
+	fprintf(report, "%-20s %14.3f %14.3f\n", "raster ms", before.rasterMs, after.rasterMs);
+	fprintf(report, "%-20s %14.2f %14.2f\n", "raster Mtris/s", before.rasterTrianglesPerSecond / 1000000.0, after.rasterTrianglesPerSecond / 1000000.0);
+
+	// Error is the simplifier's estimate of how far the surface moved, in model units and as a fraction of the bounding radius
+	fprintf(report, "\n%-6s %12s %12s %14s %12s\n", "lod", "triangles", "vertices", "error", "of radius");
+	for (int lod = 0; lod < builder.GetLodCount(); ++lod)
+	{
+		fprintf(report, "%-6d %12u %12u %14.6f %11.3f%%\n", lod, builder.GetLodTriangles(lod), builder.GetLodVertices(lod), builder.GetLodError(lod),
+			builder.m_boundsRadius > 0.0f ? builder.GetLodError(lod) / builder.m_boundsRadius * 100.0f : 0.0f);
+	}
+
+	fclose(report);
+	return 0;
+}
+
+bool MeshBuilderClass::LoadModel(const char* filename)
+{
+	std::string contents;
+	if (ReadFile(filename, contents) == false)
+		return false;
+
+	// "Vertex Count: N", then "Data:", then eight numbers per vertex
+	size_t countStart = contents.find(':');
+	size_t dataStart = countStart == std::string::npos ? std::string::npos : contents.find(':', countStart + 1);
+	if (dataStart == std::string::npos)
+		return false;
+
+	const int vertexCount = atoi(contents.c_str() + countStart + 1);
+	if (vertexCount < 3 || vertexCount % 3 != 0)
+		return false;
+
+	std::vector<SourceVertexType> triangles(vertexCount);
+	const char* c = contents.c_str() + dataStart + 1;
+	for (int i = 0; i < vertexCount; ++i)
+	{
+		float* values = &triangles[i].position.x;
+		for (int j = 0; j < 8; ++j)
+		{
+			char* end = nullptr;
+			values[j] = strtof(c, &end);
+			if (end == c)
+				return false;
+			c = end;
+		}
+	}
+
+	return LoadTriangles(triangles);
+}
+
+bool MeshBuilderClass::LoadTriangles(const std::vector<SourceVertexType>& raw)
+{
+	m_vertices.clear();
+	m_lods.clear();
+	m_quantized.clear();
+
+	const unsigned int vertexCount = (unsigned int)raw.size();
+	if (vertexCount < 3 || vertexCount % 3 != 0)
+		return false;
+
+	// Weld exact duplicates. Sort so equal vertices end up next to each other, every group maps to its first member
+	std::vector<unsigned int> order(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; ++i)
+		order[i] = i;
+
+	std::sort(order.begin(), order.end(), [&raw](unsigned int a, unsigned int b)
+	{
+		int difference = memcmp(&raw[a], &raw[b], sizeof(SourceVertexType));
+		return difference != 0 ? difference < 0 : a < b;
+	});
+
+	std::vector<unsigned int> first(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		bool same = i > 0 && memcmp(&raw[order[i]], &raw[order[i - 1]], sizeof(SourceVertexType)) == 0;
+		first[order[i]] = same ? first[order[i - 1]] : order[i];
+	}
+
+	// Numbered in the order they turn up in the file, so the input order is still the file's
+	m_lods.resize(1);
+	MeshLodType& lod = m_lods[0];
+	lod.indices.resize(vertexCount);
+	lod.error = 0.0f;
+	lod.vertexCount = 0;
+
+	std::vector<unsigned int> remap(vertexCount, NO_VERTEX);
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		unsigned int& index = remap[first[i]];
+		if (index == NO_VERTEX)
+		{
+			index = (unsigned int)m_vertices.size();
+			m_vertices.push_back(raw[i]);
+		}
+
+		lod.indices[i] = index;
+	}
+
+	lod.vertexCount = (unsigned int)m_vertices.size();
+	CalculateBounds();
+
+	return true;
+}
+
+void MeshBuilderClass::CalculateBounds()
+{
+	XMVECTOR low = XMVectorReplicate(3.0e38f);
+	XMVECTOR high = XMVectorReplicate(-3.0e38f);
+	for (size_t i = 0; i < m_vertices.size(); ++i)
+	{
+		XMVECTOR position = XMLoadFloat3(&m_vertices[i].position);
+		low = XMVectorMin(low, position);
+		high = XMVectorMax(high, position);
+	}
+
+	XMVECTOR center = XMVectorScale(XMVectorAdd(low, high), 0.5f);
+
+	float radius = 0.0f;
+	for (size_t i = 0; i < m_vertices.size(); ++i)
+	{
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&m_vertices[i].position), center)));
+		radius = distance > radius ? distance : radius;
+	}
+
+	XMStoreFloat3(&m_boundsMin, low);
+	XMStoreFloat3(&m_boundsMax, high);
+	XMStoreFloat3(&m_boundsCenter, center);
+	m_boundsRadius = radius;
+}
+
+void MeshBuilderClass::OptimizeVertexCache()
+{
+	for (MeshLodType& lod : m_lods)
+		OptimizeVertexCache(lod.indices);
+}
+
+void MeshBuilderClass::OptimizeOverdraw(float threshold)
+{
+	for (MeshLodType& lod : m_lods)
+		OptimizeOverdraw(lod.indices, threshold);
+}
+
+void MeshBuilderClass::OptimizeVertexCache(std::vector<unsigned int>& indices)
+{
+	const unsigned int vertexCount = (unsigned int)m_vertices.size();
+	const unsigned int triangleCount = (unsigned int)indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles using each vertex, the first remaining[v] entries of its range are the ones not drawn yet
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < indices.size(); ++i)
+		++remaining[indices[i]];
+
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); ++i)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	for (unsigned int t = 0; t < triangleCount; ++t)
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	// Room for the cache plus the three vertices pushed in at the front before the tail drops off
+	unsigned int cache[MESH_CACHE_SIZE + 3];
+	unsigned int newCache[MESH_CACHE_SIZE + 3];
+	int cacheCount = 0;
+	unsigned int nextUnemitted = 0;
+	int best = -1;
+
+	for (unsigned int drawn = 0; drawn < triangleCount; ++drawn)
+	{
+		// Nothing in the cache leads anywhere, start again at the first triangle that hasn't been drawn
+		if (best < 0)
+		{
+			while (emitted[nextUnemitted])
+				++nextUnemitted;
+			best = (int)nextUnemitted;
+		}
+
+		const unsigned int* triangle = &indices[best * 3];
+		emitted[best] = true;
+
+		int newCount = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned int v = triangle[k];
+			result.push_back(v);
+
+			// Take the triangle off the vertex's live list
+			unsigned int* live = &adjacency[offsets[v]];
+			for (unsigned int j = 0; j < remaining[v]; ++j)
+			{
+				if (live[j] == (unsigned int)best)
+				{
+					live[j] = live[remaining[v] - 1];
+					break;
+				}
+			}
+			--remaining[v];
+
+			newCache[newCount++] = v;
+		}
+
+		// Old contents behind the new triangle, minus the vertices that just moved to the front
+		for (int i = 0; i < cacheCount; ++i)
+		{
+			const unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache[newCount++] = v;
+		}
+
+		// Rescore everything whose position changed, including what fell out the back, and the triangles around them
+		for (int i = 0; i < newCount; ++i)
+		{
+			const unsigned int v = newCache[i];
+			cachePosition[v] = i < MESH_CACHE_SIZE ? i : -1;
+
+			float score = VertexScore(cachePosition[v], remaining[v]);
+			float change = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			for (unsigned int j = 0; j < remaining[v]; ++j)
+				triangleScores[adjacency[offsets[v] + j]] += change;
+		}
+
+		cacheCount = newCount < MESH_CACHE_SIZE ? newCount : MESH_CACHE_SIZE;
+		memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+
+		// Next triangle is the best one touching the cache
+		best = -1;
+		float bestScore = -1.0e30f;
+		for (int i = 0; i < cacheCount; ++i)
+		{
+			const unsigned int v = cache[i];
+			for (unsigned int j = 0; j < remaining[v]; ++j)
+			{
+				const unsigned int t = adjacency[offsets[v] + j];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					best = (int)t;
+				}
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+void MeshBuilderClass::OptimizeOverdraw(std::vector<unsigned int>& indices, float threshold)
+{
+	const unsigned int vertexCount = (unsigned int)m_vertices.size();
+	const unsigned int triangleCount = (unsigned int)indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	const float cacheAcmr = CalculateAcmr(indices, vertexCount, MESH_MEASURE_CACHE_SIZE);
+
+	// Fifo simulation with time stamps: a vertex is in the cache if it went in less than a cache size of misses ago
+	std::vector<unsigned int> stamps(vertexCount, 0);
+	unsigned int time = MESH_MEASURE_CACHE_SIZE + 1;
+	auto misses = [&](unsigned int t)
+	{
+		unsigned int count = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned int v = indices[t * 3 + k];
+			if (time - stamps[v] > (unsigned int)MESH_MEASURE_CACHE_SIZE)
+			{
+				stamps[v] = time++;
+				++count;
+			}
+		}
+		return count;
+	};
+
+	// Hard boundaries where all three vertices miss, the cache order has jumped to a new patch there anyway
+	std::vector<unsigned int> hard;
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		if (misses(t) == 3 || t == 0)
+			hard.push_back(t);
+	}
+	hard.push_back(triangleCount);
+
+	// Soft boundaries inside those: start over with a cold cache and cut as soon as the piece so far is as cache
+	// friendly as the threshold allows. Every piece then pays for its own cold start, so drawing them in any order
+	// costs about the same (Sander, Nehab and Barczak, "Fast triangle reordering for vertex locality and reduced overdraw")
+	std::vector<unsigned int> clusters;
+	for (size_t h = 0; h + 1 < hard.size(); ++h)
+	{
+		unsigned int start = hard[h];
+		unsigned int clusterMisses = 0;
+		time += MESH_MEASURE_CACHE_SIZE + 1;
+		clusters.push_back(start);
+
+		for (unsigned int t = hard[h]; t < hard[h + 1]; ++t)
+		{
+			clusterMisses += misses(t);
+			if (t + 1 < hard[h + 1] && (float)clusterMisses <= cacheAcmr * threshold * (float)(t + 1 - start))
+			{
+				start = t + 1;
+				clusterMisses = 0;
+				time += MESH_MEASURE_CACHE_SIZE + 1;
+				clusters.push_back(start);
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// Occlusion potential: how far out the cluster sits along its own facing direction. Outer, outward facing
+	// clusters cover inner ones from most directions so they should go first
+	const unsigned int clusterCount = (unsigned int)clusters.size() - 1;
+	std::vector<XMFLOAT3> centroids(clusterCount);
+	std::vector<XMFLOAT3> normals(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for (unsigned int cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (unsigned int t = clusters[cluster]; t < clusters[cluster + 1]; ++t)
+		{
+			XMVECTOR a = XMLoadFloat3(&m_vertices[indices[t * 3]].position);
+			XMVECTOR b = XMLoadFloat3(&m_vertices[indices[t * 3 + 1]].position);
+			XMVECTOR c = XMLoadFloat3(&m_vertices[indices[t * 3 + 2]].position);
+
+			// Length is twice the area, so the sums below are area weighted
+			XMVECTOR cross = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+			float weight = XMVectorGetX(XMVector3Length(cross));
+
+			centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c), weight / 3.0f));
+			normal = XMVectorAdd(normal, cross);
+			area += weight;
+		}
+
+		meshCentroid = XMVectorAdd(meshCentroid, centroid);
+		meshArea += area;
+
+		XMStoreFloat3(&centroids[cluster], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&normals[cluster], XMVector3Normalize(normal));
+	}
+
+	meshCentroid = meshArea > 0.0f ? XMVectorScale(meshCentroid, 1.0f / meshArea) : meshCentroid;
+
+	std::vector<float> keys(clusterCount);
+	std::vector<unsigned int> order(clusterCount);
+	for (unsigned int cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		keys[cluster] = XMVectorGetX(XMVector3Dot(XMVectorSubtract(XMLoadFloat3(&centroids[cluster]), meshCentroid), XMLoadFloat3(&normals[cluster])));
+		order[cluster] = cluster;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&keys](unsigned int a, unsigned int b) { return keys[a] > keys[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (unsigned int i = 0; i < clusterCount; ++i)
+		result.insert(result.end(), indices.begin() + clusters[order[i]] * 3, indices.begin() + clusters[order[i] + 1] * 3);
+
+	// The clusters should have kept it within the threshold, but don't trade away more cache hits than that
+	if (CalculateAcmr(result, vertexCount, MESH_MEASURE_CACHE_SIZE) <= cacheAcmr * threshold)
+		indices.swap(result);
+}
+
+void MeshBuilderClass::OptimizeVertexFetch()
+{
+	/*
+		Renumber in order of first use, vertices no triangle uses go away. Collapses only ever drop vertices,
+		so every LOD uses a subset of the vertices of the one before it. Numbering from the coarsest LOD up
+		puts each LOD's vertices at the front of the buffer, LOD n only ever touches the first vertexCount of them
+	*/
+	std::vector<unsigned int> remap(m_vertices.size(), NO_VERTEX);
+	std::vector<SourceVertexType> vertices;
+	vertices.reserve(m_vertices.size());
+
+	for (size_t lod = m_lods.size(); lod-- > 0;)
+	{
+		const std::vector<unsigned int>& indices = m_lods[lod].indices;
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			unsigned int& index = remap[indices[i]];
+			if (index == NO_VERTEX)
+			{
+				index = (unsigned int)vertices.size();
+				vertices.push_back(m_vertices[indices[i]]);
+			}
+		}
+
+		m_lods[lod].vertexCount = (unsigned int)vertices.size();
+	}
+
+	for (MeshLodType& lod : m_lods)
+	{
+		for (size_t i = 0; i < lod.indices.size(); ++i)
+			lod.indices[i] = remap[lod.indices[i]];
+	}
+
+	m_vertices.swap(vertices);
+}
+
+void MeshBuilderClass::GenerateLods(int maxLods)
+{
+	if (m_lods.empty())
+		return;
+
+	m_lods.resize(1);
+	const std::vector<unsigned int>& full = m_lods[0].indices;
+
+	// Area weighted quadrics from the full mesh, carried down the chain so every LOD's error is measured against the original surface
+	std::vector<QuadricType> quadrics(m_vertices.size());
+	for (size_t t = 0; t + 2 < full.size(); t += 3)
+	{
+		const XMFLOAT3& a = m_vertices[full[t]].position;
+		XMVECTOR normal = TriangleNormal(a, m_vertices[full[t + 1]].position, m_vertices[full[t + 2]].position);
+		const float area = XMVectorGetX(XMVector3Length(normal)) * 0.5f;
+		if (area == 0.0f)
+			continue;
+
+		XMFLOAT3 plane;
+		XMStoreFloat3(&plane, XMVector3Normalize(normal));
+		const double d = -(plane.x * a.x + plane.y * a.y + plane.z * a.z);
+		for (int k = 0; k < 3; ++k)
+			AddPlane(quadrics[full[t + k]], plane.x, plane.y, plane.z, d, area);
+	}
+
+	std::vector<bool> locked;
+	FindLockedVertices(locked);
+
+	const float maxError = MESH_LOD_MAX_ERROR * m_boundsRadius;
+	const int levels = maxLods < MESH_MAX_LODS ? maxLods : MESH_MAX_LODS;
+
+	for (int level = 1; level < levels; ++level)
+	{
+		const unsigned int previousIndices = (unsigned int)m_lods.back().indices.size();
+		if (previousIndices / 3 <= (unsigned int)MESH_LOD_MIN_TRIANGLES)
+			break;
+
+		MeshLodType lod;
+		float error = Simplify(m_lods.back().indices, (unsigned int)(previousIndices / 3 * MESH_LOD_REDUCTION) * 3, maxError, quadrics, locked, lod.indices);
+		lod.error = error > m_lods.back().error ? error : m_lods.back().error;
+		lod.vertexCount = CountVertices(lod.indices, m_vertices.size());
+
+		// Not worth a level of its own if the simplifier ran out of things it's allowed to collapse
+		if ((float)lod.indices.size() > (float)previousIndices * MESH_LOD_MIN_REDUCTION)
+			break;
+
+		m_lods.push_back(lod);
+	}
+}
+
+void MeshBuilderClass::FindLockedVertices(std::vector<bool>& locked)
+{
+	/*
+		Vertices that must not move: ones on a seam, where the same position has been split into several vertices
+		for different uvs or normals (moving one copy would tear the surface open), and ones on an open border,
+		where an edge has a triangle on one side only (moving them eats into the outline)
+	*/
+	const unsigned int vertexCount = (unsigned int)m_vertices.size();
+	std::vector<unsigned int> order(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; ++i)
+		order[i] = i;
+
+	std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b)
+	{
+		int difference = memcmp(&m_vertices[a].position, &m_vertices[b].position, sizeof(XMFLOAT3));
+		return difference != 0 ? difference < 0 : a < b;
+	});
+
+	std::vector<unsigned int> positionId(vertexCount);
+	std::vector<bool> lockedPosition(vertexCount, false);
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		bool same = i > 0 && memcmp(&m_vertices[order[i]].position, &m_vertices[order[i - 1]].position, sizeof(XMFLOAT3)) == 0;
+		positionId[order[i]] = same ? positionId[order[i - 1]] : order[i];
+		if (same)
+			lockedPosition[positionId[order[i]]] = true;
+	}
+
+	// Directed edges between positions, a border edge is one whose reverse isn't there
+	const std::vector<unsigned int>& indices = m_lods[0].indices;
+	std::vector<unsigned long long> edges;
+	edges.reserve(indices.size());
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned long long from = positionId[indices[t + k]];
+			const unsigned long long to = positionId[indices[t + (k + 1) % 3]];
+			edges.push_back(from << 32 | to);
+		}
+	}
+
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size(); ++i)
+	{
+		const unsigned long long reverse = (edges[i] & 0xFFFFFFFFull) << 32 | edges[i] >> 32;
+		if (std::binary_search(edges.begin(), edges.end(), reverse) == false)
+		{
+			lockedPosition[(size_t)(edges[i] >> 32)] = true;
+			lockedPosition[(size_t)(edges[i] & 0xFFFFFFFFull)] = true;
+		}
+	}
+
+	locked.resize(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		locked[v] = lockedPosition[positionId[v]];
+}
+
+float MeshBuilderClass::Simplify(const std::vector<unsigned int>& source, unsigned int targetIndexCount, float maxError,
+	std::vector<QuadricType>& quadrics, const std::vector<bool>& locked, std::vector<unsigned int>& result)
+{
+	/*
+		Garland and Heckbert's quadric error metric with half edge collapses: a vertex is merged into one of its
+		neighbours and disappears, nothing new is created, so the LOD can share the full mesh's vertex buffer.
+		Each pass scores every collapse, then takes them cheapest first as long as they don't overlap
+		(a vertex and its ring change at most once per pass) or flip a triangle over. Passes repeat until the
+		target is reached or the next collapse would cost more than maxError
+	*/
+	const unsigned int vertexCount = (unsigned int)m_vertices.size();
+	const double maxCost = (double)maxError * (double)maxError;
+	float error = 0.0f;
+
+	result = source;
+
+	std::vector<CollapseType> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<unsigned int> counts(vertexCount);
+	std::vector<unsigned int> offsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+
+	while (result.size() > targetIndexCount)
+	{
+		// Triangles around each vertex, for the flip test
+		std::fill(counts.begin(), counts.end(), 0);
+		for (size_t i = 0; i < result.size(); ++i)
+			++counts[result[i]];
+
+		offsets[0] = 0;
+		for (unsigned int v = 0; v < vertexCount; ++v)
+			offsets[v + 1] = offsets[v] + counts[v];
+
+		adjacency.resize(result.size());
+		std::fill(counts.begin(), counts.end(), 0);
+		for (size_t i = 0; i < result.size(); ++i)
+			adjacency[offsets[result[i]] + counts[result[i]]++] = (unsigned int)(i / 3);
+
+		// Both directions of every edge, interior edges turn up twice but that doesn't hurt
+		collapses.clear();
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				const unsigned int a = result[t + k];
+				const unsigned int b = result[t + (k + 1) % 3];
+				for (int direction = 0; direction < 2; ++direction)
+				{
+					CollapseType collapse;
+					collapse.from = direction == 0 ? a : b;
+					collapse.to = direction == 0 ? b : a;
+					if (locked[collapse.from])
+						continue;
+
+					QuadricType merged = quadrics[collapse.from];
+					AddQuadric(merged, quadrics[collapse.to]);
+					collapse.cost = QuadricError(merged, m_vertices[collapse.to].position);
+					collapses.push_back(collapse);
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const CollapseType& a, const CollapseType& b) { return a.cost < b.cost; });
+
+		for (unsigned int v = 0; v < vertexCount; ++v)
+			remap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		const unsigned int needed = (unsigned int)(result.size() - targetIndexCount) / 3;
+		unsigned int removed = 0;
+
+		for (size_t i = 0; i < collapses.size() && removed < needed; ++i)
+		{
+			const CollapseType& collapse = collapses[i];
+			if (collapse.cost > maxCost)
+				break;
+
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// Every triangle that keeps its area has to keep facing the same way once from sits where to is
+			const unsigned int* around = &adjacency[offsets[collapse.from]];
+			const unsigned int aroundCount = offsets[collapse.from + 1] - offsets[collapse.from];
+			bool flips = false;
+			unsigned int degenerate = 0;
+			for (unsigned int j = 0; j < aroundCount && flips == false; ++j)
+			{
+				const unsigned int* triangle = &result[around[j] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					++degenerate;
+					continue;
+				}
+
+				XMFLOAT3 corners[3];
+				for (int k = 0; k < 3; ++k)
+					corners[k] = m_vertices[triangle[k] == collapse.from ? collapse.to : triangle[k]].position;
+
+				XMVECTOR before = TriangleNormal(m_vertices[triangle[0]].position, m_vertices[triangle[1]].position, m_vertices[triangle[2]].position);
+				XMVECTOR after = TriangleNormal(corners[0], corners[1], corners[2]);
+				flips = XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f;
+			}
+
+			if (flips)
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			float collapseError = (float)sqrt(collapse.cost > 0.0 ? collapse.cost : 0.0);
+			error = collapseError > error ? collapseError : error;
+			removed += degenerate;
+
+			// The whole ring is off limits for the rest of the pass, its triangles were only checked against this collapse
+			for (unsigned int j = 0; j < aroundCount; ++j)
+			{
+				for (int k = 0; k < 3; ++k)
+					touched[result[around[j] * 3 + k]] = true;
+			}
+		}
+
+		if (removed == 0)
+			break;
+
+		// Apply the pass, triangles that lost an edge go
+		size_t write = 0;
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			const unsigned int a = remap[result[t]];
+			const unsigned int b = remap[result[t + 1]];
+			const unsigned int c = remap[result[t + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	return error;
+}
+
+int MeshBuilderClass::GetLodCount()
+{
+	return (int)m_lods.size();
+}
+
+unsigned int MeshBuilderClass::GetLodTriangles(int lod)
+{
+	return (unsigned int)m_lods[lod].indices.size() / 3;
+}
+
+unsigned int MeshBuilderClass::GetLodVertices(int lod)
+{
+	return m_lods[lod].vertexCount;
+}
+
+float MeshBuilderClass::GetLodError(int lod)
+{
+	return m_lods[lod].error;
+}
+
+void MeshBuilderClass::Quantize()
+{
+	const float* low = &m_boundsMin.x;
+	const float* high = &m_boundsMax.x;
+	float scale[3];
+	for (int k = 0; k < 3; ++k)
+		scale[k] = high[k] > low[k] ? high[k] - low[k] : 1.0f;
+
+	m_quantized.resize(m_vertices.size());
+	for (size_t i = 0; i < m_vertices.size(); ++i)
+	{
+		const SourceVertexType& source = m_vertices[i];
+		MeshVertexType& vertex = m_quantized[i];
+
+		const float* position = &source.position.x;
+		for (int k = 0; k < 3; ++k)
+		{
+			float unit = (position[k] - low[k]) / scale[k];
+			unit = unit < 0.0f ? 0.0f : (unit > 1.0f ? 1.0f : unit);
+			vertex.position[k] = (unsigned short)(unit * 65535.0f + 0.5f);
+		}
+		vertex.position[3] = 0;
+
+		EncodeOctahedral(source.normal, vertex.normal);
+
+		vertex.texture[0] = XMConvertFloatToHalf(source.texture.x);
+		vertex.texture[1] = XMConvertFloatToHalf(source.texture.y);
+	}
+}
+
+bool MeshBuilderClass::Write(const char* filename)
+{
+	if (m_lods.empty())
+		return false;
+
+	CalculateBounds();
+	Quantize();
+
+	const unsigned int vertexCount = (unsigned int)m_quantized.size();
+	const bool shortIndices = vertexCount <= 0x10000;
+
+	MeshFileHeaderType header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.formatId = MeshVertexFormat::id;
+	header.vertexStride = MeshVertexFormat::stride;
+	header.vertexCount = vertexCount;
+	header.indexSize = shortIndices ? 2 : 4;
+	header.lodCount = (unsigned int)m_lods.size();
+
+	// All the LODs' indices in one block, finest first
+	std::vector<unsigned int> indices;
+	for (size_t i = 0; i < m_lods.size(); ++i)
+	{
+		MeshLodHeaderType& lod = header.lods[i];
+		lod.firstIndex = (unsigned int)indices.size();
+		lod.indexCount = (unsigned int)m_lods[i].indices.size();
+		lod.vertexCount = m_lods[i].vertexCount;
+		lod.error = m_lods[i].error;
+		indices.insert(indices.end(), m_lods[i].indices.begin(), m_lods[i].indices.end());
+	}
+
+	header.indexCount = (unsigned int)indices.size();
+	header.vertexOffset = AlignOffset(sizeof(MeshFileHeaderType));
+	header.indexOffset = AlignOffset(header.vertexOffset + vertexCount * header.vertexStride);
+
+	const float* low = &m_boundsMin.x;
+	const float* high = &m_boundsMax.x;
+	for (int k = 0; k < 3; ++k)
+	{
+		header.positionScale[k] = high[k] > low[k] ? high[k] - low[k] : 1.0f;
+		header.positionBias[k] = low[k];
+	}
+	header.boundsCenter[0] = m_boundsCenter.x;
+	header.boundsCenter[1] = m_boundsCenter.y;
+	header.boundsCenter[2] = m_boundsCenter.z;
+	header.boundsRadius = m_boundsRadius;
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "wb") != 0 || file == nullptr)
+		return false;
+
+	bool result = fwrite(&header, sizeof(header), 1, file) == 1;
+	result = result && WritePadding(file, header.vertexOffset);
+	result = result && (vertexCount == 0 || fwrite(&m_quantized[0], header.vertexStride, vertexCount, file) == vertexCount);
+	result = result && WritePadding(file, header.indexOffset);
+
+	if (shortIndices)
+	{
+		std::vector<unsigned short> shortened(indices.begin(), indices.end());
+		result = result && fwrite(&shortened[0], sizeof(unsigned short), shortened.size(), file) == shortened.size();
+	}
+	else
+	{
+		result = result && fwrite(&indices[0], sizeof(unsigned int), indices.size(), file) == indices.size();
+	}
+
+	fclose(file);
+	return result;
+}
+
+void MeshBuilderClass::Measure(MeshStatsType& stats)
+{
+	const unsigned int vertexCount = (unsigned int)m_vertices.size();
+	const bool quantized = m_quantized.empty() == false;
+	static const std::vector<unsigned int> none;
+	const std::vector<unsigned int>& indices = m_lods.empty() ? none : m_lods[0].indices;
+
+	stats.vertexCount = vertexCount;
+	stats.triangleCount = (unsigned int)indices.size() / 3;
+	stats.acmr = CalculateAcmr(indices, vertexCount, MESH_MEASURE_CACHE_SIZE);
+	stats.atvr = vertexCount > 0 ? stats.acmr * (float)stats.triangleCount / (float)vertexCount : 0.0f;
+	stats.bytesPerVertex = quantized ? MeshVertexFormat::stride : SourceVertexFormat::stride;
+	stats.vertexBytes = stats.bytesPerVertex * vertexCount;
+	stats.indexBytes = (unsigned int)indices.size() * (quantized && vertexCount <= 0x10000 ? 2 : 4);
+	stats.overdraw = 0.0f;
+	stats.rasterMs = 0.0;
+	stats.rasterTrianglesPerSecond = 0.0;
+
+	if (indices.empty())
+		return;
+
+	// Rasterize what the gpu would see, so decode the quantized positions once it's been written
+	std::vector<XMFLOAT3> positions(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; ++i)
+	{
+		if (quantized)
+		{
+			const float* low = &m_boundsMin.x;
+			const float* high = &m_boundsMax.x;
+			float* position = &positions[i].x;
+			for (int k = 0; k < 3; ++k)
+				position[k] = (float)m_quantized[i].position[k] / 65535.0f * (high[k] > low[k] ? high[k] - low[k] : 1.0f) + low[k];
+		}
+		else
+		{
+			positions[i] = m_vertices[i].position;
+		}
+	}
+
+	// Orthographic views from the cube corners, each fitting the bounding sphere
+	const float radius = m_boundsRadius > 0.0f ? m_boundsRadius : 1.0f;
+	const XMVECTOR center = XMLoadFloat3(&m_boundsCenter);
+	XMMATRIX transforms[MESH_RASTER_VIEWS];
+	for (int view = 0; view < MESH_RASTER_VIEWS; ++view)
+	{
+		XMVECTOR direction = XMVector3Normalize(XMVectorSet(view & 1 ? 1.0f : -1.0f, view & 2 ? 1.0f : -1.0f, view & 4 ? 1.0f : -1.0f, 0.0f));
+		XMVECTOR eye = XMVectorSubtract(center, XMVectorScale(direction, radius * 2.0f));
+		transforms[view] = XMMatrixLookAtLH(eye, center, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+			XMMatrixOrthographicLH(radius * 2.0f, radius * 2.0f, radius * 0.5f, radius * 3.5f);
+	}
+
+	SoftwareRasterizerClass raster;
+	if (raster.Initialize(MESH_RASTER_SIZE, MESH_RASTER_SIZE) == false)
+		return;
+
+	// Overdraw first, counting covered pixels after every view would land in the timing otherwise
+	unsigned long long covered = 0;
+	for (int view = 0; view < MESH_RASTER_VIEWS; ++view)
+	{
+		raster.Clear();
+		raster.DrawIndexed(&positions[0], &indices[0], (unsigned int)indices.size(), transforms[view]);
+		covered += raster.CountCoveredPixels();
+	}
+	stats.overdraw = covered > 0 ? (float)raster.GetStats().pixelsWritten / (float)covered : 0.0f;
+
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	for (int pass = 0; pass < MESH_RASTER_PASSES; ++pass)
+	{
+		for (int view = 0; view < MESH_RASTER_VIEWS; ++view)
+		{
+			raster.Clear();
+			raster.DrawIndexed(&positions[0], &indices[0], (unsigned int)indices.size(), transforms[view]);
+		}
+	}
+
+	QueryPerformanceCounter(&end);
+	raster.Shutdown();
+
+	const double seconds = (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+	stats.rasterMs = seconds * 1000.0 / MESH_RASTER_PASSES;
+	stats.rasterTrianglesPerSecond = seconds > 0.0 ? (double)stats.triangleCount * MESH_RASTER_VIEWS * MESH_RASTER_PASSES / seconds : 0.0;
+}
+
+float MeshBuilderClass::CalculateAcmr(const std::vector<unsigned int>& indices, unsigned int vertexCount, int cacheSize)
+{
+	if (indices.size() < 3)
+		return 0.0f;
+
+	// Same time stamp fifo as OptimizeOverdraw
+	std::vector<unsigned int> stamps(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	unsigned int misses = 0;
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		if (time - stamps[indices[i]] > (unsigned int)cacheSize)
+		{
+			stamps[indices[i]] = time++;
+			++misses;
+		}
+	}
+
+	return (float)misses / (float)(indices.size() / 3);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <directxmath.h>
+#include <string>
+#include <vector>
+#include "meshfile.h"
+#include "softwarerasterizerclass.h"
+
+using namespace DirectX;
+
+/*
+	Offline mesh build step, run with -buildmesh <model.txt> <output.mesh> [-out report.txt].
+	Reads a model in the tutorials' text format (a vertex count, then x y z tu tv nx ny nz for three vertices per
+	triangle), welds the duplicate vertices into an indexed mesh and then:
+		- simplifies it into a LOD chain, each level about MESH_LOD_REDUCTION of the one before, all of them
+		  sharing one vertex buffer (quadric error edge collapses, seams and open borders stay put)
+		- orders every LOD's triangles for the post transform vertex cache (Forsyth's linear speed algorithm)
+		- splits that order into clusters where the cache starts over and sorts the clusters outside in, so
+		  triangles that are likely to occlude others go first. Kept only if the cache order doesn't get
+		  more than MESH_OVERDRAW_THRESHOLD worse
+		- orders vertices by first use, coarsest LOD first, so fetches walk the vertex buffer forwards and
+		  every LOD only touches the front of it
+		- quantizes to MeshVertexFormat: 16 bit positions with a per mesh scale and bias, octahedral normals, half uvs
+	and writes the mesh file. The report compares the welded input with the result: ACMR and ATVR for a 16 entry
+	fifo cache, bytes per vertex, and a run through SoftwareRasterizerClass from MESH_RASTER_VIEWS directions
+	for overdraw and triangles per second. Then the LOD chain with each level's error.
+*/
+
+const int MESH_CACHE_SIZE = 32; // what the vertex cache ordering assumes, bigger than any real cache so it suits all of them
+const int MESH_MEASURE_CACHE_SIZE = RASTER_VERTEX_CACHE_SIZE; // what the ACMR in the report is for
+const float MESH_OVERDRAW_THRESHOLD = 1.05f;
+const int MESH_RASTER_SIZE = 512;
+const int MESH_RASTER_VIEWS = 8;
+const int MESH_RASTER_PASSES = 4; // repeats of every view for a steadier timing
+const float MESH_LOD_REDUCTION = 0.5f; // triangles of each LOD relative to the one before
+const float MESH_LOD_MIN_REDUCTION = 0.8f; // a LOD that can't get below this much of the one before isn't worth keeping
+const float MESH_LOD_MAX_ERROR = 0.25f; // fraction of the bounding radius the surface may move (rms), the chain stops there, far away that is still under a pixel
+const int MESH_LOD_MIN_TRIANGLES = 32; // nothing coarser than this
+const char* const MESH_DEFAULT_REPORT = "mesh_build.txt";
+
+// One vertex as it comes out of the model file
+struct SourceVertexType
+{
+	XMFLOAT3 position;
+	XMFLOAT2 texture;
+	XMFLOAT3 normal;
+};
+
+// Symmetric 4x4 matrix, the sum of the squared distance functions of a set of planes, each weighted by its triangle's area
+struct QuadricType
+{
+	double xx, xy, xz, xw;
+	double yy, yz, yw;
+	double zz, zw;
+	double ww;
+	double weight; // total area, errors are divided by it so they come out as an rms distance
+};
+
+struct MeshStatsType
+{
+	unsigned int vertexCount;
+	unsigned int triangleCount;
+	float acmr; // vertex transforms per triangle
+	float atvr; // vertex transforms per vertex, 1 is perfect
+	unsigned int bytesPerVertex;
+	unsigned int vertexBytes;
+	unsigned int indexBytes;
+	float overdraw; // pixels written per pixel covered
+	double rasterMs;
+	double rasterTrianglesPerSecond;
+};
+
+class MeshBuilderClass
+{
+private:
+	struct MeshLodType
+	{
+		std::vector<unsigned int> indices;
+		unsigned int vertexCount; // distinct vertices used
+		float error; // model space
+	};
+
+	struct CollapseType
+	{
+		unsigned int from;
+		unsigned int to;
+		double cost;
+	};
+
+public:
+	MeshBuilderClass();
+	MeshBuilderClass(const MeshBuilderClass&);
+	~MeshBuilderClass();
+
+	// The whole -buildmesh step, returns the process exit code, 0 = fine, 2 = couldn't read or write something
+	static int Build(const std::string&, const std::string&, const std::string&);
+
+	bool LoadModel(const char*);
+	// Same as LoadModel for geometry made in code, three vertices per triangle
+	bool LoadTriangles(const std::vector<SourceVertexType>&);
+	// Up to the given number of levels including the full mesh
+	void GenerateLods(int);
+	void OptimizeVertexCache();
+	void OptimizeOverdraw(float);
+	void OptimizeVertexFetch();
+	bool Write(const char*);
+
+	// Stats for LOD 0, quantized if the mesh has been written already
+	void Measure(MeshStatsType&);
+
+	int GetLodCount();
+	unsigned int GetLodTriangles(int);
+	unsigned int GetLodVertices(int);
+	float GetLodError(int);
+
+	static float CalculateAcmr(const std::vector<unsigned int>&, unsigned int, int);
+
+private:
+	void OptimizeVertexCache(std::vector<unsigned int>&);
+	void OptimizeOverdraw(std::vector<unsigned int>&, float);
+	void FindLockedVertices(std::vector<bool>&);
+	float Simplify(const std::vector<unsigned int>&, unsigned int, float, std::vector<QuadricType>&, const std::vector<bool>&, std::vector<unsigned int>&);
+	void Quantize();
+	void CalculateBounds();
+
+private:
+	std::vector<SourceVertexType> m_vertices;
+	std::vector<MeshLodType> m_lods; // 0 is the full mesh
+	std::vector<MeshVertexType> m_quantized; // empty until Write
+	XMFLOAT3 m_boundsMin;
+	XMFLOAT3 m_boundsMax;
+	XMFLOAT3 m_boundsCenter;
+	float m_boundsRadius;
+};
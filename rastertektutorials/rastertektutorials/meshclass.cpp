@@ -0,0 +1,168 @@
+#include "meshclass.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+MeshClass::MeshClass() :
+	m_vertexBuffer(nullptr),
+	m_indexBuffer(nullptr),
+	m_indexFormat(DXGI_FORMAT_R16_UINT)
+{
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+MeshClass::MeshClass(const MeshClass&)
+{
+}
+
+MeshClass::~MeshClass()
+{
+}
+
+bool MeshClass::Initialize(ID3D11Device* device, const char* filename)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "rb") != 0 || file == nullptr)
+		return false;
+
+	// Read the whole thing, it's laid out so the blocks can go to the buffers as they are
+	std::vector<char> contents;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		contents.insert(contents.end(), buffer, buffer + read);
+	fclose(file);
+
+	if (contents.size() < sizeof(MeshFileHeaderType))
+		return false;
+
+	memcpy(&m_header, &contents[0], sizeof(m_header));
+
+	if (m_header.magic != MESH_FILE_MAGIC || m_header.version != MESH_FILE_VERSION)
+		return false;
+
+	if (m_header.formatId != MeshVertexFormat::id || m_header.vertexStride != MeshVertexFormat::stride)
+		return false;
+
+	if (m_header.indexSize != 2 && m_header.indexSize != 4)
+		return false;
+
+	if (m_header.lodCount < 1 || m_header.lodCount > (unsigned int)MESH_MAX_LODS)
+		return false;
+
+	for (unsigned int i = 0; i < m_header.lodCount; ++i)
+	{
+		const MeshLodHeaderType& lod = m_header.lods[i];
+		// Not firstIndex + indexCount, a bad header could wrap that round to something small
+		if (lod.firstIndex > m_header.indexCount || lod.indexCount > m_header.indexCount - lod.firstIndex || lod.vertexCount > m_header.vertexCount)
+			return false;
+	}
+
+	const size_t vertexBytes = (size_t)m_header.vertexCount * m_header.vertexStride;
+	const size_t indexBytes = (size_t)m_header.indexCount * m_header.indexSize;
+	if (vertexBytes == 0 || indexBytes == 0 || m_header.vertexOffset + vertexBytes > contents.size() || m_header.indexOffset + indexBytes > contents.size())
+		return false;
+
+	m_indexFormat = m_header.indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+	D3D11_BUFFER_DESC vertexBufferDesc;
+	vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	vertexBufferDesc.ByteWidth = (UINT)vertexBytes;
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = 0;
+	vertexBufferDesc.MiscFlags = 0;
+	vertexBufferDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA vertexData;
+	vertexData.pSysMem = &contents[m_header.vertexOffset];
+	vertexData.SysMemPitch = 0;
+	vertexData.SysMemSlicePitch = 0;
+
+	if (FAILED(device->CreateBuffer(&vertexBufferDesc, &vertexData, &m_vertexBuffer)))
+		return false;
+
+	D3D11_BUFFER_DESC indexBufferDesc;
+	indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexBufferDesc.ByteWidth = (UINT)indexBytes;
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA indexData;
+	indexData.pSysMem = &contents[m_header.indexOffset];
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+
+	if (FAILED(device->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer)))
+		return false;
+
+	return true;
+}
+
+void MeshClass::Shutdown()
+{
+	if (m_indexBuffer)
+	{
+		m_indexBuffer->Release();
+		m_indexBuffer = nullptr;
+	}
+
+	if (m_vertexBuffer)
+	{
+		m_vertexBuffer->Release();
+		m_vertexBuffer = nullptr;
+	}
+}
+
+void MeshClass::Render(ID3D11DeviceContext* deviceContext)
+{
+	unsigned int stride = MeshVertexFormat::stride;
+	unsigned int offset = 0;
+
+	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	deviceContext->IASetIndexBuffer(m_indexBuffer, m_indexFormat, 0);
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+bool MeshClass::CreateInputLayout(ID3D11Device* device, const void* shaderBytecode, SIZE_T bytecodeLength, ID3D11InputLayout** layout)
+{
+	return SUCCEEDED(device->CreateInputLayout(MeshVertexFormat::GetInputLayout(), MeshVertexFormat::count, shaderBytecode, bytecodeLength, layout));
+}
+
+unsigned int MeshClass::GetIndexCount()
+{
+	return m_header.indexCount;
+}
+
+int MeshClass::GetLodCount()
+{
+	return (int)m_header.lodCount;
+}
+
+const MeshLodHeaderType& MeshClass::GetLod(int lod)
+{
+	const int last = (int)m_header.lodCount - 1;
+	return m_header.lods[lod < 0 ? 0 : (lod > last ? last : lod)];
+}
+
+unsigned int MeshClass::GetVertexCount()
+{
+	return m_header.vertexCount;
+}
+
+XMFLOAT3 MeshClass::GetPositionScale()
+{
+	return XMFLOAT3(m_header.positionScale[0], m_header.positionScale[1], m_header.positionScale[2]);
+}
+
+XMFLOAT3 MeshClass::GetPositionBias()
+{
+	return XMFLOAT3(m_header.positionBias[0], m_header.positionBias[1], m_header.positionBias[2]);
+}
+
+XMFLOAT4 MeshClass::GetBounds()
+{
+	return XMFLOAT4(m_header.boundsCenter[0], m_header.boundsCenter[1], m_header.boundsCenter[2], m_header.boundsRadius);
+}
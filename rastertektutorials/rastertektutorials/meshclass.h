@@ -0,0 +1,47 @@
+#pragma once
+
+#include <d3d11.h>
+#include <directxmath.h>
+#include "meshfile.h"
+
+using namespace DirectX;
+
+/*
+	A mesh built by -buildmesh with its LOD chain, loaded straight into immutable vertex and index buffers.
+	Vertices are MeshVertexFormat, the input layout comes from the same template so shaders only need
+	mesh.hlsli to decode positions (GetPositionScale/Bias go in their constant buffer) and normals.
+*/
+
+class MeshClass
+{
+public:
+	MeshClass();
+	MeshClass(const MeshClass&);
+	~MeshClass();
+
+	// False for missing files and for files from another version or vertex format, rebuild those
+	bool Initialize(ID3D11Device*, const char*);
+	void Shutdown();
+
+	// Binds the buffers, then it's DrawIndexed(lod.indexCount, lod.firstIndex, 0) for the LOD you want
+	void Render(ID3D11DeviceContext*);
+
+	// Input layout for a vertex shader that takes MeshVertexFormat
+	static bool CreateInputLayout(ID3D11Device*, const void*, SIZE_T, ID3D11InputLayout**);
+
+	unsigned int GetIndexCount();
+	int GetLodCount();
+	// Clamped to the coarsest LOD there is
+	const MeshLodHeaderType& GetLod(int);
+	unsigned int GetVertexCount();
+	XMFLOAT3 GetPositionScale();
+	XMFLOAT3 GetPositionBias();
+	// Bounding sphere in model space, xyz centre and w radius
+	XMFLOAT4 GetBounds();
+
+private:
+	ID3D11Buffer* m_vertexBuffer;
+	ID3D11Buffer* m_indexBuffer;
+	DXGI_FORMAT m_indexFormat;
+	MeshFileHeaderType m_header;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include "vertexformat.h"
+
+/*
+	Binary mesh files, written by MeshBuilderClass (-buildmesh) and read by MeshClass.
+	A MeshFileHeaderType, then the vertices in MeshVertexFormat, then the indices, each block starting on a
+	MESH_FILE_ALIGNMENT boundary so the file can be handed to the gpu without touching the data.
+	Indices are 16 bit unless the mesh has more vertices than that can address. The index block holds every LOD,
+	finest first. Coarser LODs only use vertices from the front of the buffer, so the vertex block is shared.
+	Bump MESH_FILE_VERSION whenever the header or the data layout changes, old files are rejected and need rebuilding.
+*/
+
+const unsigned int MESH_FILE_MAGIC = 0x4853454D; // "MESH"
+const unsigned int MESH_FILE_VERSION = 2; // 2: LOD chain
+const unsigned int MESH_FILE_ALIGNMENT = 16;
+const int MESH_MAX_LODS = 8;
+
+struct MeshLodHeaderType
+{
+	unsigned int firstIndex; // into the index block
+	unsigned int indexCount;
+	unsigned int vertexCount; // this LOD uses vertices [0, vertexCount)
+	float error; // how far the surface may have moved from the full mesh, model space
+};
+
+struct MeshFileHeaderType
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int formatId; // MeshVertexFormat::id of the writer
+	unsigned int vertexStride;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int indexSize; // 2 or 4 bytes
+	unsigned int vertexOffset; // bytes from the start of the file
+	unsigned int indexOffset;
+	float positionScale[3]; // position = quantized position * scale + bias
+	float positionBias[3];
+	float boundsCenter[3]; // bounding sphere in model space
+	float boundsRadius;
+	unsigned int lodCount;
+	MeshLodHeaderType lods[MESH_MAX_LODS];
+};
+
+// One vertex as it sits in the file and the vertex buffer
+struct MeshVertexType
+{
+	unsigned short position[4]; // unorm, w is padding
+	short normal[2]; // snorm octahedral
+	unsigned short texture[2]; // half floats
+};
+
+static_assert(sizeof(MeshVertexType) == MeshVertexFormat::stride, "MeshVertexType doesn't match MeshVertexFormat");
+static_assert(offsetof(MeshVertexType, position) == MeshVertexFormat::OffsetOf<PositionQuantized>(), "MeshVertexType doesn't match MeshVertexFormat");
+static_assert(offsetof(MeshVertexType, normal) == MeshVertexFormat::OffsetOf<NormalOctahedral>(), "MeshVertexType doesn't match MeshVertexFormat");
+static_assert(offsetof(MeshVertexType, texture) == MeshVertexFormat::OffsetOf<TexcoordHalf>(), "MeshVertexType doesn't match MeshVertexFormat");
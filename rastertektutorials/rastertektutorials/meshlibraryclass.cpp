@@ -0,0 +1,98 @@
+#include "meshlibraryclass.h"
+
+MeshLibraryClass::MeshLibraryClass()
+{
+}
+
+MeshLibraryClass::MeshLibraryClass(const MeshLibraryClass&)
+{
+}
+
+MeshLibraryClass::~MeshLibraryClass()
+{
+}
+
+bool MeshLibraryClass::Initialize()
+{
+	m_meshes.clear();
+	return true;
+}
+
+void MeshLibraryClass::Shutdown()
+{
+	for (MeshClass* mesh : m_meshes)
+	{
+		mesh->Shutdown();
+		delete mesh;
+	}
+	m_meshes.clear();
+}
+
+int MeshLibraryClass::Load(ID3D11Device* device, const char* filename)
+{
+	MeshClass* mesh = new MeshClass();
+	if (mesh == nullptr)
+		return -1;
+
+	if (mesh->Initialize(device, filename) == false)
+	{
+		mesh->Shutdown();
+		delete mesh;
+		return -1;
+	}
+
+	m_meshes.push_back(mesh);
+	return (int)m_meshes.size() - 1;
+}
+
+int MeshLibraryClass::GetMeshCount()
+{
+	return (int)m_meshes.size();
+}
+
+MeshClass* MeshLibraryClass::GetMesh(unsigned int mesh)
+{
+	return m_meshes.empty() ? nullptr : m_meshes[mesh % m_meshes.size()];
+}
+
+void MeshLibraryClass::GetLodChain(unsigned int id, LodChainType& chain)
+{
+	MeshClass* mesh = GetMesh(id);
+	chain.count = mesh != nullptr ? mesh->GetLodCount() : 1;
+	for (int lod = 0; lod < MESH_MAX_LODS; ++lod)
+	{
+		chain.triangles[lod] = mesh != nullptr && lod < chain.count ? mesh->GetLod(lod).indexCount / 3 : 0;
+		chain.error[lod] = mesh != nullptr && lod < chain.count ? mesh->GetLod(lod).error : 0.0f;
+	}
+}
+
+int MeshLibraryClass::Render(ID3D11DeviceContext* deviceContext, MeshShaderClass* shader, const std::vector<DrawItemType>& items, TextureStreamerClass* textures)
+{
+	if (m_meshes.empty())
+		return 0;
+
+	const int textureCount = textures != nullptr ? textures->GetTextureCount() : 0;
+	MeshClass* bound = nullptr;
+	int draws = 0;
+
+	for (const DrawItemType& item : items)
+	{
+		MeshClass* mesh = GetMesh(item.mesh);
+		if (mesh != bound)
+		{
+			mesh->Render(deviceContext);
+			bound = mesh;
+		}
+
+		ID3D11ShaderResourceView* texture = textureCount > 0 ? textures->GetView((int)(item.material % textureCount)) : nullptr;
+		if (shader->SetObjectParameters(deviceContext, XMLoadFloat4x4(&item.world), mesh, texture) == false)
+			return -1;
+
+		// GetLod clamps, a chain registered for a different file can't send it past the end
+		const MeshLodHeaderType& lod = mesh->GetLod((int)item.lod);
+		deviceContext->DrawIndexed(lod.indexCount, lod.firstIndex, 0);
+		++draws;
+	}
+
+	return draws;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+#include "drawitem.h"
+#include "lodselectorclass.h"
+#include "meshclass.h"
+#include "meshshaderclass.h"
+#include "texturestreamerclass.h"
+
+/*
+	The meshes the render thread draws, loaded from -buildmesh files. DrawItemType::mesh indexes them, wrapping round
+	when the scene uses more ids than there are files, the same way materials map onto the loaded textures.
+	Render issues one DrawIndexed per item for the LOD the scene picked, the buffers only get bound again when the mesh
+	changes and the scene sorts its items by mesh so that's once per mesh.
+*/
+
+class MeshLibraryClass
+{
+public:
+	MeshLibraryClass();
+	MeshLibraryClass(const MeshLibraryClass&);
+	~MeshLibraryClass();
+
+	bool Initialize();
+	void Shutdown();
+
+	// Returns the mesh's index or -1 if it isn't a mesh file this build can read
+	int Load(ID3D11Device*, const char*);
+	int GetMeshCount();
+	// Any mesh id, nullptr only when nothing is loaded
+	MeshClass* GetMesh(unsigned int);
+	// The LOD chain a mesh id draws with, for LodSelectorClass::SetChain
+	void GetLodChain(unsigned int, LodChainType&);
+
+	// Textures for the materials, nullptr for depth only. Returns the draws issued, -1 if the constants couldn't be written
+	int Render(ID3D11DeviceContext*, MeshShaderClass*, const std::vector<DrawItemType>&, TextureStreamerClass*);
+
+private:
+	std::vector<MeshClass*> m_meshes;
+};
@@ -0,0 +1,179 @@
+#include "meshshaderclass.h"
+
+MeshShaderClass::MeshShaderClass() :
+	m_ShaderCache(nullptr),
+	m_program(-1),
+	m_frameBuffer(nullptr),
+	m_objectBuffer(nullptr),
+	m_sampleState(nullptr)
+{
+}
+
+MeshShaderClass::MeshShaderClass(const MeshShaderClass&)
+{
+}
+
+MeshShaderClass::~MeshShaderClass()
+{
+}
+
+bool MeshShaderClass::Initialize(ShaderCacheClass* shaderCache, ID3D11Device* device, HWND hwnd)
+{
+	m_ShaderCache = shaderCache;
+	return InitializeShader(device, hwnd, "mesh.vs", "mesh.ps");
+}
+
+void MeshShaderClass::Shutdown()
+{
+	ShutdownShader();
+}
+
+bool MeshShaderClass::SetShaderParameters(ID3D11DeviceContext* deviceContext, XMMATRIX viewMatrix, XMMATRIX projectionMatrix)
+{
+	// Looked up every time, a reload may have swapped it since last frame
+	const ShaderProgramType* program = m_ShaderCache->GetProgram(m_program);
+	if (program == nullptr)
+		return false;
+
+	if (SetFrameBuffer(deviceContext, viewMatrix, projectionMatrix) == false)
+		return false;
+
+	deviceContext->IASetInputLayout(program->layout);
+	deviceContext->VSSetShader(program->vertexShader, nullptr, 0);
+	deviceContext->PSSetShader(program->pixelShader, nullptr, 0);
+	deviceContext->PSSetConstantBuffers(MESH_OBJECT_SLOT, 1, &m_objectBuffer);
+	deviceContext->PSSetSamplers(0, 1, &m_sampleState);
+	return true;
+}
+
+bool MeshShaderClass::SetDepthParameters(ID3D11DeviceContext* deviceContext, XMMATRIX viewProjectionMatrix)
+{
+	const ShaderProgramType* program = m_ShaderCache->GetProgram(m_program);
+	if (program == nullptr)
+		return false;
+
+	// The cascade matrix already goes from world to clip space, view is left out
+	if (SetFrameBuffer(deviceContext, XMMatrixIdentity(), viewProjectionMatrix) == false)
+		return false;
+
+	// Depth is all a caster writes, no pixel shader means the rasterizer skips that stage entirely
+	deviceContext->IASetInputLayout(program->layout);
+	deviceContext->VSSetShader(program->vertexShader, nullptr, 0);
+	deviceContext->PSSetShader(nullptr, nullptr, 0);
+	return true;
+}
+
+bool MeshShaderClass::SetObjectParameters(ID3D11DeviceContext* deviceContext, XMMATRIX worldMatrix, MeshClass* mesh, ID3D11ShaderResourceView* texture)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext->Map(m_objectBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		return false;
+
+	ObjectBufferType* data = (ObjectBufferType*)mappedResource.pData;
+	data->world = XMMatrixTranspose(worldMatrix);
+	data->positionScale = mesh->GetPositionScale();
+	data->textured = texture != nullptr ? 1.0f : 0.0f;
+	data->positionBias = mesh->GetPositionBias();
+	data->padding = 0.0f;
+	deviceContext->Unmap(m_objectBuffer, 0);
+
+	deviceContext->PSSetShaderResources(0, 1, &texture);
+	return true;
+}
+
+bool MeshShaderClass::SetFrameBuffer(ID3D11DeviceContext* deviceContext, XMMATRIX viewMatrix, XMMATRIX projectionMatrix)
+{
+	// Shaders want column major
+	viewMatrix = XMMatrixTranspose(viewMatrix);
+	projectionMatrix = XMMatrixTranspose(projectionMatrix);
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext->Map(m_frameBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		return false;
+
+	FrameBufferType* data = (FrameBufferType*)mappedResource.pData;
+	data->view = viewMatrix;
+	data->projection = projectionMatrix;
+	deviceContext->Unmap(m_frameBuffer, 0);
+
+	deviceContext->VSSetConstantBuffers(MESH_FRAME_SLOT, 1, &m_frameBuffer);
+	deviceContext->VSSetConstantBuffers(MESH_OBJECT_SLOT, 1, &m_objectBuffer);
+	return true;
+}
+
+bool MeshShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, const char* vsFilename, const char* psFilename)
+{
+	HRESULT result;
+
+	// Layout comes from the vertex format the mesh builder wrote the vertices with
+	m_program = m_ShaderCache->Load(vsFilename, "MeshVertexShader", psFilename, "MeshPixelShader", MeshVertexFormat::GetInputLayout(), MeshVertexFormat::count);
+	if (m_program < 0)
+	{
+		MessageBox(hwnd, "Error compiling shader.  Check shader-error.txt for message.", vsFilename, MB_OK);
+		return false;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = sizeof(FrameBufferType);
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	result = device->CreateBuffer(&bufferDesc, nullptr, &m_frameBuffer);
+	if (FAILED(result))
+		return false;
+
+	bufferDesc.ByteWidth = sizeof(ObjectBufferType);
+	result = device->CreateBuffer(&bufferDesc, nullptr, &m_objectBuffer);
+	if (FAILED(result))
+		return false;
+
+	// Wrap, the mesh builder's uvs are free to tile
+	D3D11_SAMPLER_DESC samplerDesc;
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.MipLODBias = 0.0f;
+	samplerDesc.MaxAnisotropy = 1;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+	samplerDesc.BorderColor[0] = 0;
+	samplerDesc.BorderColor[1] = 0;
+	samplerDesc.BorderColor[2] = 0;
+	samplerDesc.BorderColor[3] = 0;
+	samplerDesc.MinLOD = 0;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	result = device->CreateSamplerState(&samplerDesc, &m_sampleState);
+	if (FAILED(result))
+		return false;
+
+	return true;
+}
+
+void MeshShaderClass::ShutdownShader()
+{
+	if (m_sampleState)
+	{
+		m_sampleState->Release();
+		m_sampleState = nullptr;
+	}
+
+	if (m_objectBuffer)
+	{
+		m_objectBuffer->Release();
+		m_objectBuffer = nullptr;
+	}
+
+	if (m_frameBuffer)
+	{
+		m_frameBuffer->Release();
+		m_frameBuffer = nullptr;
+	}
+
+	// The program itself belongs to the cache
+	m_program = -1;
+	m_ShaderCache = nullptr;
+}
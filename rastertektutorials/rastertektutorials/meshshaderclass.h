@@ -0,0 +1,64 @@
+#pragma once
+
+#include <d3d11.h>
+#include <directxmath.h>
+#include "shadercacheclass.h"
+#include "meshclass.h"
+
+using namespace DirectX;
+
+/*
+	Shader for MeshClass geometry (mesh.vs / mesh.ps), textured and lit by the sun with its cascaded shadows
+	plus the clustered lights, so it expects LightBufferClass and ShadowMapClass to be bound already.
+	SetShaderParameters binds the pipeline once per pass and SetObjectParameters fills in each draw.
+	SetDepthParameters is the shadow caster version: the same vertex shader with the cascade's matrix
+	as the projection and no pixel shader at all.
+*/
+
+const int MESH_FRAME_SLOT = 0; // b0, vertex shader
+const int MESH_OBJECT_SLOT = 3; // b3, both stages, b1 and b2 are the clusters' and the shadows'
+
+class MeshShaderClass
+{
+private:
+	struct FrameBufferType
+	{
+		XMMATRIX view;
+		XMMATRIX projection;
+	};
+
+	// Matches cbuffer ObjectBuffer in mesh.vs and mesh.ps
+	struct ObjectBufferType
+	{
+		XMMATRIX world;
+		XMFLOAT3 positionScale;
+		float textured;
+		XMFLOAT3 positionBias;
+		float padding;
+	};
+
+public:
+	MeshShaderClass();
+	MeshShaderClass(const MeshShaderClass&);
+	~MeshShaderClass();
+
+	bool Initialize(ShaderCacheClass*, ID3D11Device*, HWND);
+	void Shutdown();
+
+	bool SetShaderParameters(ID3D11DeviceContext*, XMMATRIX, XMMATRIX);
+	bool SetDepthParameters(ID3D11DeviceContext*, XMMATRIX);
+	// World matrix, the mesh for its position decode, and the texture (nullptr draws it untextured)
+	bool SetObjectParameters(ID3D11DeviceContext*, XMMATRIX, MeshClass*, ID3D11ShaderResourceView*);
+
+private:
+	bool InitializeShader(ID3D11Device*, HWND, const char*, const char*);
+	void ShutdownShader();
+	bool SetFrameBuffer(ID3D11DeviceContext*, XMMATRIX, XMMATRIX);
+
+private:
+	ShaderCacheClass* m_ShaderCache;
+	int m_program;
+	ID3D11Buffer* m_frameBuffer;
+	ID3D11Buffer* m_objectBuffer;
+	ID3D11SamplerState* m_sampleState;
+};
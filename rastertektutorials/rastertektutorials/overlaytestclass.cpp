@@ -0,0 +1,282 @@
+#include "overlaytestclass.h"
+#include "graphicsclass.h"
+
+#include <windows.h>
+#include <algorithm>
+#include <vector>
+
+static unsigned int NextRandom(unsigned int& state)
+{
+	// xorshift32, same sequence every run so runs can be compared
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static long long Now()
+{
+	LARGE_INTEGER time;
+	QueryPerformanceCounter(&time);
+	return time.QuadPart;
+}
+
+static double Milliseconds(long long start, long long end)
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return (double)(end - start) * 1000.0 / (double)frequency.QuadPart;
+}
+
+// Never dereferenced without a device, only compared
+static ID3D11ShaderResourceView* FakeTexture(int index)
+{
+	return (ID3D11ShaderResourceView*)(size_t)((index + 1) * 16);
+}
+
+OverlayTestClass::OverlayTestClass() :
+	m_SpriteBatch(nullptr),
+	m_Atlas(nullptr),
+	m_Font(nullptr),
+	m_random(0x2545F491)
+{
+}
+
+OverlayTestClass::OverlayTestClass(const OverlayTestClass&)
+{
+}
+
+OverlayTestClass::~OverlayTestClass()
+{
+}
+
+int OverlayTestClass::Run(const std::string& reportName)
+{
+	FILE* report = nullptr;
+	if (fopen_s(&report, reportName.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	OverlayTestClass test;
+	bool passed = test.Initialize();
+	if (passed)
+	{
+		// Both run whatever happens so the report is complete
+		const bool batching = test.TestBatching(report);
+		const bool hud = test.TestHud(report);
+		passed = batching && hud;
+	}
+	else
+	{
+		fprintf(report, "couldn't create the sprite batch, atlas or font (%s %d)\n", HUD_FONT, HUD_FONT_SIZE);
+	}
+	test.Shutdown();
+
+	fprintf(report, "\n%s\n", passed ? "passed" : "FAILED");
+	fclose(report);
+	return passed ? 0 : 1;
+}
+
+bool OverlayTestClass::Initialize()
+{
+	m_SpriteBatch = new SpriteBatchClass();
+	if (m_SpriteBatch == nullptr)
+		return false;
+
+	if (m_SpriteBatch->Initialize(nullptr, OVERLAY_TEST_QUADS) == false)
+		return false;
+
+	// Same atlas and font the HUD uses, only the upload needs a device
+	m_Atlas = new AtlasClass();
+	if (m_Atlas == nullptr)
+		return false;
+
+	if (m_Atlas->Initialize(OVERLAY_ATLAS_SIZE, OVERLAY_ATLAS_SIZE) == false)
+		return false;
+
+	m_Font = new FontClass();
+	if (m_Font == nullptr)
+		return false;
+
+	return m_Font->Initialize(m_Atlas, HUD_FONT, HUD_FONT_SIZE);
+}
+
+void OverlayTestClass::Shutdown()
+{
+	if (m_Font)
+	{
+		m_Font->Shutdown();
+		delete m_Font;
+		m_Font = nullptr;
+	}
+
+	if (m_Atlas)
+	{
+		m_Atlas->Shutdown();
+		delete m_Atlas;
+		m_Atlas = nullptr;
+	}
+
+	if (m_SpriteBatch)
+	{
+		m_SpriteBatch->Shutdown();
+		delete m_SpriteBatch;
+		m_SpriteBatch = nullptr;
+	}
+}
+
+bool OverlayTestClass::TestBatching(FILE* report)
+{
+	AtlasRegionType region = { 0.0f, 0.0f, 1.0f, 1.0f, 1, 1 };
+	std::vector<double> endTimes;
+	endTimes.reserve(OVERLAY_TEST_FRAMES);
+
+	int maxBatches = 0;
+	int maxPairs = 0;
+	int maxChanges = 0;
+	int badFrames = 0;
+	for (int frame = 0; frame < OVERLAY_TEST_FRAMES; ++frame)
+	{
+		bool used[OVERLAY_TEST_LAYERS][OVERLAY_TEST_TEXTURES] = {};
+		int changes = 0;
+		int lastTexture = -1;
+		int lastLayer = -1;
+
+		m_SpriteBatch->Begin(OVERLAY_TEST_SCREEN_WIDTH, OVERLAY_TEST_SCREEN_HEIGHT);
+		for (int i = 0; i < OVERLAY_TEST_QUADS; ++i)
+		{
+			// Runs of a few quads, like a real overlay where neighbouring draws often share a texture
+			if (i % 4 == 0)
+			{
+				lastTexture = (int)(NextRandom(m_random) % OVERLAY_TEST_TEXTURES);
+				lastLayer = (int)(NextRandom(m_random) % OVERLAY_TEST_LAYERS);
+				m_SpriteBatch->SetLayer(lastLayer);
+				++changes;
+			}
+
+			used[lastLayer][lastTexture] = true;
+			m_SpriteBatch->Draw(FakeTexture(lastTexture), (float)(i % 240) * 8.0f, (float)(i / 240) * 8.0f, 6.0f, 6.0f, region, 0xFFFFFFFF);
+		}
+
+		const long long start = Now();
+		m_SpriteBatch->End();
+		endTimes.push_back(Milliseconds(start, Now()));
+
+		int pairs = 0;
+		for (int layer = 0; layer < OVERLAY_TEST_LAYERS; ++layer)
+		{
+			for (int texture = 0; texture < OVERLAY_TEST_TEXTURES; ++texture)
+				pairs += used[layer][texture] ? 1 : 0;
+		}
+
+		const int batches = m_SpriteBatch->GetBatchCount();
+		if (batches > pairs || CheckBatches(OVERLAY_TEST_QUADS) == false || m_SpriteBatch->GetDroppedQuads() != 0)
+			++badFrames;
+
+		maxBatches = batches > maxBatches ? batches : maxBatches;
+		maxPairs = pairs > maxPairs ? pairs : maxPairs;
+		maxChanges = changes > maxChanges ? changes : maxChanges;
+	}
+
+	// One texture on one layer has to come out as a single draw
+	m_SpriteBatch->Begin(OVERLAY_TEST_SCREEN_WIDTH, OVERLAY_TEST_SCREEN_HEIGHT);
+	for (int i = 0; i < OVERLAY_TEST_QUADS; ++i)
+		m_SpriteBatch->Draw(FakeTexture(0), (float)(i % 240) * 8.0f, (float)(i / 240) * 8.0f, 6.0f, 6.0f, region, 0xFFFFFFFF);
+	m_SpriteBatch->End();
+	const int singleBatches = m_SpriteBatch->GetBatchCount();
+	const bool single = singleBatches == 1 && CheckBatches(OVERLAY_TEST_QUADS);
+
+	// Past the limit quads are dropped and counted, what did fit still batches
+	m_SpriteBatch->Begin(OVERLAY_TEST_SCREEN_WIDTH, OVERLAY_TEST_SCREEN_HEIGHT);
+	for (int i = 0; i < OVERLAY_TEST_QUADS + OVERLAY_TEST_OVERFLOW; ++i)
+		m_SpriteBatch->Draw(FakeTexture(i % OVERLAY_TEST_TEXTURES), 0.0f, 0.0f, 6.0f, 6.0f, region, 0xFFFFFFFF);
+	m_SpriteBatch->End();
+	const int dropped = m_SpriteBatch->GetDroppedQuads();
+	const bool overflow = dropped == OVERLAY_TEST_OVERFLOW && m_SpriteBatch->GetBatchCount() == OVERLAY_TEST_TEXTURES && CheckBatches(OVERLAY_TEST_QUADS);
+
+	double total = 0.0;
+	for (double time : endTimes)
+		total += time;
+
+	std::sort(endTimes.begin(), endTimes.end());
+	const double median = endTimes[endTimes.size() / 2];
+	const double quadsPerSecond = total > 0.0 ? (double)OVERLAY_TEST_QUADS * OVERLAY_TEST_FRAMES / (total / 1000.0) : 0.0;
+
+	const bool passed = badFrames == 0 && single && overflow;
+	fprintf(report, "batching: %d frames of %d quads over %d textures and %d layers\n", OVERLAY_TEST_FRAMES, OVERLAY_TEST_QUADS,
+		OVERLAY_TEST_TEXTURES, OVERLAY_TEST_LAYERS);
+	fprintf(report, "  texture/layer changes in submission order %d, layer/texture pairs used %d, batches %d (worst frame each)\n",
+		maxChanges, maxPairs, maxBatches);
+	fprintf(report, "  frames with too many batches or a bad batch list %d\n", badFrames);
+	fprintf(report, "  one texture one layer: %d batches\n", singleBatches);
+	fprintf(report, "  %d quads over the limit: %d dropped\n", OVERLAY_TEST_OVERFLOW, dropped);
+	fprintf(report, "  End() median %.3f ms, %.1f million quads/sec\n", median, quadsPerSecond / 1000000.0);
+	fprintf(report, "  %s\n\n", passed ? "passed" : "FAILED");
+	return passed;
+}
+
+bool OverlayTestClass::TestHud(FILE* report)
+{
+	// As long as the real one, the numbers don't matter
+	const char* text =
+		"NVIDIA GeForce RTX 0000 (8192 MB)\n"
+		"Frame 123456  cpu 4.21 ms  gpu 3.87 ms\n"
+		"Draws 123  visible 4567 / 10000  triangles 1234567\n"
+		"Lights 256  cluster indices 34567 (135 KB)\n"
+		"Shadow cascades redrawn 1  casters 345  drawn 456\n"
+		"Textures 24  resident 187.5 / 256 MB  loads 1234  evictions 56\n"
+		"Particles 65536  drawn 43210 (1024 KB)\n"
+		"Memory 512.3 MB  atlas 37%\n"
+		"Shader reloads 3 (41.2 ms)  failed 0";
+
+	const float margin = 8.0f;
+	const unsigned int textColor = SpriteColor(1.0f, 1.0f, 1.0f, 1.0f);
+	const unsigned int panelColor = SpriteColor(0.0f, 0.0f, 0.0f, 0.6f);
+
+	m_SpriteBatch->Begin(OVERLAY_TEST_SCREEN_WIDTH, OVERLAY_TEST_SCREEN_HEIGHT);
+	m_SpriteBatch->SetLayer(0);
+	m_SpriteBatch->DrawTextPanel(m_Font, m_Atlas, margin, margin, margin, text, textColor, panelColor);
+	m_SpriteBatch->End();
+	const int hudQuads = m_SpriteBatch->GetQuadCount();
+	const int hudBatches = m_SpriteBatch->GetBatchCount();
+
+	// Same grid RenderOverlay draws for the overlay benchmark, under the hud
+	m_SpriteBatch->Begin(OVERLAY_TEST_SCREEN_WIDTH, OVERLAY_TEST_SCREEN_HEIGHT);
+	m_SpriteBatch->SetLayer(0);
+	for (int i = 0; i < OVERLAY_TEST_STRESS_QUADS; ++i)
+	{
+		const float x = (float)(i % 100) * 8.0f;
+		const float y = (float)(i / 100 % 75) * 8.0f;
+		m_SpriteBatch->DrawRect(m_Atlas, x, y, 6.0f, 6.0f, SpriteColor((i % 7) / 7.0f, (i % 5) / 5.0f, (i % 3) / 3.0f, 0.5f));
+	}
+	m_SpriteBatch->DrawTextPanel(m_Font, m_Atlas, margin, margin, margin, text, textColor, panelColor);
+	m_SpriteBatch->End();
+	const int stressBatches = m_SpriteBatch->GetBatchCount();
+
+	// A HUD with no glyphs in it would pass the batch count without testing anything
+	const bool passed = hudQuads > 1 && hudBatches == 1 && stressBatches == 1 && CheckBatches(m_SpriteBatch->GetQuadCount());
+	fprintf(report, "hud: %d quads in %d batches, %d batches with %d stress quads under it\n", hudQuads, hudBatches, stressBatches,
+		OVERLAY_TEST_STRESS_QUADS);
+	fprintf(report, "  %s\n", passed ? "passed" : "FAILED");
+	return passed;
+}
+
+bool OverlayTestClass::CheckBatches(int quadCount)
+{
+	const std::vector<SpriteBatchType>& batches = m_SpriteBatch->GetBatches();
+	if (m_SpriteBatch->GetQuadCount() != quadCount || (int)m_SpriteBatch->GetVertices().size() != quadCount * 4)
+		return false;
+
+	int next = 0;
+	for (size_t i = 0; i < batches.size(); ++i)
+	{
+		if (batches[i].startQuad != next || batches[i].quadCount <= 0)
+			return false;
+
+		if (i > 0 && batches[i].texture == batches[i - 1].texture)
+			return false;
+
+		next += batches[i].quadCount;
+	}
+
+	return next == quadCount;
+}
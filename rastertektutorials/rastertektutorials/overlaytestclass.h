@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include "atlasclass.h"
+#include "fontclass.h"
+#include "spritebatchclass.h"
+
+/*
+	Headless sprite batch tests, run with -overlaytest [-out report.txt]. No window and no device, SpriteBatchClass
+	does all of End() without one and the atlas is never uploaded. Exit code 0 if everything passed and 1 if anything didn't.
+		- Batching: every frame pushes OVERLAY_TEST_QUADS quads spread at random over OVERLAY_TEST_TEXTURES textures and
+		  OVERLAY_TEST_LAYERS layers. There can't be more batches than layer/texture pairs actually used, the batches have
+		  to cover every quad once in order, and two neighbouring batches never share a texture. End() is timed on its
+		  own and reported as quads/sec. One texture on one layer is one batch, and quads past the limit are dropped and counted.
+		- Hud: the HUD panel and text (GraphicsClass::BuildHud's layout with a HUD sized string) is one batch, on its own
+		  and with the benchmark's stress grid from the same atlas under it.
+	The textures are made up pointers, nothing ever dereferences them without a device.
+*/
+
+const char* const OVERLAY_TEST_DEFAULT_REPORT = "overlay_test.txt";
+const int OVERLAY_TEST_SCREEN_WIDTH = 1920;
+const int OVERLAY_TEST_SCREEN_HEIGHT = 1080;
+const int OVERLAY_TEST_QUADS = SPRITE_BATCH_MAX_QUADS;
+const int OVERLAY_TEST_TEXTURES = 8;
+const int OVERLAY_TEST_LAYERS = 4;
+const int OVERLAY_TEST_FRAMES = 200;
+const int OVERLAY_TEST_OVERFLOW = 100;
+const int OVERLAY_TEST_STRESS_QUADS = 5000;
+
+class OverlayTestClass
+{
+public:
+	OverlayTestClass();
+	OverlayTestClass(const OverlayTestClass&);
+	~OverlayTestClass();
+
+	// Returns the process exit code, 0 = passed, 1 = failed, 2 = couldn't write the report
+	static int Run(const std::string&);
+
+	bool Initialize();
+	void Shutdown();
+
+	bool TestBatching(FILE*);
+	bool TestHud(FILE*);
+
+private:
+	// Batches cover quads 0..count-1 once and in order, neighbours never share a texture
+	bool CheckBatches(int);
+
+private:
+	SpriteBatchClass* m_SpriteBatch;
+	AtlasClass* m_Atlas;
+	FontClass* m_Font;
+	unsigned int m_random;
+};
@@ -0,0 +1,42 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: particle.vs
+// One instance per particle, the four vertices of the strip are the corners of
+// a quad built in view space so it always faces the camera.
+////////////////////////////////////////////////////////////////////////////////
+
+cbuffer MatrixBuffer
+{
+	matrix viewMatrix;
+	matrix projectionMatrix;
+};
+
+struct VertexInputType
+{
+	float3 position : POSITION;
+	float size : TEXCOORD0;
+	float4 color : COLOR;
+};
+
+struct PixelInputType
+{
+	float4 position : SV_POSITION;
+	float2 corner : TEXCOORD0;
+	float4 color : COLOR;
+};
+
+PixelInputType ParticleVertexShader(VertexInputType input, uint vertexId : SV_VertexID)
+{
+	PixelInputType output;
+
+	// 0..3 -> (-1,-1) (1,-1) (-1,1) (1,1), a triangle strip
+	float2 corner = float2((vertexId & 1) ? 1.0f : -1.0f, (vertexId & 2) ? 1.0f : -1.0f);
+
+	float4 viewPosition = mul(float4(input.position, 1.0f), viewMatrix);
+	viewPosition.xy += corner * input.size;
+
+	output.position = mul(viewPosition, projectionMatrix);
+	output.corner = corner;
+	output.color = input.color;
+
+	return output;
+}
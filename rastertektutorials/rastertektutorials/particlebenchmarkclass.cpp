@@ -0,0 +1,288 @@
+#include "particlebenchmarkclass.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <string.h>
+
+static long long Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double Milliseconds(long long start, long long end)
+{
+	return (double)(end - start) / 1000000.0;
+}
+
+ParticleBenchmarkClass::ParticleBenchmarkClass() :
+	m_Jobs(nullptr),
+	m_Frustum(nullptr)
+{
+}
+
+ParticleBenchmarkClass::ParticleBenchmarkClass(const ParticleBenchmarkClass&)
+{
+}
+
+ParticleBenchmarkClass::~ParticleBenchmarkClass()
+{
+}
+
+int ParticleBenchmarkClass::Run(const std::string& reportName)
+{
+	ParticleBenchmarkClass benchmark;
+	if (benchmark.Initialize() == false)
+		return 2;
+
+	const int capacities[2] = { PARTICLE_BENCHMARK_SMALL, PARTICLE_BENCHMARK_LARGE };
+	ResultType results[2];
+	bool result = true;
+	for (int run = 0; run < 2 && result; ++run)
+		result = benchmark.Measure(capacities[run], results[run]);
+
+	const int threads = benchmark.m_Jobs->GetThreadCount();
+	benchmark.Shutdown();
+	if (result == false)
+		return 2;
+
+	FILE* report = fopen(reportName.c_str(), "w");
+	if (report == nullptr)
+		return 2;
+
+	fprintf(report, "particles, %d threads, %d measured frames at a fixed %.4f s step, median / p95 in ms\n\n", threads, PARTICLE_BENCHMARK_FRAMES,
+		PARTICLE_BENCHMARK_TIME_STEP);
+	fprintf(report, "%-10s %16s %10s %16s %16s %16s %10s %10s  %s\n", "capacity", "alive", "visible", "update", "build", "copy", "unsorted", "behind", "checks");
+
+	bool passed = true;
+	for (const ResultType& run : results)
+	{
+		char alive[32], update[32], build[32], copy[32];
+		snprintf(alive, sizeof(alive), "%d..%d", run.countMin, run.countMax);
+		snprintf(update, sizeof(update), "%.2f / %.2f", run.updateMedian, run.updateP95);
+		snprintf(build, sizeof(build), "%.2f / %.2f", run.buildMedian, run.buildP95);
+		snprintf(copy, sizeof(copy), "%.2f / %.2f", run.copyMedian, run.copyP95);
+		fprintf(report, "%-10d %16s %10u %16s %16s %16s %10d %10d  %s\n", run.capacity, alive, run.visible, update, build, copy,
+			run.unsortedFrames, run.behindPlanes, Passed(run) ? "passed" : "FAILED");
+
+		if (run.visible != run.expectedVisible)
+			fprintf(report, "  visible %u but the frustum check finds %u\n", run.visible, run.expectedVisible);
+		if (run.steady == false)
+			fprintf(report, "  the count never levelled off\n");
+
+		passed = passed && Passed(run);
+	}
+
+	fprintf(report, "\n%s\n", passed ? "all checks passed" : "FAILED");
+	fclose(report);
+
+	return passed ? 0 : 1;
+}
+
+bool ParticleBenchmarkClass::Initialize()
+{
+	m_Jobs = new JobSystemClass();
+	if (m_Jobs == nullptr)
+		return false;
+
+	if (m_Jobs->Initialize(0) == false)
+		return false;
+
+	// Looking down at the fountains from behind and above, some of the spray goes out of view at the sides
+	const XMMATRIX viewMatrix = XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -20.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 40.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMStoreFloat4x4(&m_view, viewMatrix);
+
+	m_Frustum = new FrustumClass();
+	if (m_Frustum == nullptr)
+		return false;
+
+	m_Frustum->ConstructFrustum(XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f), viewMatrix);
+
+	// Floor under the fountains and a wall the left ones spray into
+	m_planes.push_back(XMFLOAT4(0.0f, 1.0f, 0.0f, 2.0f));
+	m_planes.push_back(XMFLOAT4(1.0f, 0.0f, 0.0f, 25.0f));
+	return true;
+}
+
+void ParticleBenchmarkClass::Shutdown()
+{
+	if (m_Frustum)
+	{
+		delete m_Frustum;
+		m_Frustum = nullptr;
+	}
+
+	if (m_Jobs)
+	{
+		m_Jobs->Shutdown();
+		delete m_Jobs;
+		m_Jobs = nullptr;
+	}
+
+	m_planes.clear();
+}
+
+bool ParticleBenchmarkClass::SetUp(ParticleSystemClass* particles, int capacity)
+{
+	if (particles->Initialize(m_Jobs, capacity) == false)
+		return false;
+
+	// Lives average 7/8 of the emitter's, so this is the rate that keeps PARTICLE_BENCHMARK_FILL of the capacity alive
+	const float rate = capacity * PARTICLE_BENCHMARK_FILL / (PARTICLE_BENCHMARK_LIFE * 0.875f) / 4.0f;
+	for (int i = 0; i < 4; ++i)
+	{
+		ParticleEmitterType emitter;
+		emitter.position = XMFLOAT3((i % 2) * 20.0f - 10.0f, 0.0f, (i / 2) * 20.0f + 30.0f);
+		emitter.rate = rate;
+		emitter.direction = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		emitter.spread = 0.3f;
+		emitter.speed = 12.0f;
+		emitter.life = PARTICLE_BENCHMARK_LIFE;
+		emitter.size = PARTICLE_BENCHMARK_SIZE;
+		emitter.color = 0xFFFFC080;
+		if (particles->AddEmitter(emitter) < 0)
+			return false;
+	}
+
+	for (const XMFLOAT4& plane : m_planes)
+	{
+		if (particles->AddPlane(plane) == false)
+			return false;
+	}
+
+	return true;
+}
+
+bool ParticleBenchmarkClass::Measure(int capacity, ResultType& result)
+{
+	ParticleSystemClass* particles = new ParticleSystemClass();
+	if (particles == nullptr)
+		return false;
+
+	if (SetUp(particles, capacity) == false)
+	{
+		particles->Shutdown();
+		delete particles;
+		return false;
+	}
+
+	memset(&result, 0, sizeof(result));
+	result.capacity = capacity;
+	result.countMin = capacity;
+
+	const XMMATRIX viewMatrix = XMLoadFloat4x4(&m_view);
+	ParticleFrameType frame;
+	frame.count = 0;
+	frame.alive = 0;
+	std::vector<ParticleVertexType> vertexBuffer(capacity);
+
+	// A whole life plus a bit so the first wave has died and the count has levelled off
+	const int warmup = (int)(PARTICLE_BENCHMARK_LIFE * 1.5f / PARTICLE_BENCHMARK_TIME_STEP);
+	for (int i = 0; i < warmup; ++i)
+	{
+		particles->Update(PARTICLE_BENCHMARK_TIME_STEP);
+		particles->Build(viewMatrix, m_Frustum->GetPlanes(), frame);
+	}
+
+	std::vector<double> update, build, copy;
+	double countSum = 0.0;
+	for (int i = 0; i < PARTICLE_BENCHMARK_FRAMES; ++i)
+	{
+		long long start = Now();
+		particles->Update(PARTICLE_BENCHMARK_TIME_STEP);
+		update.push_back(Milliseconds(start, Now()));
+
+		start = Now();
+		particles->Build(viewMatrix, m_Frustum->GetPlanes(), frame);
+		build.push_back(Milliseconds(start, Now()));
+
+		start = Now();
+		if (frame.count > 0)
+			memcpy(&vertexBuffer[0], &frame.vertices[0], frame.count * sizeof(ParticleVertexType));
+		copy.push_back(Milliseconds(start, Now()));
+
+		const int count = particles->GetCount();
+		result.countMin = count < result.countMin ? count : result.countMin;
+		result.countMax = count > result.countMax ? count : result.countMax;
+		countSum += count;
+
+		result.unsortedFrames += IsSorted(frame) ? 0 : 1;
+		result.behindPlanes += CountBehindPlanes(particles);
+	}
+
+	const double countAverage = countSum / PARTICLE_BENCHMARK_FRAMES;
+	result.steady = countAverage > 0.0 && result.countMin >= countAverage * (1.0 - PARTICLE_BENCHMARK_STEADY) &&
+		result.countMax <= countAverage * (1.0 + PARTICLE_BENCHMARK_STEADY);
+	result.visible = frame.count;
+	result.expectedVisible = CountVisible(particles);
+
+	Percentiles(update, result.updateMedian, result.updateP95);
+	Percentiles(build, result.buildMedian, result.buildP95);
+	Percentiles(copy, result.copyMedian, result.copyP95);
+
+	particles->Shutdown();
+	delete particles;
+	return true;
+}
+
+bool ParticleBenchmarkClass::IsSorted(const ParticleFrameType& frame)
+{
+	// Bucketed, so only as exact as the float depth, a tiny step towards the camera is fine
+	float previous = FLT_MAX;
+	for (unsigned int i = 0; i < frame.count; ++i)
+	{
+		const XMFLOAT3& position = frame.vertices[i].position;
+		const float depth = position.x * m_view._13 + position.y * m_view._23 + position.z * m_view._33 + m_view._43;
+		if (depth > previous + 0.001f)
+			return false;
+
+		previous = depth;
+	}
+
+	return true;
+}
+
+int ParticleBenchmarkClass::CountBehindPlanes(ParticleSystemClass* particles)
+{
+	int behind = 0;
+	for (int i = 0; i < particles->GetCount(); ++i)
+	{
+		XMFLOAT3 position, velocity;
+		particles->GetParticle(i, position, velocity);
+		for (const XMFLOAT4& plane : m_planes)
+		{
+			if (plane.x * position.x + plane.y * position.y + plane.z * position.z + plane.w < -0.001f)
+			{
+				++behind;
+				break;
+			}
+		}
+	}
+
+	return behind;
+}
+
+unsigned int ParticleBenchmarkClass::CountVisible(ParticleSystemClass* particles)
+{
+	unsigned int visible = 0;
+	for (int i = 0; i < particles->GetCount(); ++i)
+	{
+		XMFLOAT3 position, velocity;
+		particles->GetParticle(i, position, velocity);
+		visible += m_Frustum->CheckSphere(position.x, position.y, position.z, PARTICLE_BENCHMARK_SIZE) ? 1 : 0;
+	}
+
+	return visible;
+}
+
+void ParticleBenchmarkClass::Percentiles(std::vector<double>& values, double& median, double& p95)
+{
+	std::sort(values.begin(), values.end());
+	median = values[values.size() / 2];
+	p95 = values[(values.size() * 95) / 100];
+}
+
+bool ParticleBenchmarkClass::Passed(const ResultType& result)
+{
+	return result.unsortedFrames == 0 && result.behindPlanes == 0 && result.steady && result.visible == result.expectedVisible;
+}
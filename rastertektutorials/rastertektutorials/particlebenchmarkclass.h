@@ -0,0 +1,80 @@
+#pragma once
+
+#include <directxmath.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "frustumclass.h"
+#include "jobsystemclass.h"
+#include "particlesystemclass.h"
+
+using namespace DirectX;
+
+/*
+	Particle benchmark, run with -particles [-out report.txt]. Windowless, no device.
+	Four fountains and two collision planes (a floor and a wall) at PARTICLE_BENCHMARK_SMALL and
+	PARTICLE_BENCHMARK_LARGE particles. The emitters are set so the count levels off a little under the capacity,
+	the warmup runs until it has (a whole particle life and then some) and then PARTICLE_BENCHMARK_FRAMES frames
+	are measured at a fixed time step:
+		update - emission, integration, collision and compaction (ParticleSystemClass::Update)
+		build - cull, depth sort and writing the vertices (ParticleSystemClass::Build)
+		copy - one memcpy of the vertices, what the render thread pays to stream them into the vertex buffer
+	Median and p95 of each. Every measured frame is also checked, outside the timing: the vertices have to be back
+	to front, no particle may be behind a plane, the count must have levelled off (within PARTICLE_BENCHMARK_STEADY
+	of its average) and on the last frame the visible count must be what FrustumClass says one sphere at a time.
+	The exit code is 1 if any check fails.
+*/
+
+const int PARTICLE_BENCHMARK_SMALL = 100000;
+const int PARTICLE_BENCHMARK_LARGE = 1000000;
+const int PARTICLE_BENCHMARK_FRAMES = 300;
+const float PARTICLE_BENCHMARK_LIFE = 3.0f;
+const float PARTICLE_BENCHMARK_SIZE = 0.1f;
+const float PARTICLE_BENCHMARK_FILL = 0.9f; // of the capacity alive once it levels off
+const float PARTICLE_BENCHMARK_STEADY = 0.05f;
+const float PARTICLE_BENCHMARK_TIME_STEP = 1.0f / 60.0f;
+const char* const PARTICLE_BENCHMARK_DEFAULT_REPORT = "particles.txt";
+
+class ParticleBenchmarkClass
+{
+private:
+	struct ResultType
+	{
+		int capacity;
+		double updateMedian, updateP95;
+		double buildMedian, buildP95;
+		double copyMedian, copyP95;
+		int countMin, countMax;
+		unsigned int visible;
+		unsigned int expectedVisible;
+		int unsortedFrames;
+		int behindPlanes;
+		bool steady;
+	};
+
+public:
+	ParticleBenchmarkClass();
+	ParticleBenchmarkClass(const ParticleBenchmarkClass&);
+	~ParticleBenchmarkClass();
+
+	// Report file, returns the process exit code, 0 = fine, 1 = a check failed, 2 = couldn't set up or write the report
+	static int Run(const std::string&);
+
+	bool Initialize();
+	void Shutdown();
+
+private:
+	bool Measure(int, ResultType&);
+	bool SetUp(ParticleSystemClass*, int);
+	bool IsSorted(const ParticleFrameType&);
+	int CountBehindPlanes(ParticleSystemClass*);
+	unsigned int CountVisible(ParticleSystemClass*);
+	static void Percentiles(std::vector<double>&, double&, double&);
+	static bool Passed(const ResultType&);
+
+private:
+	JobSystemClass* m_Jobs;
+	FrustumClass* m_Frustum;
+	XMFLOAT4X4 m_view;
+	std::vector<XMFLOAT4> m_planes;
+};
@@ -0,0 +1,120 @@
+#include "particlebufferclass.h"
+
+#include <string.h>
+
+ParticleBufferClass::ParticleBufferClass() :
+	m_vertexBuffer(nullptr),
+	m_maxVertices(0),
+	m_ringPosition(0),
+	m_drawStart(0),
+	m_drawCount(0)
+{
+}
+
+ParticleBufferClass::ParticleBufferClass(const ParticleBufferClass&)
+{
+}
+
+ParticleBufferClass::~ParticleBufferClass()
+{
+}
+
+bool ParticleBufferClass::Initialize(ID3D11Device* device)
+{
+	return CreateBuffer(device, PARTICLE_BUFFER_INITIAL_VERTICES);
+}
+
+void ParticleBufferClass::Shutdown()
+{
+	ReleaseBuffer();
+}
+
+bool ParticleBufferClass::CreateBuffer(ID3D11Device* device, unsigned int vertexCount)
+{
+	D3D11_BUFFER_DESC vertexBufferDesc;
+	vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vertexBufferDesc.ByteWidth = vertexCount * sizeof(ParticleVertexType);
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vertexBufferDesc.MiscFlags = 0;
+	vertexBufferDesc.StructureByteStride = 0;
+
+	if (FAILED(device->CreateBuffer(&vertexBufferDesc, nullptr, &m_vertexBuffer)))
+		return false;
+
+	m_maxVertices = vertexCount;
+	m_ringPosition = 0;
+	return true;
+}
+
+void ParticleBufferClass::ReleaseBuffer()
+{
+	if (m_vertexBuffer)
+	{
+		m_vertexBuffer->Release();
+		m_vertexBuffer = nullptr;
+	}
+
+	m_maxVertices = 0;
+	m_ringPosition = 0;
+	m_drawCount = 0;
+}
+
+bool ParticleBufferClass::Upload(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const ParticleFrameType& frame)
+{
+	m_drawCount = 0;
+	const unsigned int count = frame.count;
+	if (count == 0)
+		return true;
+
+	// Grow by half again so a slowly rising particle count doesn't recreate the buffer every frame
+	if (count > m_maxVertices)
+	{
+		ReleaseBuffer();
+		if (CreateBuffer(device, count + count / 2) == false)
+			return false;
+	}
+
+	// Same as the sprite ring, the gpu may still be drawing what earlier frames wrote
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (m_ringPosition + count > m_maxVertices)
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		m_ringPosition = 0;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext->Map(m_vertexBuffer, 0, mapType, 0, &mappedResource)))
+		return false;
+
+	memcpy((ParticleVertexType*)mappedResource.pData + m_ringPosition, frame.vertices.data(), count * sizeof(ParticleVertexType));
+	deviceContext->Unmap(m_vertexBuffer, 0);
+
+	m_drawStart = m_ringPosition;
+	m_drawCount = count;
+	m_ringPosition += count;
+	return true;
+}
+
+void ParticleBufferClass::Draw(ID3D11DeviceContext* deviceContext)
+{
+	if (m_drawCount == 0)
+		return;
+
+	// Instance data, the start instance picks this frame's part of the ring
+	unsigned int stride = sizeof(ParticleVertexType);
+	unsigned int offset = 0;
+	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	deviceContext->DrawInstanced(4, m_drawCount, 0, m_drawStart);
+}
+
+unsigned int ParticleBufferClass::GetDrawCount()
+{
+	return m_drawCount;
+}
+
+unsigned int ParticleBufferClass::GetBufferSize()
+{
+	return m_maxVertices * sizeof(ParticleVertexType);
+}
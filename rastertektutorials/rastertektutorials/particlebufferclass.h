@@ -0,0 +1,44 @@
+#pragma once
+
+#include <d3d11.h>
+#include "particlesystemclass.h"
+
+/*
+	Gets a frame's particles (ParticleFrameType, already culled and sorted on the jobs) onto the gpu and draws them.
+	The vertices go into one dynamic vertex buffer used as a ring like SpriteBatchClass does, NO_OVERWRITE while
+	there's room and DISCARD when a frame doesn't fit in what's left. Since the jobs already wrote the vertices in
+	draw order this is a single memcpy.
+	One vertex per particle read per instance, the vertex shader makes the quad out of SV_VertexID, so a frame is one
+	DrawInstanced of a 4 vertex strip. The buffer grows when a frame needs more room and never shrinks.
+*/
+
+const unsigned int PARTICLE_BUFFER_INITIAL_VERTICES = 64 * 1024;
+
+class ParticleBufferClass
+{
+public:
+	ParticleBufferClass();
+	ParticleBufferClass(const ParticleBufferClass&);
+	~ParticleBufferClass();
+
+	bool Initialize(ID3D11Device*);
+	void Shutdown();
+
+	bool Upload(ID3D11Device*, ID3D11DeviceContext*, const ParticleFrameType&);
+	// Whatever the last Upload sent, the particle shader has to be set already
+	void Draw(ID3D11DeviceContext*);
+
+	unsigned int GetDrawCount();
+	unsigned int GetBufferSize();
+
+private:
+	bool CreateBuffer(ID3D11Device*, unsigned int);
+	void ReleaseBuffer();
+
+private:
+	ID3D11Buffer* m_vertexBuffer;
+	unsigned int m_maxVertices;
+	unsigned int m_ringPosition; // in vertices
+	unsigned int m_drawStart;
+	unsigned int m_drawCount;
+};
@@ -0,0 +1,120 @@
+#include "particleshaderclass.h"
+
+ParticleShaderClass::ParticleShaderClass() :
+	m_ShaderCache(nullptr),
+	m_program(-1),
+	m_matrixBuffer(nullptr)
+{
+}
+
+ParticleShaderClass::ParticleShaderClass(const ParticleShaderClass&)
+{
+}
+
+ParticleShaderClass::~ParticleShaderClass()
+{
+}
+
+bool ParticleShaderClass::Initialize(ShaderCacheClass* shaderCache, ID3D11Device* device, HWND hwnd)
+{
+	m_ShaderCache = shaderCache;
+	return InitializeShader(device, hwnd, "particle.vs", "particle.ps");
+}
+
+void ParticleShaderClass::Shutdown()
+{
+	ShutdownShader();
+}
+
+bool ParticleShaderClass::SetShaderParameters(ID3D11DeviceContext* deviceContext, XMMATRIX viewMatrix, XMMATRIX projectionMatrix)
+{
+	// Looked up every time, a reload may have swapped it since last frame
+	const ShaderProgramType* program = m_ShaderCache->GetProgram(m_program);
+	if (program == nullptr)
+		return false;
+
+	// Shaders want column major
+	viewMatrix = XMMatrixTranspose(viewMatrix);
+	projectionMatrix = XMMatrixTranspose(projectionMatrix);
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		return false;
+
+	MatrixBufferType* data = (MatrixBufferType*)mappedResource.pData;
+	data->view = viewMatrix;
+	data->projection = projectionMatrix;
+	deviceContext->Unmap(m_matrixBuffer, 0);
+
+	deviceContext->VSSetConstantBuffers(0, 1, &m_matrixBuffer);
+	deviceContext->IASetInputLayout(program->layout);
+	deviceContext->VSSetShader(program->vertexShader, nullptr, 0);
+	deviceContext->PSSetShader(program->pixelShader, nullptr, 0);
+	return true;
+}
+
+bool ParticleShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, const char* vsFilename, const char* psFilename)
+{
+	HRESULT result;
+
+	// Has to match ParticleVertexType in particlesystemclass.h, per instance, the corners come from SV_VertexID
+	D3D11_INPUT_ELEMENT_DESC polygonLayout[3];
+	polygonLayout[0].SemanticName = "POSITION";
+	polygonLayout[0].SemanticIndex = 0;
+	polygonLayout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	polygonLayout[0].InputSlot = 0;
+	polygonLayout[0].AlignedByteOffset = 0;
+	polygonLayout[0].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	polygonLayout[0].InstanceDataStepRate = 1;
+
+	polygonLayout[1].SemanticName = "TEXCOORD";
+	polygonLayout[1].SemanticIndex = 0;
+	polygonLayout[1].Format = DXGI_FORMAT_R32_FLOAT;
+	polygonLayout[1].InputSlot = 0;
+	polygonLayout[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[1].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	polygonLayout[1].InstanceDataStepRate = 1;
+
+	polygonLayout[2].SemanticName = "COLOR";
+	polygonLayout[2].SemanticIndex = 0;
+	polygonLayout[2].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	polygonLayout[2].InputSlot = 0;
+	polygonLayout[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[2].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	polygonLayout[2].InstanceDataStepRate = 1;
+
+	const int numElements = sizeof(polygonLayout) / sizeof(polygonLayout[0]);
+	m_program = m_ShaderCache->Load(vsFilename, "ParticleVertexShader", psFilename, "ParticlePixelShader", polygonLayout, numElements);
+	if (m_program < 0)
+	{
+		MessageBox(hwnd, "Error compiling shader.  Check shader-error.txt for message.", vsFilename, MB_OK);
+		return false;
+	}
+
+	D3D11_BUFFER_DESC matrixBufferDesc;
+	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
+	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	matrixBufferDesc.MiscFlags = 0;
+	matrixBufferDesc.StructureByteStride = 0;
+
+	result = device->CreateBuffer(&matrixBufferDesc, nullptr, &m_matrixBuffer);
+	if (FAILED(result))
+		return false;
+
+	return true;
+}
+
+void ParticleShaderClass::ShutdownShader()
+{
+	if (m_matrixBuffer)
+	{
+		m_matrixBuffer->Release();
+		m_matrixBuffer = nullptr;
+	}
+
+	// The program itself belongs to the cache
+	m_program = -1;
+	m_ShaderCache = nullptr;
+}
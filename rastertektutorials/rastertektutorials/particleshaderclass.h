@@ -0,0 +1,43 @@
+#pragma once
+
+#include <d3d11.h>
+#include <directxmath.h>
+#include "shadercacheclass.h"
+
+using namespace DirectX;
+
+/*
+	Shader for ParticleBufferClass (particle.vs / particle.ps), camera facing quads blended over the scene.
+	Like SpriteShaderClass it only binds the pipeline state, the buffer does the drawing.
+	The quads are built in view space so they always face the camera, which is why it takes view and projection
+	separately instead of one matrix.
+*/
+
+class ParticleShaderClass
+{
+private:
+	struct MatrixBufferType
+	{
+		XMMATRIX view;
+		XMMATRIX projection;
+	};
+
+public:
+	ParticleShaderClass();
+	ParticleShaderClass(const ParticleShaderClass&);
+	~ParticleShaderClass();
+
+	bool Initialize(ShaderCacheClass*, ID3D11Device*, HWND);
+	void Shutdown();
+
+	bool SetShaderParameters(ID3D11DeviceContext*, XMMATRIX, XMMATRIX);
+
+private:
+	bool InitializeShader(ID3D11Device*, HWND, const char*, const char*);
+	void ShutdownShader();
+
+private:
+	ShaderCacheClass* m_ShaderCache;
+	int m_program;
+	ID3D11Buffer* m_matrixBuffer;
+};
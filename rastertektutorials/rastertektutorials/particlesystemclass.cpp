@@ -0,0 +1,555 @@
+#include "particlesystemclass.h"
+#include "alignedmemory.h"
+
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+#include <emmintrin.h>
+
+static const unsigned int PARTICLE_CULLED = 0xFFFFFFFF; // a NaN, never the bits of a depth
+
+static unsigned int Hash(unsigned int x)
+{
+	// Bit mixer, good enough that neighbouring slots get unrelated numbers
+	x ^= x >> 16;
+	x *= 0x7FEB352D;
+	x ^= x >> 15;
+	x *= 0x846CA68B;
+	x ^= x >> 16;
+	return x;
+}
+
+static float RandomUnit(unsigned int& state)
+{
+	state = Hash(state);
+	return (float)(state & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+static int DepthBucket(unsigned int key, float farDepth, float scale)
+{
+	float depth;
+	memcpy(&depth, &key, sizeof(depth));
+	const int bucket = (int)((farDepth - depth) * scale);
+	return bucket < PARTICLE_SORT_BUCKETS ? bucket : PARTICLE_SORT_BUCKETS - 1;
+}
+
+ParticleSystemClass::ParticleSystemClass() :
+	m_Jobs(nullptr),
+	m_data(nullptr),
+	m_positionX(nullptr),
+	m_positionY(nullptr),
+	m_positionZ(nullptr),
+	m_velocityX(nullptr),
+	m_velocityY(nullptr),
+	m_velocityZ(nullptr),
+	m_age(nullptr),
+	m_life(nullptr),
+	m_size(nullptr),
+	m_color(nullptr),
+	m_keys(nullptr),
+	m_sorted(nullptr),
+	m_capacity(0),
+	m_count(0),
+	m_frame(0)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+ParticleSystemClass::ParticleSystemClass(const ParticleSystemClass&)
+{
+}
+
+ParticleSystemClass::~ParticleSystemClass()
+{
+}
+
+bool ParticleSystemClass::Initialize(JobSystemClass* jobs, int capacity)
+{
+	m_Jobs = jobs;
+	if (m_Jobs == nullptr || capacity < 1)
+		return false;
+
+	// A multiple of 16 keeps every array 64 byte aligned when they're packed back to back
+	m_capacity = (capacity + 15) & ~15;
+	const size_t arrayBytes = (size_t)m_capacity * sizeof(float);
+
+	m_data = (unsigned char*)AlignedAlloc(arrayBytes * 11 + (size_t)m_capacity * sizeof(SortEntryType), 64);
+	if (m_data == nullptr)
+		return false;
+
+	m_positionX = (float*)(m_data + arrayBytes * 0);
+	m_positionY = (float*)(m_data + arrayBytes * 1);
+	m_positionZ = (float*)(m_data + arrayBytes * 2);
+	m_velocityX = (float*)(m_data + arrayBytes * 3);
+	m_velocityY = (float*)(m_data + arrayBytes * 4);
+	m_velocityZ = (float*)(m_data + arrayBytes * 5);
+	m_age = (float*)(m_data + arrayBytes * 6);
+	m_life = (float*)(m_data + arrayBytes * 7);
+	m_size = (float*)(m_data + arrayBytes * 8);
+	m_color = (unsigned int*)(m_data + arrayBytes * 9);
+	m_keys = (unsigned int*)(m_data + arrayBytes * 10);
+	m_sorted = (SortEntryType*)(m_data + arrayBytes * 11);
+
+	const int cullBatches = (m_capacity + PARTICLE_CULL_BATCH_SIZE - 1) / PARTICLE_CULL_BATCH_SIZE;
+	m_runnerDead.resize(m_Jobs->GetThreadCount());
+	m_bucketCounts.resize((size_t)cullBatches * PARTICLE_SORT_BUCKETS);
+	m_bucketStarts.resize(PARTICLE_SORT_BUCKETS + 1);
+	m_batchNear.resize(cullBatches);
+	m_batchFar.resize(cullBatches);
+	m_count = 0;
+	return true;
+}
+
+void ParticleSystemClass::Shutdown()
+{
+	if (m_data)
+	{
+		AlignedFree(m_data);
+		m_data = nullptr;
+	}
+
+	Clear();
+	m_runnerDead.clear();
+	m_holes.clear();
+	m_fillers.clear();
+	m_bucketCounts.clear();
+	m_bucketStarts.clear();
+	m_batchNear.clear();
+	m_batchFar.clear();
+	m_capacity = 0;
+	m_Jobs = nullptr;
+}
+
+int ParticleSystemClass::AddEmitter(const ParticleEmitterType& emitter)
+{
+	m_emitters.push_back(emitter);
+	m_emitCarry.push_back(0.0f);
+	m_emitCounts.push_back(0);
+	return (int)m_emitters.size() - 1;
+}
+
+ParticleEmitterType* ParticleSystemClass::GetEmitter(int emitter)
+{
+	return emitter >= 0 && emitter < (int)m_emitters.size() ? &m_emitters[emitter] : nullptr;
+}
+
+bool ParticleSystemClass::AddPlane(const XMFLOAT4& plane)
+{
+	if (m_planes.size() >= PARTICLE_MAX_PLANES)
+		return false;
+
+	m_planes.push_back(plane);
+	return true;
+}
+
+void ParticleSystemClass::Clear()
+{
+	m_emitters.clear();
+	m_emitCarry.clear();
+	m_emitCounts.clear();
+	m_planes.clear();
+	m_count = 0;
+}
+
+void ParticleSystemClass::Update(float deltaTime)
+{
+	m_stats.emitted = 0;
+	m_stats.died = 0;
+	m_stats.moved = 0;
+	++m_frame;
+
+	Emit(deltaTime);
+	if (m_count == 0)
+		return;
+
+	for (std::vector<unsigned int>& dead : m_runnerDead)
+		dead.clear();
+
+	m_Jobs->ParallelFor(m_count, PARTICLE_BATCH_SIZE, [this, deltaTime](int begin, int end, int runner)
+	{
+		Integrate(begin, end, deltaTime, m_runnerDead[runner]);
+	});
+
+	Compact();
+}
+
+void ParticleSystemClass::Build(XMMATRIX viewMatrix, const XMFLOAT4* frustumPlanes, ParticleFrameType& frame)
+{
+	frame.alive = (unsigned int)m_count;
+	frame.count = 0;
+	m_stats.visible = 0;
+	if (m_count == 0)
+		return;
+
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, viewMatrix);
+
+	const int batches = (m_count + PARTICLE_CULL_BATCH_SIZE - 1) / PARTICLE_CULL_BATCH_SIZE;
+	m_Jobs->ParallelFor(batches, 1, [this, &view, frustumPlanes](int begin, int end, int)
+	{
+		for (int batch = begin; batch < end; ++batch)
+			Cull(batch, view, frustumPlanes);
+	});
+
+	// Buckets spread over what's actually visible this frame
+	float nearDepth = FLT_MAX;
+	float farDepth = 0.0f;
+	for (int batch = 0; batch < batches; ++batch)
+	{
+		nearDepth = m_batchNear[batch] < nearDepth ? m_batchNear[batch] : nearDepth;
+		farDepth = m_batchFar[batch] > farDepth ? m_batchFar[batch] : farDepth;
+	}
+
+	if (nearDepth > farDepth)
+		return;
+
+	const float scale = farDepth > nearDepth ? PARTICLE_SORT_BUCKETS / (farDepth - nearDepth) : 0.0f;
+	m_Jobs->ParallelFor(batches, 1, [this, farDepth, scale](int begin, int end, int)
+	{
+		for (int batch = begin; batch < end; ++batch)
+			Count(batch, farDepth, scale);
+	});
+
+	// Counts to offsets, bucket major so each bucket's particles end up together, batches in order inside it
+	unsigned int total = 0;
+	for (int bucket = 0; bucket < PARTICLE_SORT_BUCKETS; ++bucket)
+	{
+		m_bucketStarts[bucket] = total;
+		for (int batch = 0; batch < batches; ++batch)
+		{
+			unsigned int& count = m_bucketCounts[(size_t)batch * PARTICLE_SORT_BUCKETS + bucket];
+			const unsigned int start = total;
+			total += count;
+			count = start;
+		}
+	}
+	m_bucketStarts[PARTICLE_SORT_BUCKETS] = total;
+
+	m_stats.visible = total;
+	frame.count = total;
+	if (frame.vertices.size() < total)
+		frame.vertices.resize(total);
+
+	m_Jobs->ParallelFor(batches, 1, [this, farDepth, scale](int begin, int end, int)
+	{
+		for (int batch = begin; batch < end; ++batch)
+			Scatter(batch, farDepth, scale);
+	});
+
+	m_Jobs->ParallelFor(PARTICLE_SORT_BUCKETS, 16, [this, &frame](int begin, int end, int)
+	{
+		for (int bucket = begin; bucket < end; ++bucket)
+			SortBucket(bucket, frame);
+	});
+}
+
+int ParticleSystemClass::GetCount()
+{
+	return m_count;
+}
+
+int ParticleSystemClass::GetCapacity()
+{
+	return m_capacity;
+}
+
+const ParticleStatsType& ParticleSystemClass::GetStats()
+{
+	return m_stats;
+}
+
+void ParticleSystemClass::GetParticle(int index, XMFLOAT3& position, XMFLOAT3& velocity)
+{
+	position = XMFLOAT3(m_positionX[index], m_positionY[index], m_positionZ[index]);
+	velocity = XMFLOAT3(m_velocityX[index], m_velocityY[index], m_velocityZ[index]);
+}
+
+void ParticleSystemClass::Emit(float deltaTime)
+{
+	// Serial part is only deciding how many, a handful of emitters
+	int total = 0;
+	for (size_t emitter = 0; emitter < m_emitters.size(); ++emitter)
+	{
+		m_emitCarry[emitter] += m_emitters[emitter].rate * deltaTime;
+		int count = (int)m_emitCarry[emitter];
+		m_emitCarry[emitter] -= (float)count;
+
+		const int room = m_capacity - m_count - total;
+		count = count < room ? count : room;
+		m_emitCounts[emitter] = count;
+		total += count;
+	}
+
+	m_stats.emitted = (unsigned int)total;
+	if (total == 0)
+		return;
+
+	const int start = m_count;
+	const unsigned int seed = m_frame * 0x9E3779B9;
+	m_Jobs->ParallelFor(total, PARTICLE_BATCH_SIZE, [this, start, seed](int begin, int end, int)
+	{
+		// Which emitter the batch starts in, then walk forwards
+		int emitter = 0;
+		int emitterEnd = m_emitCounts[0];
+		while (begin >= emitterEnd)
+			emitterEnd += m_emitCounts[++emitter];
+
+		for (int i = begin; i < end; ++i)
+		{
+			while (i >= emitterEnd)
+				emitterEnd += m_emitCounts[++emitter];
+
+			const ParticleEmitterType& source = m_emitters[emitter];
+			const int slot = start + i;
+			unsigned int random = seed ^ (unsigned int)slot;
+
+			const float spread = source.spread * source.speed;
+			m_positionX[slot] = source.position.x;
+			m_positionY[slot] = source.position.y;
+			m_positionZ[slot] = source.position.z;
+			m_velocityX[slot] = source.direction.x * source.speed + (RandomUnit(random) * 2.0f - 1.0f) * spread;
+			m_velocityY[slot] = source.direction.y * source.speed + (RandomUnit(random) * 2.0f - 1.0f) * spread;
+			m_velocityZ[slot] = source.direction.z * source.speed + (RandomUnit(random) * 2.0f - 1.0f) * spread;
+			m_age[slot] = 0.0f;
+			m_life[slot] = source.life * (0.75f + 0.25f * RandomUnit(random));
+			m_size[slot] = source.size;
+			m_color[slot] = source.color;
+		}
+	});
+
+	m_count += total;
+}
+
+void ParticleSystemClass::Integrate(int begin, int end, float deltaTime, std::vector<unsigned int>& dead)
+{
+	const float drag = 1.0f - PARTICLE_DRAG * deltaTime;
+	const __m128 dt = _mm_set1_ps(deltaTime);
+	const __m128 gravity = _mm_set1_ps(PARTICLE_GRAVITY * deltaTime);
+	const __m128 damping = _mm_set1_ps(drag > 0.0f ? drag : 0.0f);
+	const __m128 bounce = _mm_set1_ps(1.0f + PARTICLE_RESTITUTION);
+	const __m128 friction = _mm_set1_ps(PARTICLE_FRICTION);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const int planeCount = (int)m_planes.size();
+
+	// begin is a multiple of the batch size, so every load is aligned. The last group of 4 can run past end into the padding
+	for (int i = begin; i < end; i += 4)
+	{
+		__m128 vx = _mm_mul_ps(_mm_load_ps(&m_velocityX[i]), damping);
+		__m128 vy = _mm_mul_ps(_mm_add_ps(_mm_load_ps(&m_velocityY[i]), gravity), damping);
+		__m128 vz = _mm_mul_ps(_mm_load_ps(&m_velocityZ[i]), damping);
+		__m128 px = _mm_add_ps(_mm_load_ps(&m_positionX[i]), _mm_mul_ps(vx, dt));
+		__m128 py = _mm_add_ps(_mm_load_ps(&m_positionY[i]), _mm_mul_ps(vy, dt));
+		__m128 pz = _mm_add_ps(_mm_load_ps(&m_positionZ[i]), _mm_mul_ps(vz, dt));
+
+		for (int plane = 0; plane < planeCount; ++plane)
+		{
+			const __m128 nx = _mm_set1_ps(m_planes[plane].x);
+			const __m128 ny = _mm_set1_ps(m_planes[plane].y);
+			const __m128 nz = _mm_set1_ps(m_planes[plane].z);
+			const __m128 d = _mm_set1_ps(m_planes[plane].w);
+
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, nx), _mm_mul_ps(py, ny)), _mm_mul_ps(pz, nz)), d);
+			const __m128 behind = _mm_cmplt_ps(distance, zero);
+			if (_mm_movemask_ps(behind) == 0)
+				continue;
+
+			// Back onto the plane
+			const __m128 push = _mm_and_ps(behind, distance);
+			px = _mm_sub_ps(px, _mm_mul_ps(nx, push));
+			py = _mm_sub_ps(py, _mm_mul_ps(ny, push));
+			pz = _mm_sub_ps(pz, _mm_mul_ps(nz, push));
+
+			// Reflect the part of the velocity going into the plane and slow the rest down
+			const __m128 speed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, nx), _mm_mul_ps(vy, ny)), _mm_mul_ps(vz, nz));
+			const __m128 hit = _mm_and_ps(behind, _mm_cmplt_ps(speed, zero));
+			const __m128 impulse = _mm_and_ps(hit, _mm_mul_ps(speed, bounce));
+			const __m128 keep = _mm_or_ps(_mm_and_ps(hit, friction), _mm_andnot_ps(hit, one));
+			vx = _mm_mul_ps(_mm_sub_ps(vx, _mm_mul_ps(nx, impulse)), keep);
+			vy = _mm_mul_ps(_mm_sub_ps(vy, _mm_mul_ps(ny, impulse)), keep);
+			vz = _mm_mul_ps(_mm_sub_ps(vz, _mm_mul_ps(nz, impulse)), keep);
+		}
+
+		const __m128 age = _mm_add_ps(_mm_load_ps(&m_age[i]), dt);
+
+		_mm_store_ps(&m_positionX[i], px);
+		_mm_store_ps(&m_positionY[i], py);
+		_mm_store_ps(&m_positionZ[i], pz);
+		_mm_store_ps(&m_velocityX[i], vx);
+		_mm_store_ps(&m_velocityY[i], vy);
+		_mm_store_ps(&m_velocityZ[i], vz);
+		_mm_store_ps(&m_age[i], age);
+
+		int expired = _mm_movemask_ps(_mm_cmpge_ps(age, _mm_load_ps(&m_life[i])));
+		while (expired)
+		{
+			const int lane = expired & 1 ? 0 : expired & 2 ? 1 : expired & 4 ? 2 : 3;
+			expired &= expired - 1;
+			if (i + lane < end)
+				dead.push_back((unsigned int)(i + lane));
+		}
+	}
+}
+
+void ParticleSystemClass::Compact()
+{
+	int died = 0;
+	for (const std::vector<unsigned int>& dead : m_runnerDead)
+		died += (int)dead.size();
+
+	m_stats.died = (unsigned int)died;
+	if (died == 0)
+		return;
+
+	// Holes below the new count get the live particles from above it, there are exactly as many of each
+	const int count = m_count - died;
+	m_holes.clear();
+	for (const std::vector<unsigned int>& dead : m_runnerDead)
+	{
+		for (unsigned int index : dead)
+		{
+			if ((int)index < count)
+				m_holes.push_back(index);
+		}
+	}
+
+	m_fillers.clear();
+	for (int i = count; i < m_count; ++i)
+	{
+		if (m_age[i] < m_life[i])
+			m_fillers.push_back((unsigned int)i);
+	}
+
+	m_Jobs->ParallelFor((int)m_holes.size(), PARTICLE_BATCH_SIZE, [this](int begin, int end, int)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const unsigned int to = m_holes[i];
+			const unsigned int from = m_fillers[i];
+			m_positionX[to] = m_positionX[from];
+			m_positionY[to] = m_positionY[from];
+			m_positionZ[to] = m_positionZ[from];
+			m_velocityX[to] = m_velocityX[from];
+			m_velocityY[to] = m_velocityY[from];
+			m_velocityZ[to] = m_velocityZ[from];
+			m_age[to] = m_age[from];
+			m_life[to] = m_life[from];
+			m_size[to] = m_size[from];
+			m_color[to] = m_color[from];
+		}
+	});
+
+	m_stats.moved = (unsigned int)m_holes.size();
+	m_count = count;
+}
+
+void ParticleSystemClass::Cull(int batch, const XMFLOAT4X4& view, const XMFLOAT4* frustumPlanes)
+{
+	const int begin = batch * PARTICLE_CULL_BATCH_SIZE;
+	const int end = begin + PARTICLE_CULL_BATCH_SIZE < m_count ? begin + PARTICLE_CULL_BATCH_SIZE : m_count;
+
+	// View depth is the third column of the (row vector) view matrix
+	const __m128 viewX = _mm_set1_ps(view._13);
+	const __m128 viewY = _mm_set1_ps(view._23);
+	const __m128 viewZ = _mm_set1_ps(view._33);
+	const __m128 viewW = _mm_set1_ps(view._43);
+	const __m128 zero = _mm_setzero_ps();
+
+	float nearDepth = FLT_MAX;
+	float farDepth = 0.0f;
+	for (int i = begin; i < end; i += 4)
+	{
+		const __m128 px = _mm_load_ps(&m_positionX[i]);
+		const __m128 py = _mm_load_ps(&m_positionY[i]);
+		const __m128 pz = _mm_load_ps(&m_positionZ[i]);
+		const __m128 radius = _mm_sub_ps(zero, _mm_load_ps(&m_size[i]));
+
+		// Sphere against the six planes, inside or touching all of them. The near plane keeps depths positive
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(frustumPlanes[plane].x)), _mm_mul_ps(py, _mm_set1_ps(frustumPlanes[plane].y))),
+				_mm_mul_ps(pz, _mm_set1_ps(frustumPlanes[plane].z))), _mm_set1_ps(frustumPlanes[plane].w));
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, radius));
+		}
+
+		const __m128 depth = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, viewX), _mm_mul_ps(py, viewY)), _mm_mul_ps(pz, viewZ)), viewW), zero);
+		const __m128i keys = _mm_or_si128(_mm_and_si128(_mm_castps_si128(visible), _mm_castps_si128(depth)), _mm_andnot_si128(_mm_castps_si128(visible), _mm_set1_epi32(-1)));
+		_mm_store_si128((__m128i*)&m_keys[i], keys);
+
+		const int mask = _mm_movemask_ps(visible);
+		if (mask == 0)
+			continue;
+
+		float depths[4];
+		_mm_storeu_ps(depths, depth);
+		for (int lane = 0; lane < 4 && i + lane < end; ++lane)
+		{
+			if (mask & (1 << lane))
+			{
+				nearDepth = depths[lane] < nearDepth ? depths[lane] : nearDepth;
+				farDepth = depths[lane] > farDepth ? depths[lane] : farDepth;
+			}
+		}
+	}
+
+	m_batchNear[batch] = nearDepth;
+	m_batchFar[batch] = farDepth;
+}
+
+void ParticleSystemClass::Count(int batch, float farDepth, float scale)
+{
+	unsigned int* counts = &m_bucketCounts[(size_t)batch * PARTICLE_SORT_BUCKETS];
+	memset(counts, 0, PARTICLE_SORT_BUCKETS * sizeof(unsigned int));
+
+	const int begin = batch * PARTICLE_CULL_BATCH_SIZE;
+	const int end = begin + PARTICLE_CULL_BATCH_SIZE < m_count ? begin + PARTICLE_CULL_BATCH_SIZE : m_count;
+	for (int i = begin; i < end; ++i)
+	{
+		if (m_keys[i] != PARTICLE_CULLED)
+			++counts[DepthBucket(m_keys[i], farDepth, scale)];
+	}
+}
+
+void ParticleSystemClass::Scatter(int batch, float farDepth, float scale)
+{
+	unsigned int* offsets = &m_bucketCounts[(size_t)batch * PARTICLE_SORT_BUCKETS];
+
+	const int begin = batch * PARTICLE_CULL_BATCH_SIZE;
+	const int end = begin + PARTICLE_CULL_BATCH_SIZE < m_count ? begin + PARTICLE_CULL_BATCH_SIZE : m_count;
+	for (int i = begin; i < end; ++i)
+	{
+		const unsigned int key = m_keys[i];
+		if (key != PARTICLE_CULLED)
+		{
+			// Positive floats sort like their bits, flipped so the furthest comes first. The vertex goes along with
+			// the key, reading the particle here is in order and the sort never has to go back to the arrays
+			const float fade = 1.0f - m_age[i] / m_life[i];
+			const unsigned int alpha = (unsigned int)((float)(m_color[i] >> 24) * (fade > 0.0f ? fade : 0.0f));
+
+			SortEntryType& entry = m_sorted[offsets[DepthBucket(key, farDepth, scale)]++];
+			entry.key = ~key;
+			entry.vertex.position = XMFLOAT3(m_positionX[i], m_positionY[i], m_positionZ[i]);
+			entry.vertex.size = m_size[i];
+			entry.vertex.color = (m_color[i] & 0x00FFFFFF) | (alpha << 24);
+		}
+	}
+}
+
+void ParticleSystemClass::SortBucket(int bucket, ParticleFrameType& frame)
+{
+	const unsigned int begin = m_bucketStarts[bucket];
+	const unsigned int end = m_bucketStarts[bucket + 1];
+	if (begin == end)
+		return;
+
+	// Small key first is far first
+	std::sort(m_sorted + begin, m_sorted + end, [](const SortEntryType& a, const SortEntryType& b)
+	{
+		return a.key < b.key;
+	});
+
+	ParticleVertexType* vertices = &frame.vertices[begin];
+	for (unsigned int i = begin; i < end; ++i)
+		*vertices++ = m_sorted[i].vertex;
+}
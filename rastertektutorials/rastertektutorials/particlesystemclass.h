@@ -0,0 +1,146 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+#include "jobsystemclass.h"
+
+using namespace DirectX;
+
+/*
+	CPU particles for effects with a lot of them (sparks, spray, debris), simulated on the main thread like the rest
+	of the scene. State is structure of arrays, one 64 byte aligned array per field, so four particles load with one
+	SSE instruction. Update() runs on the job threads in batches of PARTICLE_BATCH_SIZE:
+		emission - every emitter's new particles for the frame go on the end, randomness is a hash of the slot so it
+		           doesn't matter which thread fills which slot
+		integration - gravity, drag, position, age
+		collision - every plane pushes particles back out and reflects their velocity (restitution, friction)
+		compaction - dead particles get filled from the live ones at the end, order doesn't matter since Build sorts
+	Build() culls against the frustum and sorts back to front for alpha blending, also on the jobs: the cull pass keeps
+	each visible particle's view depth and the batch's depth range, the visible range gets cut into PARTICLE_SORT_BUCKETS
+	buckets (so an effect far off still spreads over all of them), every batch counts and scatters its particles into
+	the buckets, then every bucket is sorted and written out as vertices on its own, straight to where they go in the
+	frame's vertex array.
+	There's no scalar fallback, the arrays are padded to a multiple of 4 so the last batch can run over its end.
+*/
+
+const int PARTICLE_BATCH_SIZE = 4096; // particles per job, multiple of 4
+const int PARTICLE_CULL_BATCH_SIZE = 16384; // per cull job, bigger since every batch has its own bucket counts
+const int PARTICLE_SORT_BUCKETS = 4096; // depth buckets over the visible depth range
+const int PARTICLE_MAX_PLANES = 8;
+const float PARTICLE_GRAVITY = -9.81f;
+const float PARTICLE_DRAG = 0.1f; // fraction of velocity lost per second
+const float PARTICLE_RESTITUTION = 0.4f; // how much of the speed into a plane bounces back
+const float PARTICLE_FRICTION = 0.8f; // velocity kept on a bounce
+
+// Same layout as VertexInputType in particle.vs, one per particle, the vertex shader expands it into a quad
+struct ParticleVertexType
+{
+	XMFLOAT3 position;
+	float size;
+	unsigned int color; // RGBA8, alpha fades out with age
+};
+
+// One frame's visible particles, back to front. Only the first count are used, the vector never shrinks
+// so a frame with fewer particles than the last doesn't clear anything
+struct ParticleFrameType
+{
+	std::vector<ParticleVertexType> vertices;
+	unsigned int count;
+	unsigned int alive; // before culling
+};
+
+struct ParticleEmitterType
+{
+	XMFLOAT3 position;
+	float rate; // particles per second
+	XMFLOAT3 direction; // unit
+	float spread; // random velocity added, as a fraction of speed
+	float speed;
+	float life; // seconds, every particle gets between 3/4 of this and all of it
+	float size;
+	unsigned int color; // RGBA8
+};
+
+struct ParticleStatsType
+{
+	unsigned int emitted;
+	unsigned int died;
+	unsigned int moved; // compaction copies
+	unsigned int visible;
+};
+
+class ParticleSystemClass
+{
+private:
+	struct SortEntryType
+	{
+		unsigned int key;
+		ParticleVertexType vertex;
+	};
+
+public:
+	ParticleSystemClass();
+	ParticleSystemClass(const ParticleSystemClass&);
+	~ParticleSystemClass();
+
+	// Job system and how many particles there can be at once
+	bool Initialize(JobSystemClass*, int);
+	void Shutdown();
+
+	// Emitters and planes stay until Clear(). Emission stops when the arrays are full
+	int AddEmitter(const ParticleEmitterType&);
+	ParticleEmitterType* GetEmitter(int);
+	// Plane as normal (unit) and d, particles are kept on the side where dot(normal, p) + d >= 0
+	bool AddPlane(const XMFLOAT4&);
+	void Clear();
+
+	void Update(float);
+	// View matrix and the frustum planes (FrustumClass::GetPlanes)
+	void Build(XMMATRIX, const XMFLOAT4*, ParticleFrameType&);
+
+	int GetCount();
+	int GetCapacity();
+	const ParticleStatsType& GetStats();
+	// Read only views for tests and debugging, index < GetCount()
+	void GetParticle(int, XMFLOAT3&, XMFLOAT3&);
+
+private:
+	void Emit(float);
+	void Integrate(int, int, float, std::vector<unsigned int>&);
+	void Compact();
+	void Cull(int, const XMFLOAT4X4&, const XMFLOAT4*);
+	void Count(int, float, float);
+	void Scatter(int, float, float);
+	void SortBucket(int, ParticleFrameType&);
+
+private:
+	JobSystemClass* m_Jobs;
+	unsigned char* m_data;
+	float* m_positionX;
+	float* m_positionY;
+	float* m_positionZ;
+	float* m_velocityX;
+	float* m_velocityY;
+	float* m_velocityZ;
+	float* m_age;
+	float* m_life;
+	float* m_size;
+	unsigned int* m_color;
+	unsigned int* m_keys; // view depth bits per particle from the last Build, PARTICLE_CULLED if it isn't visible
+	SortEntryType* m_sorted;
+	int m_capacity;
+	int m_count;
+	unsigned int m_frame;
+	std::vector<ParticleEmitterType> m_emitters;
+	std::vector<float> m_emitCarry; // fractions of a particle each emitter owes from earlier frames
+	std::vector<int> m_emitCounts; // this frame's, per emitter
+	std::vector<XMFLOAT4> m_planes;
+	std::vector<std::vector<unsigned int>> m_runnerDead;
+	std::vector<unsigned int> m_holes;
+	std::vector<unsigned int> m_fillers;
+	std::vector<unsigned int> m_bucketCounts; // PARTICLE_SORT_BUCKETS per cull batch, turned into offsets before the scatter
+	std::vector<unsigned int> m_bucketStarts; // where each bucket starts in m_sorted, one extra at the end
+	std::vector<float> m_batchNear; // closest and furthest visible depth per cull batch
+	std::vector<float> m_batchFar;
+	ParticleStatsType m_stats;
+};
@@ -0,0 +1,482 @@
+#include "profilerclass.h"
+
+#include <stdio.h>
+#include <string.h>
+
+ProfilerClass::ProfilerClass() :
+	m_device(nullptr),
+	m_deviceContext(nullptr),
+	m_currentSlot(0),
+	m_inFrame(false),
+	m_frameIndex(0),
+	m_droppedFrames(0),
+	m_cpuFrequency(1),
+	m_startTicks(0),
+	m_passDepth(0),
+	m_zoneDepth(0),
+	m_historyHead(0)
+{
+	ZeroMemory(m_slots, sizeof(m_slots));
+}
+
+ProfilerClass::ProfilerClass(const ProfilerClass&)
+{
+}
+
+ProfilerClass::~ProfilerClass()
+{
+}
+
+bool ProfilerClass::Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
+{
+	m_device = device;
+	m_deviceContext = deviceContext;
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	m_cpuFrequency = frequency.QuadPart;
+	m_startTicks = Now();
+
+	m_lastFrame.reserve(PROFILER_MAX_PASSES + PROFILER_MAX_ZONES + 2);
+	m_history.reserve(PROFILER_MAX_HISTORY);
+
+	// Headless, nothing to create
+	if (m_device == nullptr || m_deviceContext == nullptr)
+	{
+		m_device = nullptr;
+		m_deviceContext = nullptr;
+		return true;
+	}
+
+	// Every slot gets its own queries so frames in flight never share one
+	for (int i = 0; i < PROFILER_FRAME_LATENCY; ++i)
+	{
+		FrameSlot& slot = m_slots[i];
+		if (CreateQuery(D3D11_QUERY_TIMESTAMP_DISJOINT, &slot.disjoint) == false)
+			return false;
+
+		if (CreateQuery(D3D11_QUERY_TIMESTAMP, &slot.frameBegin) == false)
+			return false;
+
+		if (CreateQuery(D3D11_QUERY_TIMESTAMP, &slot.frameEnd) == false)
+			return false;
+
+		for (int p = 0; p < PROFILER_MAX_PASSES; ++p)
+		{
+			if (CreateQuery(D3D11_QUERY_TIMESTAMP, &slot.passes[p].begin) == false)
+				return false;
+
+			if (CreateQuery(D3D11_QUERY_TIMESTAMP, &slot.passes[p].end) == false)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void ProfilerClass::Shutdown()
+{
+	for (int i = 0; i < PROFILER_FRAME_LATENCY; ++i)
+		ReleaseSlot(m_slots[i]);
+
+	m_device = nullptr;
+	m_deviceContext = nullptr;
+	m_lastFrame.clear();
+	m_history.clear();
+}
+
+void ProfilerClass::BeginFrame()
+{
+	/*
+		Read back whatever finished, oldest first so the history stays in order.
+		The slot we are about to reuse is the oldest one, if it still isn't done the gpu is more
+		than PROFILER_FRAME_LATENCY frames behind and we throw that frame away instead of stalling.
+	*/
+	for (int i = 1; i <= PROFILER_FRAME_LATENCY; ++i)
+	{
+		FrameSlot& slot = m_slots[(m_currentSlot + i) % PROFILER_FRAME_LATENCY];
+		if (slot.pending == false)
+			continue;
+
+		if (Resolve(slot) == false)
+			break;
+	}
+
+	m_currentSlot = (m_currentSlot + 1) % PROFILER_FRAME_LATENCY;
+	FrameSlot& slot = m_slots[m_currentSlot];
+	if (slot.pending)
+	{
+		slot.pending = false;
+		++m_droppedFrames;
+	}
+
+	slot.passCount = 0;
+	slot.zoneCount = 0;
+	slot.frame = m_frameIndex++;
+	m_passDepth = 0;
+	m_zoneDepth = 0;
+	m_inFrame = true;
+
+	slot.cpuBegin = Now();
+	if (m_deviceContext)
+	{
+		m_deviceContext->Begin(slot.disjoint);
+		m_deviceContext->End(slot.frameBegin);
+	}
+}
+
+void ProfilerClass::EndFrame()
+{
+	if (m_inFrame == false)
+		return;
+
+	// Close anything left open so a missing End call doesn't corrupt the next frame
+	while (m_passDepth > 0)
+		EndPass();
+
+	while (m_zoneDepth > 0)
+		EndCpuZone();
+
+	FrameSlot& slot = m_slots[m_currentSlot];
+	if (m_deviceContext)
+	{
+		m_deviceContext->End(slot.frameEnd);
+		m_deviceContext->End(slot.disjoint);
+	}
+
+	slot.cpuEnd = Now();
+	slot.pending = true;
+	m_inFrame = false;
+}
+
+void ProfilerClass::BeginPass(const char* name)
+{
+	FrameSlot& slot = m_slots[m_currentSlot];
+	if (m_inFrame == false)
+		return;
+
+	// Out of room it isn't recorded but still takes a level, so its EndPass closes nothing rather than its parent
+	if (slot.passCount >= PROFILER_MAX_PASSES || m_passDepth >= PROFILER_MAX_PASSES)
+	{
+		if (m_passDepth < PROFILER_MAX_PASSES)
+			m_passStack[m_passDepth] = -1;
+
+		++m_passDepth;
+		return;
+	}
+
+	PassRecord& pass = slot.passes[slot.passCount];
+	pass.name = name;
+	pass.depth = m_passDepth;
+	pass.syntheticBegin = Now();
+	pass.syntheticEnd = pass.syntheticBegin;
+
+	if (m_deviceContext)
+		m_deviceContext->End(pass.begin);
+
+	m_passStack[m_passDepth++] = slot.passCount++;
+}
+
+void ProfilerClass::EndPass()
+{
+	if (m_passDepth <= 0)
+		return;
+
+	--m_passDepth;
+	if (m_passDepth >= PROFILER_MAX_PASSES || m_passStack[m_passDepth] < 0)
+		return;
+
+	FrameSlot& slot = m_slots[m_currentSlot];
+	PassRecord& pass = slot.passes[m_passStack[m_passDepth]];
+	pass.syntheticEnd = Now();
+
+	if (m_deviceContext)
+		m_deviceContext->End(pass.end);
+}
+
+void ProfilerClass::BeginCpuZone(const char* name)
+{
+	FrameSlot& slot = m_slots[m_currentSlot];
+	if (m_inFrame == false)
+		return;
+
+	// Same as BeginPass, a zone that doesn't fit still has to be matched by its EndCpuZone
+	if (slot.zoneCount >= PROFILER_MAX_ZONES || m_zoneDepth >= PROFILER_MAX_ZONES)
+	{
+		if (m_zoneDepth < PROFILER_MAX_ZONES)
+			m_zoneStack[m_zoneDepth] = -1;
+
+		++m_zoneDepth;
+		return;
+	}
+
+	ZoneRecord& zone = slot.zones[slot.zoneCount];
+	zone.name = name;
+	zone.depth = m_zoneDepth;
+	zone.begin = Now();
+	zone.end = zone.begin;
+
+	m_zoneStack[m_zoneDepth++] = slot.zoneCount++;
+}
+
+void ProfilerClass::EndCpuZone()
+{
+	if (m_zoneDepth <= 0)
+		return;
+
+	--m_zoneDepth;
+	if (m_zoneDepth >= PROFILER_MAX_ZONES || m_zoneStack[m_zoneDepth] < 0)
+		return;
+
+	FrameSlot& slot = m_slots[m_currentSlot];
+	slot.zones[m_zoneStack[m_zoneDepth]].end = Now();
+}
+
+const std::vector<ProfilerEvent>& ProfilerClass::GetLastFrameEvents()
+{
+	return m_lastFrame;
+}
+
+double ProfilerClass::GetGpuFrameTime()
+{
+	return GetGpuPassTime("Frame");
+}
+
+double ProfilerClass::GetCpuFrameTime()
+{
+	return GetCpuZoneTime("Frame");
+}
+
+double ProfilerClass::GetGpuPassTime(const char* name)
+{
+	// Passes can run more than once a frame so add them all up
+	double total = 0.0;
+	for (const ProfilerEvent& e : m_lastFrame)
+	{
+		if (e.gpu && strcmp(e.name, name) == 0)
+			total += e.endMs - e.startMs;
+	}
+
+	return total;
+}
+
+double ProfilerClass::GetCpuZoneTime(const char* name)
+{
+	double total = 0.0;
+	for (const ProfilerEvent& e : m_lastFrame)
+	{
+		if (e.gpu == false && strcmp(e.name, name) == 0)
+			total += e.endMs - e.startMs;
+	}
+
+	return total;
+}
+
+unsigned long long ProfilerClass::GetDroppedFrames()
+{
+	return m_droppedFrames;
+}
+
+double ProfilerClass::GetTimeMs()
+{
+	return TicksToMs(Now() - m_startTicks);
+}
+
+void ProfilerClass::AddCpuEvent(const char* name, double startMs, double endMs)
+{
+	ProfilerEvent e = { name, false, 0, m_frameIndex, startMs, endMs };
+	AddHistory(e);
+}
+
+bool ProfilerClass::WriteTrace(const char* filename)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "w") != 0 || file == nullptr)
+		return false;
+
+	/*
+		Chrome trace event format, complete ("X") events with microsecond timestamps.
+		CPU zones go on thread 1 and GPU passes on thread 2 of the same process so they line up
+		on one timeline when loaded into chrome://tracing.
+	*/
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+	const size_t count = m_history.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Oldest first, m_historyHead is the oldest entry once the ring has wrapped
+		const ProfilerEvent& e = m_history[(m_historyHead + i) % count];
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+			e.name, e.gpu ? "gpu" : "cpu", e.gpu ? 2 : 1, e.startMs * 1000.0, (e.endMs - e.startMs) * 1000.0, e.frame);
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+bool ProfilerClass::CreateQuery(D3D11_QUERY type, ID3D11Query** query)
+{
+	D3D11_QUERY_DESC queryDesc;
+	queryDesc.Query = type;
+	queryDesc.MiscFlags = 0;
+
+	if (FAILED(m_device->CreateQuery(&queryDesc, query)))
+		return false;
+
+	return true;
+}
+
+bool ProfilerClass::Resolve(FrameSlot& slot)
+{
+	const double cpuBeginMs = TicksToMs(slot.cpuBegin - m_startTicks);
+	const double cpuEndMs = TicksToMs(slot.cpuEnd - m_startTicks);
+
+	// Default to the synthetic timestamps, these get replaced by the real ones below when we have a device
+	double gpuFrequency = (double)m_cpuFrequency;
+	UINT64 frameBegin = (UINT64)slot.cpuBegin;
+	UINT64 frameEnd = (UINT64)slot.cpuEnd;
+
+	if (m_deviceContext)
+	{
+		// DONOTFLUSH so polling never forces a submit, S_FALSE just means try again next frame
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if (m_deviceContext->GetData(slot.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return false;
+
+		// The gpu clock changed during the frame (power state etc.) so the timestamps are garbage
+		if (disjoint.Disjoint)
+		{
+			slot.pending = false;
+			++m_droppedFrames;
+			return true;
+		}
+
+		gpuFrequency = (double)disjoint.Frequency;
+		if (m_deviceContext->GetData(slot.frameBegin, &frameBegin, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return false;
+
+		if (m_deviceContext->GetData(slot.frameEnd, &frameEnd, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return false;
+	}
+
+	// Grab all the pass timestamps before touching the results so a query that isn't ready leaves them alone
+	UINT64 passBegin[PROFILER_MAX_PASSES];
+	UINT64 passEnd[PROFILER_MAX_PASSES];
+	for (int i = 0; i < slot.passCount; ++i)
+	{
+		const PassRecord& pass = slot.passes[i];
+		passBegin[i] = (UINT64)pass.syntheticBegin;
+		passEnd[i] = (UINT64)pass.syntheticEnd;
+
+		if (m_deviceContext)
+		{
+			if (m_deviceContext->GetData(pass.begin, &passBegin[i], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				return false;
+
+			if (m_deviceContext->GetData(pass.end, &passEnd[i], sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				return false;
+		}
+	}
+
+	/*
+		The gpu and cpu clocks are unrelated so gpu times are placed relative to the cpu time
+		we issued the frame begin timestamp. The gpu actually runs a bit later than that so this
+		lines up submission with execution, good enough to see which passes are expensive.
+	*/
+	m_lastFrame.clear();
+
+	ProfilerEvent cpuFrame = { "Frame", false, 0, slot.frame, cpuBeginMs, cpuEndMs };
+	m_lastFrame.push_back(cpuFrame);
+
+	for (int i = 0; i < slot.zoneCount; ++i)
+	{
+		const ZoneRecord& zone = slot.zones[i];
+		ProfilerEvent e = { zone.name, false, zone.depth + 1, slot.frame,
+			TicksToMs(zone.begin - m_startTicks), TicksToMs(zone.end - m_startTicks) };
+		m_lastFrame.push_back(e);
+	}
+
+	ProfilerEvent gpuFrame = { "Frame", true, 0, slot.frame, cpuBeginMs,
+		cpuBeginMs + (double)(frameEnd - frameBegin) * 1000.0 / gpuFrequency };
+	m_lastFrame.push_back(gpuFrame);
+
+	for (int i = 0; i < slot.passCount; ++i)
+	{
+		ProfilerEvent e = { slot.passes[i].name, true, slot.passes[i].depth + 1, slot.frame,
+			cpuBeginMs + (double)(INT64)(passBegin[i] - frameBegin) * 1000.0 / gpuFrequency,
+			cpuBeginMs + (double)(INT64)(passEnd[i] - frameBegin) * 1000.0 / gpuFrequency };
+		m_lastFrame.push_back(e);
+	}
+
+	for (const ProfilerEvent& e : m_lastFrame)
+		AddHistory(e);
+
+	slot.pending = false;
+	return true;
+}
+
+void ProfilerClass::AddHistory(const ProfilerEvent& e)
+{
+	if (m_history.size() < PROFILER_MAX_HISTORY)
+	{
+		m_history.push_back(e);
+	}
+	else
+	{
+		m_history[m_historyHead] = e;
+		m_historyHead = (m_historyHead + 1) % PROFILER_MAX_HISTORY;
+	}
+}
+
+void ProfilerClass::ReleaseSlot(FrameSlot& slot)
+{
+	if (slot.disjoint)
+	{
+		slot.disjoint->Release();
+		slot.disjoint = nullptr;
+	}
+
+	if (slot.frameBegin)
+	{
+		slot.frameBegin->Release();
+		slot.frameBegin = nullptr;
+	}
+
+	if (slot.frameEnd)
+	{
+		slot.frameEnd->Release();
+		slot.frameEnd = nullptr;
+	}
+
+	for (int p = 0; p < PROFILER_MAX_PASSES; ++p)
+	{
+		if (slot.passes[p].begin)
+		{
+			slot.passes[p].begin->Release();
+			slot.passes[p].begin = nullptr;
+		}
+
+		if (slot.passes[p].end)
+		{
+			slot.passes[p].end->Release();
+			slot.passes[p].end = nullptr;
+		}
+	}
+
+	slot.pending = false;
+}
+
+double ProfilerClass::TicksToMs(long long ticks)
+{
+	return (double)ticks * 1000.0 / (double)m_cpuFrequency;
+}
+
+long long ProfilerClass::Now()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
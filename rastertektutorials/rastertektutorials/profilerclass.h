@@ -0,0 +1,123 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+
+/*
+	GPU + CPU profiler.
+	GPU passes are timed with timestamp queries wrapped in a disjoint query. The results only show up a few
+	frames later so we keep PROFILER_FRAME_LATENCY sets of queries in flight and read back the oldest one
+	without flushing, we never wait on the gpu. If a set still isn't ready when we need to reuse it the frame is dropped.
+	CPU zones are stored in the same slot as the gpu passes of that frame so both end up on one timeline.
+	If there is no device (headless) the gpu timestamps are synthesized from the cpu clock so everything downstream still works.
+*/
+
+const int PROFILER_FRAME_LATENCY = 4;
+const int PROFILER_MAX_PASSES = 32;
+const int PROFILER_MAX_ZONES = 64;
+const int PROFILER_MAX_HISTORY = 65536; // max events kept for WriteTrace
+
+struct ProfilerEvent
+{
+	const char* name; // must be a string literal or otherwise outlive the profiler
+	bool gpu;
+	int depth;
+	unsigned long long frame;
+	double startMs; // relative to profiler initialization
+	double endMs;
+};
+
+class ProfilerClass
+{
+public:
+	ProfilerClass();
+	ProfilerClass(const ProfilerClass&);
+	~ProfilerClass();
+
+	// Device and context can be nullptr, then synthetic timestamps are used
+	bool Initialize(ID3D11Device*, ID3D11DeviceContext*);
+	void Shutdown();
+
+	void BeginFrame();
+	void EndFrame();
+
+	void BeginPass(const char*);
+	void EndPass();
+
+	void BeginCpuZone(const char*);
+	void EndCpuZone();
+
+	// Results from the most recently resolved frame
+	const std::vector<ProfilerEvent>& GetLastFrameEvents();
+	double GetGpuFrameTime();
+	double GetCpuFrameTime();
+	double GetGpuPassTime(const char*);
+	double GetCpuZoneTime(const char*);
+	unsigned long long GetDroppedFrames();
+
+	// Current time on the profiler timeline in ms, other systems can use it to log their own events
+	double GetTimeMs();
+	void AddCpuEvent(const char*, double, double);
+
+	// Writes every event still in the history as a chrome://tracing json file
+	bool WriteTrace(const char*);
+
+private:
+	struct PassRecord
+	{
+		const char* name;
+		int depth;
+		ID3D11Query* begin;
+		ID3D11Query* end;
+		long long syntheticBegin;
+		long long syntheticEnd;
+	};
+
+	struct ZoneRecord
+	{
+		const char* name;
+		int depth;
+		long long begin;
+		long long end;
+	};
+
+	struct FrameSlot
+	{
+		ID3D11Query* disjoint;
+		ID3D11Query* frameBegin;
+		ID3D11Query* frameEnd;
+		PassRecord passes[PROFILER_MAX_PASSES];
+		int passCount;
+		ZoneRecord zones[PROFILER_MAX_ZONES];
+		int zoneCount;
+		long long cpuBegin; // cpu time the frame begin timestamp was issued, used to line up the gpu results
+		long long cpuEnd;
+		unsigned long long frame;
+		bool pending;
+	};
+
+	bool CreateQuery(D3D11_QUERY, ID3D11Query**);
+	bool Resolve(FrameSlot&);
+	void AddHistory(const ProfilerEvent&);
+	void ReleaseSlot(FrameSlot&);
+	double TicksToMs(long long);
+	long long Now();
+
+private:
+	ID3D11Device* m_device;
+	ID3D11DeviceContext* m_deviceContext;
+	FrameSlot m_slots[PROFILER_FRAME_LATENCY];
+	int m_currentSlot;
+	bool m_inFrame;
+	unsigned long long m_frameIndex;
+	unsigned long long m_droppedFrames;
+	long long m_cpuFrequency;
+	long long m_startTicks;
+	int m_passStack[PROFILER_MAX_PASSES]; // -1 for a pass that wasn't recorded
+	int m_passDepth; // keeps counting past PROFILER_MAX_PASSES so every End still matches its Begin
+	int m_zoneStack[PROFILER_MAX_ZONES];
+	int m_zoneDepth;
+	std::vector<ProfilerEvent> m_lastFrame;
+	std::vector<ProfilerEvent> m_history;
+	size_t m_historyHead; // ring buffer write position once m_history is full
+};
@@ -0,0 +1,277 @@
+#include "profilertestclass.h"
+
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+// Synthetic gpu times go through a different conversion than the cpu ones, allow for the rounding
+const double PROFILER_TEST_EPSILON_MS = 0.001;
+
+ProfilerTestClass::ProfilerTestClass() :
+	m_Profiler(nullptr),
+	m_resolvedFrames(0)
+{
+}
+
+ProfilerTestClass::ProfilerTestClass(const ProfilerTestClass&)
+{
+}
+
+ProfilerTestClass::~ProfilerTestClass()
+{
+}
+
+int ProfilerTestClass::Run(const std::string& reportName)
+{
+	FILE* report = nullptr;
+	if (fopen_s(&report, reportName.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	ProfilerTestClass test;
+	bool passed = test.Initialize();
+	if (passed)
+	{
+		// The trace is of the frames the nesting test recorded, it still runs if those failed so the report is complete
+		const bool nesting = test.TestNesting(report);
+		const bool trace = test.TestTrace(report);
+		passed = nesting && trace;
+	}
+	test.Shutdown();
+
+	fprintf(report, "\n%s\n", passed ? "passed" : "FAILED");
+	fclose(report);
+	return passed ? 0 : 1;
+}
+
+bool ProfilerTestClass::Initialize()
+{
+	m_Profiler = new ProfilerClass();
+	if (m_Profiler == nullptr)
+		return false;
+
+	return m_Profiler->Initialize(nullptr, nullptr);
+}
+
+void ProfilerTestClass::Shutdown()
+{
+	if (m_Profiler)
+	{
+		m_Profiler->Shutdown();
+		delete m_Profiler;
+		m_Profiler = nullptr;
+	}
+}
+
+bool ProfilerTestClass::TestNesting(FILE* report)
+{
+	int badFrames = 0;
+	unsigned long long lastFrame = (unsigned long long)-1;
+	m_resolvedFrames = 0;
+
+	// One extra BeginFrame at the end resolves the last recorded frame, the empty frame it starts is never checked
+	for (int frame = 0; frame <= PROFILER_TEST_FRAMES; ++frame)
+	{
+		m_Profiler->BeginFrame();
+
+		const std::vector<ProfilerEvent>& events = m_Profiler->GetLastFrameEvents();
+		if (events.empty() == false && events[0].frame != lastFrame)
+		{
+			lastFrame = events[0].frame;
+			++m_resolvedFrames;
+			badFrames += CheckFrame(events, lastFrame % 2 == 1) ? 0 : 1;
+		}
+
+		if (frame < PROFILER_TEST_FRAMES)
+			RecordFrame(frame % 2 == 1);
+
+		m_Profiler->EndFrame();
+	}
+
+	const unsigned long long dropped = m_Profiler->GetDroppedFrames();
+	const bool passed = badFrames == 0 && m_resolvedFrames == PROFILER_TEST_FRAMES && dropped == 0;
+	fprintf(report, "nesting: %d frames (latency %d), every other one %d levels past the zone and pass limits\n", PROFILER_TEST_FRAMES,
+		PROFILER_FRAME_LATENCY, PROFILER_TEST_EXTRA_LEVELS);
+	fprintf(report, "  %d resolved, %llu dropped, %d with an event outside its parent, at the wrong depth or closed early\n",
+		m_resolvedFrames, dropped, badFrames);
+	fprintf(report, "  %s\n\n", passed ? "passed" : "FAILED");
+	return passed;
+}
+
+bool ProfilerTestClass::TestTrace(FILE* report)
+{
+	if (m_Profiler->WriteTrace(PROFILER_TEST_TRACE_FILE) == false)
+	{
+		fprintf(report, "trace: couldn't write %s\n  FAILED\n", PROFILER_TEST_TRACE_FILE);
+		return false;
+	}
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, PROFILER_TEST_TRACE_FILE, "r") != 0 || file == nullptr)
+	{
+		fprintf(report, "trace: couldn't read %s back\n  FAILED\n", PROFILER_TEST_TRACE_FILE);
+		return false;
+	}
+
+	std::vector<int> perFrame(PROFILER_TEST_FRAMES, 0);
+	bool header = false;
+	bool footer = false;
+	int threadNames = 0;
+	int events = 0;
+	int badEvents = 0;
+
+	char line[512];
+	for (int lineNumber = 0; fgets(line, sizeof(line), file); ++lineNumber)
+	{
+		if (lineNumber == 0)
+		{
+			header = strcmp(line, "{\"traceEvents\":[\n") == 0;
+			continue;
+		}
+
+		footer = strcmp(line, "]}\n") == 0;
+		if (strstr(line, "\"ph\":\"M\""))
+		{
+			++threadNames;
+			continue;
+		}
+
+		if (strstr(line, "\"ph\":\"X\"") == nullptr)
+			continue;
+
+		char name[64];
+		char category[8];
+		int thread = 0;
+		double start = 0.0;
+		double duration = 0.0;
+		unsigned long long frame = 0;
+		const int fields = sscanf(line, "{\"name\":\"%63[^\"]\",\"cat\":\"%7[^\"]\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lf,\"dur\":%lf,\"args\":{\"frame\":%llu}}",
+			name, category, &thread, &start, &duration, &frame);
+
+		++events;
+		const bool gpu = strcmp(category, "gpu") == 0;
+		if (fields != 6 || thread != (gpu ? 2 : 1) || (gpu == false && strcmp(category, "cpu") != 0) || duration < 0.0 || frame >= (unsigned long long)PROFILER_TEST_FRAMES)
+		{
+			++badEvents;
+			continue;
+		}
+
+		++perFrame[(size_t)frame];
+	}
+
+	fclose(file);
+
+	int expectedEvents = 0;
+	int wrongFrames = 0;
+	for (int frame = 0; frame < PROFILER_TEST_FRAMES; ++frame)
+	{
+		expectedEvents += EventsPerFrame(frame % 2 == 1);
+		wrongFrames += perFrame[frame] == EventsPerFrame(frame % 2 == 1) ? 0 : 1;
+	}
+
+	const bool passed = header && footer && threadNames == 2 && events == expectedEvents && badEvents == 0 && wrongFrames == 0;
+	fprintf(report, "trace: %s, header %s, footer %s, %d thread names\n", PROFILER_TEST_TRACE_FILE, header ? "ok" : "missing",
+		footer ? "ok" : "missing", threadNames);
+	fprintf(report, "  %d of %d events, %d malformed, %d frames with the wrong number of events\n", events, expectedEvents, badEvents, wrongFrames);
+	fprintf(report, "  %s\n", passed ? "passed" : "FAILED");
+	return passed;
+}
+
+void ProfilerTestClass::RecordFrame(bool overflow)
+{
+	if (overflow == false)
+	{
+		// Outer { Inner { Leaf } Second }, zones and then passes
+		m_Profiler->BeginCpuZone("Outer");
+		m_Profiler->BeginCpuZone("Inner");
+		m_Profiler->BeginCpuZone("Leaf");
+		m_Profiler->EndCpuZone();
+		m_Profiler->EndCpuZone();
+		m_Profiler->BeginCpuZone("Second");
+		m_Profiler->EndCpuZone();
+		m_Profiler->EndCpuZone();
+
+		m_Profiler->BeginPass("Outer");
+		m_Profiler->BeginPass("Inner");
+		m_Profiler->BeginPass("Leaf");
+		m_Profiler->EndPass();
+		m_Profiler->EndPass();
+		m_Profiler->BeginPass("Second");
+		m_Profiler->EndPass();
+		m_Profiler->EndPass();
+		return;
+	}
+
+	/*
+		Deeper than the profiler keeps. The levels past the limit aren't recorded, but their End calls must not
+		close Outer, which is only ended after the sleep.
+	*/
+	m_Profiler->BeginCpuZone("Outer");
+	for (int i = 0; i < PROFILER_MAX_ZONES + PROFILER_TEST_EXTRA_LEVELS; ++i)
+		m_Profiler->BeginCpuZone("Nested");
+	for (int i = 0; i < PROFILER_MAX_ZONES + PROFILER_TEST_EXTRA_LEVELS; ++i)
+		m_Profiler->EndCpuZone();
+	std::this_thread::sleep_for(std::chrono::milliseconds(PROFILER_TEST_SLEEP_MS));
+	m_Profiler->EndCpuZone();
+
+	m_Profiler->BeginPass("Outer");
+	for (int i = 0; i < PROFILER_MAX_PASSES + PROFILER_TEST_EXTRA_LEVELS; ++i)
+		m_Profiler->BeginPass("Nested");
+	for (int i = 0; i < PROFILER_MAX_PASSES + PROFILER_TEST_EXTRA_LEVELS; ++i)
+		m_Profiler->EndPass();
+	std::this_thread::sleep_for(std::chrono::milliseconds(PROFILER_TEST_SLEEP_MS));
+	m_Profiler->EndPass();
+}
+
+bool ProfilerTestClass::CheckFrame(const std::vector<ProfilerEvent>& events, bool overflow)
+{
+	if ((int)events.size() != EventsPerFrame(overflow))
+		return false;
+
+	const char* const treeNames[5] = { "Frame", "Outer", "Inner", "Leaf", "Second" };
+	const int treeDepths[5] = { 0, 1, 2, 3, 2 };
+
+	// Resolve puts out the cpu frame and its zones, then the gpu frame and its passes, each in the order they began
+	for (int gpu = 0; gpu < 2; ++gpu)
+	{
+		const ProfilerEvent* parents[PROFILER_MAX_ZONES + PROFILER_MAX_PASSES + 2] = {};
+		const ProfilerEvent* outer = nullptr;
+		double lastNestedEnd = 0.0;
+		int index = 0;
+
+		for (const ProfilerEvent& e : events)
+		{
+			if (e.gpu != (gpu == 1))
+				continue;
+
+			// Where the fixed tree or the overflow chain should have put it
+			const char* expectedName = overflow ? (index == 0 ? "Frame" : (index == 1 ? "Outer" : "Nested")) : (index < 5 ? treeNames[index] : "");
+			const int expectedDepth = overflow ? index : (index < 5 ? treeDepths[index] : -1);
+			if (strcmp(e.name, expectedName) != 0 || e.depth != expectedDepth || e.endMs < e.startMs)
+				return false;
+
+			if (e.depth > 0)
+			{
+				const ProfilerEvent* parent = parents[e.depth - 1];
+				if (parent == nullptr || e.startMs < parent->startMs - PROFILER_TEST_EPSILON_MS || e.endMs > parent->endMs + PROFILER_TEST_EPSILON_MS)
+					return false;
+			}
+
+			parents[e.depth] = &e;
+			outer = index == 1 ? &e : outer;
+			lastNestedEnd = index > 1 && e.endMs > lastNestedEnd ? e.endMs : lastNestedEnd;
+			++index;
+		}
+
+		// Half the sleep is plenty to tell closing after it from closing with the nested levels
+		if (overflow && (outer == nullptr || outer->endMs - lastNestedEnd < PROFILER_TEST_SLEEP_MS * 0.5))
+			return false;
+	}
+
+	return true;
+}
+
+int ProfilerTestClass::EventsPerFrame(bool overflow)
+{
+	// A cpu and a gpu "Frame" event, then everything that fit
+	return overflow ? 2 + PROFILER_MAX_ZONES + PROFILER_MAX_PASSES : 2 + 4 + 4;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "profilerclass.h"
+
+/*
+	Headless profiler tests, run with -profilertest [-out report.txt]. ProfilerClass with a null device and context,
+	so the gpu timestamps are the synthetic ones. Exit code 0 if everything passed and 1 if anything didn't.
+		- Nesting: PROFILER_TEST_FRAMES frames (several times PROFILER_FRAME_LATENCY) alternating a small fixed tree of
+		  zones and passes with one that opens more than PROFILER_MAX_ZONES / PROFILER_MAX_PASSES levels. Every frame
+		  that comes back has to have each event inside its parent at the right depth. On the overflowing frames the
+		  outer zone and pass must still close after the sleep that follows the levels that didn't fit, not when those
+		  were ended. All but the frames still in flight have to be resolved and none dropped.
+		- Trace: WriteTrace's file has the header, a complete event per resolved event with the right thread for
+		  cpu and gpu, no negative durations, every resolved frame with the number of events it should have, and the
+		  closing brackets.
+*/
+
+const char* const PROFILER_TEST_DEFAULT_REPORT = "profiler_test.txt";
+const char* const PROFILER_TEST_TRACE_FILE = "profiler_test_trace.json";
+const int PROFILER_TEST_FRAMES = PROFILER_FRAME_LATENCY * 4;
+const int PROFILER_TEST_EXTRA_LEVELS = 8; // opened past the limits on the overflowing frames
+const int PROFILER_TEST_SLEEP_MS = 2;
+
+class ProfilerTestClass
+{
+public:
+	ProfilerTestClass();
+	ProfilerTestClass(const ProfilerTestClass&);
+	~ProfilerTestClass();
+
+	// Returns the process exit code, 0 = passed, 1 = failed, 2 = couldn't write the report
+	static int Run(const std::string&);
+
+	bool Initialize();
+	void Shutdown();
+
+	bool TestNesting(FILE*);
+	bool TestTrace(FILE*);
+
+private:
+	void RecordFrame(bool);
+	// Events of one resolved frame, true if every one sits inside its parent
+	bool CheckFrame(const std::vector<ProfilerEvent>&, bool);
+	static int EventsPerFrame(bool);
+
+private:
+	ProfilerClass* m_Profiler;
+	int m_resolvedFrames;
+};
@@ -0,0 +1,679 @@
+#include "sceneclass.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+// Bounding sphere of an entity in world space
+static void WorldSphere(const TransformComponent& transform, const BoundsComponent& bounds, XMFLOAT3& center, float& radius)
+{
+	XMVECTOR offset = XMVector3Rotate(XMVectorScale(XMLoadFloat3(&bounds.center), transform.scale), XMLoadFloat4(&transform.rotation));
+	XMStoreFloat3(&center, XMVectorAdd(XMLoadFloat3(&transform.position), offset));
+	radius = bounds.radius * transform.scale;
+}
+
+static void MakeDrawItem(const TransformComponent& transform, const RenderableComponent& renderable, DrawItemType& item)
+{
+	XMMATRIX world = XMMatrixScaling(transform.scale, transform.scale, transform.scale);
+	world = XMMatrixMultiply(world, XMMatrixRotationQuaternion(XMLoadFloat4(&transform.rotation)));
+	world = XMMatrixMultiply(world, XMMatrixTranslation(transform.position.x, transform.position.y, transform.position.z));
+	XMStoreFloat4x4(&item.world, world);
+	item.mesh = renderable.mesh;
+	item.material = renderable.material;
+	item.lod = renderable.lod;
+	item.lodPixels = 0.0f;
+	item.screenSize = 0.0f;
+}
+
+static bool SortDrawItems(const DrawItemType& a, const DrawItemType& b)
+{
+	if (a.mesh != b.mesh)
+		return a.mesh < b.mesh;
+
+	return a.material != b.material ? a.material < b.material : a.lod < b.lod;
+}
+
+SceneClass::SceneClass() :
+	m_Jobs(nullptr),
+	m_Entities(nullptr),
+	m_Tree(nullptr),
+	m_Camera(nullptr),
+	m_Frustum(nullptr),
+	m_Commands(nullptr),
+	m_Lighting(nullptr),
+	m_Shadows(nullptr),
+	m_Lods(nullptr),
+	m_Particles(nullptr),
+	m_Snapshot(nullptr),
+	m_lightFrames(0)
+{
+}
+
+SceneClass::SceneClass(const SceneClass&)
+{
+}
+
+SceneClass::~SceneClass()
+{
+}
+
+bool SceneClass::Initialize(JobSystemClass* jobs, XMMATRIX projectionMatrix, int screenHeight)
+{
+	m_Jobs = jobs;
+	XMStoreFloat4x4(&m_projection, projectionMatrix);
+
+	m_Entities = new EntityStoreClass();
+	if (m_Entities == nullptr)
+		return false;
+
+	if (m_Entities->Initialize(m_Jobs) == false)
+		return false;
+
+	// Whoever destroys an entity or takes its bounds away, its tree proxy has to go with it
+	m_Entities->SetRemoveCallback([this](EntityId entity, unsigned int mask) { OnComponentsRemoved(entity, mask); });
+
+	m_Tree = new AabbTreeClass();
+	if (m_Tree == nullptr)
+		return false;
+
+	if (m_Tree->Initialize(m_Jobs) == false)
+		return false;
+
+	m_Camera = new CameraClass();
+	if (m_Camera == nullptr)
+		return false;
+
+	m_Camera->SetPosition(0.0f, 0.0f, -10.0f);
+
+	m_Frustum = new FrustumClass();
+	if (m_Frustum == nullptr)
+		return false;
+
+	m_Commands = new EntityCommandBufferClass();
+	if (m_Commands == nullptr)
+		return false;
+
+	m_Lighting = new ClusteredLightingClass();
+	if (m_Lighting == nullptr)
+		return false;
+
+	if (m_Lighting->Initialize(m_Jobs, projectionMatrix) == false)
+		return false;
+
+	m_Shadows = new ShadowCascadeClass();
+	if (m_Shadows == nullptr)
+		return false;
+
+	if (m_Shadows->Initialize(projectionMatrix) == false)
+		return false;
+
+	m_Lods = new LodSelectorClass();
+	if (m_Lods == nullptr)
+		return false;
+
+	if (m_Lods->Initialize(projectionMatrix, screenHeight) == false)
+		return false;
+
+	m_Particles = new ParticleSystemClass();
+	if (m_Particles == nullptr)
+		return false;
+
+	if (m_Particles->Initialize(jobs, SCENE_MAX_PARTICLES) == false)
+		return false;
+
+	m_runnerItems.resize(m_Entities->GetThreadCount());
+	m_runnerCasters.resize(m_Entities->GetThreadCount() * SHADOW_CASCADE_COUNT * 2);
+	return true;
+}
+
+void SceneClass::Shutdown()
+{
+	if (m_Particles)
+	{
+		m_Particles->Shutdown();
+		delete m_Particles;
+		m_Particles = nullptr;
+	}
+
+	if (m_Lods)
+	{
+		m_Lods->Shutdown();
+		delete m_Lods;
+		m_Lods = nullptr;
+	}
+
+	if (m_Shadows)
+	{
+		m_Shadows->Shutdown();
+		delete m_Shadows;
+		m_Shadows = nullptr;
+	}
+
+	if (m_Lighting)
+	{
+		m_Lighting->Shutdown();
+		delete m_Lighting;
+		m_Lighting = nullptr;
+	}
+
+	if (m_Commands)
+	{
+		delete m_Commands;
+		m_Commands = nullptr;
+	}
+
+	if (m_Frustum)
+	{
+		delete m_Frustum;
+		m_Frustum = nullptr;
+	}
+
+	if (m_Camera)
+	{
+		delete m_Camera;
+		m_Camera = nullptr;
+	}
+
+	if (m_Tree)
+	{
+		m_Tree->Shutdown();
+		delete m_Tree;
+		m_Tree = nullptr;
+	}
+
+	if (m_Entities)
+	{
+		// Tree is already gone, nothing to clean up per entity anymore
+		m_Entities->SetRemoveCallback(nullptr);
+		m_Entities->Shutdown();
+		delete m_Entities;
+		m_Entities = nullptr;
+	}
+
+	// Unmapped only once the store that was using its chunks is gone
+	if (m_Snapshot)
+	{
+		m_Snapshot->Shutdown();
+		delete m_Snapshot;
+		m_Snapshot = nullptr;
+	}
+
+	m_runnerItems.clear();
+	m_runnerCasters.clear();
+	m_viewLights.clear();
+}
+
+void SceneClass::CreateDemoObjects()
+{
+	for (int x = 0; x < 16; ++x)
+	{
+		for (int y = 0; y < 16; ++y)
+		{
+			for (int z = 0; z < 16; ++z)
+			{
+				const XMFLOAT3 position(x * 2.0f - 15.0f, y * 2.0f - 15.0f, z * 2.0f + 10.0f);
+				const XMFLOAT3 velocity(0.0f, ((x + y + z) % 3 - 1) * 0.5f, 0.0f);
+				CreateObject(position, 0.5f, (unsigned int)((x + y + z) % SCENE_MESH_COUNT), velocity);
+			}
+		}
+	}
+
+	// A ring of colored lights through the block, every fourth one a spot pointing down the z axis
+	for (int i = 0; i < 64; ++i)
+	{
+		const float angle = i * XM_2PI / 64.0f;
+		const XMFLOAT3 position(cosf(angle) * 14.0f, sinf(angle) * 14.0f, 10.0f + (i % 8) * 4.0f);
+		const XMFLOAT3 color((i % 3) == 0 ? 1.0f : 0.3f, (i % 3) == 1 ? 1.0f : 0.3f, (i % 3) == 2 ? 1.0f : 0.3f);
+		const XMFLOAT3 velocity(0.0f, 0.0f, ((i % 2) * 2 - 1) * 1.0f);
+		CreateLight(position, color, 6.0f, XMFLOAT3(0.0f, 0.0f, 1.0f), (i % 4) == 0 ? XM_PI / 6.0f : 0.0f, velocity);
+	}
+
+	// A fountain in the middle of the block, landing on a floor just under it
+	ParticleEmitterType fountain;
+	fountain.position = XMFLOAT3(0.0f, -15.0f, 25.0f);
+	fountain.rate = 8000.0f;
+	fountain.direction = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	fountain.spread = 0.25f;
+	fountain.speed = 18.0f;
+	fountain.life = 4.0f;
+	fountain.size = 0.08f;
+	fountain.color = 0xFFFFC080;
+	m_Particles->AddEmitter(fountain);
+	m_Particles->AddPlane(XMFLOAT4(0.0f, 1.0f, 0.0f, 16.0f));
+}
+
+EntityId SceneClass::CreateObject(const XMFLOAT3& position, float radius, unsigned int mesh, const XMFLOAT3& velocity)
+{
+	const EntityId entity = m_Entities->CreateEntity(COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_VELOCITY) |
+		COMPONENT_BIT(COMPONENT_BOUNDS) | COMPONENT_BIT(COMPONENT_RENDERABLE));
+
+	TransformComponent* transform = m_Entities->Get<TransformComponent>(entity);
+	transform->position = position;
+	transform->scale = 1.0f;
+	transform->rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	VelocityComponent* motion = m_Entities->Get<VelocityComponent>(entity);
+	motion->linear = velocity;
+	motion->spin = 0.0f;
+
+	BoundsComponent* bounds = m_Entities->Get<BoundsComponent>(entity);
+	bounds->center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	bounds->radius = radius;
+
+	AabbType box;
+	box.min = XMFLOAT3(position.x - radius, position.y - radius, position.z - radius);
+	box.max = XMFLOAT3(position.x + radius, position.y + radius, position.z + radius);
+	bounds->proxy = m_Tree->CreateProxy(box, (unsigned int)(entity & 0xFFFFFFFFull)) + 1;
+
+	RenderableComponent* renderable = m_Entities->Get<RenderableComponent>(entity);
+	renderable->mesh = mesh;
+	renderable->material = 0;
+	renderable->flags = RENDERABLE_CAST_SHADOWS;
+	renderable->lod = 0;
+
+	// Something new in the cached shadow maps
+	if (velocity.x == 0.0f && velocity.y == 0.0f && velocity.z == 0.0f)
+	{
+		renderable->flags |= RENDERABLE_STATIC;
+		m_Shadows->InvalidateSphere(position, radius);
+	}
+
+	return entity;
+}
+
+EntityId SceneClass::CreateLight(const XMFLOAT3& position, const XMFLOAT3& color, float range, const XMFLOAT3& direction, float spotAngle, const XMFLOAT3& velocity)
+{
+	const EntityId entity = m_Entities->CreateEntity(COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_VELOCITY) |
+		COMPONENT_BIT(COMPONENT_LIGHT));
+
+	TransformComponent* transform = m_Entities->Get<TransformComponent>(entity);
+	transform->position = position;
+	transform->scale = 1.0f;
+	transform->rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	VelocityComponent* motion = m_Entities->Get<VelocityComponent>(entity);
+	motion->linear = velocity;
+	motion->spin = 0.0f;
+
+	LightComponent* light = m_Entities->Get<LightComponent>(entity);
+	light->color = color;
+	light->range = range;
+	XMStoreFloat3(&light->direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+	light->spotAngle = spotAngle;
+
+	return entity;
+}
+
+void SceneClass::DestroyObject(EntityId entity)
+{
+	m_Entities->DestroyEntity(entity);
+}
+
+bool SceneClass::LoadSnapshot(const char* filename)
+{
+	if (m_Snapshot)
+		return false;
+
+	m_Snapshot = new SceneSnapshotClass();
+	if (m_Snapshot == nullptr)
+		return false;
+
+	return m_Snapshot->Load(this, filename);
+}
+
+bool SceneClass::WriteSnapshot(const char* filename)
+{
+	return SceneSnapshotClass::Write(this, filename);
+}
+
+void SceneClass::Update(float deltaTime)
+{
+	MovementSystem(deltaTime);
+
+	// Anything the systems queued up, before bounds so new entities get their proxies this frame
+	m_Entities->Playback(*m_Commands);
+
+	BoundsSystem();
+	m_Tree->Update();
+
+	m_Particles->Update(deltaTime);
+}
+
+void SceneClass::BuildFramePacket(FramePacket& packet)
+{
+	m_Camera->Render();
+
+	XMMATRIX viewMatrix;
+	m_Camera->GetViewMatrix(viewMatrix);
+	XMStoreFloat4x4(&packet.view, viewMatrix);
+	packet.cameraPosition = m_Camera->GetPosition();
+	packet.sceneEntityCount = (unsigned int)m_Entities->GetEntityCount();
+
+	m_Frustum->ConstructFrustum(XMLoadFloat4x4(&m_projection), viewMatrix);
+	RenderSystem(packet);
+	LightSystem(viewMatrix, packet);
+	ShadowSystem(viewMatrix, packet);
+	m_Particles->Build(viewMatrix, m_Frustum->GetPlanes(), packet.particles);
+}
+
+CameraClass* SceneClass::GetCamera()
+{
+	return m_Camera;
+}
+
+EntityStoreClass* SceneClass::GetEntities()
+{
+	return m_Entities;
+}
+
+AabbTreeClass* SceneClass::GetTree()
+{
+	return m_Tree;
+}
+
+ShadowCascadeClass* SceneClass::GetShadows()
+{
+	return m_Shadows;
+}
+
+ClusteredLightingClass* SceneClass::GetLighting()
+{
+	return m_Lighting;
+}
+
+LodSelectorClass* SceneClass::GetLods()
+{
+	return m_Lods;
+}
+
+ParticleSystemClass* SceneClass::GetParticles()
+{
+	return m_Particles;
+}
+
+EntityCommandBufferClass* SceneClass::GetCommands()
+{
+	return m_Commands;
+}
+
+void SceneClass::MovementSystem(float deltaTime)
+{
+	const unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_VELOCITY);
+	m_Entities->ParallelForEachChunk(mask, [deltaTime](ChunkType& chunk, int)
+	{
+		TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+		const VelocityComponent* velocities = EntityStoreClass::GetArray<VelocityComponent>(chunk);
+
+		for (int i = 0; i < chunk.count; ++i)
+		{
+			TransformComponent& transform = transforms[i];
+			const VelocityComponent& velocity = velocities[i];
+			transform.position.x += velocity.linear.x * deltaTime;
+			transform.position.y += velocity.linear.y * deltaTime;
+			transform.position.z += velocity.linear.z * deltaTime;
+
+			if (velocity.spin != 0.0f)
+			{
+				XMVECTOR spin = XMQuaternionRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), velocity.spin * deltaTime);
+				XMStoreFloat4(&transform.rotation, XMQuaternionNormalize(XMQuaternionMultiply(XMLoadFloat4(&transform.rotation), spin)));
+			}
+		}
+	});
+}
+
+void SceneClass::BoundsSystem()
+{
+	// The tree isn't thread safe so this one stays on one thread, most moves don't leave their fat box anyway
+	const unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BOUNDS);
+	m_Entities->ForEachChunk(mask, [this](ChunkType& chunk)
+	{
+		const TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+		BoundsComponent* bounds = EntityStoreClass::GetArray<BoundsComponent>(chunk);
+		const EntityId* entities = EntityStoreClass::GetEntities(chunk);
+
+		for (int i = 0; i < chunk.count; ++i)
+		{
+			XMFLOAT3 center;
+			float radius;
+			WorldSphere(transforms[i], bounds[i], center, radius);
+
+			AabbType box;
+			box.min = XMFLOAT3(center.x - radius, center.y - radius, center.z - radius);
+			box.max = XMFLOAT3(center.x + radius, center.y + radius, center.z + radius);
+
+			// Entities made through a command buffer don't have a proxy yet, if they're static casters the shadow cache has to know
+			if (bounds[i].proxy == 0)
+			{
+				bounds[i].proxy = m_Tree->CreateProxy(box, (unsigned int)(entities[i] & 0xFFFFFFFFull)) + 1;
+
+				const RenderableComponent* renderable = m_Entities->Get<RenderableComponent>(entities[i]);
+				if (renderable && (renderable->flags & RENDERABLE_STATIC))
+					m_Shadows->InvalidateSphere(center, radius);
+			}
+			else
+				m_Tree->MoveProxy(bounds[i].proxy - 1, box);
+		}
+	});
+}
+
+void SceneClass::RenderSystem(FramePacket& packet)
+{
+	/*
+		Straight walk over every chunk that has something to draw, the transforms and bounds are
+		contiguous so this is just streaming memory. Each runner collects into its own list and
+		the lists are glued together afterwards so no locking is needed.
+		The LOD pick is written back to the renderable, next frame's hysteresis starts from it. Whatever the
+		budget pass forces on top isn't, so objects don't stay coarse after the pressure is gone.
+	*/
+	for (std::vector<DrawItemType>& items : m_runnerItems)
+		items.clear();
+
+	const unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BOUNDS) | COMPONENT_BIT(COMPONENT_RENDERABLE);
+	const XMVECTOR camera = XMLoadFloat3(&packet.cameraPosition);
+	m_Entities->ParallelForEachChunk(mask, [this, camera](ChunkType& chunk, int runner)
+	{
+		const TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+		const BoundsComponent* bounds = EntityStoreClass::GetArray<BoundsComponent>(chunk);
+		RenderableComponent* renderables = EntityStoreClass::GetArray<RenderableComponent>(chunk);
+		std::vector<DrawItemType>& items = m_runnerItems[runner];
+
+		for (int i = 0; i < chunk.count; ++i)
+		{
+			const TransformComponent& transform = transforms[i];
+
+			XMFLOAT3 center;
+			float radius;
+			WorldSphere(transform, bounds[i], center, radius);
+			if (m_Frustum->CheckSphere(center.x, center.y, center.z, radius) == false)
+				continue;
+
+			// Nearest point of the sphere, the part of the object that shows the error the most
+			const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&center), camera))) - radius;
+
+			float lodPixels;
+			renderables[i].lod = (unsigned int)m_Lods->Select(renderables[i].mesh, distance, transform.scale, (int)renderables[i].lod, lodPixels);
+
+			DrawItemType item;
+			MakeDrawItem(transform, renderables[i], item);
+			item.lodPixels = lodPixels;
+			item.screenSize = 2.0f * bounds[i].radius * lodPixels;
+			items.push_back(item);
+		}
+	});
+
+	packet.drawItems.clear();
+	for (const std::vector<DrawItemType>& items : m_runnerItems)
+		packet.drawItems.insert(packet.drawItems.end(), items.begin(), items.end());
+
+	packet.trianglesSubmitted = m_Lods->ApplyBudget(packet.drawItems);
+
+	// Sorted so the render thread can bind each mesh and material once
+	std::sort(packet.drawItems.begin(), packet.drawItems.end(), SortDrawItems);
+}
+
+void SceneClass::LightSystem(const XMMATRIX& viewMatrix, FramePacket& packet)
+{
+	// Gathering is cheap next to the binning (a few thousand lights at most) so it stays on this thread
+	m_viewLights.clear();
+
+	const unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_LIGHT);
+	m_Entities->ForEachChunk(mask, [this, &viewMatrix](ChunkType& chunk)
+	{
+		const TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+		const LightComponent* lights = EntityStoreClass::GetArray<LightComponent>(chunk);
+
+		for (int i = 0; i < chunk.count; ++i)
+		{
+			const TransformComponent& transform = transforms[i];
+			const LightComponent& light = lights[i];
+
+			LightType viewLight;
+			XMStoreFloat3(&viewLight.position, XMVector3TransformCoord(XMLoadFloat3(&transform.position), viewMatrix));
+			viewLight.range = light.range * transform.scale;
+			viewLight.color = light.color;
+
+			if (light.spotAngle > 0.0f)
+			{
+				XMVECTOR direction = XMVector3Rotate(XMLoadFloat3(&light.direction), XMLoadFloat4(&transform.rotation));
+				XMStoreFloat3(&viewLight.direction, XMVector3Normalize(XMVector3TransformNormal(direction, viewMatrix)));
+				viewLight.cosAngle = cosf(light.spotAngle);
+				viewLight.kind = LIGHT_SPOT;
+			}
+			else
+			{
+				viewLight.direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+				viewLight.cosAngle = -1.0f;
+				viewLight.kind = LIGHT_POINT;
+			}
+
+			m_viewLights.push_back(viewLight);
+		}
+	});
+
+	m_Lighting->Build(m_viewLights.data(), (int)m_viewLights.size(), packet.lightClusters);
+
+#ifdef _DEBUG
+	// Every so often make sure the SIMD binning still agrees with the plain one
+	if (++m_lightFrames % LIGHT_VALIDATE_INTERVAL == 0)
+	{
+		const int mismatches = m_Lighting->Validate(m_viewLights.data(), (int)m_viewLights.size(), packet.lightClusters);
+		if (mismatches != 0)
+		{
+			char message[128];
+			sprintf_s(message, sizeof(message), "Light clusters: %d clusters differ from the reference\n", mismatches);
+			OutputDebugString(message);
+		}
+	}
+#endif
+}
+
+void SceneClass::ShadowSystem(const XMMATRIX& viewMatrix, FramePacket& packet)
+{
+	/*
+		Same walk as the render system but against the shadow cascades instead of the view frustum.
+		Static casters only matter for cascades whose cache is being redrawn this frame, which most frames is none,
+		so for a mostly static scene this is a light space transform and a flag check per entity.
+	*/
+	ShadowFrameType& shadows = packet.shadows;
+	m_Shadows->Update(viewMatrix, shadows);
+
+#ifdef _DEBUG
+	const int uncovered = m_Shadows->CheckCoverage(viewMatrix);
+	if (uncovered != 0)
+	{
+		char message[128];
+		sprintf_s(message, sizeof(message), "Shadows: %d cascades don't cover their part of the view\n", uncovered);
+		OutputDebugString(message);
+	}
+#endif
+
+	bool redrawing[SHADOW_CASCADE_COUNT];
+	bool anyRedrawing = false;
+	for (int c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+	{
+		redrawing[c] = m_Shadows->IsRedrawing(c);
+		anyRedrawing = anyRedrawing || redrawing[c];
+	}
+
+	for (std::vector<DrawItemType>& casters : m_runnerCasters)
+		casters.clear();
+
+	const unsigned int mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BOUNDS) | COMPONENT_BIT(COMPONENT_RENDERABLE);
+	m_Entities->ParallelForEachChunk(mask, [this, &redrawing, anyRedrawing](ChunkType& chunk, int runner)
+	{
+		const TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+		const BoundsComponent* bounds = EntityStoreClass::GetArray<BoundsComponent>(chunk);
+		const RenderableComponent* renderables = EntityStoreClass::GetArray<RenderableComponent>(chunk);
+		std::vector<DrawItemType>* casters = &m_runnerCasters[runner * SHADOW_CASCADE_COUNT * 2];
+
+		for (int i = 0; i < chunk.count; ++i)
+		{
+			const unsigned int flags = renderables[i].flags;
+			const bool isStatic = (flags & RENDERABLE_STATIC) != 0;
+			if ((flags & RENDERABLE_CAST_SHADOWS) == 0 || (isStatic && anyRedrawing == false))
+				continue;
+
+			XMFLOAT3 center, lightCenter;
+			float radius;
+			WorldSphere(transforms[i], bounds[i], center, radius);
+			m_Shadows->GetLightSpace(center, lightCenter);
+
+			// World matrix is only built once the caster lands in some cascade
+			DrawItemType item;
+			bool built = false;
+			for (int c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+			{
+				if ((isStatic && redrawing[c] == false) || m_Shadows->TestCaster(c, lightCenter, radius) == false)
+					continue;
+
+				if (built == false)
+				{
+					MakeDrawItem(transforms[i], renderables[i], item);
+					built = true;
+				}
+
+				casters[c * 2 + (isStatic ? 0 : 1)].push_back(item);
+			}
+		}
+	});
+
+	for (int c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+	{
+		ShadowCascadeType& cascade = shadows.cascades[c];
+		for (size_t runner = 0; runner < m_runnerItems.size(); ++runner)
+		{
+			const std::vector<DrawItemType>* casters = &m_runnerCasters[runner * SHADOW_CASCADE_COUNT * 2];
+			cascade.staticCasters.insert(cascade.staticCasters.end(), casters[c * 2].begin(), casters[c * 2].end());
+			cascade.dynamicCasters.insert(cascade.dynamicCasters.end(), casters[c * 2 + 1].begin(), casters[c * 2 + 1].end());
+		}
+
+		std::sort(cascade.staticCasters.begin(), cascade.staticCasters.end(), SortDrawItems);
+		std::sort(cascade.dynamicCasters.begin(), cascade.dynamicCasters.end(), SortDrawItems);
+		shadows.castersSubmitted += (int)(cascade.staticCasters.size() + cascade.dynamicCasters.size());
+	}
+}
+
+void SceneClass::OnComponentsRemoved(EntityId entity, unsigned int mask)
+{
+	const unsigned int casterMask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BOUNDS) | COMPONENT_BIT(COMPONENT_RENDERABLE);
+	if ((mask & casterMask) == 0)
+		return;
+
+	// A static caster leaving (or no longer being one) takes its shadow out of the cache
+	const RenderableComponent* renderable = m_Entities->Get<RenderableComponent>(entity);
+	const TransformComponent* transform = m_Entities->Get<TransformComponent>(entity);
+	BoundsComponent* bounds = m_Entities->Get<BoundsComponent>(entity);
+	if (renderable && transform && bounds && (renderable->flags & RENDERABLE_STATIC))
+	{
+		XMFLOAT3 center;
+		float radius;
+		WorldSphere(*transform, *bounds, center, radius);
+		m_Shadows->InvalidateSphere(center, radius);
+	}
+
+	if (bounds && bounds->proxy != 0 && (mask & COMPONENT_BIT(COMPONENT_BOUNDS)))
+	{
+		m_Tree->DestroyProxy(bounds->proxy - 1);
+		bounds->proxy = 0;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+#include "aabbtreeclass.h"
+#include "cameraclass.h"
+#include "clusteredlightingclass.h"
+#include "entitystoreclass.h"
+#include "framequeueclass.h"
+#include "frustumclass.h"
+#include "jobsystemclass.h"
+#include "lodselectorclass.h"
+#include "particlesystemclass.h"
+#include "scenesnapshotclass.h"
+#include "shadowcascadeclass.h"
+
+using namespace DirectX;
+
+/*
+	Everything in the world. Lives on the main (simulation) thread: Update() runs the systems,
+	BuildFramePacket() runs the render system which copies what the render thread needs into the packet,
+	so the render thread never touches the entity store.
+	Entities with bounds are also kept in an AABB tree for spatial queries (picking, proximity),
+	the tree user data is the entity index. Entities with a light component get binned into the
+	light clusters every frame, renderables that cast shadows get sorted into the shadow cascades.
+	Visible renderables get a LOD from their size on screen, then the whole set is held to the triangle budget.
+	Particles are simulated with the rest of the world in Update and culled and sorted into the packet.
+	The world is either built in code or mapped in from a snapshot, and can be saved to one at any frame boundary.
+*/
+
+const int LIGHT_VALIDATE_INTERVAL = 120; // debug builds check the binning against the scalar reference this often, in frames
+const int SCENE_MAX_PARTICLES = 65536;
+const unsigned int SCENE_MESH_COUNT = 4; // mesh ids the demo and benchmark objects pick from
+
+class SceneClass
+{
+public:
+	SceneClass();
+	SceneClass(const SceneClass&);
+	~SceneClass();
+
+	// Projection and back buffer height, the LOD selection needs both
+	bool Initialize(JobSystemClass*, XMMATRIX, int);
+	void Shutdown();
+
+	// Convenience for a moving, drawable object with a bounding sphere. Zero velocity makes it static for the shadow cache
+	EntityId CreateObject(const XMFLOAT3&, float, unsigned int, const XMFLOAT3&);
+	// Position, color, range, local direction, spot half angle (0 for a point light), velocity
+	EntityId CreateLight(const XMFLOAT3&, const XMFLOAT3&, float, const XMFLOAT3&, float, const XMFLOAT3&);
+	// Something to look at until there are real levels, a slowly drifting block of objects in front of the camera
+	void CreateDemoObjects();
+	void DestroyObject(EntityId);
+	// Snapshots instead of building the world in code (SceneSnapshotClass), loading only works on a scene with nothing in it yet
+	bool LoadSnapshot(const char*);
+	bool WriteSnapshot(const char*);
+
+	void Update(float);
+	void BuildFramePacket(FramePacket&);
+
+	CameraClass* GetCamera();
+	EntityStoreClass* GetEntities();
+	AabbTreeClass* GetTree();
+	ClusteredLightingClass* GetLighting();
+	// Sun direction lives here
+	ShadowCascadeClass* GetShadows();
+	// Register LOD chains here, it's also where LODs and the triangle budget get switched off
+	LodSelectorClass* GetLods();
+	// Emitters and collision planes go here
+	ParticleSystemClass* GetParticles();
+	// Structural changes from inside systems go here, played back in Update right after movement
+	EntityCommandBufferClass* GetCommands();
+
+private:
+	void MovementSystem(float);
+	void BoundsSystem();
+	void RenderSystem(FramePacket&);
+	void LightSystem(const XMMATRIX&, FramePacket&);
+	void ShadowSystem(const XMMATRIX&, FramePacket&);
+	void OnComponentsRemoved(EntityId, unsigned int);
+
+private:
+	JobSystemClass* m_Jobs;
+	EntityStoreClass* m_Entities;
+	AabbTreeClass* m_Tree;
+	CameraClass* m_Camera;
+	FrustumClass* m_Frustum;
+	EntityCommandBufferClass* m_Commands;
+	ClusteredLightingClass* m_Lighting;
+	ShadowCascadeClass* m_Shadows;
+	LodSelectorClass* m_Lods;
+	ParticleSystemClass* m_Particles;
+	SceneSnapshotClass* m_Snapshot; // the mapping the entity store's chunks live in, if the scene was loaded
+	XMFLOAT4X4 m_projection;
+	std::vector<std::vector<DrawItemType>> m_runnerItems;
+	std::vector<std::vector<DrawItemType>> m_runnerCasters; // SHADOW_CASCADE_COUNT * 2 per runner, static then dynamic
+	std::vector<LightType> m_viewLights;
+	unsigned long long m_lightFrames;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <directxmath.h>
+#include "components.h"
+#include "lodselectorclass.h"
+
+using namespace DirectX;
+
+/*
+	Binary scene snapshots, written from a running scene and mapped back in place by SceneSnapshotClass.
+	A SceneFileHeaderType, the archetype table, each archetype's chunk entity counts, every entity slot's generation
+	and the LOD chains, then from the first SCENE_FILE_ALIGNMENT boundary on the entity store's chunks byte for byte,
+	each archetype's back to back. Chunks are ENTITY_CHUNK_SIZE and page aligned, so the store works straight out of
+	the mapping: a chunk already is SoA, one aligned array per component.
+	Nothing in the file is a pointer. Links are SceneOffsetType, bytes from the start of the file, which turn into
+	pointers once the base address is known. Runtime only state is cleared on the way out (tree proxies), the loader
+	doesn't have to touch any chunk.
+	The schema (chunk size and every component's size) is in the header, chunks are only valid for a build that lays
+	them out the same way. Bump SCENE_FILE_VERSION whenever the header, the tables or a component's meaning changes,
+	old files are rejected and need writing again.
+*/
+
+const unsigned int SCENE_FILE_MAGIC = 0x454E4353; // "SCNE"
+const unsigned int SCENE_FILE_VERSION = 1;
+const unsigned int SCENE_FILE_ALIGNMENT = 4096; // page size, a multiple of ENTITY_CHUNK_ALIGNMENT
+const int SCENE_MAX_COMPONENTS = 32; // bits in a component mask
+
+// Offset 0 is the header, so it doubles as null
+template<typename T> struct SceneOffsetType
+{
+	unsigned long long offset;
+
+	T* Get(unsigned char* base) const
+	{
+		return offset ? (T*)(base + offset) : nullptr;
+	}
+};
+
+struct SceneArchetypeType
+{
+	unsigned int mask;
+	unsigned int capacity; // entities per chunk the writer laid out
+	unsigned int chunkCount;
+	unsigned int padding;
+	SceneOffsetType<unsigned int> counts; // entities in each chunk
+	SceneOffsetType<unsigned char> chunks; // chunkCount chunks of chunkSize bytes
+};
+
+struct SceneFileHeaderType
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long fileSize;
+
+	// Schema
+	unsigned int chunkSize;
+	unsigned int componentCount;
+	unsigned int componentSizes[SCENE_MAX_COMPONENTS];
+	unsigned int lodChainSize; // sizeof(LodChainType)
+
+	unsigned int archetypeCount;
+	unsigned int entityCount;
+	unsigned int slotCount; // entity indices in use or free, every one has a generation
+	unsigned int lodChainCount; // by mesh id
+	unsigned int padding0;
+	SceneOffsetType<SceneArchetypeType> archetypes;
+	SceneOffsetType<unsigned int> generations;
+	SceneOffsetType<LodChainType> lodChains;
+
+	XMFLOAT3 cameraPosition;
+	XMFLOAT3 cameraRotation; // degrees, like CameraClass
+	XMFLOAT3 lightDirection;
+	unsigned int padding1;
+};
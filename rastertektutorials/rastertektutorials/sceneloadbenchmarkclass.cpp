@@ -0,0 +1,476 @@
+#include "sceneloadbenchmarkclass.h"
+
+#include <windows.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static unsigned int NextRandom(unsigned int& state)
+{
+	// xorshift32, same sequence every run so runs can be compared
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static float RandomFloat(unsigned int& state, float low, float high)
+{
+	return low + (high - low) * (float)(NextRandom(state) & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+static long long Now()
+{
+	LARGE_INTEGER time;
+	QueryPerformanceCounter(&time);
+	return time.QuadPart;
+}
+
+static double Milliseconds(long long start, long long end)
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return (double)(end - start) * 1000.0 / (double)frequency.QuadPart;
+}
+
+static unsigned long long FileBytes(const char* filename)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "rb") != 0 || file == nullptr)
+		return 0;
+
+	fseek(file, 0, SEEK_END);
+	const unsigned long long size = (unsigned long long)ftell(file);
+	fclose(file);
+	return size;
+}
+
+// Text parsing, the next whitespace separated word and numbers
+static bool ReadWord(const char*& cursor, char* word, int size)
+{
+	while (*cursor == ' ' || *cursor == '\n' || *cursor == '\r' || *cursor == '\t')
+		++cursor;
+
+	int length = 0;
+	while (*cursor && *cursor != ' ' && *cursor != '\n' && *cursor != '\r' && *cursor != '\t' && length < size - 1)
+		word[length++] = *cursor++;
+
+	word[length] = '\0';
+	return length > 0;
+}
+
+static float ReadFloat(const char*& cursor)
+{
+	char* end;
+	const float value = strtof(cursor, &end);
+	cursor = end;
+	return value;
+}
+
+static unsigned int ReadUint(const char*& cursor)
+{
+	char* end;
+	const unsigned int value = (unsigned int)strtoul(cursor, &end, 10);
+	cursor = end;
+	return value;
+}
+
+static XMFLOAT3 ReadFloat3(const char*& cursor)
+{
+	XMFLOAT3 value;
+	value.x = ReadFloat(cursor);
+	value.y = ReadFloat(cursor);
+	value.z = ReadFloat(cursor);
+	return value;
+}
+
+SceneLoadBenchmarkClass::SceneLoadBenchmarkClass() :
+	m_Jobs(nullptr),
+	m_random(0x2545F491)
+{
+}
+
+SceneLoadBenchmarkClass::SceneLoadBenchmarkClass(const SceneLoadBenchmarkClass&)
+{
+}
+
+SceneLoadBenchmarkClass::~SceneLoadBenchmarkClass()
+{
+}
+
+int SceneLoadBenchmarkClass::Run(int entityCount, const std::string& reportName)
+{
+	SceneLoadBenchmarkClass benchmark;
+	if (benchmark.Initialize() == false)
+		return 2;
+
+	// The source scene only lives long enough to be saved both ways
+	SceneClass* source = nullptr;
+	bool result = benchmark.CreateScene(source) && benchmark.BuildScene(source, entityCount);
+	const int archetypes = result ? source->GetEntities()->GetArchetypeCount() : 0;
+	const int chunks = result ? source->GetEntities()->GetChunkCount() : 0;
+	const int entities = result ? source->GetEntities()->GetEntityCount() : 0;
+
+	long long start = Now();
+	result = result && source->WriteSnapshot(SCENE_LOAD_SNAPSHOT_FILE);
+	const double snapshotWriteMs = Milliseconds(start, Now());
+
+	start = Now();
+	result = result && benchmark.WriteText(source, SCENE_LOAD_TEXT_FILE);
+	const double textWriteMs = Milliseconds(start, Now());
+
+	if (source)
+	{
+		source->Shutdown();
+		delete source;
+	}
+
+	LoadTimesType text, snapshot;
+	for (int pass = 0; pass < SCENE_LOAD_PASSES && result; ++pass)
+	{
+		LoadTimesType textPass, snapshotPass;
+		result = benchmark.Measure(false, textPass) && benchmark.Measure(true, snapshotPass);
+		if (pass == 0)
+		{
+			text = textPass;
+			snapshot = snapshotPass;
+			continue;
+		}
+
+		text.loadMs = textPass.loadMs < text.loadMs ? textPass.loadMs : text.loadMs;
+		text.firstPassMs = textPass.firstPassMs < text.firstPassMs ? textPass.firstPassMs : text.firstPassMs;
+		text.firstUpdateMs = textPass.firstUpdateMs < text.firstUpdateMs ? textPass.firstUpdateMs : text.firstUpdateMs;
+		snapshot.loadMs = snapshotPass.loadMs < snapshot.loadMs ? snapshotPass.loadMs : snapshot.loadMs;
+		snapshot.firstPassMs = snapshotPass.firstPassMs < snapshot.firstPassMs ? snapshotPass.firstPassMs : snapshot.firstPassMs;
+		snapshot.firstUpdateMs = snapshotPass.firstUpdateMs < snapshot.firstUpdateMs ? snapshotPass.firstUpdateMs : snapshot.firstUpdateMs;
+	}
+
+	benchmark.Shutdown();
+	if (result == false)
+		return 2;
+
+	FILE* report = nullptr;
+	if (fopen_s(&report, reportName.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	const bool match = text.checksum == snapshot.checksum && text.entityCount == entities && snapshot.entityCount == entities;
+	const double textTotal = text.loadMs + text.firstPassMs + text.firstUpdateMs;
+	const double snapshotTotal = snapshot.loadMs + snapshot.firstPassMs + snapshot.firstUpdateMs;
+
+	fprintf(report, "scene load, %d entities in %d archetypes and %d chunks, best of %d, warm file cache\n\n", entities, archetypes, chunks, SCENE_LOAD_PASSES);
+	fprintf(report, "%-10s %10s %10s %10s %14s %16s %10s\n", "format", "file MB", "write ms", "load ms", "first pass ms", "first update ms", "total ms");
+	fprintf(report, "%-10s %10.1f %10.1f %10.2f %14.2f %16.2f %10.2f\n", "text", FileBytes(SCENE_LOAD_TEXT_FILE) / (1024.0 * 1024.0), textWriteMs,
+		text.loadMs, text.firstPassMs, text.firstUpdateMs, textTotal);
+	fprintf(report, "%-10s %10.1f %10.1f %10.2f %14.2f %16.2f %10.2f\n", "snapshot", FileBytes(SCENE_LOAD_SNAPSHOT_FILE) / (1024.0 * 1024.0), snapshotWriteMs,
+		snapshot.loadMs, snapshot.firstPassMs, snapshot.firstUpdateMs, snapshotTotal);
+	fprintf(report, "\nload %.1fx faster, %.1fx through the first update\n", snapshot.loadMs > 0.0 ? text.loadMs / snapshot.loadMs : 0.0,
+		snapshotTotal > 0.0 ? textTotal / snapshotTotal : 0.0);
+	fprintf(report, "%s\n", match ? "both loads have the same components" : "FAILED, the loads don't have the same components");
+	fclose(report);
+
+	return match ? 0 : 1;
+}
+
+bool SceneLoadBenchmarkClass::Initialize()
+{
+	m_Jobs = new JobSystemClass();
+	if (m_Jobs == nullptr)
+		return false;
+
+	if (m_Jobs->Initialize(0) == false)
+		return false;
+
+	XMStoreFloat4x4(&m_projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+	return true;
+}
+
+void SceneLoadBenchmarkClass::Shutdown()
+{
+	if (m_Jobs)
+	{
+		m_Jobs->Shutdown();
+		delete m_Jobs;
+		m_Jobs = nullptr;
+	}
+}
+
+bool SceneLoadBenchmarkClass::CreateScene(SceneClass*& scene)
+{
+	scene = new SceneClass();
+	if (scene == nullptr)
+		return false;
+
+	return scene->Initialize(m_Jobs, XMLoadFloat4x4(&m_projection), 1080);
+}
+
+bool SceneLoadBenchmarkClass::BuildScene(SceneClass* scene, int entityCount)
+{
+	// Made up chains, the snapshot carries them but nothing is drawn here
+	for (unsigned int mesh = 0; mesh < 4; ++mesh)
+	{
+		LodChainType chain;
+		chain.count = 4;
+		for (int lod = 0; lod < chain.count; ++lod)
+		{
+			chain.triangles[lod] = (20000 >> lod) >> mesh;
+			chain.error[lod] = lod * 0.01f * (mesh + 1);
+		}
+		scene->GetLods()->SetChain(mesh, chain);
+	}
+
+	scene->GetCamera()->SetPosition(0.0f, 20.0f, -100.0f);
+	scene->GetCamera()->SetRotation(10.0f, 0.0f, 0.0f);
+
+	// A quarter of the objects move, the rest are static shadow casters
+	const float worldSize = 2000.0f;
+	std::vector<EntityId> created;
+	created.reserve(entityCount);
+	for (int i = 0; i < entityCount; ++i)
+	{
+		const XMFLOAT3 position(RandomFloat(m_random, -0.5f, 0.5f) * worldSize, RandomFloat(m_random, 0.0f, 50.0f), RandomFloat(m_random, -0.5f, 0.5f) * worldSize);
+		if (i % SCENE_LOAD_LIGHT_RATIO == 0)
+		{
+			const XMFLOAT3 color(RandomFloat(m_random, 0.2f, 1.0f), RandomFloat(m_random, 0.2f, 1.0f), RandomFloat(m_random, 0.2f, 1.0f));
+			created.push_back(scene->CreateLight(position, color, RandomFloat(m_random, 2.0f, 10.0f), XMFLOAT3(0.0f, -1.0f, 0.0f),
+				i % 4 == 0 ? XM_PI / 6.0f : 0.0f, XMFLOAT3(0.0f, 0.0f, 0.0f)));
+			continue;
+		}
+
+		const XMFLOAT3 velocity = i % 4 == 1 ? XMFLOAT3(RandomFloat(m_random, -1.0f, 1.0f), 0.0f, RandomFloat(m_random, -1.0f, 1.0f)) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		created.push_back(scene->CreateObject(position, RandomFloat(m_random, 0.5f, 3.0f), NextRandom(m_random) % 4, velocity));
+	}
+
+	// Holes in the slots and bumped generations, a saved session has those too
+	for (size_t i = 0; i < created.size(); i += SCENE_LOAD_DESTROY_RATIO)
+		scene->DestroyObject(created[i]);
+
+	return scene->GetEntities()->GetEntityCount() > 0;
+}
+
+bool SceneLoadBenchmarkClass::WriteText(SceneClass* scene, const char* filename)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "w") != 0 || file == nullptr)
+		return false;
+
+	// %.9g is enough digits for every float to come back exactly
+	const XMFLOAT3 position = scene->GetCamera()->GetPosition();
+	const XMFLOAT3 rotation = scene->GetCamera()->GetRotation();
+	const XMFLOAT3 light = scene->GetShadows()->GetLightDirection();
+	fprintf(file, "camera %.9g %.9g %.9g %.9g %.9g %.9g\n", position.x, position.y, position.z, rotation.x, rotation.y, rotation.z);
+	fprintf(file, "sun %.9g %.9g %.9g\n", light.x, light.y, light.z);
+
+	LodSelectorClass* lods = scene->GetLods();
+	for (unsigned int mesh = 0; mesh < lods->GetChainCount(); ++mesh)
+	{
+		const LodChainType& chain = lods->GetChain(mesh);
+		fprintf(file, "chain %u %d", mesh, chain.count);
+		for (int lod = 0; lod < chain.count; ++lod)
+			fprintf(file, " %u %.9g", chain.triangles[lod], chain.error[lod]);
+		fprintf(file, "\n");
+	}
+
+	scene->GetEntities()->ForEachChunk(0, [file](ChunkType& chunk)
+	{
+		const TransformComponent* transforms = EntityStoreClass::GetArray<TransformComponent>(chunk);
+		const VelocityComponent* velocities = EntityStoreClass::GetArray<VelocityComponent>(chunk);
+		const BoundsComponent* bounds = EntityStoreClass::GetArray<BoundsComponent>(chunk);
+		const RenderableComponent* renderables = EntityStoreClass::GetArray<RenderableComponent>(chunk);
+		const LightComponent* lights = EntityStoreClass::GetArray<LightComponent>(chunk);
+
+		for (int i = 0; i < chunk.count; ++i)
+		{
+			fprintf(file, "entity %u\n", chunk.archetype->mask);
+			if (transforms)
+			{
+				const TransformComponent& t = transforms[i];
+				fprintf(file, "transform %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", t.position.x, t.position.y, t.position.z, t.scale,
+					t.rotation.x, t.rotation.y, t.rotation.z, t.rotation.w);
+			}
+			if (velocities)
+				fprintf(file, "velocity %.9g %.9g %.9g %.9g\n", velocities[i].linear.x, velocities[i].linear.y, velocities[i].linear.z, velocities[i].spin);
+			if (bounds)
+				fprintf(file, "bounds %.9g %.9g %.9g %.9g\n", bounds[i].center.x, bounds[i].center.y, bounds[i].center.z, bounds[i].radius);
+			if (renderables)
+				fprintf(file, "renderable %u %u %u %u\n", renderables[i].mesh, renderables[i].material, renderables[i].flags, renderables[i].lod);
+			if (lights)
+			{
+				const LightComponent& l = lights[i];
+				fprintf(file, "light %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", l.color.x, l.color.y, l.color.z, l.range,
+					l.direction.x, l.direction.y, l.direction.z, l.spotAngle);
+			}
+		}
+	});
+
+	const bool result = ferror(file) == 0;
+	fclose(file);
+	return result;
+}
+
+bool SceneLoadBenchmarkClass::ParseText(SceneClass* scene, const char* filename)
+{
+	// Whole file in one read, then a parse and an entity at a time, like any text level format would
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "rb") != 0 || file == nullptr)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	const size_t size = (size_t)ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	std::vector<char> contents(size + 1);
+	const bool read = fread(&contents[0], 1, size, file) == size;
+	fclose(file);
+	if (read == false)
+		return false;
+	contents[size] = '\0';
+
+	EntityStoreClass* entities = scene->GetEntities();
+	EntityId entity = INVALID_ENTITY;
+	const char* cursor = &contents[0];
+	char word[32];
+	while (ReadWord(cursor, word, sizeof(word)))
+	{
+		if (strcmp(word, "entity") == 0)
+		{
+			entity = entities->CreateEntity(ReadUint(cursor));
+		}
+		else if (strcmp(word, "transform") == 0)
+		{
+			TransformComponent* transform = entities->Get<TransformComponent>(entity);
+			if (transform == nullptr)
+				return false;
+
+			transform->position = ReadFloat3(cursor);
+			transform->scale = ReadFloat(cursor);
+			const XMFLOAT3 xyz = ReadFloat3(cursor);
+			transform->rotation = XMFLOAT4(xyz.x, xyz.y, xyz.z, ReadFloat(cursor));
+		}
+		else if (strcmp(word, "velocity") == 0)
+		{
+			VelocityComponent* velocity = entities->Get<VelocityComponent>(entity);
+			if (velocity == nullptr)
+				return false;
+
+			velocity->linear = ReadFloat3(cursor);
+			velocity->spin = ReadFloat(cursor);
+		}
+		else if (strcmp(word, "bounds") == 0)
+		{
+			BoundsComponent* bounds = entities->Get<BoundsComponent>(entity);
+			if (bounds == nullptr)
+				return false;
+
+			bounds->center = ReadFloat3(cursor);
+			bounds->radius = ReadFloat(cursor);
+		}
+		else if (strcmp(word, "renderable") == 0)
+		{
+			RenderableComponent* renderable = entities->Get<RenderableComponent>(entity);
+			if (renderable == nullptr)
+				return false;
+
+			renderable->mesh = ReadUint(cursor);
+			renderable->material = ReadUint(cursor);
+			renderable->flags = ReadUint(cursor);
+			renderable->lod = ReadUint(cursor);
+		}
+		else if (strcmp(word, "light") == 0)
+		{
+			LightComponent* light = entities->Get<LightComponent>(entity);
+			if (light == nullptr)
+				return false;
+
+			light->color = ReadFloat3(cursor);
+			light->range = ReadFloat(cursor);
+			light->direction = ReadFloat3(cursor);
+			light->spotAngle = ReadFloat(cursor);
+		}
+		else if (strcmp(word, "chain") == 0)
+		{
+			const unsigned int mesh = ReadUint(cursor);
+			LodChainType chain;
+			chain.count = (int)ReadUint(cursor);
+			if (chain.count < 1 || chain.count > MESH_MAX_LODS)
+				return false;
+
+			for (int lod = 0; lod < chain.count; ++lod)
+			{
+				chain.triangles[lod] = ReadUint(cursor);
+				chain.error[lod] = ReadFloat(cursor);
+			}
+			scene->GetLods()->SetChain(mesh, chain);
+		}
+		else if (strcmp(word, "camera") == 0)
+		{
+			const XMFLOAT3 position = ReadFloat3(cursor);
+			const XMFLOAT3 rotation = ReadFloat3(cursor);
+			scene->GetCamera()->SetPosition(position.x, position.y, position.z);
+			scene->GetCamera()->SetRotation(rotation.x, rotation.y, rotation.z);
+		}
+		else if (strcmp(word, "sun") == 0)
+		{
+			scene->GetShadows()->SetLightDirection(ReadFloat3(cursor));
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SceneLoadBenchmarkClass::Measure(bool snapshot, LoadTimesType& times)
+{
+	SceneClass* scene = nullptr;
+	bool result = CreateScene(scene);
+
+	const long long start = Now();
+	result = result && (snapshot ? scene->LoadSnapshot(SCENE_LOAD_SNAPSHOT_FILE) : ParseText(scene, SCENE_LOAD_TEXT_FILE));
+	const long long loaded = Now();
+
+	times.checksum = result ? Checksum(scene) : 0;
+	times.entityCount = result ? scene->GetEntities()->GetEntityCount() : 0;
+	const long long firstPass = Now();
+
+	if (result)
+		scene->Update(SCENE_LOAD_TIME_STEP);
+	const long long firstUpdate = Now();
+
+	times.loadMs = Milliseconds(start, loaded);
+	times.firstPassMs = Milliseconds(loaded, firstPass);
+	times.firstUpdateMs = Milliseconds(firstPass, firstUpdate);
+
+	if (scene)
+	{
+		scene->Shutdown();
+		delete scene;
+	}
+
+	return result;
+}
+
+unsigned long long SceneLoadBenchmarkClass::Checksum(SceneClass* scene)
+{
+	// FNV-1a over every archetype's component data in store order. Entity ids differ between the loads so they're left out
+	unsigned long long hash = 14695981039346656037ull;
+	scene->GetEntities()->ForEachChunk(0, [&hash](ChunkType& chunk)
+	{
+		for (int c = 0; c < COMPONENT_COUNT; ++c)
+		{
+			const unsigned char* data = (const unsigned char*)EntityStoreClass::GetArray(chunk, c);
+			if (data == nullptr)
+				continue;
+
+			const size_t bytes = (size_t)chunk.count * COMPONENT_SIZES[c];
+			for (size_t i = 0; i < bytes; ++i)
+				hash = (hash ^ data[i]) * 1099511628211ull;
+		}
+
+		hash = (hash ^ chunk.archetype->mask) * 1099511628211ull;
+	});
+
+	return hash;
+}
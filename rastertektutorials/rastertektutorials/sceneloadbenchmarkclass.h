@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include "jobsystemclass.h"
+#include "sceneclass.h"
+
+/*
+	Scene load benchmark, run with -sceneload [-entities N] [-out report.txt]. Windowless.
+	Builds a big synthetic scene (moving and static objects, lights, some destroyed again so there are free slots,
+	LOD chains), saves it both as a snapshot and as a text level file, then loads each into a fresh scene
+	SCENE_LOAD_PASSES times. The text file is the conventional way: read it, parse it, create every entity and fill
+	in its components one at a time. The snapshot is mapped and its chunks used where they are.
+	Timed separately, best of the passes: the load itself, a first pass reading every component (for the snapshot
+	that's where the pages actually come in) and the first scene update (the tree gets built, moving entities get
+	written to). Both loads must come out with the same component data, the exit code is 1 if they don't.
+	The files stay in the file cache between passes, so these are warm loads.
+*/
+
+const int SCENE_LOAD_DEFAULT_ENTITIES = 500000;
+const int SCENE_LOAD_PASSES = 3;
+const int SCENE_LOAD_LIGHT_RATIO = 32; // one light per this many objects
+const int SCENE_LOAD_DESTROY_RATIO = 16; // every this many objects one gets destroyed again
+const char* const SCENE_LOAD_DEFAULT_REPORT = "scene_load.txt";
+const char* const SCENE_LOAD_SNAPSHOT_FILE = "scene_load.snapshot";
+const char* const SCENE_LOAD_TEXT_FILE = "scene_load.level";
+const float SCENE_LOAD_TIME_STEP = 1.0f / 60.0f;
+
+class SceneLoadBenchmarkClass
+{
+private:
+	struct LoadTimesType
+	{
+		double loadMs;
+		double firstPassMs;
+		double firstUpdateMs;
+		unsigned long long checksum;
+		int entityCount;
+	};
+
+public:
+	SceneLoadBenchmarkClass();
+	SceneLoadBenchmarkClass(const SceneLoadBenchmarkClass&);
+	~SceneLoadBenchmarkClass();
+
+	// Entity count and report file, returns the process exit code, 0 = fine, 1 = the loads disagree, 2 = couldn't read or write something
+	static int Run(int, const std::string&);
+
+	bool Initialize();
+	void Shutdown();
+
+private:
+	bool BuildScene(SceneClass*, int);
+	bool WriteText(SceneClass*, const char*);
+	bool ParseText(SceneClass*, const char*);
+	bool Measure(bool, LoadTimesType&);
+	bool CreateScene(SceneClass*&);
+	static unsigned long long Checksum(SceneClass*);
+
+private:
+	JobSystemClass* m_Jobs;
+	XMFLOAT4X4 m_projection;
+	unsigned int m_random;
+};
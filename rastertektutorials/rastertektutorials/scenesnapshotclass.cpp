@@ -0,0 +1,238 @@
+#include "scenesnapshotclass.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "sceneclass.h"
+
+static unsigned long long AlignOffset(unsigned long long offset, unsigned long long alignment)
+{
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static bool InFile(unsigned long long offset, unsigned long long bytes, unsigned long long fileSize)
+{
+	return offset != 0 && offset <= fileSize && bytes <= fileSize - offset;
+}
+
+SceneSnapshotClass::SceneSnapshotClass() :
+	m_File(nullptr)
+{
+}
+
+SceneSnapshotClass::SceneSnapshotClass(const SceneSnapshotClass&)
+{
+}
+
+SceneSnapshotClass::~SceneSnapshotClass()
+{
+}
+
+bool SceneSnapshotClass::Write(SceneClass* scene, const char* filename)
+{
+	EntityStoreClass* entities = scene->GetEntities();
+	LodSelectorClass* lods = scene->GetLods();
+
+	// Archetypes that ended up empty aren't worth a table entry
+	std::vector<ArchetypeType*> archetypes;
+	unsigned int chunkCount = 0;
+	for (ArchetypeType* archetype : entities->GetArchetypes())
+	{
+		if (archetype->chunks.empty() == false)
+		{
+			archetypes.push_back(archetype);
+			chunkCount += (unsigned int)archetype->chunks.size();
+		}
+	}
+
+	// Tables right after the header, 8 byte aligned for the offsets in them, chunks from the first page after that
+	SceneFileHeaderType header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SCENE_FILE_MAGIC;
+	header.version = SCENE_FILE_VERSION;
+	header.chunkSize = ENTITY_CHUNK_SIZE;
+	header.componentCount = COMPONENT_COUNT;
+	for (int c = 0; c < COMPONENT_COUNT; ++c)
+		header.componentSizes[c] = COMPONENT_SIZES[c];
+	header.lodChainSize = sizeof(LodChainType);
+	header.archetypeCount = (unsigned int)archetypes.size();
+	header.entityCount = (unsigned int)entities->GetEntityCount();
+	header.slotCount = entities->GetSlotCount();
+	header.lodChainCount = lods->GetChainCount();
+
+	unsigned long long offset = AlignOffset(sizeof(SceneFileHeaderType), 8);
+	header.archetypes.offset = archetypes.empty() ? 0 : offset;
+	offset += archetypes.size() * sizeof(SceneArchetypeType);
+
+	std::vector<SceneArchetypeType> table(archetypes.size());
+	for (size_t i = 0; i < archetypes.size(); ++i)
+	{
+		table[i].mask = archetypes[i]->mask;
+		table[i].capacity = (unsigned int)archetypes[i]->capacity;
+		table[i].chunkCount = (unsigned int)archetypes[i]->chunks.size();
+		table[i].padding = 0;
+		table[i].counts.offset = offset;
+		offset += table[i].chunkCount * sizeof(unsigned int);
+	}
+
+	offset = AlignOffset(offset, 8);
+	header.generations.offset = header.slotCount > 0 ? offset : 0;
+	offset += header.slotCount * sizeof(unsigned int);
+
+	offset = AlignOffset(offset, 8);
+	header.lodChains.offset = header.lodChainCount > 0 ? offset : 0;
+	offset += header.lodChainCount * sizeof(LodChainType);
+
+	offset = AlignOffset(offset, SCENE_FILE_ALIGNMENT);
+	for (SceneArchetypeType& archetype : table)
+	{
+		archetype.chunks.offset = offset;
+		offset += (unsigned long long)archetype.chunkCount * ENTITY_CHUNK_SIZE;
+	}
+	header.fileSize = offset;
+
+	header.cameraPosition = scene->GetCamera()->GetPosition();
+	header.cameraRotation = scene->GetCamera()->GetRotation();
+	header.lightDirection = scene->GetShadows()->GetLightDirection();
+
+	// Everything before the chunks is built in memory and goes out in one write
+	const unsigned long long chunkStart = archetypes.empty() ? offset : table[0].chunks.offset;
+	std::vector<unsigned char> tables((size_t)chunkStart, 0);
+	memcpy(&tables[0], &header, sizeof(header));
+	if (table.empty() == false)
+		memcpy(&tables[(size_t)header.archetypes.offset], &table[0], table.size() * sizeof(SceneArchetypeType));
+
+	for (size_t i = 0; i < archetypes.size(); ++i)
+	{
+		unsigned int* counts = (unsigned int*)&tables[(size_t)table[i].counts.offset];
+		for (size_t chunk = 0; chunk < archetypes[i]->chunks.size(); ++chunk)
+			counts[chunk] = (unsigned int)archetypes[i]->chunks[chunk]->count;
+	}
+
+	unsigned int* generations = (unsigned int*)&tables[(size_t)header.generations.offset];
+	for (unsigned int index = 0; index < header.slotCount; ++index)
+		generations[index] = entities->GetGeneration(index);
+
+	LodChainType* chains = (LodChainType*)&tables[(size_t)header.lodChains.offset];
+	for (unsigned int mesh = 0; mesh < header.lodChainCount; ++mesh)
+		chains[mesh] = lods->GetChain(mesh);
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "wb") != 0 || file == nullptr)
+		return false;
+
+	bool result = fwrite(&tables[0], 1, tables.size(), file) == tables.size();
+
+	// Chunks as they are, only the tree proxies cleared since the tree isn't saved
+	std::vector<unsigned char> chunkCopy(ENTITY_CHUNK_SIZE);
+	for (size_t i = 0; i < archetypes.size() && result; ++i)
+	{
+		for (ChunkType* chunk : archetypes[i]->chunks)
+		{
+			memcpy(&chunkCopy[0], chunk->data, ENTITY_CHUNK_SIZE);
+
+			const int boundsOffset = archetypes[i]->offsets[COMPONENT_BOUNDS];
+			if (boundsOffset >= 0)
+			{
+				BoundsComponent* bounds = (BoundsComponent*)&chunkCopy[boundsOffset];
+				for (int row = 0; row < chunk->count; ++row)
+					bounds[row].proxy = 0;
+			}
+
+			result = fwrite(&chunkCopy[0], 1, ENTITY_CHUNK_SIZE, file) == ENTITY_CHUNK_SIZE;
+			if (result == false)
+				break;
+		}
+	}
+
+	fclose(file);
+	return result;
+}
+
+bool SceneSnapshotClass::Load(SceneClass* scene, const char* filename)
+{
+	EntityStoreClass* entities = scene->GetEntities();
+	if (entities->GetEntityCount() != 0 || entities->GetSlotCount() != 0 || m_File != nullptr)
+		return false;
+
+	m_File = new MappedFileClass();
+	if (m_File == nullptr)
+		return false;
+
+	if (m_File->Initialize(filename, true) == false || m_File->GetSize() < sizeof(SceneFileHeaderType))
+		return false;
+
+	unsigned char* base = m_File->GetWritableData();
+	const unsigned long long fileSize = m_File->GetSize();
+	const SceneFileHeaderType& header = *(const SceneFileHeaderType*)base;
+
+	// Magic and version first, the rest of the header only means something if those match
+	if (header.magic != SCENE_FILE_MAGIC || header.version != SCENE_FILE_VERSION || header.fileSize != fileSize)
+		return false;
+
+	if (header.chunkSize != ENTITY_CHUNK_SIZE || header.componentCount != COMPONENT_COUNT || header.lodChainSize != sizeof(LodChainType))
+		return false;
+
+	for (int c = 0; c < COMPONENT_COUNT; ++c)
+	{
+		if (header.componentSizes[c] != COMPONENT_SIZES[c])
+			return false;
+	}
+
+	// Every table has to be inside the file before anything is read out of it
+	if ((header.archetypeCount > 0 && InFile(header.archetypes.offset, header.archetypeCount * sizeof(SceneArchetypeType), fileSize) == false) ||
+		(header.slotCount > 0 && InFile(header.generations.offset, header.slotCount * sizeof(unsigned int), fileSize) == false) ||
+		(header.lodChainCount > 0 && InFile(header.lodChains.offset, header.lodChainCount * sizeof(LodChainType), fileSize) == false))
+		return false;
+
+	// The only fix up there is, offsets to pointers, the chunks themselves are used where they are
+	const SceneArchetypeType* archetypes = header.archetypes.Get(base);
+	for (unsigned int i = 0; i < header.archetypeCount; ++i)
+	{
+		const SceneArchetypeType& archetype = archetypes[i];
+
+		// A component this build doesn't have would make GetArchetype lay out columns past the end of COMPONENT_SIZES
+		if ((archetype.mask & ~((1u << COMPONENT_COUNT) - 1)) != 0)
+			return false;
+
+		if (InFile(archetype.counts.offset, archetype.chunkCount * sizeof(unsigned int), fileSize) == false ||
+			InFile(archetype.chunks.offset, (unsigned long long)archetype.chunkCount * ENTITY_CHUNK_SIZE, fileSize) == false)
+			return false;
+
+		const unsigned int* counts = archetype.counts.Get(base);
+		unsigned char* chunks = archetype.chunks.Get(base);
+		for (unsigned int chunk = 0; chunk < archetype.chunkCount; ++chunk)
+		{
+			if (entities->AttachChunk(archetype.mask, (int)archetype.capacity, chunks + (size_t)chunk * ENTITY_CHUNK_SIZE, (int)counts[chunk], header.slotCount) == false)
+				return false;
+		}
+	}
+
+	if (entities->GetEntityCount() != (int)header.entityCount || entities->AttachSlots(header.slotCount, header.generations.Get(base)) == false)
+		return false;
+
+	const LodChainType* chains = header.lodChains.Get(base);
+	for (unsigned int mesh = 0; mesh < header.lodChainCount; ++mesh)
+		scene->GetLods()->SetChain(mesh, chains[mesh]);
+
+	scene->GetCamera()->SetPosition(header.cameraPosition.x, header.cameraPosition.y, header.cameraPosition.z);
+	scene->GetCamera()->SetRotation(header.cameraRotation.x, header.cameraRotation.y, header.cameraRotation.z);
+	scene->GetShadows()->SetLightDirection(header.lightDirection);
+	scene->GetShadows()->Invalidate();
+	return true;
+}
+
+void SceneSnapshotClass::Shutdown()
+{
+	if (m_File)
+	{
+		m_File->Shutdown();
+		delete m_File;
+		m_File = nullptr;
+	}
+}
+
+unsigned long long SceneSnapshotClass::GetFileSize()
+{
+	return m_File ? m_File->GetSize() : 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "mappedfileclass.h"
+#include "scenefile.h"
+
+/*
+	Saves a running scene to a snapshot file (scenefile.h) and loads one back without parsing or copying anything.
+	Loading maps the file copy on write and gives the entity store the chunks right where they are in the mapping,
+	all that happens per chunk is turning its offset into a pointer. Pages come in when a system first reads them
+	and only the ones something writes to (moving entities) get copied, static parts of the world stay shared with
+	the file cache. The mapping stays open for as long as the scene uses it, SceneClass shuts it down after its store.
+	The tree is rebuilt by the bounds system on the first update (proxies are saved as 0), which also invalidates
+	the shadow caches for the static casters.
+	A snapshot can't be saved over the file the scene was loaded from while it's mapped, save under another name.
+*/
+
+const char* const SCENE_SNAPSHOT_FILE = "scene.snapshot"; // where the running demo saves to
+const unsigned int SCENE_SNAPSHOT_KEY = VK_F5;
+
+class SceneClass;
+
+class SceneSnapshotClass
+{
+public:
+	SceneSnapshotClass();
+	SceneSnapshotClass(const SceneSnapshotClass&);
+	~SceneSnapshotClass();
+
+	// Between frames, when nothing is queued in the scene's command buffer
+	static bool Write(SceneClass*, const char*);
+
+	// Into a scene that doesn't have any entities yet
+	bool Load(SceneClass*, const char*);
+	void Shutdown();
+
+	unsigned long long GetFileSize();
+
+private:
+	MappedFileClass* m_File;
+};
@@ -0,0 +1,398 @@
+#include "shadercacheclass.h"
+#include "filewatcherclass.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+
+// Does what D3D_COMPILE_STANDARD_FILE_INCLUDE does (quoted includes relative to the including file) but also
+// remembers every file it opened. That one is a magic pointer, not an object, so it can't be wrapped directly
+class IncludeRecorderClass : public ID3DInclude
+{
+public:
+	// Directory the cache reads from (with its slash), the including file relative to it
+	IncludeRecorderClass(const std::string& sourceDirectory, const std::string& rootFile, std::vector<std::string>& includes) :
+		m_includes(includes),
+		m_sourceDirectory(sourceDirectory)
+	{
+		m_rootDirectory = Directory(rootFile);
+	}
+
+	HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+	{
+		std::map<LPCVOID, std::string>::iterator parent = m_directories.find(parentData);
+		const std::string path = FileWatcherClass::NormalizePath((parent != m_directories.end() ? parent->second : m_rootDirectory) + fileName);
+
+		// Record it even if it can't be read, fixing the missing file has to trigger a rebuild too
+		if (std::find(m_includes.begin(), m_includes.end(), path) == m_includes.end())
+			m_includes.push_back(path);
+
+		std::ifstream fin(m_sourceDirectory + path, std::ios::binary | std::ios::ate);
+		if (fin.good() == false)
+			return E_FAIL;
+
+		const std::streamoff size = fin.tellg();
+		char* buffer = new char[size > 0 ? (size_t)size : 1];
+		fin.seekg(0);
+		fin.read(buffer, size);
+		if (fin.fail())
+		{
+			delete[] buffer;
+			return E_FAIL;
+		}
+
+		m_directories[buffer] = Directory(path);
+		*data = buffer;
+		*bytes = (UINT)size;
+		return S_OK;
+	}
+
+	HRESULT __stdcall Close(LPCVOID data) override
+	{
+		m_directories.erase(data);
+		delete[] (const char*)data;
+		return S_OK;
+	}
+
+private:
+	static std::string Directory(const std::string& file)
+	{
+		const size_t slash = file.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : file.substr(0, slash + 1);
+	}
+
+private:
+	std::vector<std::string>& m_includes;
+	std::string m_sourceDirectory;
+	std::string m_rootDirectory;
+	std::map<LPCVOID, std::string> m_directories; // directory of each open include, nested ones are relative to it
+};
+
+ShaderCacheClass::ShaderCacheClass() :
+	m_device(nullptr),
+	m_quit(false),
+	m_reloadCount(0),
+	m_failedReloadCount(0),
+	m_lastReloadLatency(0.0),
+	m_frequency(1)
+{
+}
+
+ShaderCacheClass::ShaderCacheClass(const ShaderCacheClass&)
+{
+}
+
+ShaderCacheClass::~ShaderCacheClass()
+{
+}
+
+bool ShaderCacheClass::Initialize(ID3D11Device* device, const char* directory)
+{
+	m_device = device;
+	m_directory = std::string(directory) + "/";
+	m_quit = false;
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	m_frequency = frequency.QuadPart;
+
+	m_thread = std::thread(&ShaderCacheClass::CompileThread, this);
+	return true;
+}
+
+void ShaderCacheClass::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+
+	m_queueReady.notify_all();
+	if (m_thread.joinable())
+		m_thread.join();
+
+	for (RebuildType& rebuild : m_finished)
+		ReleaseProgram(rebuild.program);
+
+	for (EntryType* entry : m_entries)
+	{
+		ReleaseProgram(entry->program);
+		delete entry;
+	}
+
+	m_finished.clear();
+	m_entries.clear();
+	m_queue.clear();
+}
+
+int ShaderCacheClass::Load(const char* vsFilename, const char* vsEntry, const char* psFilename, const char* psEntry, const D3D11_INPUT_ELEMENT_DESC* layout, int elementCount)
+{
+	EntryType* entry = new EntryType();
+	entry->vsFile = FileWatcherClass::NormalizePath(vsFilename);
+	entry->vsEntry = vsEntry;
+	entry->psFile = FileWatcherClass::NormalizePath(psFilename);
+	entry->psEntry = psEntry;
+	entry->queued = false;
+	entry->queuedTime = 0;
+	ZeroMemory(&entry->program, sizeof(entry->program));
+
+	// Keep our own copy of the semantic names, the caller's layout is usually a local
+	entry->semanticNames.reserve(elementCount);
+	for (int i = 0; i < elementCount; ++i)
+		entry->semanticNames.push_back(layout[i].SemanticName);
+
+	entry->layout.assign(layout, layout + elementCount);
+	for (int i = 0; i < elementCount; ++i)
+		entry->layout[i].SemanticName = entry->semanticNames[i].c_str();
+
+	if (Compile(*entry, entry->program, entry->includes, false) == false)
+	{
+		delete entry;
+		return -1;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.push_back(entry);
+	return (int)m_entries.size() - 1;
+}
+
+const ShaderProgramType* ShaderCacheClass::GetProgram(int handle)
+{
+	// Only the render thread swaps programs so no lock needed for reading them, just for the vector
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (handle < 0 || handle >= (int)m_entries.size())
+		return nullptr;
+
+	return &m_entries[handle]->program;
+}
+
+void ShaderCacheClass::Reload(const std::vector<std::string>& files)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	bool queued = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (int i = 0; i < (int)m_entries.size(); ++i)
+		{
+			EntryType* entry = m_entries[i];
+			if (entry->queued)
+				continue;
+
+			for (const std::string& file : files)
+			{
+				if (file == entry->vsFile || file == entry->psFile || std::find(entry->includes.begin(), entry->includes.end(), file) != entry->includes.end())
+				{
+					entry->queued = true;
+					entry->queuedTime = now.QuadPart;
+					m_queue.push_back(i);
+					queued = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (queued)
+		m_queueReady.notify_one();
+}
+
+int ShaderCacheClass::ApplyPending()
+{
+	std::vector<RebuildType> finished;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_finished.empty())
+			return 0;
+
+		finished.swap(m_finished);
+	}
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	// Nothing from the old programs is bound past this point in the frame, the context keeps its own references anyway
+	for (RebuildType& rebuild : finished)
+	{
+		EntryType* entry = m_entries[rebuild.handle];
+		ReleaseProgram(entry->program);
+		entry->program = rebuild.program;
+		m_lastReloadLatency = (double)(now.QuadPart - rebuild.queuedTime) * 1000.0 / (double)m_frequency;
+		++m_reloadCount;
+	}
+
+	return (int)finished.size();
+}
+
+int ShaderCacheClass::GetReloadCount()
+{
+	return m_reloadCount;
+}
+
+int ShaderCacheClass::GetFailedReloadCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_failedReloadCount;
+}
+
+double ShaderCacheClass::GetLastReloadLatency()
+{
+	return m_lastReloadLatency;
+}
+
+bool ShaderCacheClass::Compile(const EntryType& entry, ShaderProgramType& program, std::vector<std::string>& includes, bool retry)
+{
+	const std::string* files[2] = { &entry.vsFile, &entry.psFile };
+	const std::string* entryPoints[2] = { &entry.vsEntry, &entry.psEntry };
+	const char* targets[2] = { "vs_5_0", "ps_5_0" };
+	ID3D10Blob* code[2] = { nullptr, nullptr };
+
+	bool result = true;
+	for (int stage = 0; stage < 2 && result; ++stage)
+	{
+		WCHAR filename[MAX_PATH];
+		MultiByteToWideChar(CP_UTF8, 0, (m_directory + *files[stage]).c_str(), -1, filename, MAX_PATH);
+
+		for (int attempt = 0; ; ++attempt)
+		{
+			IncludeRecorderClass includeRecorder(m_directory, *files[stage], includes);
+			ID3D10Blob* errorMessage = nullptr;
+			const HRESULT hr = D3DCompileFromFile(filename, nullptr, &includeRecorder, entryPoints[stage]->c_str(),
+				targets[stage], D3D10_SHADER_ENABLE_STRICTNESS, 0, &code[stage], &errorMessage);
+			if (SUCCEEDED(hr))
+				break;
+
+			// No error message = couldn't open the file, on a reload that's most likely the editor still writing it
+			if (errorMessage == nullptr && retry && attempt < SHADER_CACHE_RETRIES)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				continue;
+			}
+
+			std::ofstream fout(SHADER_ERROR_FILE);
+			if (errorMessage)
+			{
+				fout.write((const char*)errorMessage->GetBufferPointer(), errorMessage->GetBufferSize());
+				OutputDebugStringA((const char*)errorMessage->GetBufferPointer());
+				errorMessage->Release();
+			}
+			else
+			{
+				fout << "Missing shader file: " << *files[stage] << "\n";
+			}
+
+			result = false;
+			break;
+		}
+	}
+
+	ShaderProgramType created;
+	ZeroMemory(&created, sizeof(created));
+	if (result)
+	{
+		result = SUCCEEDED(m_device->CreateVertexShader(code[0]->GetBufferPointer(), code[0]->GetBufferSize(), nullptr, &created.vertexShader)) &&
+			SUCCEEDED(m_device->CreatePixelShader(code[1]->GetBufferPointer(), code[1]->GetBufferSize(), nullptr, &created.pixelShader)) &&
+			SUCCEEDED(m_device->CreateInputLayout(entry.layout.data(), (unsigned int)entry.layout.size(), code[0]->GetBufferPointer(), code[0]->GetBufferSize(), &created.layout));
+	}
+
+	for (ID3D10Blob* blob : code)
+	{
+		if (blob)
+			blob->Release();
+	}
+
+	if (result == false)
+	{
+		ReleaseProgram(created);
+		return false;
+	}
+
+	program = created;
+	return true;
+}
+
+void ShaderCacheClass::ReleaseProgram(ShaderProgramType& program)
+{
+	if (program.layout)
+	{
+		program.layout->Release();
+		program.layout = nullptr;
+	}
+
+	if (program.pixelShader)
+	{
+		program.pixelShader->Release();
+		program.pixelShader = nullptr;
+	}
+
+	if (program.vertexShader)
+	{
+		program.vertexShader->Release();
+		program.vertexShader = nullptr;
+	}
+}
+
+void ShaderCacheClass::CompileThread()
+{
+	for (;;)
+	{
+		int handle;
+		EntryType* entry;
+		long long queuedTime;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queueReady.wait(lock, [this]() { return m_quit || m_queue.empty() == false; });
+			if (m_quit)
+				return;
+
+			handle = m_queue.front();
+			m_queue.pop_front();
+			entry = m_entries[handle];
+
+			// Cleared before compiling so a save that lands mid compile queues another rebuild
+			entry->queued = false;
+			queuedTime = entry->queuedTime;
+		}
+
+		// The file description never changes after Load so it's safe to read without the lock, the includes can
+		RebuildType rebuild;
+		rebuild.handle = handle;
+		rebuild.queuedTime = queuedTime;
+		ZeroMemory(&rebuild.program, sizeof(rebuild.program));
+
+		std::vector<std::string> includes;
+		const bool result = Compile(*entry, rebuild.program, includes, true);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (result)
+		{
+			entry->includes.swap(includes);
+
+			// Saved twice before the first rebuild got swapped in, the newer one wins
+			for (RebuildType& older : m_finished)
+			{
+				if (older.handle == handle)
+				{
+					ReleaseProgram(older.program);
+					older.handle = -1;
+				}
+			}
+
+			m_finished.erase(std::remove_if(m_finished.begin(), m_finished.end(), [](const RebuildType& r) { return r.handle < 0; }), m_finished.end());
+			m_finished.push_back(rebuild);
+		}
+		else
+		{
+			// Keep watching the old includes as well, a failed compile stops at the first error and may not have seen them all
+			for (const std::string& include : includes)
+			{
+				if (std::find(entry->includes.begin(), entry->includes.end(), include) == entry->includes.end())
+					entry->includes.push_back(include);
+			}
+
+			++m_failedReloadCount;
+		}
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3dcompiler.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+	Owns every compiled vertex/pixel shader pair (a program) and rebuilds them when their source files change.
+	Users keep the int handle from Load and look the program up whenever they bind it, never hold on to the pointers.
+	Every #include the compiler opens is recorded per program, so saving a shared .hlsli rebuilds everything using it.
+	Rebuilds are compiled and created on a background thread (the device is free threaded, only the context isn't)
+	and only swapped in by ApplyPending on the render thread at the start of a frame, so a frame never sees
+	half a reload and rendering never waits on the compiler. A rebuild that fails to compile keeps the old program
+	and writes the errors to shader-error.txt.
+*/
+
+const char* const SHADER_ERROR_FILE = "shader-error.txt";
+const int SHADER_CACHE_RETRIES = 3; // the editor can still have the file locked right after saving
+
+struct ShaderProgramType
+{
+	ID3D11VertexShader* vertexShader;
+	ID3D11PixelShader* pixelShader;
+	ID3D11InputLayout* layout;
+};
+
+class ShaderCacheClass
+{
+private:
+	struct EntryType
+	{
+		std::string vsFile;
+		std::string vsEntry;
+		std::string psFile;
+		std::string psEntry;
+		std::vector<D3D11_INPUT_ELEMENT_DESC> layout;
+		std::vector<std::string> semanticNames; // layout points into these
+		std::vector<std::string> includes; // from the last compile, normalized, guarded by m_mutex
+		ShaderProgramType program;
+		bool queued;
+		long long queuedTime;
+	};
+
+	struct RebuildType
+	{
+		int handle;
+		ShaderProgramType program;
+		long long queuedTime;
+	};
+
+public:
+	ShaderCacheClass();
+	ShaderCacheClass(const ShaderCacheClass&);
+	~ShaderCacheClass();
+
+	// Device and the directory the shader files are read from, the names Load and Reload take are relative to it
+	bool Initialize(ID3D11Device*, const char*);
+	void Shutdown();
+
+	// vs file, vs entry point, ps file, ps entry point, input layout, element count.
+	// Compiles right away, returns -1 if that fails (errors are in SHADER_ERROR_FILE)
+	int Load(const char*, const char*, const char*, const char*, const D3D11_INPUT_ELEMENT_DESC*, int);
+	const ShaderProgramType* GetProgram(int);
+
+	// Queues a rebuild of every program that uses one of these files (normalized like FileWatcherClass does), never blocks
+	void Reload(const std::vector<std::string>&);
+	// Swaps in finished rebuilds, render thread at a frame boundary. Returns how many were swapped
+	int ApplyPending();
+
+	int GetReloadCount();
+	int GetFailedReloadCount();
+	// Ms from Reload() to the program being swapped in, for the most recent one
+	double GetLastReloadLatency();
+
+private:
+	bool Compile(const EntryType&, ShaderProgramType&, std::vector<std::string>&, bool);
+	void ReleaseProgram(ShaderProgramType&);
+	void CompileThread();
+
+private:
+	ID3D11Device* m_device;
+	std::string m_directory; // with the trailing slash
+	std::vector<EntryType*> m_entries;
+	std::deque<int> m_queue;
+	std::vector<RebuildType> m_finished;
+	std::mutex m_mutex;
+	std::condition_variable m_queueReady;
+	std::thread m_thread;
+	bool m_quit;
+	int m_reloadCount;
+	int m_failedReloadCount;
+	double m_lastReloadLatency;
+	long long m_frequency;
+};
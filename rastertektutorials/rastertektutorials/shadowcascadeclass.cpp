@@ -0,0 +1,237 @@
+#include "shadowcascadeclass.h"
+
+#include <math.h>
+#include <string.h>
+
+ShadowCascadeClass::ShadowCascadeClass()
+{
+	m_lightDirection = XMFLOAT3(0.0f, -1.0f, 0.0f);
+	memset(m_cascades, 0, sizeof(m_cascades));
+}
+
+ShadowCascadeClass::ShadowCascadeClass(const ShadowCascadeClass&)
+{
+}
+
+ShadowCascadeClass::~ShadowCascadeClass()
+{
+}
+
+bool ShadowCascadeClass::Initialize(XMMATRIX projectionMatrix)
+{
+	XMStoreFloat4x4(&m_projection, projectionMatrix);
+	if (m_projection._33 == 0.0f || m_projection._33 == 1.0f || m_projection._11 == 0.0f || m_projection._22 == 0.0f)
+		return false;
+
+	// Same as ClusteredLightingClass, near and far out of a left handed perspective matrix
+	const float screenNear = -m_projection._43 / m_projection._33;
+	const float screenFar = m_projection._43 / (1.0f - m_projection._33);
+	if (screenNear <= 0.0f || screenFar <= screenNear)
+		return false;
+
+	const float shadowFar = screenFar < SHADOW_DISTANCE ? screenFar : SHADOW_DISTANCE;
+
+	// Squared distance from the view axis to a frustum corner at depth 1
+	const float cornerSq = 1.0f / (m_projection._11 * m_projection._11) + 1.0f / (m_projection._22 * m_projection._22);
+
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		CascadeStateType& cascade = m_cascades[i];
+
+		// Practical split scheme, blend of even and logarithmic spacing
+		float split[2];
+		for (int j = 0; j < 2; ++j)
+		{
+			const float fraction = (float)(i + j) / SHADOW_CASCADE_COUNT;
+			const float linear = screenNear + (shadowFar - screenNear) * fraction;
+			const float logarithmic = screenNear * powf(shadowFar / screenNear, fraction);
+			split[j] = linear + (logarithmic - linear) * SHADOW_SPLIT_LAMBDA;
+		}
+
+		cascade.splitNear = split[0];
+		cascade.splitFar = split[1];
+
+		/*
+			Smallest sphere around the slice: its center is on the view axis, at the depth where the near and far
+			corners are equally far away. For long thin slices that's past the far plane, then the far plane's center
+			is as good as it gets. Radius is rounded up a little so float noise can't change the shadow map scale.
+		*/
+		const float nearSq = split[0] * split[0] * cornerSq;
+		const float farSq = split[1] * split[1] * cornerSq;
+		float depth = (split[1] + split[0]) * (1.0f + cornerSq) * 0.5f;
+		float radius;
+		if (depth > split[1])
+		{
+			depth = split[1];
+			const float nearCorner = nearSq + (split[1] - split[0]) * (split[1] - split[0]);
+			radius = sqrtf(nearCorner > farSq ? nearCorner : farSq);
+		}
+		else
+		{
+			radius = sqrtf(nearSq + (depth - split[0]) * (depth - split[0]));
+		}
+
+		cascade.sphereDepth = depth;
+		cascade.sphereRadius = ceilf(radius * 16.0f) / 16.0f;
+		cascade.cacheRadius = cascade.sphereRadius * (1.0f + SHADOW_CACHE_MARGIN);
+		cascade.cacheCenter = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		cascade.valid = false;
+		cascade.redraw = false;
+	}
+
+	SetLightDirection(XMFLOAT3(0.4f, -1.0f, 0.3f));
+	return true;
+}
+
+void ShadowCascadeClass::Shutdown()
+{
+	Invalidate();
+}
+
+void ShadowCascadeClass::SetLightDirection(const XMFLOAT3& direction)
+{
+	XMStoreFloat3(&m_lightDirection, XMVector3Normalize(XMLoadFloat3(&direction)));
+	BuildLightView();
+	Invalidate();
+}
+
+XMFLOAT3 ShadowCascadeClass::GetLightDirection()
+{
+	return m_lightDirection;
+}
+
+void ShadowCascadeClass::Invalidate()
+{
+	for (CascadeStateType& cascade : m_cascades)
+		cascade.valid = false;
+}
+
+void ShadowCascadeClass::InvalidateSphere(const XMFLOAT3& center, float radius)
+{
+	XMFLOAT3 lightCenter;
+	GetLightSpace(center, lightCenter);
+
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		if (m_cascades[i].valid && TestCaster(i, lightCenter, radius))
+			m_cascades[i].valid = false;
+	}
+}
+
+void ShadowCascadeClass::BuildLightView()
+{
+	// Any up vector works as long as it isn't parallel to the light, the cache only cares that it stays the same
+	const XMVECTOR up = fabsf(m_lightDirection.y) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	XMStoreFloat4x4(&m_lightView, XMMatrixLookToLH(XMVectorZero(), XMLoadFloat3(&m_lightDirection), up));
+}
+
+void ShadowCascadeClass::Update(XMMATRIX viewMatrix, ShadowFrameType& frame)
+{
+	const XMMATRIX inverseView = XMMatrixInverse(nullptr, viewMatrix);
+	const XMMATRIX lightView = XMLoadFloat4x4(&m_lightView);
+
+	frame.lightDirection = m_lightDirection;
+	frame.cascadesRedrawn = 0;
+	frame.castersSubmitted = 0;
+
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		CascadeStateType& cascade = m_cascades[i];
+
+		XMFLOAT3 center;
+		XMVECTOR world = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, cascade.sphereDepth, 1.0f), inverseView);
+		XMStoreFloat3(&center, XMVector3TransformCoord(world, lightView));
+
+		// Still inside the cached area, depth included, or does the cache have to follow?
+		const float texelSize = cascade.cacheRadius * 2.0f / SHADOW_MAP_SIZE;
+		const float reach = cascade.cacheRadius - cascade.sphereRadius;
+		const bool inside = fabsf(center.x - cascade.cacheCenter.x) <= reach && fabsf(center.y - cascade.cacheCenter.y) <= reach &&
+			fabsf(center.z - cascade.cacheCenter.z) <= reach;
+
+		cascade.redraw = cascade.valid == false || inside == false;
+		if (cascade.redraw)
+		{
+			// Whole texels only, so static and dynamic casters land on the same grid from one frame to the next
+			cascade.cacheCenter.x = floorf(center.x / texelSize + 0.5f) * texelSize;
+			cascade.cacheCenter.y = floorf(center.y / texelSize + 0.5f) * texelSize;
+			cascade.cacheCenter.z = floorf(center.z / texelSize + 0.5f) * texelSize;
+			cascade.valid = true;
+			++frame.cascadesRedrawn;
+		}
+
+		const XMFLOAT3& cache = cascade.cacheCenter;
+		const float radius = cascade.cacheRadius;
+		XMMATRIX projection = XMMatrixOrthographicOffCenterLH(cache.x - radius, cache.x + radius, cache.y - radius, cache.y + radius,
+			cache.z - radius - SHADOW_CASTER_DISTANCE, cache.z + radius);
+
+		ShadowCascadeType& output = frame.cascades[i];
+		XMStoreFloat4x4(&output.viewProjection, XMMatrixMultiply(lightView, projection));
+		output.splitNear = cascade.splitNear;
+		output.splitFar = cascade.splitFar;
+		output.texelSize = texelSize;
+		output.redrawStatic = cascade.redraw;
+		output.staticCasters.clear();
+		output.dynamicCasters.clear();
+	}
+}
+
+void ShadowCascadeClass::GetLightSpace(const XMFLOAT3& world, XMFLOAT3& light)
+{
+	// Rotation only, no need for the full transform
+	const XMFLOAT4X4& m = m_lightView;
+	light.x = world.x * m._11 + world.y * m._21 + world.z * m._31;
+	light.y = world.x * m._12 + world.y * m._22 + world.z * m._32;
+	light.z = world.x * m._13 + world.y * m._23 + world.z * m._33;
+}
+
+bool ShadowCascadeClass::TestCaster(int index, const XMFLOAT3& center, float radius)
+{
+	// The cached box, stretched SHADOW_CASTER_DISTANCE towards the light
+	const CascadeStateType& cascade = m_cascades[index];
+	const float reach = cascade.cacheRadius + radius;
+	return fabsf(center.x - cascade.cacheCenter.x) <= reach && fabsf(center.y - cascade.cacheCenter.y) <= reach &&
+		center.z - cascade.cacheCenter.z <= reach && cascade.cacheCenter.z - center.z <= reach + SHADOW_CASTER_DISTANCE;
+}
+
+bool ShadowCascadeClass::IsRedrawing(int index)
+{
+	return m_cascades[index].redraw;
+}
+
+XMFLOAT3 ShadowCascadeClass::GetCacheCenter(int index)
+{
+	return m_cascades[index].cacheCenter;
+}
+
+int ShadowCascadeClass::CheckCoverage(XMMATRIX viewMatrix)
+{
+	const XMMATRIX inverseView = XMMatrixInverse(nullptr, viewMatrix);
+	const XMMATRIX lightView = XMLoadFloat4x4(&m_lightView);
+	const float epsilon = 0.0001f;
+	int failed = 0;
+
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		const CascadeStateType& cascade = m_cascades[i];
+		const float radius = cascade.cacheRadius;
+		const XMMATRIX projection = XMMatrixOrthographicOffCenterLH(cascade.cacheCenter.x - radius, cascade.cacheCenter.x + radius,
+			cascade.cacheCenter.y - radius, cascade.cacheCenter.y + radius, cascade.cacheCenter.z - radius - SHADOW_CASTER_DISTANCE, cascade.cacheCenter.z + radius);
+		const XMMATRIX transform = XMMatrixMultiply(inverseView, XMMatrixMultiply(lightView, projection));
+
+		bool inside = true;
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			const float depth = (corner & 4) ? cascade.splitFar : cascade.splitNear;
+			const float x = ((corner & 1) ? 1.0f : -1.0f) * depth / m_projection._11;
+			const float y = ((corner & 2) ? 1.0f : -1.0f) * depth / m_projection._22;
+
+			XMFLOAT3 clip;
+			XMStoreFloat3(&clip, XMVector3TransformCoord(XMVectorSet(x, y, depth, 1.0f), transform));
+			inside = inside && fabsf(clip.x) <= 1.0f + epsilon && fabsf(clip.y) <= 1.0f + epsilon && clip.z >= -epsilon && clip.z <= 1.0f + epsilon;
+		}
+
+		failed += inside ? 0 : 1;
+	}
+
+	return failed;
+}
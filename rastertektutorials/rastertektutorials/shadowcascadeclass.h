@@ -0,0 +1,98 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+#include "drawitem.h"
+
+using namespace DirectX;
+
+/*
+	Cascade fitting and the static caster cache for the sun shadow, no device needed.
+	The view out to SHADOW_DISTANCE is split into SHADOW_CASCADE_COUNT depth ranges (log/linear blend). Each range
+	is wrapped in a bounding sphere, which doesn't change size when the camera turns, so a cascade only ever slides.
+	Static casters are rendered into a cached depth map that covers the sphere plus SHADOW_CACHE_MARGIN, snapped
+	to its texel grid. Every frame the cache is copied into the shadow map and the dynamic casters go on top.
+	The cache (and the cascade's matrix) only moves when the sphere slides out of it, so most frames redraw no
+	static casters at all and the shadow edges don't shimmer, the texel grid stays put until it jumps.
+	Anything that changes what static casters are inside a cache has to call InvalidateSphere (or Invalidate).
+*/
+
+const int SHADOW_CASCADE_COUNT = 4;
+const int SHADOW_MAP_SIZE = 2048;
+const float SHADOW_DISTANCE = 200.0f; // shadows stop here, or at the far plane if it's closer
+const float SHADOW_SPLIT_LAMBDA = 0.75f; // 0 = linear splits, 1 = logarithmic
+const float SHADOW_CACHE_MARGIN = 0.25f; // cache covers this much more than the cascade needs, the camera can move about this far before a redraw
+const float SHADOW_CASTER_DISTANCE = 300.0f; // casters this far towards the light from a cascade still land in it
+
+struct ShadowCascadeType
+{
+	XMFLOAT4X4 viewProjection; // world to the cascade's shadow map, d3d clip space
+	float splitNear; // camera view depth range this cascade is used for
+	float splitFar;
+	float texelSize; // world units per shadow map texel
+	bool redrawStatic; // cache moved or was invalidated, static casters go into it again this frame
+	std::vector<DrawItemType> staticCasters; // only filled when redrawStatic
+	std::vector<DrawItemType> dynamicCasters;
+};
+
+// One frame of shadow work for the render thread, lives in the frame packet
+struct ShadowFrameType
+{
+	ShadowCascadeType cascades[SHADOW_CASCADE_COUNT];
+	XMFLOAT3 lightDirection; // world space, pointing away from the light
+	int cascadesRedrawn; // cascades that had their static casters drawn again
+	int castersSubmitted; // static + dynamic caster draws over all cascades
+};
+
+class ShadowCascadeClass
+{
+public:
+	ShadowCascadeClass();
+	ShadowCascadeClass(const ShadowCascadeClass&);
+	~ShadowCascadeClass();
+
+	// Projection has to be a perspective one (D3DClass's), the splits and sphere sizes come from it
+	bool Initialize(XMMATRIX);
+	void Shutdown();
+
+	// Moves every cache, so everything gets redrawn
+	void SetLightDirection(const XMFLOAT3&);
+	XMFLOAT3 GetLightDirection();
+	void Invalidate();
+	// A static caster appeared, disappeared or moved, world space bounding sphere
+	void InvalidateSphere(const XMFLOAT3&, float);
+
+	// Fits the cascades to the camera's view matrix, fills in the matrices and redraw flags and empties the caster lists
+	void Update(XMMATRIX, ShadowFrameType&);
+	// World to light space, do it once per caster and test every cascade with the result
+	void GetLightSpace(const XMFLOAT3&, XMFLOAT3&);
+	// Whether a caster with this light space bounding sphere can throw a shadow into a cascade, uses the last Update
+	bool TestCaster(int, const XMFLOAT3&, float);
+	bool IsRedrawing(int);
+	// Light space, where the cascade's cached map is centred, for ShadowTestClass
+	XMFLOAT3 GetCacheCenter(int);
+
+	// Checks that every cascade's slice of the view frustum lands inside its shadow map, returns the cascades that don't
+	int CheckCoverage(XMMATRIX);
+
+private:
+	struct CascadeStateType
+	{
+		float splitNear;
+		float splitFar;
+		float sphereDepth; // view depth of the bounding sphere's center
+		float sphereRadius;
+		XMFLOAT3 cacheCenter; // light space
+		float cacheRadius; // half the width of the cached area
+		bool valid; // cache holds what's under cacheCenter
+		bool redraw; // this frame
+	};
+
+	void BuildLightView();
+
+private:
+	XMFLOAT4X4 m_projection;
+	XMFLOAT3 m_lightDirection;
+	XMFLOAT4X4 m_lightView; // world to light space, rotation only
+	CascadeStateType m_cascades[SHADOW_CASCADE_COUNT];
+};
@@ -0,0 +1,272 @@
+#include "shadowmapclass.h"
+
+ShadowMapClass::ShadowMapClass() :
+	m_cacheTexture(nullptr),
+	m_shadowTexture(nullptr),
+	m_shadowResource(nullptr),
+	m_rasterState(nullptr),
+	m_sampler(nullptr),
+	m_constantBuffer(nullptr),
+	m_drawCount(0)
+{
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		m_cacheViews[i] = nullptr;
+		m_shadowViews[i] = nullptr;
+	}
+}
+
+ShadowMapClass::ShadowMapClass(const ShadowMapClass&)
+{
+}
+
+ShadowMapClass::~ShadowMapClass()
+{
+}
+
+bool ShadowMapClass::Initialize(ID3D11Device* device)
+{
+	// The cache is only ever a depth target and a copy source, the shadow map also gets sampled
+	if (CreateDepthArray(device, D3D11_BIND_DEPTH_STENCIL, &m_cacheTexture, m_cacheViews) == false)
+		return false;
+
+	if (CreateDepthArray(device, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE, &m_shadowTexture, m_shadowViews) == false)
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC resourceDesc;
+	ZeroMemory(&resourceDesc, sizeof(resourceDesc));
+	resourceDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	resourceDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	resourceDesc.Texture2DArray.MostDetailedMip = 0;
+	resourceDesc.Texture2DArray.MipLevels = 1;
+	resourceDesc.Texture2DArray.FirstArraySlice = 0;
+	resourceDesc.Texture2DArray.ArraySize = SHADOW_CASCADE_COUNT;
+
+	if (FAILED(device->CreateShaderResourceView(m_shadowTexture, &resourceDesc, &m_shadowResource)))
+		return false;
+
+	// Depth bias against acne, no culling so single sided geometry still casts
+	D3D11_RASTERIZER_DESC rasterDesc;
+	ZeroMemory(&rasterDesc, sizeof(rasterDesc));
+	rasterDesc.FillMode = D3D11_FILL_SOLID;
+	rasterDesc.CullMode = D3D11_CULL_NONE;
+	rasterDesc.FrontCounterClockwise = false;
+	rasterDesc.DepthBias = SHADOW_DEPTH_BIAS;
+	rasterDesc.DepthBiasClamp = 0.0f;
+	rasterDesc.SlopeScaledDepthBias = SHADOW_SLOPE_BIAS;
+	rasterDesc.DepthClipEnable = true;
+
+	if (FAILED(device->CreateRasterizerState(&rasterDesc, &m_rasterState)))
+		return false;
+
+	// Comparison sampler for hardware pcf, outside the map counts as lit
+	D3D11_SAMPLER_DESC samplerDesc;
+	ZeroMemory(&samplerDesc, sizeof(samplerDesc));
+	samplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.MipLODBias = 0.0f;
+	samplerDesc.MaxAnisotropy = 1;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+	samplerDesc.BorderColor[0] = 1.0f;
+	samplerDesc.BorderColor[1] = 1.0f;
+	samplerDesc.BorderColor[2] = 1.0f;
+	samplerDesc.BorderColor[3] = 1.0f;
+	samplerDesc.MinLOD = 0.0f;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	if (FAILED(device->CreateSamplerState(&samplerDesc, &m_sampler)))
+		return false;
+
+	D3D11_BUFFER_DESC constantBufferDesc;
+	constantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	constantBufferDesc.ByteWidth = sizeof(ShadowConstantsType);
+	constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	constantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	constantBufferDesc.MiscFlags = 0;
+	constantBufferDesc.StructureByteStride = 0;
+
+	if (FAILED(device->CreateBuffer(&constantBufferDesc, nullptr, &m_constantBuffer)))
+		return false;
+
+	return true;
+}
+
+bool ShadowMapClass::CreateDepthArray(ID3D11Device* device, unsigned int bindFlags, ID3D11Texture2D** texture, ID3D11DepthStencilView** views)
+{
+	// Typeless so the same memory can be a D32 depth target and an R32 texture
+	D3D11_TEXTURE2D_DESC textureDesc;
+	ZeroMemory(&textureDesc, sizeof(textureDesc));
+	textureDesc.Width = SHADOW_MAP_SIZE;
+	textureDesc.Height = SHADOW_MAP_SIZE;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = SHADOW_CASCADE_COUNT;
+	textureDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = bindFlags;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.MiscFlags = 0;
+
+	if (FAILED(device->CreateTexture2D(&textureDesc, nullptr, texture)))
+		return false;
+
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC viewDesc;
+		ZeroMemory(&viewDesc, sizeof(viewDesc));
+		viewDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		viewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		viewDesc.Texture2DArray.MipSlice = 0;
+		viewDesc.Texture2DArray.FirstArraySlice = i;
+		viewDesc.Texture2DArray.ArraySize = 1;
+
+		if (FAILED(device->CreateDepthStencilView(*texture, &viewDesc, &views[i])))
+			return false;
+	}
+
+	return true;
+}
+
+void ShadowMapClass::Shutdown()
+{
+	if (m_constantBuffer)
+	{
+		m_constantBuffer->Release();
+		m_constantBuffer = nullptr;
+	}
+
+	if (m_sampler)
+	{
+		m_sampler->Release();
+		m_sampler = nullptr;
+	}
+
+	if (m_rasterState)
+	{
+		m_rasterState->Release();
+		m_rasterState = nullptr;
+	}
+
+	if (m_shadowResource)
+	{
+		m_shadowResource->Release();
+		m_shadowResource = nullptr;
+	}
+
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		if (m_shadowViews[i])
+		{
+			m_shadowViews[i]->Release();
+			m_shadowViews[i] = nullptr;
+		}
+
+		if (m_cacheViews[i])
+		{
+			m_cacheViews[i]->Release();
+			m_cacheViews[i] = nullptr;
+		}
+	}
+
+	if (m_shadowTexture)
+	{
+		m_shadowTexture->Release();
+		m_shadowTexture = nullptr;
+	}
+
+	if (m_cacheTexture)
+	{
+		m_cacheTexture->Release();
+		m_cacheTexture = nullptr;
+	}
+}
+
+bool ShadowMapClass::Render(ID3D11DeviceContext* deviceContext, const ShadowFrameType& frame, MeshLibraryClass* meshes, MeshShaderClass* shader)
+{
+	m_drawCount = 0;
+
+	// Can't be a render target while it's still bound for sampling from last frame
+	ID3D11ShaderResourceView* nullResource = nullptr;
+	deviceContext->PSSetShaderResources(SHADOW_MAP_SLOT, 1, &nullResource);
+
+	D3D11_VIEWPORT viewport;
+	viewport.TopLeftX = 0.0f;
+	viewport.TopLeftY = 0.0f;
+	viewport.Width = (float)SHADOW_MAP_SIZE;
+	viewport.Height = (float)SHADOW_MAP_SIZE;
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+	deviceContext->RSSetViewports(1, &viewport);
+	deviceContext->RSSetState(m_rasterState);
+
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		const ShadowCascadeType& cascade = frame.cascades[i];
+
+		if (cascade.redrawStatic)
+		{
+			deviceContext->ClearDepthStencilView(m_cacheViews[i], D3D11_CLEAR_DEPTH, 1.0f, 0);
+			deviceContext->OMSetRenderTargets(0, nullptr, m_cacheViews[i]);
+			if (RenderCasters(deviceContext, cascade, cascade.staticCasters, meshes, shader) == false)
+				return false;
+		}
+
+		// Whole slice, same format and size so it's a straight gpu copy
+		deviceContext->CopySubresourceRegion(m_shadowTexture, i, 0, 0, 0, m_cacheTexture, i, nullptr);
+
+		// Moving casters go on top of the copy every frame, they never touch the cache
+		deviceContext->OMSetRenderTargets(0, nullptr, m_shadowViews[i]);
+		if (RenderCasters(deviceContext, cascade, cascade.dynamicCasters, meshes, shader) == false)
+			return false;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext->Map(m_constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		return false;
+
+	ShadowConstantsType* constants = (ShadowConstantsType*)mappedResource.pData;
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		constants->cascades[i] = XMMatrixTranspose(XMLoadFloat4x4(&frame.cascades[i].viewProjection));
+		constants->splitFar[i] = frame.cascades[i].splitFar;
+		constants->texelSize[i] = frame.cascades[i].texelSize;
+	}
+	constants->lightDirection = frame.lightDirection;
+	constants->padding = 0.0f;
+	deviceContext->Unmap(m_constantBuffer, 0);
+
+	return true;
+}
+
+int ShadowMapClass::GetDrawCount()
+{
+	return m_drawCount;
+}
+
+bool ShadowMapClass::RenderCasters(ID3D11DeviceContext* deviceContext, const ShadowCascadeType& cascade, const std::vector<DrawItemType>& casters,
+	MeshLibraryClass* meshes, MeshShaderClass* shader)
+{
+	if (casters.empty() || meshes->GetMeshCount() == 0)
+		return true;
+
+	if (shader->SetDepthParameters(deviceContext, XMLoadFloat4x4(&cascade.viewProjection)) == false)
+		return false;
+
+	// No textures, depth is all that gets written
+	const int draws = meshes->Render(deviceContext, shader, casters, nullptr);
+	if (draws < 0)
+		return false;
+
+	m_drawCount += draws;
+	return true;
+}
+
+void ShadowMapClass::Bind(ID3D11DeviceContext* deviceContext)
+{
+	deviceContext->PSSetShaderResources(SHADOW_MAP_SLOT, 1, &m_shadowResource);
+	deviceContext->PSSetSamplers(SHADOW_SAMPLER_SLOT, 1, &m_sampler);
+	deviceContext->PSSetConstantBuffers(SHADOW_CONSTANT_SLOT, 1, &m_constantBuffer);
+}
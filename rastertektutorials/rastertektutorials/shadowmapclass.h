@@ -0,0 +1,68 @@
+#pragma once
+
+#include <d3d11.h>
+#include <directxmath.h>
+#include "meshlibraryclass.h"
+#include "meshshaderclass.h"
+#include "shadowcascadeclass.h"
+
+using namespace DirectX;
+
+/*
+	The gpu half of the cascaded shadows, ShadowCascadeClass decides what gets drawn where.
+	Two depth texture arrays with a slice per cascade: the static cache, which keeps its contents between
+	frames, and the shadow map the lit shaders sample. Per cascade and frame: if the cache is stale clear it and
+	draw the static casters into it, copy it into the shadow map, draw the dynamic casters on top.
+	Casters are drawn through the mesh path with MeshShaderClass's depth only setup, at the LOD the scene picked.
+	shadows.hlsli is the shader side.
+*/
+
+const int SHADOW_MAP_SLOT = 9; // t9
+const int SHADOW_SAMPLER_SLOT = 1; // s1
+const int SHADOW_CONSTANT_SLOT = 2; // b2
+const int SHADOW_DEPTH_BIAS = 1000; // in depth buffer units (2^-24 for 32 bit float depth, scaled by the exponent)
+const float SHADOW_SLOPE_BIAS = 2.0f;
+
+class ShadowMapClass
+{
+private:
+	// Matches cbuffer ShadowBuffer in shadows.hlsli
+	struct ShadowConstantsType
+	{
+		XMMATRIX cascades[SHADOW_CASCADE_COUNT];
+		float splitFar[SHADOW_CASCADE_COUNT];
+		float texelSize[SHADOW_CASCADE_COUNT];
+		XMFLOAT3 lightDirection;
+		float padding;
+	};
+
+public:
+	ShadowMapClass();
+	ShadowMapClass(const ShadowMapClass&);
+	~ShadowMapClass();
+
+	bool Initialize(ID3D11Device*);
+	void Shutdown();
+
+	// Leaves the shadow map as the render target and no pixel shader, put the back buffer and viewport back afterwards
+	bool Render(ID3D11DeviceContext*, const ShadowFrameType&, MeshLibraryClass*, MeshShaderClass*);
+	// Caster draws issued by the last Render, static and dynamic
+	int GetDrawCount();
+	// Pixel shader slots SHADOW_MAP_SLOT, SHADOW_SAMPLER_SLOT and SHADOW_CONSTANT_SLOT
+	void Bind(ID3D11DeviceContext*);
+
+private:
+	bool CreateDepthArray(ID3D11Device*, unsigned int, ID3D11Texture2D**, ID3D11DepthStencilView**);
+	bool RenderCasters(ID3D11DeviceContext*, const ShadowCascadeType&, const std::vector<DrawItemType>&, MeshLibraryClass*, MeshShaderClass*);
+
+private:
+	ID3D11Texture2D* m_cacheTexture;
+	ID3D11DepthStencilView* m_cacheViews[SHADOW_CASCADE_COUNT];
+	ID3D11Texture2D* m_shadowTexture;
+	ID3D11DepthStencilView* m_shadowViews[SHADOW_CASCADE_COUNT];
+	ID3D11ShaderResourceView* m_shadowResource;
+	ID3D11RasterizerState* m_rasterState;
+	ID3D11SamplerState* m_sampler;
+	ID3D11Buffer* m_constantBuffer;
+	int m_drawCount;
+};
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: shadows.hlsli
+// Cascaded sun shadow lookup for pixel shaders, the gpu side of ShadowMapClass.
+// #include it and call SampleShadow with the pixel's world position and view depth,
+// 1 = lit, 0 = in shadow. Layout has to match ShadowConstantsType.
+////////////////////////////////////////////////////////////////////////////////
+
+#define SHADOW_CASCADE_COUNT 4
+
+Texture2DArray shadowMap : register(t9);
+SamplerComparisonState shadowSampler : register(s1);
+
+cbuffer ShadowBuffer : register(b2)
+{
+	matrix shadowCascades[SHADOW_CASCADE_COUNT]; // world to cascade clip space
+	float4 shadowSplitFar; // view depth where each cascade ends
+	float4 shadowTexelSize; // world units per texel, for normal offsets
+	float3 shadowLightDirection;
+	float shadowPadding;
+};
+
+float SampleShadow(float3 worldPosition, float viewDepth)
+{
+	// First cascade whose range reaches this far, past the last one there's no shadow
+	uint cascade = 0;
+	[unroll] for (uint i = 0; i < SHADOW_CASCADE_COUNT - 1; ++i)
+		cascade += viewDepth > shadowSplitFar[i] ? 1 : 0;
+
+	if (viewDepth > shadowSplitFar[SHADOW_CASCADE_COUNT - 1])
+		return 1.0f;
+
+	float4 position = mul(float4(worldPosition, 1.0f), shadowCascades[cascade]);
+	float2 uv = float2(position.x * 0.5f + 0.5f, 0.5f - position.y * 0.5f);
+
+	// 3x3 pcf, each tap is already a bilinear 2x2 comparison
+	float2 texel;
+	float elements;
+	shadowMap.GetDimensions(texel.x, texel.y, elements);
+	texel = 1.0f / texel;
+
+	float lit = 0.0f;
+	[unroll] for (int y = -1; y <= 1; ++y)
+	{
+		[unroll] for (int x = -1; x <= 1; ++x)
+			lit += shadowMap.SampleCmpLevelZero(shadowSampler, float3(uv + float2(x, y) * texel, cascade), position.z);
+	}
+
+	return lit / 9.0f;
+}
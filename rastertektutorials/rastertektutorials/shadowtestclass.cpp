@@ -0,0 +1,298 @@
+#include "shadowtestclass.h"
+
+#include <math.h>
+
+static unsigned int NextRandom(unsigned int& state)
+{
+	// xorshift32, same sequence every run so runs can be compared
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static float RandomFloat(unsigned int& state, float low, float high)
+{
+	return low + (high - low) * (float)(NextRandom(state) & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+static XMMATRIX ViewMatrix(const XMFLOAT3& position, const XMFLOAT3& forward)
+{
+	return XMMatrixLookToLH(XMLoadFloat3(&position), XMLoadFloat3(&forward), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+}
+
+static void CameraAt(int frame, XMFLOAT3& position, XMFLOAT3& forward)
+{
+	// Round the circle once per half of the run, then it turns and flies back the other way
+	const float direction = frame < SHADOW_TEST_PATH_FRAMES / 2 ? 1.0f : -1.0f;
+	const float angle = XM_2PI * (float)frame / (float)(SHADOW_TEST_PATH_FRAMES / 2) * direction;
+
+	position = XMFLOAT3(SHADOW_TEST_PATH_RADIUS * cosf(angle), 8.0f + 4.0f * sinf(angle * 3.0f), SHADOW_TEST_PATH_RADIUS * sinf(angle));
+	forward = XMFLOAT3(-sinf(angle) * direction, -0.2f, cosf(angle) * direction);
+}
+
+// Half the width of the area a cascade's map covers, from its texel size
+static float CacheRadius(const ShadowCascadeType& cascade)
+{
+	return cascade.texelSize * SHADOW_MAP_SIZE * 0.5f;
+}
+
+/*
+	How far inside a cascade's map (and SHADOW_CASTER_DISTANCE towards the light) a sphere reaches, in clip space,
+	negative if it's outside. Straight from the matrix the render thread draws with, an orthographic one, so x and y
+	are scaled by the cache radius and depth by the length of the box.
+*/
+static float OverlapMargin(const ShadowCascadeType& cascade, const XMFLOAT3& center, float radius)
+{
+	XMFLOAT3 clip;
+	XMStoreFloat3(&clip, XMVector3TransformCoord(XMLoadFloat3(&center), XMLoadFloat4x4(&cascade.viewProjection)));
+
+	const float cacheRadius = CacheRadius(cascade);
+	const float xy = radius / cacheRadius;
+	const float z = radius / (cacheRadius * 2.0f + SHADOW_CASTER_DISTANCE);
+
+	const float margins[4] = { 1.0f + xy - fabsf(clip.x), 1.0f + xy - fabsf(clip.y), clip.z + z, 1.0f + z - clip.z };
+	float margin = margins[0];
+	for (int i = 1; i < 4; ++i)
+		margin = margins[i] < margin ? margins[i] : margin;
+
+	return margin;
+}
+
+ShadowTestClass::ShadowTestClass() :
+	m_Cascades(nullptr),
+	m_random(0x6C8E9CF5)
+{
+}
+
+ShadowTestClass::ShadowTestClass(const ShadowTestClass&)
+{
+}
+
+ShadowTestClass::~ShadowTestClass()
+{
+}
+
+int ShadowTestClass::Run(const std::string& reportName)
+{
+	FILE* report = nullptr;
+	if (fopen_s(&report, reportName.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	ShadowTestClass test;
+	bool passed = test.Initialize();
+	if (passed)
+	{
+		// All of them run whatever happens so the report is complete
+		const bool stationary = test.TestStationary(report);
+		const bool moves = test.TestSmallMoves(report);
+		const bool path = test.TestPath(report);
+		const bool invalidation = test.TestInvalidation(report);
+		passed = stationary && moves && path && invalidation;
+	}
+	test.Shutdown();
+
+	fprintf(report, "\n%s\n", passed ? "passed" : "FAILED");
+	fclose(report);
+	return passed ? 0 : 1;
+}
+
+bool ShadowTestClass::Initialize()
+{
+	// Same projection GraphicsClass makes at this size
+	const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)SHADOW_TEST_SCREEN_WIDTH / (float)SHADOW_TEST_SCREEN_HEIGHT, 0.1f, 1000.0f);
+	XMStoreFloat4x4(&m_projection, projection);
+
+	m_Cascades = new ShadowCascadeClass();
+	if (m_Cascades == nullptr)
+		return false;
+
+	return Reset();
+}
+
+void ShadowTestClass::Shutdown()
+{
+	if (m_Cascades)
+	{
+		m_Cascades->Shutdown();
+		delete m_Cascades;
+		m_Cascades = nullptr;
+	}
+}
+
+bool ShadowTestClass::Reset()
+{
+	m_Cascades->Shutdown();
+	return m_Cascades->Initialize(XMLoadFloat4x4(&m_projection));
+}
+
+int ShadowTestClass::CountUnsnapped()
+{
+	// In texels, doubles so the division doesn't add error of its own
+	int unsnapped = 0;
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		const XMFLOAT3 center = m_Cascades->GetCacheCenter(i);
+		const double texel = m_frame.cascades[i].texelSize;
+		const double axes[3] = { center.x / texel, center.y / texel, center.z / texel };
+		for (int axis = 0; axis < 3; ++axis)
+			unsnapped += fabs(axes[axis] - floor(axes[axis] + 0.5)) > SHADOW_TEST_SNAP_TOLERANCE ? 1 : 0;
+	}
+
+	return unsnapped;
+}
+
+bool ShadowTestClass::TestStationary(FILE* report)
+{
+	if (Reset() == false)
+		return false;
+
+	const XMMATRIX view = ViewMatrix(XMFLOAT3(0.0f, 5.0f, -20.0f), XMFLOAT3(0.2f, -0.1f, 1.0f));
+	m_Cascades->Update(view, m_frame);
+	const int first = m_frame.cascadesRedrawn;
+
+	int redrawn = 0;
+	for (int frame = 0; frame < SHADOW_TEST_STILL_FRAMES; ++frame)
+	{
+		m_Cascades->Update(view, m_frame);
+		redrawn += m_frame.cascadesRedrawn;
+	}
+
+	const bool passed = first == SHADOW_CASCADE_COUNT && redrawn == 0;
+	fprintf(report, "stationary: %d of %d cascades drawn on the first frame, %d redrawn over the next %d frames%s\n", first, SHADOW_CASCADE_COUNT,
+		redrawn, SHADOW_TEST_STILL_FRAMES, passed ? "" : "  FAILED");
+	return passed;
+}
+
+bool ShadowTestClass::TestSmallMoves(FILE* report)
+{
+	if (Reset() == false)
+		return false;
+
+	const XMFLOAT3 start(10.0f, 6.0f, -30.0f);
+	const XMFLOAT3 forward(-0.3f, -0.15f, 1.0f);
+	m_Cascades->Update(ViewMatrix(start, forward), m_frame);
+
+	/*
+		The cache is SHADOW_CACHE_MARGIN bigger than the cascade's sphere, that's how far the sphere can slide before
+		the cache has to follow. Snapping can leave the cache up to half a texel off the sphere's centre on each axis,
+		take a whole one off to be safe. The tightest cascade decides.
+	*/
+	float reach = 0.0f;
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		const float cacheRadius = CacheRadius(m_frame.cascades[i]);
+		const float slack = cacheRadius - cacheRadius / (1.0f + SHADOW_CACHE_MARGIN) - m_frame.cascades[i].texelSize;
+		reach = i == 0 || slack < reach ? slack : reach;
+	}
+
+	// Every move is from where the caches were fitted, so each one is a separate test of the same margin
+	int redrawn = 0;
+	for (int move = 0; move < SHADOW_TEST_MOVES; ++move)
+	{
+		XMFLOAT3 offset(RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f), RandomFloat(m_random, -1.0f, 1.0f));
+		XMStoreFloat3(&offset, XMVectorScale(XMVector3Normalize(XMLoadFloat3(&offset)), RandomFloat(m_random, 0.0f, reach)));
+
+		const XMFLOAT3 position(start.x + offset.x, start.y + offset.y, start.z + offset.z);
+		m_Cascades->Update(ViewMatrix(position, forward), m_frame);
+		redrawn += m_frame.cascadesRedrawn;
+	}
+
+	// Three times as far has to be past the margin on at least one axis whichever way the light points
+	const XMFLOAT3 beyond(start.x + reach * 3.0f, start.y, start.z);
+	m_Cascades->Update(ViewMatrix(beyond, forward), m_frame);
+	const bool followed = m_frame.cascades[0].redrawStatic;
+
+	const bool passed = redrawn == 0 && followed;
+	fprintf(report, "small moves: %d moves of up to %.3f, %d cascades redrawn, a move of %.3f %s the first cascade%s\n", SHADOW_TEST_MOVES, reach,
+		redrawn, reach * 3.0f, followed ? "redrew" : "did not redraw", passed ? "" : "  FAILED");
+	return passed;
+}
+
+bool ShadowTestClass::TestPath(FILE* report)
+{
+	if (Reset() == false)
+		return false;
+
+	int uncovered = 0;
+	int unsnapped = 0;
+	int redraws[SHADOW_CASCADE_COUNT] = { 0 };
+
+	for (int frame = 0; frame < SHADOW_TEST_PATH_FRAMES; ++frame)
+	{
+		XMFLOAT3 position, forward;
+		CameraAt(frame, position, forward);
+		const XMMATRIX view = ViewMatrix(position, forward);
+
+		m_Cascades->Update(view, m_frame);
+		uncovered += m_Cascades->CheckCoverage(view);
+		unsnapped += CountUnsnapped();
+
+		for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+			redraws[i] += m_frame.cascades[i].redrawStatic ? 1 : 0;
+	}
+
+	const bool passed = uncovered == 0 && unsnapped == 0;
+	fprintf(report, "path: %d frames, %d cascade frames not covered, %d cache centre axes off the texel grid%s\n", SHADOW_TEST_PATH_FRAMES, uncovered,
+		unsnapped, passed ? "" : "  FAILED");
+	fprintf(report, "  redraws by cascade:");
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+		fprintf(report, " %d (%.1f%%)", redraws[i], redraws[i] * 100.0f / SHADOW_TEST_PATH_FRAMES);
+	fprintf(report, "\n");
+	return passed;
+}
+
+bool ShadowTestClass::TestInvalidation(FILE* report)
+{
+	if (Reset() == false)
+		return false;
+
+	const XMFLOAT3 camera(0.0f, 10.0f, 0.0f);
+	const XMMATRIX view = ViewMatrix(camera, XMFLOAT3(0.0f, -0.25f, 1.0f));
+	m_Cascades->Update(view, m_frame);
+	m_Cascades->Update(view, m_frame);
+
+	int tested = 0, skipped = 0, wrong = 0, partial = 0, none = 0;
+	for (int sphere = 0; sphere < SHADOW_TEST_SPHERES; ++sphere)
+	{
+		// From right by the camera to past the last cascade, some off to the side of all of them
+		const XMFLOAT3 center(camera.x + RandomFloat(m_random, -200.0f, 200.0f), camera.y + RandomFloat(m_random, -40.0f, 80.0f),
+			camera.z + RandomFloat(m_random, -60.0f, 320.0f));
+		const float radius = RandomFloat(m_random, 0.25f, 8.0f);
+
+		// Camera hasn't moved, so the matrices from the last Update are still where every cache is
+		bool expected[SHADOW_CASCADE_COUNT];
+		bool edge = false;
+		int count = 0;
+		for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+		{
+			const float margin = OverlapMargin(m_frame.cascades[i], center, radius);
+			expected[i] = margin >= 0.0f;
+			edge = edge || fabsf(margin) < SHADOW_TEST_EDGE;
+			count += expected[i] ? 1 : 0;
+		}
+
+		m_Cascades->InvalidateSphere(center, radius);
+		m_Cascades->Update(view, m_frame);
+
+		if (edge)
+		{
+			++skipped;
+			continue;
+		}
+
+		bool right = true;
+		for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+			right = right && m_frame.cascades[i].redrawStatic == expected[i];
+
+		++tested;
+		wrong += right ? 0 : 1;
+		partial += count > 0 && count < SHADOW_CASCADE_COUNT ? 1 : 0;
+		none += count == 0 ? 1 : 0;
+	}
+
+	const bool passed = wrong == 0 && partial > 0;
+	fprintf(report, "invalidation: %d spheres (%d on an edge skipped), %d dirtied the wrong cascades, %d some but not all, %d none%s\n", tested, skipped,
+		wrong, partial, none, passed ? "" : "  FAILED");
+	return passed;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <directxmath.h>
+#include <stdio.h>
+#include <string>
+#include "shadowcascadeclass.h"
+
+using namespace DirectX;
+
+/*
+	Headless shadow cache tests, run with -shadowtest [-out report.txt]. No window and no device, ShadowCascadeClass
+	doesn't need one. Exit code 0 if everything passed and 1 if anything didn't.
+		- Stationary: every cascade is drawn on the first frame and none again while the camera stands still.
+		- Small moves: moving the camera anywhere within SHADOW_CACHE_MARGIN of the tightest cascade (less a texel
+		  for the snapping) redraws nothing, and moving well past it does redraw that cascade.
+		- Path: a camera flying a circle, turning round halfway. Every frame CheckCoverage has to come back 0 and every
+		  cache centre has to sit on its cascade's texel grid (within SHADOW_TEST_SNAP_TOLERANCE texels).
+		- Invalidation: random spheres through InvalidateSphere with the camera still, the cascades redrawn next frame
+		  have to be exactly the ones the sphere overlaps. That's worked out from the matrices the render thread gets,
+		  not from TestCaster, and at least some spheres have to dirty some but not all of the cascades.
+	The report has the counts behind each check and how often each cascade was redrawn along the path.
+*/
+
+const char* const SHADOW_TEST_DEFAULT_REPORT = "shadow_test.txt";
+const int SHADOW_TEST_SCREEN_WIDTH = 1920;
+const int SHADOW_TEST_SCREEN_HEIGHT = 1080;
+const int SHADOW_TEST_STILL_FRAMES = 120;
+const int SHADOW_TEST_MOVES = 1000;
+const int SHADOW_TEST_PATH_FRAMES = 1800;
+const float SHADOW_TEST_PATH_RADIUS = 60.0f;
+const int SHADOW_TEST_SPHERES = 1000;
+const float SHADOW_TEST_SNAP_TOLERANCE = 0.05f; // texels, cache centres are float so whole texels come out a little off
+const float SHADOW_TEST_EDGE = 0.001f; // spheres this close to a cascade's edge (clip space) could go either way and are skipped
+
+class ShadowTestClass
+{
+public:
+	ShadowTestClass();
+	ShadowTestClass(const ShadowTestClass&);
+	~ShadowTestClass();
+
+	// Returns the process exit code, 0 = passed, 1 = failed, 2 = couldn't write the report
+	static int Run(const std::string&);
+
+	bool Initialize();
+	void Shutdown();
+
+	bool TestStationary(FILE*);
+	bool TestSmallMoves(FILE*);
+	bool TestPath(FILE*);
+	bool TestInvalidation(FILE*);
+
+private:
+	// Starts the cascades over with nothing cached
+	bool Reset();
+	int CountUnsnapped();
+
+private:
+	ShadowCascadeClass* m_Cascades;
+	ShadowFrameType m_frame;
+	XMFLOAT4X4 m_projection;
+	unsigned int m_random;
+};
@@ -0,0 +1,179 @@
+#include "softwarerasterizerclass.h"
+
+#include <math.h>
+#include <string.h>
+
+SoftwareRasterizerClass::SoftwareRasterizerClass() :
+	m_width(0),
+	m_height(0),
+	m_cacheNext(0)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+SoftwareRasterizerClass::SoftwareRasterizerClass(const SoftwareRasterizerClass&)
+{
+}
+
+SoftwareRasterizerClass::~SoftwareRasterizerClass()
+{
+}
+
+bool SoftwareRasterizerClass::Initialize(int width, int height)
+{
+	if (width < 1 || height < 1)
+		return false;
+
+	m_width = width;
+	m_height = height;
+	m_depth.resize(width * height);
+
+	Clear();
+	ResetStats();
+
+	return true;
+}
+
+void SoftwareRasterizerClass::Shutdown()
+{
+	m_depth.clear();
+	m_depth.shrink_to_fit();
+}
+
+void SoftwareRasterizerClass::Clear()
+{
+	for (size_t i = 0; i < m_depth.size(); ++i)
+		m_depth[i] = 1.0f;
+
+	for (int i = 0; i < RASTER_VERTEX_CACHE_SIZE; ++i)
+		m_cache[i].index = 0xFFFFFFFF;
+	m_cacheNext = 0;
+}
+
+void SoftwareRasterizerClass::DrawIndexed(const XMFLOAT3* positions, const unsigned int* indices, unsigned int indexCount, CXMMATRIX transform)
+{
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+	{
+		XMFLOAT3 a = TransformVertex(positions, indices[i], transform);
+		XMFLOAT3 b = TransformVertex(positions, indices[i + 1], transform);
+		XMFLOAT3 c = TransformVertex(positions, indices[i + 2], transform);
+
+		++m_stats.triangles;
+		DrawTriangle(a, b, c);
+	}
+}
+
+XMFLOAT3 SoftwareRasterizerClass::TransformVertex(const XMFLOAT3* positions, unsigned int index, CXMMATRIX transform)
+{
+	for (int i = 0; i < RASTER_VERTEX_CACHE_SIZE; ++i)
+	{
+		if (m_cache[i].index == index)
+			return m_cache[i].position;
+	}
+
+	// Miss, replace the oldest entry. Hits don't refresh anything, it's a fifo not an lru
+	XMVECTOR clip = XMVector3TransformCoord(XMLoadFloat3(&positions[index]), transform);
+
+	CacheEntryType& entry = m_cache[m_cacheNext];
+	entry.index = index;
+	entry.position.x = (XMVectorGetX(clip) * 0.5f + 0.5f) * (float)m_width;
+	entry.position.y = (0.5f - XMVectorGetY(clip) * 0.5f) * (float)m_height;
+	entry.position.z = XMVectorGetZ(clip);
+
+	m_cacheNext = (m_cacheNext + 1) % RASTER_VERTEX_CACHE_SIZE;
+	++m_stats.vertexTransforms;
+
+	return entry.position;
+}
+
+void SoftwareRasterizerClass::DrawTriangle(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+	// Twice the signed area, positive for clockwise on screen (y points down)
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (area <= 0.0f)
+	{
+		++m_stats.trianglesCulled;
+		return;
+	}
+
+	int minX = (int)floorf(a.x < b.x ? (a.x < c.x ? a.x : c.x) : (b.x < c.x ? b.x : c.x));
+	int maxX = (int)ceilf(a.x > b.x ? (a.x > c.x ? a.x : c.x) : (b.x > c.x ? b.x : c.x));
+	int minY = (int)floorf(a.y < b.y ? (a.y < c.y ? a.y : c.y) : (b.y < c.y ? b.y : c.y));
+	int maxY = (int)ceilf(a.y > b.y ? (a.y > c.y ? a.y : c.y) : (b.y > c.y ? b.y : c.y));
+	minX = minX < 0 ? 0 : minX;
+	minY = minY < 0 ? 0 : minY;
+	maxX = maxX > m_width ? m_width : maxX;
+	maxY = maxY > m_height ? m_height : maxY;
+
+	if (minX >= maxX || minY >= maxY)
+		return;
+
+	// Edge functions for the edges opposite a, b and c, they're the barycentric weights of those corners times area.
+	// Top left rule: a pixel centre exactly on an edge belongs to the triangle only if it's a top or left edge,
+	// so neighbours sharing the edge don't both draw it. With clockwise winding and y down those are the edges
+	// going right along a horizontal or going up
+	const XMFLOAT3* from[3] = { &b, &c, &a };
+	const XMFLOAT3* to[3] = { &c, &a, &b };
+	float stepX[3], stepY[3], rowStart[3];
+	bool topLeft[3];
+	for (int e = 0; e < 3; ++e)
+	{
+		float dx = to[e]->x - from[e]->x;
+		float dy = to[e]->y - from[e]->y;
+		topLeft[e] = (dy == 0.0f && dx > 0.0f) || dy < 0.0f;
+
+		stepX[e] = -dy;
+		stepY[e] = dx;
+		rowStart[e] = dx * ((float)minY + 0.5f - from[e]->y) - dy * ((float)minX + 0.5f - from[e]->x);
+	}
+
+	float inverseArea = 1.0f / area;
+
+	for (int y = minY; y < maxY; ++y)
+	{
+		float w0 = rowStart[0], w1 = rowStart[1], w2 = rowStart[2];
+		float* depthRow = &m_depth[y * m_width];
+
+		for (int x = minX; x < maxX; ++x)
+		{
+			if ((w0 > 0.0f || (w0 == 0.0f && topLeft[0])) && (w1 > 0.0f || (w1 == 0.0f && topLeft[1])) && (w2 > 0.0f || (w2 == 0.0f && topLeft[2])))
+			{
+				++m_stats.pixelsTested;
+
+				float depth = (w0 * a.z + w1 * b.z + w2 * c.z) * inverseArea;
+				if (depth < depthRow[x])
+				{
+					depthRow[x] = depth;
+					++m_stats.pixelsWritten;
+				}
+			}
+
+			w0 += stepX[0];
+			w1 += stepX[1];
+			w2 += stepX[2];
+		}
+
+		rowStart[0] += stepY[0];
+		rowStart[1] += stepY[1];
+		rowStart[2] += stepY[2];
+	}
+}
+
+const RasterStatsType& SoftwareRasterizerClass::GetStats()
+{
+	return m_stats;
+}
+
+void SoftwareRasterizerClass::ResetStats()
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+unsigned int SoftwareRasterizerClass::CountCoveredPixels()
+{
+	unsigned int covered = 0;
+	for (size_t i = 0; i < m_depth.size(); ++i)
+		covered += m_depth[i] < 1.0f ? 1 : 0;
+
+	return covered;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+/*
+	Depth only triangle rasterizer on the cpu, for measuring meshes rather than drawing them.
+	Runs vertices through a small fifo post transform cache like the hardware does, culls back faces (clockwise is
+	front, same as the d3d default), and fills pixel centres with the top left rule and a less depth test.
+	The stats say how many vertices had to be transformed and how many pixels passed the depth test, which is
+	what vertex cache and overdraw ordering are meant to bring down.
+*/
+
+const int RASTER_VERTEX_CACHE_SIZE = 16;
+
+struct RasterStatsType
+{
+	unsigned long long triangles;
+	unsigned long long trianglesCulled; // back facing
+	unsigned long long vertexTransforms; // post transform cache misses
+	unsigned long long pixelsTested; // inside a front facing triangle
+	unsigned long long pixelsWritten; // passed the depth test, what a pixel shader would have run on
+};
+
+class SoftwareRasterizerClass
+{
+private:
+	struct CacheEntryType
+	{
+		unsigned int index;
+		XMFLOAT3 position; // pixels, depth in z
+	};
+
+public:
+	SoftwareRasterizerClass();
+	SoftwareRasterizerClass(const SoftwareRasterizerClass&);
+	~SoftwareRasterizerClass();
+
+	bool Initialize(int, int);
+	void Shutdown();
+
+	// Depth back to 1, and empties the vertex cache
+	void Clear();
+	// Triangle list, the matrix takes positions to clip space (w is divided out, there's no clipping against near)
+	void DrawIndexed(const XMFLOAT3*, const unsigned int*, unsigned int, CXMMATRIX);
+
+	const RasterStatsType& GetStats();
+	void ResetStats();
+	// Pixels with anything drawn on them since the last Clear
+	unsigned int CountCoveredPixels();
+
+private:
+	XMFLOAT3 TransformVertex(const XMFLOAT3*, unsigned int, CXMMATRIX);
+	void DrawTriangle(const XMFLOAT3&, const XMFLOAT3&, const XMFLOAT3&);
+
+private:
+	int m_width;
+	int m_height;
+	std::vector<float> m_depth;
+	CacheEntryType m_cache[RASTER_VERTEX_CACHE_SIZE];
+	int m_cacheNext;
+	RasterStatsType m_stats;
+};
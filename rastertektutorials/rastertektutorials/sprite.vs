@@ -0,0 +1,36 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: sprite.vs
+// 2D overlay quads, positions are already in pixels relative to the screen centre
+// so the ortho matrix is all that's needed.
+////////////////////////////////////////////////////////////////////////////////
+
+cbuffer MatrixBuffer
+{
+	matrix projectionMatrix;
+};
+
+struct VertexInputType
+{
+	float2 position : POSITION;
+	float2 tex : TEXCOORD0;
+	float4 color : COLOR;
+};
+
+struct PixelInputType
+{
+	float4 position : SV_POSITION;
+	float2 tex : TEXCOORD0;
+	float4 color : COLOR;
+};
+
+PixelInputType SpriteVertexShader(VertexInputType input)
+{
+	PixelInputType output;
+
+	// z just has to land between the near and far plane of the ortho matrix, depth testing is off for 2D
+	output.position = mul(float4(input.position, 1.0f, 1.0f), projectionMatrix);
+	output.tex = input.tex;
+	output.color = input.color;
+
+	return output;
+}
@@ -0,0 +1,323 @@
+#include "spritebatchclass.h"
+
+#include <algorithm>
+#include <string.h>
+
+SpriteBatchClass::SpriteBatchClass() :
+	m_maxQuads(0),
+	m_screenWidth(0),
+	m_screenHeight(0),
+	m_layer(0),
+	m_droppedQuads(0),
+	m_ringPosition(0),
+	m_vertexBuffer(nullptr),
+	m_indexBuffer(nullptr)
+{
+}
+
+SpriteBatchClass::SpriteBatchClass(const SpriteBatchClass&)
+{
+}
+
+SpriteBatchClass::~SpriteBatchClass()
+{
+}
+
+bool SpriteBatchClass::Initialize(ID3D11Device* device, int maxQuads)
+{
+	m_maxQuads = maxQuads < 1 ? 1 : (maxQuads > SPRITE_BATCH_MAX_QUADS ? SPRITE_BATCH_MAX_QUADS : maxQuads);
+	m_quads.reserve(m_maxQuads);
+	m_sortKeys.reserve(m_maxQuads);
+	m_vertices.reserve((size_t)m_maxQuads * 4);
+	m_ringPosition = 0;
+
+	if (device == nullptr)
+		return true;
+
+	D3D11_BUFFER_DESC vertexBufferDesc;
+	vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vertexBufferDesc.ByteWidth = sizeof(SpriteVertexType) * m_maxQuads * 4;
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vertexBufferDesc.MiscFlags = 0;
+	vertexBufferDesc.StructureByteStride = 0;
+
+	if (FAILED(device->CreateBuffer(&vertexBufferDesc, nullptr, &m_vertexBuffer)))
+		return false;
+
+	// Quads never change shape so the indices are built once, draws pick their quads with the base vertex
+	std::vector<unsigned short> indices((size_t)m_maxQuads * 6);
+	for (int i = 0; i < m_maxQuads; ++i)
+	{
+		const unsigned short vertex = (unsigned short)(i * 4);
+		indices[i * 6 + 0] = vertex + 0;
+		indices[i * 6 + 1] = vertex + 1;
+		indices[i * 6 + 2] = vertex + 2;
+		indices[i * 6 + 3] = vertex + 2;
+		indices[i * 6 + 4] = vertex + 1;
+		indices[i * 6 + 5] = vertex + 3;
+	}
+
+	D3D11_BUFFER_DESC indexBufferDesc;
+	indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexBufferDesc.ByteWidth = (unsigned int)(sizeof(unsigned short) * indices.size());
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA indexData;
+	indexData.pSysMem = indices.data();
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+
+	if (FAILED(device->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer)))
+		return false;
+
+	return true;
+}
+
+void SpriteBatchClass::Shutdown()
+{
+	if (m_indexBuffer)
+	{
+		m_indexBuffer->Release();
+		m_indexBuffer = nullptr;
+	}
+
+	if (m_vertexBuffer)
+	{
+		m_vertexBuffer->Release();
+		m_vertexBuffer = nullptr;
+	}
+
+	m_quads.clear();
+	m_sortKeys.clear();
+	m_textures.clear();
+	m_vertices.clear();
+	m_batches.clear();
+}
+
+void SpriteBatchClass::Begin(int screenWidth, int screenHeight)
+{
+	m_screenWidth = screenWidth;
+	m_screenHeight = screenHeight;
+	m_layer = 0;
+	m_droppedQuads = 0;
+	m_quads.clear();
+	m_textures.clear();
+}
+
+void SpriteBatchClass::SetLayer(int layer)
+{
+	m_layer = layer;
+}
+
+void SpriteBatchClass::Draw(ID3D11ShaderResourceView* texture, float x, float y, float width, float height, const AtlasRegionType& region, unsigned int color)
+{
+	if ((int)m_quads.size() >= m_maxQuads)
+	{
+		++m_droppedQuads;
+		return;
+	}
+
+	// Only a handful of textures per frame, a linear search beats any map here
+	unsigned int textureIndex = 0;
+	while (textureIndex < m_textures.size() && m_textures[textureIndex] != texture)
+		++textureIndex;
+
+	if (textureIndex == m_textures.size())
+		m_textures.push_back(texture);
+
+	QuadType quad;
+	quad.left = x;
+	quad.top = y;
+	quad.right = x + width;
+	quad.bottom = y + height;
+	quad.u0 = region.u0;
+	quad.v0 = region.v0;
+	quad.u1 = region.u1;
+	quad.v1 = region.v1;
+	quad.color = color;
+	quad.texture = textureIndex;
+	quad.layer = m_layer;
+	m_quads.push_back(quad);
+}
+
+void SpriteBatchClass::DrawRect(AtlasClass* atlas, float x, float y, float width, float height, unsigned int color)
+{
+	Draw(atlas->GetTexture(), x, y, width, height, atlas->GetWhiteRegion(), color);
+}
+
+float SpriteBatchClass::DrawString(FontClass* font, float x, float y, const char* text, unsigned int color)
+{
+	ID3D11ShaderResourceView* texture = font->GetAtlas()->GetTexture();
+	float penX = x;
+	float penY = y;
+	float widest = 0.0f;
+
+	for (const char* c = text; *c; ++c)
+	{
+		if (*c == '\n')
+		{
+			widest = std::max(widest, penX - x);
+			penX = x;
+			penY += font->GetLineHeight();
+			continue;
+		}
+
+		const GlyphType* glyph = font->GetGlyph(*c);
+		if (glyph == nullptr)
+			continue;
+
+		// Spaces have a region with nothing in it, no point spending a quad on them
+		if (*c != ' ' && glyph->region.width > 0)
+			Draw(texture, penX, penY, (float)glyph->region.width, (float)glyph->region.height, glyph->region, color);
+
+		penX += glyph->advance;
+	}
+
+	return std::max(widest, penX - x);
+}
+
+void SpriteBatchClass::DrawTextPanel(FontClass* font, AtlasClass* atlas, float x, float y, float margin, const char* text, unsigned int textColor, unsigned int panelColor)
+{
+	const int layer = m_layer;
+
+	SetLayer(layer + 1);
+	const float width = DrawString(font, x + margin, y + margin, text, textColor);
+
+	int lines = 1;
+	for (const char* c = text; *c; ++c)
+		lines += *c == '\n' ? 1 : 0;
+
+	SetLayer(layer);
+	DrawRect(atlas, x, y, width + margin * 2.0f, font->GetLineHeight() * lines + margin * 2.0f, panelColor);
+}
+
+void SpriteBatchClass::End()
+{
+	/*
+		Sort on a single 64 bit key: layer | texture | submission order. Submission order in the low bits
+		makes the sort stable and also tells us which quad the key belongs to.
+		Layer is biased so negative layers still sort below positive ones.
+	*/
+	const int quadCount = (int)m_quads.size();
+	m_sortKeys.resize(quadCount);
+	for (int i = 0; i < quadCount; ++i)
+	{
+		const unsigned long long layer = (unsigned long long)(unsigned short)(m_quads[i].layer + 0x8000);
+		m_sortKeys[i] = (layer << 48) | ((unsigned long long)(m_quads[i].texture & 0xFFFF) << 32) | (unsigned int)i;
+	}
+
+	std::sort(m_sortKeys.begin(), m_sortKeys.end());
+
+	// Pixels with 0,0 top left -> ortho space with 0,0 in the middle and y up
+	const float halfWidth = m_screenWidth * 0.5f;
+	const float halfHeight = m_screenHeight * 0.5f;
+
+	m_vertices.resize((size_t)quadCount * 4);
+	m_batches.clear();
+	for (int i = 0; i < quadCount; ++i)
+	{
+		const QuadType& quad = m_quads[(unsigned int)(m_sortKeys[i] & 0xFFFFFFFFull)];
+		ID3D11ShaderResourceView* texture = m_textures[quad.texture];
+
+		if (m_batches.empty() || m_batches.back().texture != texture)
+		{
+			SpriteBatchType batch = { texture, i, 0 };
+			m_batches.push_back(batch);
+		}
+
+		++m_batches.back().quadCount;
+
+		const float left = quad.left - halfWidth;
+		const float right = quad.right - halfWidth;
+		const float top = halfHeight - quad.top;
+		const float bottom = halfHeight - quad.bottom;
+
+		// Clockwise from the front: top left, top right, bottom left, bottom right
+		SpriteVertexType* vertex = &m_vertices[(size_t)i * 4];
+		vertex[0].position = XMFLOAT2(left, top);
+		vertex[0].texture = XMFLOAT2(quad.u0, quad.v0);
+		vertex[0].color = quad.color;
+		vertex[1].position = XMFLOAT2(right, top);
+		vertex[1].texture = XMFLOAT2(quad.u1, quad.v0);
+		vertex[1].color = quad.color;
+		vertex[2].position = XMFLOAT2(left, bottom);
+		vertex[2].texture = XMFLOAT2(quad.u0, quad.v1);
+		vertex[2].color = quad.color;
+		vertex[3].position = XMFLOAT2(right, bottom);
+		vertex[3].texture = XMFLOAT2(quad.u1, quad.v1);
+		vertex[3].color = quad.color;
+	}
+}
+
+bool SpriteBatchClass::Render(ID3D11DeviceContext* deviceContext, SpriteShaderClass* shader, XMMATRIX orthoMatrix)
+{
+	const int quadCount = (int)m_quads.size();
+	if (quadCount == 0 || deviceContext == nullptr)
+		return true;
+
+	/*
+		Append after whatever the previous frames wrote, the gpu may still be reading that so NO_OVERWRITE
+		promises we won't touch it. Once we run off the end DISCARD hands us a fresh buffer and we start over at 0.
+	*/
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (m_ringPosition + quadCount > m_maxQuads)
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		m_ringPosition = 0;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext->Map(m_vertexBuffer, 0, mapType, 0, &mappedResource)))
+		return false;
+
+	SpriteVertexType* vertices = (SpriteVertexType*)mappedResource.pData + (size_t)m_ringPosition * 4;
+	memcpy(vertices, m_vertices.data(), sizeof(SpriteVertexType) * m_vertices.size());
+	deviceContext->Unmap(m_vertexBuffer, 0);
+
+	if (shader->SetShaderParameters(deviceContext, orthoMatrix) == false)
+		return false;
+
+	unsigned int stride = sizeof(SpriteVertexType);
+	unsigned int offset = 0;
+	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	for (const SpriteBatchType& batch : m_batches)
+	{
+		shader->SetTexture(deviceContext, batch.texture);
+		deviceContext->DrawIndexed(batch.quadCount * 6, 0, (m_ringPosition + batch.startQuad) * 4);
+	}
+
+	m_ringPosition += quadCount;
+	return true;
+}
+
+int SpriteBatchClass::GetQuadCount()
+{
+	return (int)m_quads.size();
+}
+
+int SpriteBatchClass::GetBatchCount()
+{
+	return (int)m_batches.size();
+}
+
+int SpriteBatchClass::GetDroppedQuads()
+{
+	return m_droppedQuads;
+}
+
+const std::vector<SpriteBatchType>& SpriteBatchClass::GetBatches()
+{
+	return m_batches;
+}
+
+const std::vector<SpriteVertexType>& SpriteBatchClass::GetVertices()
+{
+	return m_vertices;
+}
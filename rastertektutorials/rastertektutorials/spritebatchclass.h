@@ -0,0 +1,106 @@
+#pragma once
+
+#include <d3d11.h>
+#include <directxmath.h>
+#include <vector>
+#include "atlasclass.h"
+#include "fontclass.h"
+#include "spriteshaderclass.h"
+
+using namespace DirectX;
+
+/*
+	Collects every 2D quad for a frame (sprites, text, rectangles) and draws them with as few draw calls as possible.
+	Begin() .. Draw*() .. End() is pure cpu work: End sorts the quads by layer and then texture (keeping submission
+	order inside a texture) and builds the vertices and the list of batches, one batch per texture change.
+	Render() streams the vertices into one dynamic vertex buffer used as a ring (NO_OVERWRITE while there's
+	room, DISCARD when it wraps) and issues one DrawIndexed per batch.
+	Everything is in pixels with 0,0 top left, converted to the centred coordinates the ortho matrix expects.
+	Layers exist because sorting by texture throws away draw order between textures: draw backgrounds
+	on a lower layer than what goes on top of them.
+	Without a device (benchmarks) End still does all the work, Render just counts draws.
+*/
+
+const int SPRITE_BATCH_MAX_QUADS = 16384; // 16 bit indices
+
+// Matches the input layout in spriteshaderclass.cpp
+struct SpriteVertexType
+{
+	XMFLOAT2 position;
+	XMFLOAT2 texture;
+	unsigned int color; // RGBA8, 0xAABBGGRR
+};
+
+struct SpriteBatchType
+{
+	ID3D11ShaderResourceView* texture;
+	int startQuad;
+	int quadCount;
+};
+
+// 0xAABBGGRR so it can go straight into an R8G8B8A8_UNORM vertex
+inline unsigned int SpriteColor(float r, float g, float b, float a)
+{
+	return ((unsigned int)(a * 255.0f + 0.5f) << 24) | ((unsigned int)(b * 255.0f + 0.5f) << 16) |
+		((unsigned int)(g * 255.0f + 0.5f) << 8) | (unsigned int)(r * 255.0f + 0.5f);
+}
+
+class SpriteBatchClass
+{
+private:
+	struct QuadType
+	{
+		float left, top, right, bottom;
+		float u0, v0, u1, v1;
+		unsigned int color;
+		unsigned int texture; // index into m_textures
+		int layer;
+	};
+
+public:
+	SpriteBatchClass();
+	SpriteBatchClass(const SpriteBatchClass&);
+	~SpriteBatchClass();
+
+	// Device can be nullptr for cpu only use, max quads is clamped to SPRITE_BATCH_MAX_QUADS
+	bool Initialize(ID3D11Device*, int);
+	void Shutdown();
+
+	// Screen width and height
+	void Begin(int, int);
+	void SetLayer(int);
+	// Texture, x, y, width, height, region, color
+	void Draw(ID3D11ShaderResourceView*, float, float, float, float, const AtlasRegionType&, unsigned int);
+	// Solid rectangle using the atlas white patch
+	void DrawRect(AtlasClass*, float, float, float, float, unsigned int);
+	// Top left of the first line, '\n' starts a new line. Returns the width of the widest line
+	float DrawString(FontClass*, float, float, const char*, unsigned int);
+	// Text on a solid panel with the given margin, top left of the panel, text color, panel color. The panel goes on the
+	// current layer and the text one above it, with the font in the same atlas the whole thing is one batch
+	void DrawTextPanel(FontClass*, AtlasClass*, float, float, float, const char*, unsigned int, unsigned int);
+	void End();
+
+	bool Render(ID3D11DeviceContext*, SpriteShaderClass*, XMMATRIX);
+
+	// Stats for the frame End() was last called for
+	int GetQuadCount();
+	int GetBatchCount();
+	int GetDroppedQuads();
+	const std::vector<SpriteBatchType>& GetBatches();
+	const std::vector<SpriteVertexType>& GetVertices();
+
+private:
+	std::vector<QuadType> m_quads;
+	std::vector<unsigned long long> m_sortKeys;
+	std::vector<ID3D11ShaderResourceView*> m_textures;
+	std::vector<SpriteVertexType> m_vertices;
+	std::vector<SpriteBatchType> m_batches;
+	int m_maxQuads;
+	int m_screenWidth;
+	int m_screenHeight;
+	int m_layer;
+	int m_droppedQuads;
+	int m_ringPosition; // in quads
+	ID3D11Buffer* m_vertexBuffer;
+	ID3D11Buffer* m_indexBuffer;
+};
@@ -0,0 +1,151 @@
+#include "spriteshaderclass.h"
+
+SpriteShaderClass::SpriteShaderClass() :
+	m_ShaderCache(nullptr),
+	m_program(-1),
+	m_matrixBuffer(nullptr),
+	m_sampleState(nullptr)
+{
+}
+
+SpriteShaderClass::SpriteShaderClass(const SpriteShaderClass&)
+{
+}
+
+SpriteShaderClass::~SpriteShaderClass()
+{
+}
+
+bool SpriteShaderClass::Initialize(ShaderCacheClass* shaderCache, ID3D11Device* device, HWND hwnd)
+{
+	m_ShaderCache = shaderCache;
+	return InitializeShader(device, hwnd, "sprite.vs", "sprite.ps");
+}
+
+void SpriteShaderClass::Shutdown()
+{
+	ShutdownShader();
+}
+
+bool SpriteShaderClass::SetShaderParameters(ID3D11DeviceContext* deviceContext, XMMATRIX projectionMatrix)
+{
+	// Looked up every time, a reload may have swapped it since last frame
+	const ShaderProgramType* program = m_ShaderCache->GetProgram(m_program);
+	if (program == nullptr)
+		return false;
+
+	// Shaders want column major
+	projectionMatrix = XMMatrixTranspose(projectionMatrix);
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	if (FAILED(deviceContext->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		return false;
+
+	MatrixBufferType* data = (MatrixBufferType*)mappedResource.pData;
+	data->projection = projectionMatrix;
+	deviceContext->Unmap(m_matrixBuffer, 0);
+
+	deviceContext->VSSetConstantBuffers(0, 1, &m_matrixBuffer);
+	deviceContext->IASetInputLayout(program->layout);
+	deviceContext->VSSetShader(program->vertexShader, nullptr, 0);
+	deviceContext->PSSetShader(program->pixelShader, nullptr, 0);
+	deviceContext->PSSetSamplers(0, 1, &m_sampleState);
+	return true;
+}
+
+void SpriteShaderClass::SetTexture(ID3D11DeviceContext* deviceContext, ID3D11ShaderResourceView* texture)
+{
+	deviceContext->PSSetShaderResources(0, 1, &texture);
+}
+
+bool SpriteShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, const char* vsFilename, const char* psFilename)
+{
+	HRESULT result;
+
+	// Has to match SpriteVertexType in spritebatchclass.h
+	D3D11_INPUT_ELEMENT_DESC polygonLayout[3];
+	polygonLayout[0].SemanticName = "POSITION";
+	polygonLayout[0].SemanticIndex = 0;
+	polygonLayout[0].Format = DXGI_FORMAT_R32G32_FLOAT;
+	polygonLayout[0].InputSlot = 0;
+	polygonLayout[0].AlignedByteOffset = 0;
+	polygonLayout[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	polygonLayout[0].InstanceDataStepRate = 0;
+
+	polygonLayout[1].SemanticName = "TEXCOORD";
+	polygonLayout[1].SemanticIndex = 0;
+	polygonLayout[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+	polygonLayout[1].InputSlot = 0;
+	polygonLayout[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	polygonLayout[1].InstanceDataStepRate = 0;
+
+	polygonLayout[2].SemanticName = "COLOR";
+	polygonLayout[2].SemanticIndex = 0;
+	polygonLayout[2].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	polygonLayout[2].InputSlot = 0;
+	polygonLayout[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	polygonLayout[2].InstanceDataStepRate = 0;
+
+	const int numElements = sizeof(polygonLayout) / sizeof(polygonLayout[0]);
+	m_program = m_ShaderCache->Load(vsFilename, "SpriteVertexShader", psFilename, "SpritePixelShader", polygonLayout, numElements);
+	if (m_program < 0)
+	{
+		MessageBox(hwnd, "Error compiling shader.  Check shader-error.txt for message.", vsFilename, MB_OK);
+		return false;
+	}
+
+	D3D11_BUFFER_DESC matrixBufferDesc;
+	matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
+	matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	matrixBufferDesc.MiscFlags = 0;
+	matrixBufferDesc.StructureByteStride = 0;
+
+	result = device->CreateBuffer(&matrixBufferDesc, nullptr, &m_matrixBuffer);
+	if (FAILED(result))
+		return false;
+
+	// Clamp so glyphs at the atlas edge don't pick up the other side, linear since sprites can be scaled
+	D3D11_SAMPLER_DESC samplerDesc;
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.MipLODBias = 0.0f;
+	samplerDesc.MaxAnisotropy = 1;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+	samplerDesc.BorderColor[0] = 0;
+	samplerDesc.BorderColor[1] = 0;
+	samplerDesc.BorderColor[2] = 0;
+	samplerDesc.BorderColor[3] = 0;
+	samplerDesc.MinLOD = 0;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	result = device->CreateSamplerState(&samplerDesc, &m_sampleState);
+	if (FAILED(result))
+		return false;
+
+	return true;
+}
+
+void SpriteShaderClass::ShutdownShader()
+{
+	if (m_sampleState)
+	{
+		m_sampleState->Release();
+		m_sampleState = nullptr;
+	}
+
+	if (m_matrixBuffer)
+	{
+		m_matrixBuffer->Release();
+		m_matrixBuffer = nullptr;
+	}
+
+	// The program itself belongs to the cache
+	m_program = -1;
+	m_ShaderCache = nullptr;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <d3d11.h>
+#include <directxmath.h>
+#include "shadercacheclass.h"
+
+using namespace DirectX;
+
+/*
+	Shader for SpriteBatchClass (sprite.vs / sprite.ps).
+	Unlike the per object shaders this doesn't draw anything itself, SetShaderParameters binds the whole
+	pipeline state once and the batch then only swaps textures between its draw calls.
+	The compiled shaders live in the ShaderCacheClass so they hot reload, this only keeps the handle.
+*/
+
+class SpriteShaderClass
+{
+private:
+	struct MatrixBufferType
+	{
+		XMMATRIX projection;
+	};
+
+public:
+	SpriteShaderClass();
+	SpriteShaderClass(const SpriteShaderClass&);
+	~SpriteShaderClass();
+
+	bool Initialize(ShaderCacheClass*, ID3D11Device*, HWND);
+	void Shutdown();
+
+	bool SetShaderParameters(ID3D11DeviceContext*, XMMATRIX);
+	void SetTexture(ID3D11DeviceContext*, ID3D11ShaderResourceView*);
+
+private:
+	bool InitializeShader(ID3D11Device*, HWND, const char*, const char*);
+	void ShutdownShader();
+
+private:
+	ShaderCacheClass* m_ShaderCache;
+	int m_program;
+	ID3D11Buffer* m_matrixBuffer;
+	ID3D11SamplerState* m_sampleState;
+};
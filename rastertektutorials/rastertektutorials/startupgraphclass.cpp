@@ -0,0 +1,246 @@
+#include "startupgraphclass.h"
+
+#include <windows.h>
+#include <stdio.h>
+
+StartupGraphClass::StartupGraphClass() :
+	m_remaining(0),
+	m_running(0),
+	m_failed(false),
+	m_quit(false),
+	m_frequency(1),
+	m_startTicks(0),
+	m_finishTicks(0),
+	m_firstFrameTicks(0)
+{
+}
+
+StartupGraphClass::StartupGraphClass(const StartupGraphClass&)
+{
+}
+
+StartupGraphClass::~StartupGraphClass()
+{
+}
+
+bool StartupGraphClass::Initialize()
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	m_frequency = frequency.QuadPart;
+	m_startTicks = Now();
+	return true;
+}
+
+void StartupGraphClass::Shutdown()
+{
+	// Run() always joins its workers, the tasks' functions may hold on to things captured by reference
+	m_tasks.clear();
+	m_ready.clear();
+	m_readyMain.clear();
+}
+
+int StartupGraphClass::AddTask(const char* name, StartupThread thread, const std::function<bool()>& function, std::initializer_list<int> dependencies)
+{
+	const int id = (int)m_tasks.size();
+
+	TaskType task;
+	task.name = name;
+	task.thread = thread;
+	task.function = function;
+	task.waitingOn = 0;
+	task.runner = 0;
+	task.start = 0;
+	task.end = 0;
+	task.failed = false;
+	m_tasks.push_back(task);
+
+	for (int dependency : dependencies)
+	{
+		if (dependency < 0 || dependency >= id)
+			continue;
+
+		m_tasks[dependency].dependents.push_back(id);
+		++m_tasks[id].waitingOn;
+	}
+
+	return id;
+}
+
+bool StartupGraphClass::Run(int workerCount)
+{
+	if (workerCount <= 0)
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+
+	// No point having more workers than tasks, and always at least one so any-thread tasks can't starve
+	int anyThreadTasks = 0;
+	for (const TaskType& task : m_tasks)
+		anyThreadTasks += task.thread == STARTUP_ANY_THREAD ? 1 : 0;
+
+	if (workerCount > anyThreadTasks)
+		workerCount = anyThreadTasks;
+	if (workerCount < 1 && anyThreadTasks > 0)
+		workerCount = 1;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_remaining = (int)m_tasks.size();
+	m_running = 0;
+	m_failed = false;
+	m_quit = false;
+
+	for (int i = 0; i < (int)m_tasks.size(); ++i)
+	{
+		if (m_tasks[i].waitingOn == 0)
+			(m_tasks[i].thread == STARTUP_MAIN_THREAD ? m_readyMain : m_ready).push_back(i);
+	}
+
+	for (int i = 0; i < workerCount; ++i)
+		m_workers.push_back(std::thread(&StartupGraphClass::WorkerThread, this, i + 1));
+
+	// This thread runs the main thread tasks and otherwise just waits
+	while (IsFinished() == false)
+	{
+		if (m_failed == false && m_readyMain.empty() == false)
+		{
+			const int id = m_readyMain.front();
+			m_readyMain.pop_front();
+			Execute(id, 0, lock);
+			continue;
+		}
+
+		m_changed.wait(lock);
+	}
+
+	m_quit = true;
+	m_finishTicks = Now();
+	lock.unlock();
+
+	m_changed.notify_all();
+	for (std::thread& worker : m_workers)
+		worker.join();
+
+	m_workers.clear();
+	return m_failed == false;
+}
+
+void StartupGraphClass::WorkerThread(int runner)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_changed.wait(lock, [this] { return m_quit || (m_failed == false && m_ready.empty() == false); });
+		if (m_quit)
+			break;
+
+		const int id = m_ready.front();
+		m_ready.pop_front();
+		Execute(id, runner, lock);
+	}
+}
+
+void StartupGraphClass::Execute(int id, int runner, std::unique_lock<std::mutex>& lock)
+{
+	// Called with the lock held, the task itself runs without it
+	TaskType& task = m_tasks[id];
+	task.runner = runner;
+	task.start = Now();
+	++m_running;
+	lock.unlock();
+
+	const bool result = task.function();
+
+	lock.lock();
+	task.end = Now();
+	task.failed = result == false;
+	--m_running;
+	--m_remaining;
+
+	// After a failure nothing new starts, Run() returns once whatever is still running is done
+	if (result == false)
+		m_failed = true;
+
+	for (int dependent : task.dependents)
+	{
+		if (--m_tasks[dependent].waitingOn == 0)
+			(m_tasks[dependent].thread == STARTUP_MAIN_THREAD ? m_readyMain : m_ready).push_back(dependent);
+	}
+
+	m_changed.notify_all();
+}
+
+bool StartupGraphClass::IsFinished()
+{
+	return m_remaining == 0 || (m_failed && m_running == 0);
+}
+
+void StartupGraphClass::MarkFirstFrame()
+{
+	long long expected = 0;
+	m_firstFrameTicks.compare_exchange_strong(expected, Now());
+}
+
+double StartupGraphClass::GetStartupTime()
+{
+	return m_finishTicks ? TicksToMs(m_finishTicks - m_startTicks) : 0.0;
+}
+
+double StartupGraphClass::GetTimeToFirstFrame()
+{
+	const long long firstFrame = m_firstFrameTicks;
+	return firstFrame ? TicksToMs(firstFrame - m_startTicks) : 0.0;
+}
+
+bool StartupGraphClass::WriteTrace(const char* filename)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "w") != 0 || file == nullptr)
+		return false;
+
+	// Same format as ProfilerClass::WriteTrace, tid 1 is the main thread, workers follow, the first frame gets its own row
+	int runners = 1;
+	for (const TaskType& task : m_tasks)
+	{
+		if (task.runner + 1 > runners)
+			runners = task.runner + 1;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Main thread\"}}");
+	for (int i = 1; i < runners; ++i)
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Startup worker %d\"}}", i + 1, i);
+
+	for (const TaskType& task : m_tasks)
+	{
+		// Never started because something it depended on failed
+		if (task.end == 0)
+			continue;
+
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"failed\":%s}}",
+			task.name, task.runner + 1, TicksToMs(task.start - m_startTicks) * 1000.0, TicksToMs(task.end - task.start) * 1000.0,
+			task.failed ? "true" : "false");
+	}
+
+	const long long firstFrame = m_firstFrameTicks;
+	if (firstFrame && m_finishTicks)
+	{
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Render thread\"}}", runners + 1);
+		fprintf(file, ",\n{\"name\":\"First frame\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{}}",
+			runners + 1, TicksToMs(m_finishTicks - m_startTicks) * 1000.0, TicksToMs(firstFrame - m_finishTicks) * 1000.0);
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+double StartupGraphClass::TicksToMs(long long ticks)
+{
+	return (double)ticks * 1000.0 / (double)m_frequency;
+}
+
+long long StartupGraphClass::Now()
+{
+	LARGE_INTEGER time;
+	QueryPerformanceCounter(&time);
+	return time.QuadPart;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Startup task graph. Each task is a function returning false on failure plus the tasks it waits for,
+	Run() starts every task as soon as its dependencies are done. Tasks that have to run on the thread that owns the window
+	(window creation, the swap chain) are marked STARTUP_MAIN_THREAD and run on the thread that called Run(),
+	the rest go to a few short lived worker threads. The job system can't do this, spinning it up is one of the tasks.
+	Every task's start and end is recorded for a chrome://tracing timeline, one row per thread,
+	along with time to first frame (Initialize() to the end of the first Present).
+*/
+
+const char* const STARTUP_TRACE_FILE = "startup_trace.json"; // open in chrome://tracing
+
+enum StartupThread
+{
+	STARTUP_ANY_THREAD,
+	STARTUP_MAIN_THREAD
+};
+
+class StartupGraphClass
+{
+public:
+	StartupGraphClass();
+	StartupGraphClass(const StartupGraphClass&);
+	~StartupGraphClass();
+
+	// Startup time is measured from here
+	bool Initialize();
+	void Shutdown();
+
+	// Name must be a string literal, dependencies are ids returned by earlier AddTask calls
+	int AddTask(const char*, StartupThread, const std::function<bool()>&, std::initializer_list<int>);
+	// Blocks until every task is done or one fails. 0 workers = one per hardware thread minus this one
+	bool Run(int);
+
+	// Any thread, only the first call counts
+	void MarkFirstFrame();
+
+	// Milliseconds since Initialize(), 0 if it hasn't happened yet
+	double GetStartupTime();
+	double GetTimeToFirstFrame();
+
+	bool WriteTrace(const char*);
+
+private:
+	struct TaskType
+	{
+		const char* name;
+		StartupThread thread;
+		std::function<bool()> function;
+		std::vector<int> dependents;
+		int waitingOn;
+		int runner; // 0 = main thread, workers are 1..n
+		long long start;
+		long long end;
+		bool failed;
+	};
+
+	void WorkerThread(int);
+	void Execute(int, int, std::unique_lock<std::mutex>&);
+	bool IsFinished();
+	double TicksToMs(long long);
+	long long Now();
+
+private:
+	std::vector<TaskType> m_tasks;
+	std::deque<int> m_ready;
+	std::deque<int> m_readyMain;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_changed;
+	int m_remaining;
+	int m_running;
+	bool m_failed;
+	bool m_quit;
+	long long m_frequency;
+	long long m_startTicks;
+	long long m_finishTicks;
+	std::atomic<long long> m_firstFrameTicks;
+};
@@ -1,10 +1,26 @@
 #include "systemclass.h"
  #include "inputclass.h"
  #include "graphicsclass.h"
+ #include "framequeueclass.h"
+ #include "jobsystemclass.h"
+ #include "sceneclass.h"
+ #include "benchmarkclass.h"
+ #include "startupgraphclass.h"
 
 SystemClass::SystemClass() : 
 	m_Input(nullptr),
-	m_Graphics(nullptr)
+	m_Graphics(nullptr),
+	m_FrameQueue(nullptr),
+	m_Jobs(nullptr),
+	m_Scene(nullptr),
+	m_Benchmark(nullptr),
+	m_Startup(nullptr),
+	m_renderFailed(false),
+	m_snapshotKeyDown(false),
+	m_timerFrequency(1),
+	m_startTime(0),
+	m_lastFrameTime(0),
+	m_frameIndex(0)
 {
 }
 
@@ -18,32 +34,182 @@ SystemClass::~SystemClass()
 	// Author of tut does't want to clean up here since 'certain windows func like ExitThread() are known for not calling your dtors
 }
 
-bool SystemClass::Initialize()
+bool SystemClass::Initialize(const BenchmarkSettingsType* benchmarkSettings, const std::string& snapshot)
 {
 	// Does all the setup for the app (window, input, graphics inits)
-	int screenWidth, screenHeight = 0;
+	int screenWidth = 0, screenHeight = 0;
+	const bool benchmark = benchmarkSettings != nullptr;
 
-	// init windows api
-	InitializeWindows(screenWidth, screenHeight);
-
-	m_Input = new InputClass();
-	if (m_Input == nullptr)
+	m_Startup = new StartupGraphClass();
+	if (m_Startup == nullptr)
 		return false;
 
-	m_Input->Initialize();
+	m_Startup->Initialize();
 
+	// Everything gets created up front, the startup tasks only initialize
+	m_Input = new InputClass();
+	m_Jobs = new JobSystemClass();
 	m_Graphics = new GraphicsClass();
-	if (m_Graphics == nullptr)
+	m_Scene = new SceneClass();
+	m_FrameQueue = new FrameQueueClass();
+	if (m_Input == nullptr || m_Jobs == nullptr || m_Graphics == nullptr || m_Scene == nullptr || m_FrameQueue == nullptr)
 		return false;
 
-	if (m_Graphics->Initialize(screenWidth, screenHeight, m_hwnd) == false)
+	/*
+		Startup as a task graph instead of one long chain. The window and the swap chain have to be made on this thread
+		(it's the one pumping the window's messages), everything else runs on startup worker threads as soon as what it needs is done:
+		adapter enumeration and device creation overlap creating the window, the font and shader compiles overlap both,
+		and the job system spins up alongside all of it. Timeline goes to STARTUP_TRACE_FILE.
+	*/
+	const int window = m_Startup->AddTask("Window", STARTUP_MAIN_THREAD, [&]()
+	{
+		// init windows api, benchmarks still render and present but into a hidden window
+		InitializeWindows(screenWidth, screenHeight, benchmark == false);
+		m_Input->Initialize();
+		return true;
+	}, {});
+
+	// Worker threads for the scene systems, one per core minus this one
+	const int jobs = m_Startup->AddTask("Job system", STARTUP_ANY_THREAD, [this]() { return m_Jobs->Initialize(0); }, {});
+	const int device = m_Startup->AddTask("Device", STARTUP_ANY_THREAD, [this]() { return m_Graphics->CreateDevice(); }, {});
+	m_Startup->AddTask("Font", STARTUP_ANY_THREAD, [this]() { return m_Graphics->LoadFont(); }, {});
+	/*
+		Benchmarks draw a sphere made here instead of whatever mesh files are lying around, it has to exist before the meshes load.
+		shader_reload edits shaders, it gets copies to edit so the ones in the asset directory stay as they are.
+	*/
+	const int benchmarkMesh = m_Startup->AddTask("Benchmark files", STARTUP_ANY_THREAD, [&]()
+	{
+		if (benchmark == false)
+			return true;
+
+		if (BenchmarkClass::WriteMesh(BENCHMARK_MESH_FILE) == false)
+			return false;
+
+		m_Graphics->SetMeshFiles({ BENCHMARK_MESH_FILE });
+
+		if (benchmarkSettings->scenario == SCENARIO_SHADER_RELOAD)
+		{
+			if (BenchmarkClass::WriteShaders(BENCHMARK_SHADER_DIRECTORY) == false)
+				return false;
+
+			m_Graphics->SetShaderDirectory(BENCHMARK_SHADER_DIRECTORY);
+		}
+
+		return true;
+	}, {});
+
+	// No owner window for its error boxes, the window's thread is busy waiting here and owning one would deadlock
+	const int resources = m_Startup->AddTask("Shaders and buffers", STARTUP_ANY_THREAD, [this]() { return m_Graphics->CreateResources(nullptr); },
+		{ device, benchmarkMesh });
+
+	// No vsync while benchmarking or every scenario measures the refresh rate
+	const int swapChain = m_Startup->AddTask("Swap chain", STARTUP_MAIN_THREAD, [&]()
+	{
+		return m_Graphics->CreateSwapChain(screenWidth, screenHeight, m_hwnd, VSYNC_ENABLED && benchmark == false);
+	}, { device, window });
+
+	const int scene = m_Startup->AddTask("Scene", STARTUP_ANY_THREAD, [&]()
+	{
+		// Scene needs the projection for culling, the render thread doesn't touch it after this
+		XMMATRIX projectionMatrix;
+		m_Graphics->GetProjectionMatrix(projectionMatrix);
+
+		if (m_Scene->Initialize(m_Jobs, projectionMatrix, screenHeight) == false)
+			return false;
+
+		// Benchmarks fill the scene with their own scenario
+		if (benchmark)
+		{
+			m_Benchmark = new BenchmarkClass();
+			if (m_Benchmark == nullptr)
+				return false;
+
+			return m_Benchmark->Initialize(*benchmarkSettings, m_Scene, m_Jobs);
+		}
+
+		// A saved world maps straight in, nothing to build
+		if (snapshot.empty() == false)
+		{
+			if (m_Scene->LoadSnapshot(snapshot.c_str()) == false)
+			{
+				MessageBox(nullptr, "Could not load the scene snapshot", "Error", MB_OK);
+				return false;
+			}
+
+			return true;
+		}
+
+		m_Scene->CreateDemoObjects();
+		return true;
+	}, { jobs, swapChain });
+
+	// LODs are picked from the chains of the mesh files that get drawn, a snapshot's saved chains give way to them
+	m_Startup->AddTask("LOD chains", STARTUP_ANY_THREAD, [this]()
+	{
+		MeshLibraryClass* meshes = m_Graphics->GetMeshes();
+		if (meshes->GetMeshCount() == 0)
+			return true;
+
+		const unsigned int meshCount = (unsigned int)meshes->GetMeshCount();
+		for (unsigned int mesh = 0; mesh < (meshCount > SCENE_MESH_COUNT ? meshCount : SCENE_MESH_COUNT); ++mesh)
+		{
+			LodChainType chain;
+			meshes->GetLodChain(mesh, chain);
+			m_Scene->GetLods()->SetChain(mesh, chain);
+		}
+
+		return true;
+	}, { resources, scene });
+
+	// Packets the main thread hands to the render thread, RENDER_FRAME_LAG of them (graphicsclass.h)
+	m_Startup->AddTask("Frame queue", STARTUP_ANY_THREAD, [this]() { return m_FrameQueue->Initialize(RENDER_FRAME_LAG); }, {});
+
+	if (m_Startup->Run(0) == false)
+	{
+		m_Startup->WriteTrace(STARTUP_TRACE_FILE);
 		return false;
+	}
+
+	LARGE_INTEGER time;
+	QueryPerformanceFrequency(&time);
+	m_timerFrequency = time.QuadPart;
+	QueryPerformanceCounter(&time);
+	m_startTime = time.QuadPart;
+	m_lastFrameTime = time.QuadPart;
 
 	return true;
 }
 
 void SystemClass::Shutdown()
 {
+	// Run() already joined the render thread, this is just in case we never got that far
+	if (m_FrameQueue != nullptr)
+		m_FrameQueue->Close();
+
+	if (m_renderThread.joinable())
+		m_renderThread.join();
+
+	if (m_FrameQueue != nullptr)
+	{
+		m_FrameQueue->Shutdown();
+		delete m_FrameQueue;
+		m_FrameQueue = nullptr;
+	}
+
+	if (m_Benchmark != nullptr)
+	{
+		m_Benchmark->Shutdown();
+		delete m_Benchmark;
+		m_Benchmark = nullptr;
+	}
+
+	if (m_Scene != nullptr)
+	{
+		m_Scene->Shutdown();
+		delete m_Scene;
+		m_Scene = nullptr;
+	}
+
 	if (m_Graphics != nullptr)
 	{
 		m_Graphics->Shutdown();
@@ -51,12 +217,26 @@ void SystemClass::Shutdown()
 		m_Graphics = nullptr;
 	}
 
+	if (m_Jobs != nullptr)
+	{
+		m_Jobs->Shutdown();
+		delete m_Jobs;
+		m_Jobs = nullptr;
+	}
+
 	if (m_Input != nullptr)
 	{
 		delete m_Input;
 		m_Input = nullptr;
 	}
 
+	if (m_Startup != nullptr)
+	{
+		m_Startup->Shutdown();
+		delete m_Startup;
+		m_Startup = nullptr;
+	}
+
 	ShutdownWindows();
 }
 
@@ -67,21 +247,56 @@ void SystemClass::Run()
 	// Init message struct to 0
 	ZeroMemory(&msg, sizeof(MSG));
 
+	/*
+		Rendering and Present happen on their own thread. This thread only pumps messages and produces frame packets,
+		so dragging the window or a modal loop inside DispatchMessage doesn't freeze rendering
+		and a slow Present doesn't hold up input.
+	*/
+	m_renderFailed = false;
+	m_renderThread = std::thread(&SystemClass::RenderThread, this);
+
 	while (true)
 	{
-		// Handle windows mssages
-		if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		// Handle every pending windows message before producing the next frame
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+
+			if (msg.message == WM_QUIT)
+				break;
 		}
 
 		if (msg.message == WM_QUIT)
 			break;
 
+		if (m_renderFailed)
+			break;
+
 		if (Frame() == false)
 			break;
 	}
+
+	// Let the render thread finish whatever is already queued and exit
+	m_FrameQueue->Close();
+	if (m_renderThread.joinable())
+		m_renderThread.join();
+
+	// Startup timeline including the first frame, the render thread marked it
+	m_Startup->WriteTrace(STARTUP_TRACE_FILE);
+
+	char text[128];
+	sprintf_s(text, sizeof(text), "Startup %.1f ms, first frame %.1f ms\n", m_Startup->GetStartupTime(), m_Startup->GetTimeToFirstFrame());
+	OutputDebugString(text);
+
+	// Every render time is in now that the render thread is gone
+	if (m_Benchmark != nullptr)
+	{
+		m_Benchmark->SetStartupTimes(m_Startup->GetStartupTime(), m_Startup->GetTimeToFirstFrame());
+		m_Benchmark->FinishRun();
+		if (m_Benchmark->WriteResults() == false)
+			MessageBox(m_hwnd, "Could not write the benchmark results", "Error", MB_OK);
+	}
 }
 
 bool SystemClass::Frame()
@@ -89,10 +304,98 @@ bool SystemClass::Frame()
 	if (m_Input->IsKeyDown(VK_ESCAPE))
 		return false;
 
-	if (m_Graphics->Frame() == false)
-		return false;
+	// Between frames is the one time the scene is guaranteed to be consistent, the render thread only has packets
+	const bool snapshotKey = m_Input->IsKeyDown(SCENE_SNAPSHOT_KEY);
+	if (snapshotKey && m_snapshotKeyDown == false && m_Benchmark == nullptr)
+	{
+		if (m_Scene->WriteSnapshot(SCENE_SNAPSHOT_FILE) == false)
+			OutputDebugString("Could not write the scene snapshot\n");
+	}
+	m_snapshotKeyDown = snapshotKey;
 
-	return true;
+	FramePacket* packet = m_FrameQueue->BeginWrite();
+	if (packet == nullptr)
+	{
+		/*
+			The render thread is RENDER_FRAME_LAG frames behind. Sleep until it frees a packet,
+			but also wake up for any window message so input stays responsive while the gpu is saturated.
+		*/
+		HANDLE spaceEvent = m_FrameQueue->GetSpaceEvent();
+		MsgWaitForMultipleObjects(1, &spaceEvent, FALSE, INFINITE, QS_ALLINPUT);
+		return true;
+	}
+
+	if (m_Benchmark != nullptr)
+		m_Benchmark->BeginFrame();
+
+	LARGE_INTEGER time;
+	QueryPerformanceCounter(&time);
+
+	// Benchmarks step by a fixed amount so every run simulates exactly the same thing
+	packet->frameIndex = m_frameIndex++;
+	packet->deltaTime = m_Benchmark ? BENCHMARK_TIME_STEP : (double)(time.QuadPart - m_lastFrameTime) / (double)m_timerFrequency;
+	packet->totalTime = (double)(time.QuadPart - m_startTime) / (double)m_timerFrequency;
+	packet->clearColor[0] = 0.5f;
+	packet->clearColor[1] = 0.5f;
+	packet->clearColor[2] = 0.5f;
+	packet->clearColor[3] = 1.0f;
+	packet->overlayStressQuads = 0;
+	m_lastFrameTime = time.QuadPart;
+
+	if (m_Benchmark != nullptr)
+		m_Benchmark->UpdateScenario(*packet);
+
+	// Simulate, then copy out what the render thread needs. Everything here runs while the render thread draws the previous packet
+	m_Scene->Update((float)packet->deltaTime);
+	m_Scene->BuildFramePacket(*packet);
+
+	if (m_Benchmark != nullptr)
+		m_Benchmark->EndFrame(*packet);
+
+	m_FrameQueue->EndWrite();
+
+	// Done once the last measured frame has been handed over, Run() then waits for the render thread to draw it
+	return m_Benchmark == nullptr || m_Benchmark->IsFinished() == false;
+}
+
+void SystemClass::RenderThread()
+{
+	// Owns the device context from here on, nothing on the main thread touches it while this runs
+	FramePacket* packet = nullptr;
+	while ((packet = m_FrameQueue->BeginRead()) != nullptr)
+	{
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter(&start);
+		const bool result = m_Graphics->Frame(*packet);
+		QueryPerformanceCounter(&end);
+
+		// Time to first frame ends once the first Present has returned
+		if (result)
+			m_Startup->MarkFirstFrame();
+
+		if (m_Benchmark != nullptr)
+		{
+			m_Benchmark->RecordRenderTime(packet->frameIndex, (double)(end.QuadPart - start.QuadPart) * 1000.0 / (double)m_timerFrequency);
+
+			// The gpu time is for an older frame, whichever one the profiler just read back. Its frame numbers count the same as ours
+			ProfilerClass* profiler = m_Graphics->GetProfiler();
+			if (profiler->GetLastFrameEvents().empty() == false)
+				m_Benchmark->RecordGpuTime(profiler->GetLastFrameEvents()[0].frame, profiler->GetGpuFrameTime());
+
+			ShaderCacheClass* shaders = m_Graphics->GetShaderCache();
+			m_Benchmark->RecordReloads(packet->frameIndex, shaders->GetReloadCount(), shaders->GetLastReloadLatency());
+		}
+
+		m_FrameQueue->EndRead();
+
+		if (result == false)
+		{
+			// Wake the main thread up in case it's waiting on messages so it sees the failure
+			m_renderFailed = true;
+			PostMessage(m_hwnd, WM_NULL, 0, 0);
+			break;
+		}
+	}
 }
 
 // Called inside our WndProc registered call back.
@@ -124,7 +427,7 @@ LRESULT CALLBACK SystemClass::MessageHandler(
 }
 
 // Init the window we render to, uses a global bool FULL_SCREEN (inside graphicsclass)
-void SystemClass::InitializeWindows(int& screenWidth, int& screenHeight)
+void SystemClass::InitializeWindows(int& screenWidth, int& screenHeight, bool visible)
 {
 	// There's prob an updated way of doing windows initialization for UWP
 	WNDCLASSEX wc;
@@ -197,7 +500,7 @@ void SystemClass::InitializeWindows(int& screenWidth, int& screenHeight)
 				posX, posY, screenWidth, screenHeight, nullptr, nullptr, m_hinstance, nullptr);
 
 	// Bring the window up on the screen and set it as main focus.
-	ShowWindow(m_hwnd, SW_SHOW);
+	ShowWindow(m_hwnd, visible ? SW_SHOW : SW_HIDE);
 	SetForegroundWindow(m_hwnd);
 	SetFocus(m_hwnd);
 
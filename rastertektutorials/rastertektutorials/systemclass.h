@@ -7,19 +7,33 @@
 
 //Winmain
 //	SystemClass
+//		StartupGraphClass (runs the inits below)
 //		InputClass
-//		GraphicsClass
+//		JobSystemClass
+//		SceneClass
+//		FrameQueueClass
+//		GraphicsClass (render thread)
+//		BenchmarkClass (only with -benchmark)
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <atlbase.h>
 #include <atlconv.h> // is this needed
+#include <thread>
+#include <atomic>
+#include <string>
 
 // Tutorial has includes when all you really need is forward declaration since the corresponding members are just pointers (we don't need to know the actual size of the data)
 // #include "inputclass.h"
 // #include "graphicsclass.h"
 class InputClass;
 class GraphicsClass;
+class FrameQueueClass;
+class JobSystemClass;
+class SceneClass;
+class BenchmarkClass;
+class StartupGraphClass;
+struct BenchmarkSettingsType;
 
 class SystemClass
 {
@@ -28,14 +42,16 @@ public:
 	SystemClass(const SystemClass&);
 	~SystemClass();
 
-	bool Initialize();
+	// Benchmark settings for a -benchmark run or nullptr for the demo, and the snapshot the demo starts from (empty for the demo objects)
+	bool Initialize(const BenchmarkSettingsType*, const std::string&);
 	void Shutdown();
 	void Run();
 
 	LRESULT CALLBACK MessageHandler(HWND, UINT, WPARAM, LPARAM);
 private:
 	bool Frame();
-	void InitializeWindows(int&, int&);
+	void RenderThread();
+	void InitializeWindows(int&, int&, bool);
 	void ShutdownWindows();
 private:
 	//LPCWSTR m_applicationName;
@@ -45,6 +61,19 @@ private:
 
 	InputClass* m_Input;
 	GraphicsClass* m_Graphics;
+	FrameQueueClass* m_FrameQueue;
+	JobSystemClass* m_Jobs;
+	SceneClass* m_Scene;
+	BenchmarkClass* m_Benchmark;
+	StartupGraphClass* m_Startup;
+
+	std::thread m_renderThread;
+	std::atomic<bool> m_renderFailed;
+	bool m_snapshotKeyDown; // SCENE_SNAPSHOT_KEY saves once per press
+	long long m_timerFrequency;
+	long long m_startTime;
+	long long m_lastFrameTime;
+	unsigned long long m_frameIndex;
 };
 
 // re-direct the windows system messaging into our MessageHandler fuction inside the system class.
@@ -0,0 +1,353 @@
+#include "texturebuilderclass.h"
+
+#include <windows.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* const FORMAT_NAMES[TEXTURE_FORMAT_COUNT] = { "bc1", "bc3", "bc5", "bc7" };
+
+static bool WritePadding(FILE* file, long alignedPosition)
+{
+	static const char zeros[TEXTURE_FILE_ALIGNMENT] = {};
+
+	long position = ftell(file);
+	return position <= alignedPosition && fwrite(zeros, 1, alignedPosition - position, file) == (size_t)(alignedPosition - position);
+}
+
+static unsigned int AlignOffset(unsigned int offset)
+{
+	return (offset + TEXTURE_FILE_ALIGNMENT - 1) & ~(TEXTURE_FILE_ALIGNMENT - 1);
+}
+
+static float SrgbToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+TextureBuilderClass::TextureBuilderClass() :
+	m_format(TEXTURE_BC7),
+	m_srgb(true)
+{
+}
+
+TextureBuilderClass::TextureBuilderClass(const TextureBuilderClass&)
+{
+}
+
+TextureBuilderClass::~TextureBuilderClass()
+{
+}
+
+int TextureBuilderClass::Build(const std::string& source, const std::string& output, TextureFormatType format, const std::string& reportName)
+{
+	TextureBuilderClass builder;
+	if (builder.LoadTarga(source.c_str()) == false)
+		return 2;
+
+	// Two channel data isn't color
+	builder.GenerateMips(format != TEXTURE_BC5);
+
+	JobSystemClass* jobs = new JobSystemClass();
+	if (jobs == nullptr || jobs->Initialize(0) == false)
+		return 2;
+
+	const double encodeMs = builder.Encode(format, jobs);
+	const int threads = jobs->GetThreadCount();
+	jobs->Shutdown();
+	delete jobs;
+
+	if (builder.Write(output.c_str()) == false)
+		return 2;
+
+	FILE* report = nullptr;
+	if (fopen_s(&report, reportName.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	unsigned long long texels = 0, bytes = 0;
+	for (int mip = 0; mip < builder.GetMipCount(); ++mip)
+	{
+		texels += (unsigned long long)builder.GetMipWidth(mip) * builder.GetMipHeight(mip);
+		bytes += builder.GetMipBytes(mip);
+	}
+
+	fprintf(report, "texture %s -> %s\n", source.c_str(), output.c_str());
+	fprintf(report, "%s, %dx%d, %d mips, %s\n", GetFormatName(format), builder.GetMipWidth(0), builder.GetMipHeight(0), builder.GetMipCount(),
+		format != TEXTURE_BC5 ? "srgb" : "linear");
+	fprintf(report, "encoded in %.1f ms on %d threads, %.1f Mtexels/s\n", encodeMs, threads, encodeMs > 0.0 ? texels / (encodeMs * 1000.0) : 0.0);
+	fprintf(report, "%llu bytes, %.1f%% of rgba8\n\n", bytes, texels > 0 ? bytes * 100.0 / (texels * 4.0) : 0.0);
+
+	fprintf(report, "%-6s %12s %12s %10s\n", "mip", "size", "bytes", "psnr dB");
+	for (int mip = 0; mip < builder.GetMipCount(); ++mip)
+	{
+		char size[32];
+		sprintf_s(size, sizeof(size), "%dx%d", builder.GetMipWidth(mip), builder.GetMipHeight(mip));
+		fprintf(report, "%-6d %12s %12u %10.2f\n", mip, size, builder.GetMipBytes(mip), builder.MeasurePsnr(mip));
+	}
+
+	fclose(report);
+	return 0;
+}
+
+bool TextureBuilderClass::CreateHeader(TextureFormatType format, int width, int height, unsigned int flags, TextureFileHeaderType& header)
+{
+	// D3D11 only takes whole 4x4 blocks for the top mip, a side under 4 texels can't be one
+	if (width < 4 || height < 4 || (width & (width - 1)) != 0 || (height & (height - 1)) != 0)
+		return false;
+
+	unsigned int mipCount = 1;
+	while ((width >> (mipCount - 1)) > 1 || (height >> (mipCount - 1)) > 1)
+		++mipCount;
+
+	if (mipCount > TEXTURE_MAX_MIPS)
+		return false;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = TEXTURE_FILE_MAGIC;
+	header.version = TEXTURE_FILE_VERSION;
+	header.format = format;
+	header.flags = flags;
+	header.width = width;
+	header.height = height;
+	header.mipCount = mipCount;
+
+	// The tail is the top of the smallest resident chain so it has to be whole blocks as well. Past 16:1 the short side
+	// gets under 4 texels before the long one fits the tail size, the tail then starts at the last mip that's still 4 across
+	unsigned int lastBlockMip = 0;
+	while ((width >> (lastBlockMip + 1)) >= 4 && (height >> (lastBlockMip + 1)) >= 4)
+		++lastBlockMip;
+
+	// First mip that fits in the tail size
+	header.tailMip = lastBlockMip;
+	while (header.tailMip > 0 && (unsigned int)(width >> (header.tailMip - 1)) <= TEXTURE_TAIL_SIZE && (unsigned int)(height >> (header.tailMip - 1)) <= TEXTURE_TAIL_SIZE)
+		--header.tailMip;
+
+	// Coarsest first, the tail packed behind the header and every mip above it on its own pages
+	const unsigned int blockBytes = TextureBlockBytes(format);
+	unsigned int offset = sizeof(TextureFileHeaderType);
+	for (int mip = (int)mipCount - 1; mip >= 0; --mip)
+	{
+		TextureMipHeaderType& level = header.mips[mip];
+		level.width = (width >> mip) > 0 ? width >> mip : 1;
+		level.height = (height >> mip) > 0 ? height >> mip : 1;
+		level.rowPitch = (level.width + 3) / 4 * blockBytes;
+		level.size = level.rowPitch * ((level.height + 3) / 4);
+
+		if ((unsigned int)mip < header.tailMip)
+			offset = AlignOffset(offset);
+
+		level.offset = offset;
+		offset += level.size;
+	}
+
+	return true;
+}
+
+const char* TextureBuilderClass::GetFormatName(TextureFormatType format)
+{
+	return format >= 0 && format < TEXTURE_FORMAT_COUNT ? FORMAT_NAMES[format] : "?";
+}
+
+bool TextureBuilderClass::LoadTarga(const char* filename)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "rb") != 0 || file == nullptr)
+		return false;
+
+	std::vector<unsigned char> contents;
+	unsigned char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		contents.insert(contents.end(), buffer, buffer + read);
+	fclose(file);
+
+	// 18 byte header: id length, color map type, image type (2 = uncompressed true color), ..., width, height, bits, descriptor
+	if (contents.size() < 18 || contents[1] != 0 || contents[2] != 2)
+		return false;
+
+	const int width = contents[12] | (contents[13] << 8);
+	const int height = contents[14] | (contents[15] << 8);
+	const int bytesPerPixel = contents[16] / 8;
+	const bool topDown = (contents[17] & 0x20) != 0;
+	const size_t dataStart = 18 + contents[0];
+	if ((bytesPerPixel != 3 && bytesPerPixel != 4) || width < 1 || height < 1 || dataStart + (size_t)width * height * bytesPerPixel > contents.size())
+		return false;
+
+	// BGR(A), bottom row first unless the descriptor says otherwise
+	std::vector<unsigned char> pixels((size_t)width * height * 4);
+	for (int y = 0; y < height; ++y)
+	{
+		const unsigned char* source = &contents[dataStart + (size_t)(topDown ? y : height - 1 - y) * width * bytesPerPixel];
+		unsigned char* destination = &pixels[(size_t)y * width * 4];
+		for (int x = 0; x < width; ++x)
+		{
+			destination[x * 4 + 0] = source[x * bytesPerPixel + 2];
+			destination[x * 4 + 1] = source[x * bytesPerPixel + 1];
+			destination[x * 4 + 2] = source[x * bytesPerPixel + 0];
+			destination[x * 4 + 3] = bytesPerPixel == 4 ? source[x * bytesPerPixel + 3] : 255;
+		}
+	}
+
+	return LoadPixels(&pixels[0], width, height);
+}
+
+bool TextureBuilderClass::LoadPixels(const unsigned char* pixels, int width, int height)
+{
+	TextureFileHeaderType header;
+	if (pixels == nullptr || CreateHeader(TEXTURE_BC1, width, height, 0, header) == false)
+		return false;
+
+	m_mips.clear();
+	m_mips.resize(1);
+	m_mips[0].pixels.assign(pixels, pixels + (size_t)width * height * 4);
+	m_mips[0].width = width;
+	m_mips[0].height = height;
+	return true;
+}
+
+void TextureBuilderClass::GenerateMips(bool srgb)
+{
+	if (m_mips.empty())
+		return;
+
+	m_srgb = srgb;
+	m_mips.resize(1);
+
+	float toLinear[256];
+	for (int i = 0; i < 256; ++i)
+		toLinear[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+
+	while (m_mips.back().width > 1 || m_mips.back().height > 1)
+	{
+		// Copies, resizing m_mips moves the one being read from
+		const int sourceWidth = m_mips.back().width;
+		const int sourceHeight = m_mips.back().height;
+		MipImageType next;
+		next.width = sourceWidth > 1 ? sourceWidth / 2 : 1;
+		next.height = sourceHeight > 1 ? sourceHeight / 2 : 1;
+		next.pixels.resize((size_t)next.width * next.height * 4);
+
+		const unsigned char* source = &m_mips.back().pixels[0];
+		for (int y = 0; y < next.height; ++y)
+		{
+			const int y0 = y * 2;
+			const int y1 = y * 2 + 1 < sourceHeight ? y * 2 + 1 : y0;
+			for (int x = 0; x < next.width; ++x)
+			{
+				const int x0 = x * 2;
+				const int x1 = x * 2 + 1 < sourceWidth ? x * 2 + 1 : x0;
+				const unsigned char* texels[4] =
+				{
+					source + ((size_t)y0 * sourceWidth + x0) * 4, source + ((size_t)y0 * sourceWidth + x1) * 4,
+					source + ((size_t)y1 * sourceWidth + x0) * 4, source + ((size_t)y1 * sourceWidth + x1) * 4
+				};
+
+				unsigned char* destination = &next.pixels[((size_t)y * next.width + x) * 4];
+				for (int c = 0; c < 4; ++c)
+				{
+					// Alpha is coverage, never gamma encoded
+					float sum = 0.0f;
+					for (int t = 0; t < 4; ++t)
+						sum += c < 3 ? toLinear[texels[t][c]] : texels[t][c] / 255.0f;
+
+					const float value = c < 3 && srgb ? LinearToSrgb(sum * 0.25f) : sum * 0.25f;
+					destination[c] = (unsigned char)(value * 255.0f + 0.5f);
+				}
+			}
+		}
+
+		m_mips.push_back(next);
+	}
+}
+
+double TextureBuilderClass::Encode(TextureFormatType format, JobSystemClass* jobs)
+{
+	m_format = format;
+
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	for (MipImageType& mip : m_mips)
+	{
+		mip.blocks.resize((size_t)((mip.width + 3) / 4) * ((mip.height + 3) / 4) * TextureBlockBytes(format));
+		EncodeImage(format, &mip.pixels[0], mip.width, mip.height, mip.width * 4, &mip.blocks[0], jobs);
+	}
+
+	QueryPerformanceCounter(&end);
+	return (double)(end.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+bool TextureBuilderClass::Write(const char* filename)
+{
+	TextureFileHeaderType header;
+	if (m_mips.empty() || m_mips[0].blocks.empty() || CreateHeader(m_format, m_mips[0].width, m_mips[0].height, m_srgb ? TEXTURE_FLAG_SRGB : 0, header) == false)
+		return false;
+
+	if (header.mipCount != m_mips.size())
+		return false;
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, filename, "wb") != 0 || file == nullptr)
+		return false;
+
+	bool result = fwrite(&header, sizeof(header), 1, file) == 1;
+	for (int mip = (int)header.mipCount - 1; mip >= 0 && result; --mip)
+	{
+		result = WritePadding(file, header.mips[mip].offset);
+		result = result && fwrite(&m_mips[mip].blocks[0], 1, header.mips[mip].size, file) == header.mips[mip].size;
+	}
+
+	fclose(file);
+	return result;
+}
+
+double TextureBuilderClass::MeasurePsnr(int mip)
+{
+	const MipImageType& image = m_mips[mip];
+	if (image.blocks.empty())
+		return 0.0;
+
+	std::vector<unsigned char> decoded(image.pixels.size());
+	DecodeImage(m_format, &image.blocks[0], image.width, image.height, &decoded[0], image.width * 4);
+
+	// BC1 keeps color, BC5 red and green, the others everything
+	const int channels = m_format == TEXTURE_BC1 ? 3 : (m_format == TEXTURE_BC5 ? 2 : 4);
+	double error = 0.0;
+	for (size_t i = 0; i < image.pixels.size(); i += 4)
+	{
+		for (int c = 0; c < channels; ++c)
+		{
+			const double difference = (double)image.pixels[i + c] - (double)decoded[i + c];
+			error += difference * difference;
+		}
+	}
+
+	const double meanSquared = error / ((double)image.width * image.height * channels);
+	return meanSquared > 0.0 ? 10.0 * log10(255.0 * 255.0 / meanSquared) : 99.0;
+}
+
+int TextureBuilderClass::GetMipCount()
+{
+	return (int)m_mips.size();
+}
+
+int TextureBuilderClass::GetMipWidth(int mip)
+{
+	return m_mips[mip].width;
+}
+
+int TextureBuilderClass::GetMipHeight(int mip)
+{
+	return m_mips[mip].height;
+}
+
+unsigned int TextureBuilderClass::GetMipBytes(int mip)
+{
+	return (unsigned int)m_mips[mip].blocks.size();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "blockcompress.h"
+#include "jobsystemclass.h"
+#include "texturefile.h"
+
+/*
+	Offline texture build step, run with -buildtexture <image.tga> <output.tex> [-format bc1|bc3|bc5|bc7] [-out report.txt].
+	Reads an uncompressed targa with power of two sides, box filters the mip chain down to 1x1 (in linear space for
+	color formats, which are sampled as sRGB, BC5 is taken as linear data like a normal map), block compresses every mip
+	with the SSE2 encoders in blockcompress.h spread over the job system, and writes the texture file for
+	TextureStreamerClass. The report has the encoder throughput and each mip's PSNR against its uncompressed version.
+*/
+
+const char* const TEXTURE_DEFAULT_REPORT = "texture_build.txt";
+
+class TextureBuilderClass
+{
+private:
+	struct MipImageType
+	{
+		std::vector<unsigned char> pixels; // RGBA8, width * 4 per row
+		std::vector<unsigned char> blocks; // empty until Encode
+		int width;
+		int height;
+	};
+
+public:
+	TextureBuilderClass();
+	TextureBuilderClass(const TextureBuilderClass&);
+	~TextureBuilderClass();
+
+	// The whole -buildtexture step, returns the process exit code, 0 = fine, 2 = couldn't read or write something
+	static int Build(const std::string&, const std::string&, TextureFormatType, const std::string&);
+	// Header with the mip layout Write uses, for a format, width, height and flags. False unless both sides are powers of two
+	// and at least 4
+	static bool CreateHeader(TextureFormatType, int, int, unsigned int, TextureFileHeaderType&);
+	static const char* GetFormatName(TextureFormatType);
+
+	// Uncompressed 24 or 32 bit targa, like the tutorials load
+	bool LoadTarga(const char*);
+	// RGBA8 made in code, width and height, rows packed
+	bool LoadPixels(const unsigned char*, int, int);
+	// sRGB or not, mip 0 stays as loaded
+	void GenerateMips(bool);
+	// Every mip, returns how long it took in ms. The job system can be nullptr
+	double Encode(TextureFormatType, JobSystemClass*);
+	bool Write(const char*);
+
+	// Decodes the mip and compares it with what went in, over the channels the format keeps
+	double MeasurePsnr(int);
+	int GetMipCount();
+	int GetMipWidth(int);
+	int GetMipHeight(int);
+	unsigned int GetMipBytes(int);
+
+private:
+	std::vector<MipImageType> m_mips;
+	TextureFormatType m_format;
+	bool m_srgb;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+	Binary texture files, written by TextureBuilderClass (-buildtexture) and streamed by TextureStreamerClass.
+	A TextureFileHeaderType, then the block compressed mips, coarsest first. The mip tail (everything from
+	TEXTURE_TAIL_SIZE down) is packed together right after the header so it comes in with one read, every mip above it
+	starts on a TEXTURE_FILE_ALIGNMENT boundary so mapping it in only touches its own pages.
+	D3D11 wants the top mip of a block compressed texture in whole 4x4 blocks. Widths and heights are powers of two
+	and at least 4, and the tail never starts below the last mip with both sides still 4 or more, so every mip that
+	can be the top of a resident chain is a multiple of 4 both ways. Past 16:1 that makes the tail bigger than
+	TEXTURE_TAIL_SIZE along the long side.
+	Bump TEXTURE_FILE_VERSION whenever the header or the data layout changes, old files are rejected and need rebuilding.
+*/
+
+const unsigned int TEXTURE_FILE_MAGIC = 0x52545854; // "TXTR"
+const unsigned int TEXTURE_FILE_VERSION = 1;
+const unsigned int TEXTURE_FILE_ALIGNMENT = 4096; // page size
+const int TEXTURE_MAX_MIPS = 16; // 32768 texels across
+const unsigned int TEXTURE_TAIL_SIZE = 64; // mips this size and smaller are always resident
+
+enum TextureFormatType
+{
+	TEXTURE_BC1, // rgb, 4 bits per texel
+	TEXTURE_BC3, // rgba, 8 bits per texel
+	TEXTURE_BC5, // two channels (normal map xy), 8 bits per texel
+	TEXTURE_BC7, // rgba, 8 bits per texel, best quality
+	TEXTURE_FORMAT_COUNT
+};
+
+// TextureFileHeaderType flags
+const unsigned int TEXTURE_FLAG_SRGB = 1; // color data, sample through an sRGB view
+
+struct TextureMipHeaderType
+{
+	unsigned int offset; // bytes from the start of the file
+	unsigned int size;
+	unsigned int width;
+	unsigned int height;
+	unsigned int rowPitch; // bytes per row of blocks
+};
+
+struct TextureFileHeaderType
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int format; // TextureFormatType
+	unsigned int flags;
+	unsigned int width;
+	unsigned int height;
+	unsigned int mipCount;
+	unsigned int tailMip; // first mip of the always resident tail, both sides at least 4
+	TextureMipHeaderType mips[TEXTURE_MAX_MIPS]; // 0 is the full size one
+};
+
+// 4x4 texel blocks
+inline unsigned int TextureBlockBytes(unsigned int format)
+{
+	return format == TEXTURE_BC1 ? 8 : 16;
+}
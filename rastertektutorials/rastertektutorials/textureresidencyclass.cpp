@@ -0,0 +1,234 @@
+#include "textureresidencyclass.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+static unsigned long long ChainBytes(const unsigned long long* mipBytes, unsigned int first, unsigned int mipCount)
+{
+	unsigned long long bytes = 0;
+	for (unsigned int mip = first; mip < mipCount; ++mip)
+		bytes += mipBytes[mip];
+
+	return bytes;
+}
+
+TextureResidencyClass::TextureResidencyClass() :
+	m_nextVictim(0),
+	m_budget(0),
+	m_residentBytes(0),
+	m_frame(1)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+TextureResidencyClass::TextureResidencyClass(const TextureResidencyClass&)
+{
+}
+
+TextureResidencyClass::~TextureResidencyClass()
+{
+}
+
+bool TextureResidencyClass::Initialize(unsigned long long budget)
+{
+	m_budget = budget;
+	m_residentBytes = 0;
+	m_frame = 1;
+	memset(&m_stats, 0, sizeof(m_stats));
+	return true;
+}
+
+void TextureResidencyClass::Shutdown()
+{
+	m_textures.clear();
+	m_loadOrder.clear();
+	m_evictOrder.clear();
+	m_residentBytes = 0;
+}
+
+int TextureResidencyClass::AddTexture(const TextureFileHeaderType& header)
+{
+	TextureType texture;
+	texture.width = header.width > header.height ? header.width : header.height;
+	texture.mipCount = header.mipCount;
+	texture.tailMip = header.tailMip;
+	for (unsigned int mip = 0; mip < TEXTURE_MAX_MIPS; ++mip)
+		texture.mipBytes[mip] = mip < header.mipCount ? header.mips[mip].size : 0;
+	texture.residentMip = texture.tailMip;
+	texture.wantedMip = texture.tailMip;
+	texture.lastUsed = 0;
+	texture.changed = false;
+
+	m_residentBytes += ChainBytes(texture.mipBytes, texture.tailMip, texture.mipCount);
+	m_stats.residentBytes = m_residentBytes;
+	m_textures.push_back(texture);
+	return (int)m_textures.size() - 1;
+}
+
+void TextureResidencyClass::SetBudget(unsigned long long budget)
+{
+	m_budget = budget;
+}
+
+void TextureResidencyClass::Request(int index, float pixels)
+{
+	if (index < 0 || index >= (int)m_textures.size())
+		return;
+
+	// Finest mip that still has at least a texel per pixel
+	TextureType& texture = m_textures[index];
+	unsigned int mip = texture.tailMip;
+	if (pixels >= (float)texture.width)
+		mip = 0;
+	else if (pixels > 0.0f)
+	{
+		const unsigned int fit = (unsigned int)floorf(log2f((float)texture.width / pixels));
+		mip = fit < texture.tailMip ? fit : texture.tailMip;
+	}
+
+	if (texture.lastUsed != m_frame)
+	{
+		texture.lastUsed = m_frame;
+		texture.wantedMip = mip;
+	}
+	else if (mip < texture.wantedMip)
+		texture.wantedMip = mip;
+}
+
+void TextureResidencyClass::Update(std::vector<ResidencyChangeType>& changes)
+{
+	changes.clear();
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	// Textures that want more, and textures holding more than anyone asked for this frame which is where room comes from
+	m_loadOrder.clear();
+	m_evictOrder.clear();
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		const TextureType& texture = m_textures[i];
+		const bool requested = texture.lastUsed == m_frame;
+		const unsigned int wanted = requested ? texture.wantedMip : texture.tailMip;
+
+		if (requested)
+		{
+			++m_stats.texturesRequested;
+			m_stats.wantedBytes += ChainBytes(texture.mipBytes, wanted, texture.mipCount);
+		}
+
+		if (wanted < texture.residentMip)
+			m_loadOrder.push_back((int)i);
+		else if (texture.residentMip < wanted)
+			m_evictOrder.push_back((int)i);
+	}
+
+	std::sort(m_loadOrder.begin(), m_loadOrder.end(), [this](int a, int b)
+	{
+		const unsigned int missingA = m_textures[a].residentMip - m_textures[a].wantedMip;
+		const unsigned int missingB = m_textures[b].residentMip - m_textures[b].wantedMip;
+		return missingA != missingB ? missingA > missingB : a < b;
+	});
+
+	std::sort(m_evictOrder.begin(), m_evictOrder.end(), [this](int a, int b)
+	{
+		return m_textures[a].lastUsed != m_textures[b].lastUsed ? m_textures[a].lastUsed < m_textures[b].lastUsed : a < b;
+	});
+
+	// The budget may have gone down since last frame
+	m_nextVictim = 0;
+	bool stopped = MakeRoom(0) == false;
+
+	// One mip per texture per round, so when the budget or the upload cap cuts things off everyone got something
+	bool progress = true;
+	while (progress && stopped == false)
+	{
+		progress = false;
+		for (int index : m_loadOrder)
+		{
+			TextureType& texture = m_textures[index];
+			if (texture.residentMip <= texture.wantedMip)
+				continue;
+
+			// A mip bigger than the cap on its own still has to come in some time
+			const unsigned long long bytes = texture.mipBytes[texture.residentMip - 1];
+			if ((m_stats.uploadedBytes > 0 && m_stats.uploadedBytes + bytes > TEXTURE_UPLOAD_BYTES_PER_FRAME) || MakeRoom(bytes) == false)
+			{
+				stopped = true;
+				break;
+			}
+
+			--texture.residentMip;
+			texture.changed = true;
+			m_residentBytes += bytes;
+			m_stats.uploadedBytes += bytes;
+			++m_stats.mipsLoaded;
+			progress = true;
+		}
+	}
+
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		TextureType& texture = m_textures[i];
+		if (texture.lastUsed == m_frame && texture.residentMip > texture.wantedMip)
+			++m_stats.texturesWaiting;
+
+		if (texture.changed)
+		{
+			ResidencyChangeType change;
+			change.texture = (int)i;
+			change.residentMip = texture.residentMip;
+			changes.push_back(change);
+			texture.changed = false;
+		}
+	}
+
+	m_stats.residentBytes = m_residentBytes;
+	++m_frame;
+}
+
+bool TextureResidencyClass::MakeRoom(unsigned long long bytes)
+{
+	// Least recently used first, and each one down to what it's still wanted for before moving on to the next
+	while (m_residentBytes + bytes > m_budget)
+	{
+		if (m_nextVictim >= m_evictOrder.size())
+			return false;
+
+		TextureType& victim = m_textures[m_evictOrder[m_nextVictim]];
+		const unsigned int keep = victim.lastUsed == m_frame ? victim.wantedMip : victim.tailMip;
+		if (victim.residentMip >= keep)
+		{
+			++m_nextVictim;
+			continue;
+		}
+
+		m_residentBytes -= victim.mipBytes[victim.residentMip];
+		++victim.residentMip;
+		victim.changed = true;
+		++m_stats.mipsEvicted;
+	}
+
+	return true;
+}
+
+unsigned int TextureResidencyClass::GetResidentMip(int index)
+{
+	return m_textures[index].residentMip;
+}
+
+unsigned int TextureResidencyClass::GetWantedMip(int index)
+{
+	// Update has moved on to the next frame by the time anyone asks
+	const TextureType& texture = m_textures[index];
+	return texture.lastUsed + 1 == m_frame ? texture.wantedMip : texture.tailMip;
+}
+
+unsigned long long TextureResidencyClass::GetBudget()
+{
+	return m_budget;
+}
+
+const ResidencyStatsType& TextureResidencyClass::GetStats()
+{
+	return m_stats;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include "texturefile.h"
+
+/*
+	Decides which mips of the streamed textures are resident, without touching any d3d so it can be run headless
+	(TextureTestClass drives it along a camera path). TextureStreamerClass owns one and does what it says.
+	Every frame each texture that's drawn is requested with how many pixels across it covers, which gives the finest
+	mip worth having. Update then loads the textures that want more, one mip at a time round robin with the worst
+	off first, and makes room by dropping mips nothing asked for this frame from the least recently used textures.
+	When that runs out the loads stop, so resident memory never goes over the budget (unless the always resident mip
+	tails alone don't fit). Loads are also capped per frame so a camera cut turns into a few frames of catching up
+	instead of one long hitch.
+*/
+
+const unsigned long long TEXTURE_UPLOAD_BYTES_PER_FRAME = 16ull << 20;
+
+struct ResidencyChangeType
+{
+	int texture;
+	unsigned int residentMip; // new finest resident mip
+};
+
+struct ResidencyStatsType
+{
+	unsigned long long residentBytes;
+	unsigned long long wantedBytes; // if everything requested this frame had what it asked for
+	unsigned long long uploadedBytes; // this frame
+	unsigned int mipsLoaded; // this frame
+	unsigned int mipsEvicted;
+	unsigned int texturesRequested;
+	unsigned int texturesWaiting; // requested and still coarser than they asked for after the update
+};
+
+class TextureResidencyClass
+{
+private:
+	struct TextureType
+	{
+		unsigned int width;
+		unsigned int mipCount;
+		unsigned int tailMip;
+		unsigned long long mipBytes[TEXTURE_MAX_MIPS];
+		unsigned int residentMip; // finest mip in memory, everything coarser is too
+		unsigned int wantedMip; // finest mip asked for this frame, tailMip if nothing was
+		unsigned long long lastUsed; // frame it was last requested in
+		bool changed;
+	};
+
+public:
+	TextureResidencyClass();
+	TextureResidencyClass(const TextureResidencyClass&);
+	~TextureResidencyClass();
+
+	// Budget in bytes
+	bool Initialize(unsigned long long);
+	void Shutdown();
+
+	// Starts out with only the tail resident, returns the texture's id
+	int AddTexture(const TextureFileHeaderType&);
+	void SetBudget(unsigned long long);
+
+	// Texture and how many pixels across it covers on screen, any number of times a frame (the biggest counts)
+	void Request(int, float);
+	// Once a frame after the requests, fills in the textures whose resident mips changed
+	void Update(std::vector<ResidencyChangeType>&);
+
+	unsigned int GetResidentMip(int);
+	// What it asked for in the frame the last Update handled, its tail mip if it wasn't drawn
+	unsigned int GetWantedMip(int);
+	unsigned long long GetBudget();
+	// From the last Update
+	const ResidencyStatsType& GetStats();
+
+private:
+	bool MakeRoom(unsigned long long);
+
+private:
+	std::vector<TextureType> m_textures;
+	std::vector<int> m_loadOrder; // Update scratch
+	std::vector<int> m_evictOrder;
+	unsigned int m_nextVictim;
+	unsigned long long m_budget;
+	unsigned long long m_residentBytes;
+	unsigned long long m_frame;
+	ResidencyStatsType m_stats;
+};
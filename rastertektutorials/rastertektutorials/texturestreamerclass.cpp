@@ -0,0 +1,200 @@
+#include "texturestreamerclass.h"
+
+#include <string.h>
+
+static DXGI_FORMAT GetDxgiFormat(unsigned int format, bool srgb)
+{
+	switch (format)
+	{
+	case TEXTURE_BC1:
+		return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case TEXTURE_BC3:
+		return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	case TEXTURE_BC5:
+		return DXGI_FORMAT_BC5_UNORM;
+	default:
+		return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+	}
+}
+
+TextureStreamerClass::TextureStreamerClass() :
+	m_Residency(nullptr)
+{
+}
+
+TextureStreamerClass::TextureStreamerClass(const TextureStreamerClass&)
+{
+}
+
+TextureStreamerClass::~TextureStreamerClass()
+{
+}
+
+bool TextureStreamerClass::Initialize(int videoCardMemory)
+{
+	int budget = (int)(videoCardMemory * TEXTURE_BUDGET_FRACTION);
+	budget = budget > TEXTURE_MIN_BUDGET_MB ? budget : TEXTURE_MIN_BUDGET_MB;
+
+	m_Residency = new TextureResidencyClass();
+	if (m_Residency == nullptr)
+		return false;
+
+	return m_Residency->Initialize((unsigned long long)budget << 20);
+}
+
+void TextureStreamerClass::Shutdown()
+{
+	for (StreamedTextureType& texture : m_textures)
+	{
+		if (texture.view)
+			texture.view->Release();
+		if (texture.texture)
+			texture.texture->Release();
+
+		texture.File->Shutdown();
+		delete texture.File;
+	}
+	m_textures.clear();
+
+	if (m_Residency)
+	{
+		m_Residency->Shutdown();
+		delete m_Residency;
+		m_Residency = nullptr;
+	}
+}
+
+int TextureStreamerClass::Load(ID3D11Device* device, const char* filename)
+{
+	StreamedTextureType texture;
+	texture.File = new MappedFileClass();
+	texture.texture = nullptr;
+	texture.view = nullptr;
+	if (texture.File == nullptr)
+		return -1;
+
+	bool result = texture.File->Initialize(filename, false) && texture.File->GetSize() >= sizeof(TextureFileHeaderType);
+	if (result)
+	{
+		memcpy(&texture.header, texture.File->GetData(), sizeof(TextureFileHeaderType));
+
+		const TextureFileHeaderType& header = texture.header;
+		result = header.magic == TEXTURE_FILE_MAGIC && header.version == TEXTURE_FILE_VERSION && header.format < TEXTURE_FORMAT_COUNT &&
+			header.mipCount > 0 && header.mipCount <= (unsigned int)TEXTURE_MAX_MIPS && header.tailMip < header.mipCount;
+
+		// Truncated files would otherwise only show up as a crash the first time the missing mip is wanted
+		for (unsigned int mip = 0; mip < header.mipCount && result; ++mip)
+			result = (unsigned long long)header.mips[mip].offset + header.mips[mip].size <= texture.File->GetSize();
+	}
+
+	if (result)
+		result = Recreate(device, nullptr, texture, texture.header.tailMip);
+
+	if (result == false)
+	{
+		texture.File->Shutdown();
+		delete texture.File;
+		return -1;
+	}
+
+	m_Residency->AddTexture(texture.header);
+	m_textures.push_back(texture);
+	return (int)m_textures.size() - 1;
+}
+
+void TextureStreamerClass::Request(int index, float pixels)
+{
+	m_Residency->Request(index, pixels);
+}
+
+bool TextureStreamerClass::Update(ID3D11Device* device, ID3D11DeviceContext* deviceContext)
+{
+	m_Residency->Update(m_changes);
+
+	for (const ResidencyChangeType& change : m_changes)
+	{
+		if (Recreate(device, deviceContext, m_textures[change.texture], change.residentMip) == false)
+			return false;
+	}
+
+	return true;
+}
+
+bool TextureStreamerClass::Recreate(ID3D11Device* device, ID3D11DeviceContext* deviceContext, StreamedTextureType& texture, unsigned int topMip)
+{
+	const TextureFileHeaderType& header = texture.header;
+	const bool srgb = (header.flags & TEXTURE_FLAG_SRGB) != 0;
+
+	D3D11_TEXTURE2D_DESC textureDesc;
+	ZeroMemory(&textureDesc, sizeof(textureDesc));
+	textureDesc.Width = header.mips[topMip].width;
+	textureDesc.Height = header.mips[topMip].height;
+	textureDesc.MipLevels = header.mipCount - topMip;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = GetDxgiFormat(header.format, srgb);
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// The first one (just the tail) goes up with the texture, there's nothing to copy from yet
+	ID3D11Texture2D* newTexture = nullptr;
+	if (texture.texture == nullptr)
+	{
+		D3D11_SUBRESOURCE_DATA data[TEXTURE_MAX_MIPS];
+		for (unsigned int mip = topMip; mip < header.mipCount; ++mip)
+		{
+			data[mip - topMip].pSysMem = texture.File->GetData() + header.mips[mip].offset;
+			data[mip - topMip].SysMemPitch = header.mips[mip].rowPitch;
+			data[mip - topMip].SysMemSlicePitch = 0;
+		}
+
+		if (FAILED(device->CreateTexture2D(&textureDesc, data, &newTexture)))
+			return false;
+	}
+	else
+	{
+		if (FAILED(device->CreateTexture2D(&textureDesc, nullptr, &newTexture)))
+			return false;
+
+		// Mips the old texture already had are a gpu copy, only the new ones are read out of the mapping
+		for (unsigned int mip = topMip; mip < header.mipCount; ++mip)
+		{
+			if (mip >= texture.topMip)
+				deviceContext->CopySubresourceRegion(newTexture, mip - topMip, 0, 0, 0, texture.texture, mip - texture.topMip, nullptr);
+			else
+				deviceContext->UpdateSubresource(newTexture, mip - topMip, nullptr, texture.File->GetData() + header.mips[mip].offset, header.mips[mip].rowPitch, 0);
+		}
+	}
+
+	ID3D11ShaderResourceView* newView = nullptr;
+	if (FAILED(device->CreateShaderResourceView(newTexture, nullptr, &newView)))
+	{
+		newTexture->Release();
+		return false;
+	}
+
+	if (texture.view)
+		texture.view->Release();
+	if (texture.texture)
+		texture.texture->Release();
+
+	texture.texture = newTexture;
+	texture.view = newView;
+	texture.topMip = topMip;
+	return true;
+}
+
+ID3D11ShaderResourceView* TextureStreamerClass::GetView(int index)
+{
+	return m_textures[index].view;
+}
+
+int TextureStreamerClass::GetTextureCount()
+{
+	return (int)m_textures.size();
+}
+
+TextureResidencyClass* TextureStreamerClass::GetResidency()
+{
+	return m_Residency;
+}
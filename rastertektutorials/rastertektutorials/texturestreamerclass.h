@@ -0,0 +1,62 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+#include "mappedfileclass.h"
+#include "texturefile.h"
+#include "textureresidencyclass.h"
+
+/*
+	Block compressed textures streamed a mip at a time out of memory mapped texture files. Render thread only.
+	Each file stays mapped for as long as it's loaded, so a mip coming in is read straight out of the mapping
+	(the first touch pages it in) and nothing is held on the cpu side. TextureResidencyClass decides what's resident,
+	whenever a texture's resident chain changes it gets a new texture with exactly those mips, the ones it already had
+	are copied over on the gpu and only the new ones come from the file, then the view is swapped. Only the tail is
+	loaded up front.
+	The budget is a fraction of the adapter's dedicated memory (D3DClass's m_videoCardMemory), with a floor for
+	adapters that report little or none of their own.
+*/
+
+const float TEXTURE_BUDGET_FRACTION = 0.5f;
+const int TEXTURE_MIN_BUDGET_MB = 64;
+
+class TextureStreamerClass
+{
+private:
+	struct StreamedTextureType
+	{
+		MappedFileClass* File;
+		TextureFileHeaderType header;
+		ID3D11Texture2D* texture;
+		ID3D11ShaderResourceView* view;
+		unsigned int topMip; // finest mip the texture holds, its mip 0
+	};
+
+public:
+	TextureStreamerClass();
+	TextureStreamerClass(const TextureStreamerClass&);
+	~TextureStreamerClass();
+
+	// Dedicated video memory in MB
+	bool Initialize(int);
+	void Shutdown();
+
+	// Maps the file and uploads its tail, returns the texture's index or -1 if it isn't a texture file this build can read
+	int Load(ID3D11Device*, const char*);
+	// Texture and how many pixels across it covers on screen this frame
+	void Request(int, float);
+	// Once a frame after the requests, loads and evicts mips
+	bool Update(ID3D11Device*, ID3D11DeviceContext*);
+
+	ID3D11ShaderResourceView* GetView(int);
+	int GetTextureCount();
+	TextureResidencyClass* GetResidency();
+
+private:
+	bool Recreate(ID3D11Device*, ID3D11DeviceContext*, StreamedTextureType&, unsigned int);
+
+private:
+	std::vector<StreamedTextureType> m_textures;
+	TextureResidencyClass* m_Residency;
+	std::vector<ResidencyChangeType> m_changes;
+};
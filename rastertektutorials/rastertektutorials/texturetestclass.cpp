@@ -0,0 +1,343 @@
+#include "texturetestclass.h"
+
+#include <windows.h>
+#include <math.h>
+#include <string.h>
+#include "frustumclass.h"
+#include "jobsystemclass.h"
+#include "texturebuilderclass.h"
+#include "textureresidencyclass.h"
+
+static unsigned int NextRandom(unsigned int& state)
+{
+	// xorshift32, same sequence every run so runs can be compared
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static float RandomFloat(unsigned int& state, float low, float high)
+{
+	return low + (high - low) * (float)(NextRandom(state) & 0xFFFFFF) / (float)0xFFFFFF;
+}
+
+static double Milliseconds(const LARGE_INTEGER& start, const LARGE_INTEGER& end, const LARGE_INTEGER& frequency)
+{
+	return (double)(end.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+static void CameraAt(int frame, XMFLOAT3& position, XMFLOAT3& forward)
+{
+	// A circle inside the field, once round per half of the run, then it turns and flies back the other way
+	const float radius = TEXTURE_TEST_FIELD_SIZE * 0.3f;
+	const float direction = frame < TEXTURE_TEST_FRAMES / 2 ? 1.0f : -1.0f;
+	const float angle = XM_2PI * (float)frame / (float)(TEXTURE_TEST_FRAMES / 2) * direction;
+
+	position = XMFLOAT3(radius * cosf(angle), 6.0f, radius * sinf(angle));
+	forward = XMFLOAT3(-sinf(angle) * direction, -0.15f, cosf(angle) * direction);
+}
+
+TextureTestClass::TextureTestClass() :
+	m_pixelScale(0.0f),
+	m_random(0x2545F491)
+{
+}
+
+TextureTestClass::TextureTestClass(const TextureTestClass&)
+{
+}
+
+TextureTestClass::~TextureTestClass()
+{
+}
+
+int TextureTestClass::Run(const std::string& reportName)
+{
+	FILE* report = nullptr;
+	if (fopen_s(&report, reportName.c_str(), "w") != 0 || report == nullptr)
+		return 2;
+
+	TextureTestClass test;
+	bool passed = test.Initialize();
+	if (passed)
+	{
+		// Both run whatever happens so the report is complete
+		const bool encoders = test.TestEncoders(report);
+		fprintf(report, "\n");
+		const bool residency = test.TestResidency(report);
+		passed = encoders && residency;
+	}
+	test.Shutdown();
+
+	fprintf(report, "\n%s\n", passed ? "passed" : "FAILED");
+	fclose(report);
+	return passed ? 0 : 1;
+}
+
+bool TextureTestClass::Initialize()
+{
+	// Square textures from 512 to 4096, alternating between the 4 and 8 bit per texel formats
+	m_headers.resize(TEXTURE_TEST_TEXTURES);
+	for (int i = 0; i < TEXTURE_TEST_TEXTURES; ++i)
+	{
+		const int size = 512 << (NextRandom(m_random) % 4);
+		const TextureFormatType format = i % 2 == 0 ? TEXTURE_BC1 : TEXTURE_BC7;
+		if (TextureBuilderClass::CreateHeader(format, size, size, TEXTURE_FLAG_SRGB, m_headers[i]) == false)
+			return false;
+	}
+
+	// Spheres sitting on the ground all over the field
+	m_objects.resize(TEXTURE_TEST_OBJECTS);
+	for (ObjectType& object : m_objects)
+	{
+		object.radius = RandomFloat(m_random, 1.0f, 8.0f);
+		object.center = XMFLOAT3(RandomFloat(m_random, -0.5f, 0.5f) * TEXTURE_TEST_FIELD_SIZE, object.radius,
+			RandomFloat(m_random, -0.5f, 0.5f) * TEXTURE_TEST_FIELD_SIZE);
+		object.texture = (int)(NextRandom(m_random) % TEXTURE_TEST_TEXTURES);
+	}
+
+	const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)TEXTURE_TEST_SCREEN_WIDTH / (float)TEXTURE_TEST_SCREEN_HEIGHT, 0.1f, 1000.0f);
+	XMStoreFloat4x4(&m_projection, projection);
+
+	// Same as LodSelectorClass, pixels per world unit at distance 1
+	m_pixelScale = m_projection._22 * (float)TEXTURE_TEST_SCREEN_HEIGHT * 0.5f;
+	return true;
+}
+
+void TextureTestClass::Shutdown()
+{
+	m_headers.clear();
+	m_objects.clear();
+}
+
+bool TextureTestClass::TestEncoders(FILE* report)
+{
+	// Smooth gradients, a ring pattern, hard edged squares and a little noise, something of everything the encoders see
+	const int size = TEXTURE_TEST_IMAGE_SIZE;
+	std::vector<unsigned char> image((size_t)size * size * 4);
+	for (int y = 0; y < size; ++y)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			const float u = (float)x / (float)size;
+			const float v = (float)y / (float)size;
+			const float ring = 0.5f + 0.5f * sinf(sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)) * 60.0f);
+			const bool square = ((x / 64) + (y / 64)) % 5 == 0;
+			const float noise = (float)(NextRandom(m_random) % 9) - 4.0f;
+
+			unsigned char* texel = &image[((size_t)y * size + x) * 4];
+			const float red = square ? 230.0f : u * 255.0f;
+			const float green = square ? 40.0f : v * 200.0f + ring * 55.0f;
+			const float blue = ring * 180.0f + noise;
+			const float alpha = 255.0f * (1.0f - 0.8f * sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)));
+			texel[0] = (unsigned char)(red < 0.0f ? 0.0f : (red > 255.0f ? 255.0f : red));
+			texel[1] = (unsigned char)(green < 0.0f ? 0.0f : (green > 255.0f ? 255.0f : green));
+			texel[2] = (unsigned char)(blue < 0.0f ? 0.0f : (blue > 255.0f ? 255.0f : blue));
+			texel[3] = (unsigned char)(alpha < 0.0f ? 0.0f : alpha);
+		}
+	}
+
+	JobSystemClass* jobs = new JobSystemClass();
+	if (jobs == nullptr || jobs->Initialize(0) == false)
+		return false;
+
+	fprintf(report, "encoders, %dx%d, best of %d, %d threads\n", size, size, TEXTURE_TEST_PASSES, jobs->GetThreadCount());
+	fprintf(report, "%-8s %14s %14s %10s\n", "format", "1 thread Mp/s", "jobs Mp/s", "psnr dB");
+
+	bool passed = true;
+	for (int format = 0; format < TEXTURE_FORMAT_COUNT; ++format)
+	{
+		TextureBuilderClass builder;
+		if (builder.LoadPixels(&image[0], size, size) == false)
+		{
+			passed = false;
+			break;
+		}
+
+		double single = 0.0, parallel = 0.0;
+		for (int pass = 0; pass < TEXTURE_TEST_PASSES; ++pass)
+		{
+			const double singleMs = builder.Encode((TextureFormatType)format, nullptr);
+			const double parallelMs = builder.Encode((TextureFormatType)format, jobs);
+			single = pass == 0 || singleMs < single ? singleMs : single;
+			parallel = pass == 0 || parallelMs < parallel ? parallelMs : parallel;
+		}
+
+		const double megapixels = (double)size * size / 1000000.0;
+		const double psnr = builder.MeasurePsnr(0);
+		const bool good = psnr >= TEXTURE_TEST_MIN_PSNR;
+		passed = passed && good;
+
+		fprintf(report, "%-8s %14.1f %14.1f %10.2f%s\n", TextureBuilderClass::GetFormatName((TextureFormatType)format),
+			single > 0.0 ? megapixels * 1000.0 / single : 0.0, parallel > 0.0 ? megapixels * 1000.0 / parallel : 0.0, psnr, good ? "" : "  FAILED");
+	}
+
+	jobs->Shutdown();
+	delete jobs;
+	return passed;
+}
+
+bool TextureTestClass::TestResidency(FILE* report)
+{
+	SimulationResultType unlimited, tight, ample;
+	Simulate(~0ull, unlimited);
+
+	// Rounded to whole MB like a real budget would be
+	const unsigned long long peak = unlimited.peakWanted;
+	Simulate(((peak / 2) >> 20) << 20, tight);
+	Simulate(((peak + peak / 4 + (1 << 20) - 1) >> 20) << 20, ample);
+
+	fprintf(report, "residency, %d textures on %d objects, %d frames at %dx%d, upload cap %llu MB per frame\n", TEXTURE_TEST_TEXTURES, TEXTURE_TEST_OBJECTS,
+		TEXTURE_TEST_FRAMES, TEXTURE_TEST_SCREEN_WIDTH, TEXTURE_TEST_SCREEN_HEIGHT, TEXTURE_UPLOAD_BYTES_PER_FRAME >> 20);
+	fprintf(report, "%-10s %10s %10s %10s %10s %8s %10s %8s %8s %8s %10s\n", "run", "budget MB", "peak MB", "wanted MB", "satisfied", "missing",
+		"loads", "evicted", "thrash", "max wait", "update ms");
+	WriteResult(report, "unlimited", unlimited);
+	WriteResult(report, "tight", tight);
+	WriteResult(report, "ample", ample);
+
+	bool passed = true;
+	const SimulationResultType* results[3] = { &unlimited, &tight, &ample };
+	for (const SimulationResultType* result : results)
+	{
+		if (result->overBudget || result->consistent == false)
+			passed = false;
+	}
+
+	if (ample.maxWait > TEXTURE_TEST_MAX_WAIT)
+		passed = false;
+
+	fprintf(report, "%s\n", passed ? "residency passed" : "residency FAILED (over budget, inconsistent changes or a wait that was too long)");
+	return passed;
+}
+
+void TextureTestClass::Simulate(unsigned long long budget, SimulationResultType& result)
+{
+	memset(&result, 0, sizeof(result));
+	result.budget = budget;
+	result.consistent = true;
+
+	TextureResidencyClass residency;
+	residency.Initialize(budget);
+	for (const TextureFileHeaderType& header : m_headers)
+		residency.AddTexture(header);
+
+	// What the changes say is resident, checked against what the residency says every frame
+	std::vector<unsigned int> resident(m_headers.size());
+	std::vector<int> evictedAt(m_headers.size() * TEXTURE_MAX_MIPS, -TEXTURE_TEST_THRASH_FRAMES - 1);
+	std::vector<int> waiting(m_headers.size(), 0);
+	std::vector<bool> requested(m_headers.size());
+	for (size_t i = 0; i < m_headers.size(); ++i)
+		resident[i] = m_headers[i].tailMip;
+
+	const XMMATRIX projection = XMLoadFloat4x4(&m_projection);
+	FrustumClass frustum;
+	std::vector<ResidencyChangeType> changes;
+	unsigned long long requests = 0, satisfied = 0, missing = 0;
+
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency(&frequency);
+	double updateMs = 0.0;
+
+	for (int frame = 0; frame < TEXTURE_TEST_FRAMES; ++frame)
+	{
+		XMFLOAT3 position, forward;
+		CameraAt(frame, position, forward);
+		const XMVECTOR eye = XMLoadFloat3(&position);
+		frustum.ConstructFrustum(projection, XMMatrixLookToLH(eye, XMLoadFloat3(&forward), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+
+		// What SceneClass does for a draw item's screen size, the bounding sphere's diameter at its nearest point
+		for (size_t i = 0; i < requested.size(); ++i)
+			requested[i] = false;
+
+		for (const ObjectType& object : m_objects)
+		{
+			if (frustum.CheckSphere(object.center.x, object.center.y, object.center.z, object.radius) == false)
+				continue;
+
+			const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&object.center), eye))) - object.radius;
+			residency.Request(object.texture, 2.0f * object.radius * m_pixelScale / (distance > 0.1f ? distance : 0.1f));
+			requested[object.texture] = true;
+		}
+
+		QueryPerformanceCounter(&start);
+		residency.Update(changes);
+		QueryPerformanceCounter(&end);
+		updateMs += Milliseconds(start, end, frequency);
+
+		for (const ResidencyChangeType& change : changes)
+		{
+			const unsigned int before = resident[change.texture];
+			for (unsigned int mip = change.residentMip; mip < before; ++mip)
+			{
+				if (frame - evictedAt[change.texture * TEXTURE_MAX_MIPS + mip] <= TEXTURE_TEST_THRASH_FRAMES)
+					++result.thrash;
+			}
+			for (unsigned int mip = before; mip < change.residentMip; ++mip)
+				evictedAt[change.texture * TEXTURE_MAX_MIPS + mip] = frame;
+
+			resident[change.texture] = change.residentMip;
+		}
+
+		const ResidencyStatsType& stats = residency.GetStats();
+		result.loads += stats.mipsLoaded;
+		result.evictions += stats.mipsEvicted;
+		result.peakResident = stats.residentBytes > result.peakResident ? stats.residentBytes : result.peakResident;
+		result.peakWanted = stats.wantedBytes > result.peakWanted ? stats.wantedBytes : result.peakWanted;
+		if (stats.residentBytes > budget)
+			result.overBudget = true;
+
+		unsigned long long residentBytes = 0;
+		for (size_t i = 0; i < m_headers.size(); ++i)
+		{
+			const int texture = (int)i;
+			if (resident[i] != residency.GetResidentMip(texture))
+				result.consistent = false;
+
+			for (unsigned int mip = resident[i]; mip < m_headers[i].mipCount; ++mip)
+				residentBytes += m_headers[i].mips[mip].size;
+
+			if (requested[i] == false)
+			{
+				waiting[i] = 0;
+				continue;
+			}
+
+			const unsigned int wanted = residency.GetWantedMip(texture);
+			++requests;
+			if (resident[i] <= wanted)
+			{
+				++satisfied;
+				waiting[i] = 0;
+				continue;
+			}
+
+			missing += resident[i] - wanted;
+			++waiting[i];
+			if (frame >= TEXTURE_TEST_WARMUP && waiting[i] > result.maxWait)
+				result.maxWait = waiting[i];
+		}
+
+		if (residentBytes != stats.residentBytes)
+			result.consistent = false;
+	}
+
+	result.satisfied = requests > 0 ? (double)satisfied / (double)requests : 1.0;
+	result.missingMips = requests > 0 ? (double)missing / (double)requests : 0.0;
+	result.updateMs = updateMs / TEXTURE_TEST_FRAMES;
+	residency.Shutdown();
+}
+
+void TextureTestClass::WriteResult(FILE* report, const char* name, const SimulationResultType& result)
+{
+	char budget[32];
+	if (result.budget == ~0ull)
+		sprintf_s(budget, sizeof(budget), "-");
+	else
+		sprintf_s(budget, sizeof(budget), "%llu", result.budget >> 20);
+
+	fprintf(report, "%-10s %10s %10.1f %10.1f %9.1f%% %8.2f %10llu %8llu %8llu %8d %10.3f%s%s\n", name, budget,
+		result.peakResident / (1024.0 * 1024.0), result.peakWanted / (1024.0 * 1024.0), result.satisfied * 100.0, result.missingMips,
+		result.loads, result.evictions, result.thrash, result.maxWait, result.updateMs,
+		result.overBudget ? "  OVER BUDGET" : "", result.consistent ? "" : "  INCONSISTENT");
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <directxmath.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "texturefile.h"
+
+using namespace DirectX;
+
+/*
+	Headless texture tests, run with -texturetest [-out report.txt]. No window and no device, exit code 0 if
+	everything passed and 1 if anything didn't, so a build script can gate on it.
+		- Encoders: a procedural image through every format, single threaded and over the job system, best of
+		  TEXTURE_TEST_PASSES for the throughput, and each one has to come out at TEXTURE_TEST_MIN_PSNR or better.
+		- Residency: TextureResidencyClass fed by a camera flying a circle over a field of textured objects (and turning
+		  round halfway, a cut), frustum culled with the screen size of each object driving its texture's mip. Run once
+		  without a budget to find what the path wants at its peak, then with a tight budget (half of that) and an
+		  ample one (a quarter over). Resident memory must stay under the budget every frame in both, the changes it
+		  reports must add up to what it says is resident, and with the ample budget no texture may wait more than
+		  TEXTURE_TEST_MAX_WAIT frames for its mips once past the start, where everything is wanted at once.
+	The report has throughput and PSNR per format, and for each run how often requests were satisfied, how many mips
+	they were short on average, loads, evictions, thrashing (a mip loaded again within TEXTURE_TEST_THRASH_FRAMES of
+	being evicted) and the longest wait.
+*/
+
+const char* const TEXTURE_TEST_DEFAULT_REPORT = "texture_test.txt";
+const int TEXTURE_TEST_IMAGE_SIZE = 1024;
+const int TEXTURE_TEST_PASSES = 3;
+const double TEXTURE_TEST_MIN_PSNR = 30.0;
+const int TEXTURE_TEST_TEXTURES = 256;
+const int TEXTURE_TEST_OBJECTS = 2000;
+const float TEXTURE_TEST_FIELD_SIZE = 400.0f;
+const int TEXTURE_TEST_FRAMES = 1800;
+const int TEXTURE_TEST_WARMUP = 60; // frames before waits count
+const int TEXTURE_TEST_MAX_WAIT = 30;
+const int TEXTURE_TEST_THRASH_FRAMES = 30;
+const int TEXTURE_TEST_SCREEN_WIDTH = 1920;
+const int TEXTURE_TEST_SCREEN_HEIGHT = 1080;
+
+class TextureTestClass
+{
+private:
+	struct ObjectType
+	{
+		XMFLOAT3 center;
+		float radius;
+		int texture;
+	};
+
+	struct SimulationResultType
+	{
+		unsigned long long budget;
+		unsigned long long peakResident;
+		unsigned long long peakWanted;
+		unsigned long long loads;
+		unsigned long long evictions;
+		unsigned long long thrash;
+		double satisfied; // fraction of requests that had all they asked for, over all frames
+		double missingMips; // per request
+		double updateMs; // per frame
+		int maxWait;
+		bool overBudget;
+		bool consistent;
+	};
+
+public:
+	TextureTestClass();
+	TextureTestClass(const TextureTestClass&);
+	~TextureTestClass();
+
+	// Returns the process exit code, 0 = passed, 1 = failed, 2 = couldn't write the report
+	static int Run(const std::string&);
+
+	bool Initialize();
+	void Shutdown();
+
+	bool TestEncoders(FILE*);
+	bool TestResidency(FILE*);
+
+private:
+	void Simulate(unsigned long long, SimulationResultType&);
+	void WriteResult(FILE*, const char*, const SimulationResultType&);
+
+private:
+	std::vector<TextureFileHeaderType> m_headers;
+	std::vector<ObjectType> m_objects;
+	XMFLOAT4X4 m_projection;
+	float m_pixelScale;
+	unsigned int m_random;
+};
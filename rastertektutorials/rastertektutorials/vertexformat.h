@@ -0,0 +1,155 @@
+#pragma once
+
+#include <d3d11.h>
+#include <utility>
+
+/*
+	Vertex formats as types. An attribute type knows its semantic, DXGI format and size, a VertexFormat is a list
+	of them and works out the stride, every attribute's offset and the D3D11 input layout at compile time.
+	The mesh builder writes vertices with the same offsets, so the layout can't drift from the data.
+	Each format also gets an id from its attribute list, mesh files store it and loaders refuse the wrong one.
+
+		typedef VertexFormat<PositionQuantized, NormalOctahedral, TexcoordHalf> MeshVertexFormat;
+		MeshVertexFormat::stride, MeshVertexFormat::OffsetOf<NormalOctahedral>(), MeshVertexFormat::GetInputLayout()
+*/
+
+// Attributes. id only has to be unique among attributes, it goes into the format id
+
+struct PositionFloat
+{
+	static const unsigned int id = 1;
+	static const unsigned int size = 12;
+	static const DXGI_FORMAT format = DXGI_FORMAT_R32G32B32_FLOAT;
+	static const unsigned int semanticIndex = 0;
+	static constexpr const char* Semantic() { return "POSITION"; }
+};
+
+struct TexcoordFloat
+{
+	static const unsigned int id = 2;
+	static const unsigned int size = 8;
+	static const DXGI_FORMAT format = DXGI_FORMAT_R32G32_FLOAT;
+	static const unsigned int semanticIndex = 0;
+	static constexpr const char* Semantic() { return "TEXCOORD"; }
+};
+
+struct NormalFloat
+{
+	static const unsigned int id = 3;
+	static const unsigned int size = 12;
+	static const DXGI_FORMAT format = DXGI_FORMAT_R32G32B32_FLOAT;
+	static const unsigned int semanticIndex = 0;
+	static constexpr const char* Semantic() { return "NORMAL"; }
+};
+
+// 16 bit unorm xyz (w unused), position = value * scale + bias with the mesh's scale and bias
+struct PositionQuantized
+{
+	static const unsigned int id = 4;
+	static const unsigned int size = 8;
+	static const DXGI_FORMAT format = DXGI_FORMAT_R16G16B16A16_UNORM;
+	static const unsigned int semanticIndex = 0;
+	static constexpr const char* Semantic() { return "POSITION"; }
+};
+
+// Unit vector folded onto an octahedron and flattened to 2D, 16 bit snorm
+struct NormalOctahedral
+{
+	static const unsigned int id = 5;
+	static const unsigned int size = 4;
+	static const DXGI_FORMAT format = DXGI_FORMAT_R16G16_SNORM;
+	static const unsigned int semanticIndex = 0;
+	static constexpr const char* Semantic() { return "NORMAL"; }
+};
+
+struct TexcoordHalf
+{
+	static const unsigned int id = 6;
+	static const unsigned int size = 4;
+	static const DXGI_FORMAT format = DXGI_FORMAT_R16G16_FLOAT;
+	static const unsigned int semanticIndex = 0;
+	static constexpr const char* Semantic() { return "TEXCOORD"; }
+};
+
+// Compile time helpers over attribute lists
+
+template<typename... Attributes> struct AttributeSize;
+template<> struct AttributeSize<>
+{
+	static const unsigned int value = 0;
+};
+template<typename First, typename... Rest> struct AttributeSize<First, Rest...>
+{
+	static const unsigned int value = First::size + AttributeSize<Rest...>::value;
+};
+
+// Offset of the Index'th attribute, the size of everything in front of it
+template<size_t Index, typename... Attributes> struct AttributeOffset;
+template<typename First, typename... Rest> struct AttributeOffset<0, First, Rest...>
+{
+	static const unsigned int value = 0;
+};
+template<size_t Index, typename First, typename... Rest> struct AttributeOffset<Index, First, Rest...>
+{
+	static const unsigned int value = First::size + AttributeOffset<Index - 1, Rest...>::value;
+};
+
+// Position of an attribute type in the list, fails to compile if it isn't in there
+template<typename Attribute, typename... Attributes> struct AttributeIndex;
+template<typename Attribute, typename... Rest> struct AttributeIndex<Attribute, Attribute, Rest...>
+{
+	static const size_t value = 0;
+};
+template<typename Attribute, typename First, typename... Rest> struct AttributeIndex<Attribute, First, Rest...>
+{
+	static const size_t value = 1 + AttributeIndex<Attribute, Rest...>::value;
+};
+
+// FNV-1a over the attribute ids, order matters
+template<typename... Attributes> struct AttributeHash;
+template<> struct AttributeHash<>
+{
+	static const unsigned int value = 2166136261u;
+};
+template<typename First, typename... Rest> struct AttributeHash<First, Rest...>
+{
+	static const unsigned int value = (AttributeHash<Rest...>::value ^ First::id) * 16777619u;
+};
+
+template<typename... Attributes>
+class VertexFormat
+{
+public:
+	static const unsigned int count = sizeof...(Attributes);
+	static const unsigned int stride = AttributeSize<Attributes...>::value;
+	static const unsigned int id = AttributeHash<Attributes...>::value;
+
+	template<typename Attribute>
+	static constexpr unsigned int OffsetOf()
+	{
+		return AttributeOffset<AttributeIndex<Attribute, Attributes...>::value, Attributes...>::value;
+	}
+
+	// Single vertex buffer in slot 0, count elements
+	static const D3D11_INPUT_ELEMENT_DESC* GetInputLayout()
+	{
+		return BuildLayout(std::make_index_sequence<sizeof...(Attributes)>());
+	}
+
+private:
+	template<size_t... Indices>
+	static const D3D11_INPUT_ELEMENT_DESC* BuildLayout(std::index_sequence<Indices...>)
+	{
+		// Every field is a constant so this is filled in by the compiler, not at run time
+		static const D3D11_INPUT_ELEMENT_DESC layout[] =
+		{
+			{ Attributes::Semantic(), Attributes::semanticIndex, Attributes::format, 0, AttributeOffset<Indices, Attributes...>::value, D3D11_INPUT_PER_VERTEX_DATA, 0 }...
+		};
+		return layout;
+	}
+};
+
+// What the model files hold, before the mesh builder gets to it
+typedef VertexFormat<PositionFloat, TexcoordFloat, NormalFloat> SourceVertexFormat;
+// What goes on the gpu
+typedef VertexFormat<PositionQuantized, NormalOctahedral, TexcoordHalf> MeshVertexFormat;